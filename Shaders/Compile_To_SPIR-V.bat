@@ -2,6 +2,15 @@ REM This code assumes that you've added the path to glslc.exe to your path envir
 
 glslc Default.vert -o DefaultVert.spv
 glslc Default.frag -o DefaultFrag.spv
+glslc DefaultBindless.frag -o DefaultBindlessFrag.spv
+glslc GpuDriven.vert -o GpuDrivenVert.spv
+glslc DefaultPacked.vert -o DefaultPackedVert.spv
+glslc GpuDrivenPacked.vert -o GpuDrivenPackedVert.spv
+glslc DepthOnly.vert -o DepthOnlyVert.spv
+glslc DepthOnlyPacked.vert -o DepthOnlyPackedVert.spv
+glslc GpuDrivenDepthOnly.vert -o GpuDrivenDepthOnlyVert.spv
+glslc GpuDrivenDepthOnlyPacked.vert -o GpuDrivenDepthOnlyPackedVert.spv
+glslc CullInstances.comp -o CullInstancesComp.spv
 
 echo Finished Shader Compilation
 PAUSE
\ No newline at end of file
@@ -6,9 +6,36 @@
 layout (location = 0) in vec2 inPosition;
 layout (location = 1) in vec3 inColour;
 
+// both come from the frame data ring (FrameDataRing.h) through dynamic offsets
+layout(std140, set = 0, binding = 0) uniform FrameConstants
+{
+    vec4 cameraPosition; // xy
+} frameConstants;
+
+struct DrawData
+{
+    vec4 positionAndScale; // xy world position, zw scale
+    float depth; // 0 is nearest
+    uint materialBuffer; // bindless storage buffer handle, see DefaultBindless.frag
+    uint material;
+    float padding;
+};
+
+// a block of draws per bind, each draw's firstInstance is its index in the block
+layout(std430, set = 0, binding = 1) readonly buffer DrawConstants
+{
+    DrawData draws[];
+} drawConstants;
+
 layout(location = 0) out vec3 VertOutFragColour;
+layout(location = 1) flat out uvec2 VertOutMaterial; // only DefaultBindless.frag reads it
+
+// has to match the depth pre-pass exactly for its depth test to pass, see DepthOnly.vert
+invariant gl_Position;
 
 void main() {
-    gl_Position = vec4(inPosition, 0.0, 1.0);
+    DrawData draw = drawConstants.draws[gl_InstanceIndex];
+    gl_Position = vec4(inPosition * draw.positionAndScale.zw + draw.positionAndScale.xy - frameConstants.cameraPosition.xy, draw.depth, 1.0);
+    VertOutMaterial = uvec2(draw.materialBuffer, draw.material);
     VertOutFragColour = inColour;
 }
\ No newline at end of file
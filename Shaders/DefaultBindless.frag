@@ -0,0 +1,27 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : require
+
+// Default.frag tinted by the draw's material, read through the bindless table (BindlessResourceTable.h) so it's only used when that's enabled
+
+layout(location = 0) in vec3 VertOutFragColour;
+layout(location = 1) flat in uvec2 VertOutMaterial; // x the material table's storage buffer handle, y the material in it
+
+struct MaterialData
+{
+    vec4 tint;
+};
+
+// BindlessResourceTable::S_SET, S_STORAGE_BUFFER_BINDING
+layout(std430, set = 1, binding = 1) readonly buffer MaterialTable
+{
+    MaterialData materials[];
+} bindlessBuffers[];
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    // fragments from different draws can end up sharing a subgroup, so the handle can't be assumed uniform
+    MaterialData material = bindlessBuffers[nonuniformEXT(VertOutMaterial.x)].materials[VertOutMaterial.y];
+    outColor = vec4(VertOutFragColour * material.tint.rgb, 1.0);
+}
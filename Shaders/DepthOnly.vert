@@ -0,0 +1,34 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Default.vert for the depth pre-pass, reads the position stream and nothing else and there's no fragment shader.
+// gl_Position has to come out bit for bit the same as Default.vert's so the scene pass's depth test passes, hence the
+// same sums in the same order and invariant
+
+layout (location = 0) in vec2 inPosition;
+
+layout(std140, set = 0, binding = 0) uniform FrameConstants
+{
+    vec4 cameraPosition; // xy
+} frameConstants;
+
+struct DrawData
+{
+    vec4 positionAndScale; // xy world position, zw scale
+    float depth; // 0 is nearest
+    uint materialBuffer; // bindless storage buffer handle, see DefaultBindless.frag
+    uint material;
+    float padding;
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer DrawConstants
+{
+    DrawData draws[];
+} drawConstants;
+
+invariant gl_Position;
+
+void main() {
+    DrawData draw = drawConstants.draws[gl_InstanceIndex];
+    gl_Position = vec4(inPosition * draw.positionAndScale.zw + draw.positionAndScale.xy - frameConstants.cameraPosition.xy, draw.depth, 1.0);
+}
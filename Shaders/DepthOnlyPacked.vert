@@ -0,0 +1,35 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// DepthOnly.vert for PackedVertex, has to match DefaultPacked.vert's gl_Position exactly
+
+layout (location = 0) in vec2 inPosition; // R16G16_SNORM
+
+layout(std140, set = 0, binding = 0) uniform FrameConstants
+{
+    vec4 cameraPosition; // xy
+} frameConstants;
+
+struct DrawData
+{
+    vec4 positionAndScale; // xy world position, zw scale
+    float depth; // 0 is nearest
+    uint materialBuffer; // bindless storage buffer handle, see DefaultBindless.frag
+    uint material;
+    float padding;
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer DrawConstants
+{
+    DrawData draws[];
+} drawConstants;
+
+invariant gl_Position;
+
+const float POSITION_SCALE = 2.0; // PackedVertex::S_POSITION_SCALE
+
+void main() {
+    vec2 position = inPosition / POSITION_SCALE;
+    DrawData draw = drawConstants.draws[gl_InstanceIndex];
+    gl_Position = vec4(position * draw.positionAndScale.zw + draw.positionAndScale.xy - frameConstants.cameraPosition.xy, draw.depth, 1.0);
+}
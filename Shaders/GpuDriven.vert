@@ -0,0 +1,38 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Default.vert with the per draw offset and scale coming from the instance buffer rather than push constants,
+// firstInstance in each indirect draw is the instance so gl_InstanceIndex indexes straight into it
+
+layout (location = 0) in vec2 inPosition;
+layout (location = 1) in vec3 inColour;
+
+struct InstanceData
+{
+    vec4 boundsCentreAndRadius;
+    vec3 boundsExtents;
+    uint meshHandle;
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer Instances
+{
+    InstanceData instances[];
+};
+
+layout(push_constant) uniform DrawConstants
+{
+    vec4 cameraPosition; // xy
+} drawConstants;
+
+layout(location = 0) out vec3 VertOutFragColour;
+
+// has to match the depth pre-pass exactly for its depth test to pass, see GpuDrivenDepthOnly.vert
+invariant gl_Position;
+
+void main() {
+    InstanceData instance = instances[gl_InstanceIndex];
+    vec2 offset = instance.boundsCentreAndRadius.xy - drawConstants.cameraPosition.xy;
+    vec2 scale = instance.boundsExtents.xy * 2.0; // the mesh spans -0.5 to 0.5
+    gl_Position = vec4(inPosition * scale + offset, instance.boundsCentreAndRadius.z, 1.0); // the instance's z is its depth
+    VertOutFragColour = inColour;
+}
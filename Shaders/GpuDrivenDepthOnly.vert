@@ -0,0 +1,32 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// GpuDriven.vert for the depth pre-pass, only the position stream and has to match its gl_Position exactly
+
+layout (location = 0) in vec2 inPosition;
+
+struct InstanceData
+{
+    vec4 boundsCentreAndRadius;
+    vec3 boundsExtents;
+    uint meshHandle;
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer Instances
+{
+    InstanceData instances[];
+};
+
+layout(push_constant) uniform DrawConstants
+{
+    vec4 cameraPosition; // xy
+} drawConstants;
+
+invariant gl_Position;
+
+void main() {
+    InstanceData instance = instances[gl_InstanceIndex];
+    vec2 offset = instance.boundsCentreAndRadius.xy - drawConstants.cameraPosition.xy;
+    vec2 scale = instance.boundsExtents.xy * 2.0; // the mesh spans -0.5 to 0.5
+    gl_Position = vec4(inPosition * scale + offset, instance.boundsCentreAndRadius.z, 1.0);
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+
+// rounds value up to the next multiple of alignment, which doesn't have to be a power of two (0 or 1 leaves it alone).
+// No Vulkan in here so the CPU side containers can share it, VkDeviceSize is a uint64_t anyway
+inline uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+	return alignment > 1 ? ((value + alignment - 1) / alignment) * alignment : value;
+}
@@ -0,0 +1,572 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+#include <system_error>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#ifdef _WINDOWS
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif // _WINDOWS
+
+#include "Alignment.h"
+#include "PipelineCache.h" // HashBytesFnv1a
+
+// Read only view of a whole file, pages come in from the OS file cache on first touch rather than being read up front
+class MappedFile
+{
+public:
+	MappedFile()
+		: m_data(nullptr)
+		, m_size(0)
+#ifdef _WINDOWS
+		, m_file(INVALID_HANDLE_VALUE)
+		, m_mapping(nullptr)
+#else
+		, m_file(-1)
+#endif // _WINDOWS
+	{}
+
+	~MappedFile() { Close(); }
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const std::string& path)
+	{
+		Close();
+#ifdef _WINDOWS
+		m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		LARGE_INTEGER fileSize = {};
+		if (m_file == INVALID_HANDLE_VALUE || !GetFileSizeEx(m_file, &fileSize) || fileSize.QuadPart == 0)
+		{
+			Close();
+			return false;
+		}
+		m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		m_data = m_mapping ? static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+		m_size = static_cast<size_t>(fileSize.QuadPart);
+#else
+		m_file = open(path.c_str(), O_RDONLY);
+		struct stat fileStat = {};
+		if (m_file < 0 || fstat(m_file, &fileStat) != 0 || fileStat.st_size == 0)
+		{
+			Close();
+			return false;
+		}
+		void* mapping = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, m_file, 0);
+		m_data = mapping != MAP_FAILED ? static_cast<const uint8_t*>(mapping) : nullptr;
+		m_size = static_cast<size_t>(fileStat.st_size);
+#endif // _WINDOWS
+		if (!m_data)
+		{
+			Close();
+			return false;
+		}
+		return true;
+	}
+
+	void Close()
+	{
+#ifdef _WINDOWS
+		if (m_data)
+		{
+			UnmapViewOfFile(m_data);
+		}
+		if (m_mapping)
+		{
+			CloseHandle(m_mapping);
+			m_mapping = nullptr;
+		}
+		if (m_file != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(m_file);
+			m_file = INVALID_HANDLE_VALUE;
+		}
+#else
+		if (m_data)
+		{
+			munmap(const_cast<uint8_t*>(m_data), m_size);
+		}
+		if (m_file >= 0)
+		{
+			close(m_file);
+			m_file = -1;
+		}
+#endif // _WINDOWS
+		m_data = nullptr;
+		m_size = 0;
+	}
+
+	const uint8_t* GetData() const { return m_data; }
+	size_t GetSize() const { return m_size; }
+	bool IsOpen() const { return m_data != nullptr; }
+
+private:
+	const uint8_t* m_data;
+	size_t m_size;
+#ifdef _WINDOWS
+	HANDLE m_file;
+	HANDLE m_mapping;
+#else
+	int m_file;
+#endif // _WINDOWS
+};
+
+enum class AssetChunkType : uint32_t
+{
+	Mesh = 1,
+	Texture = 2,
+	Shader = 3,
+};
+
+// Package layout, everything little endian and every chunk starting on an S_CHUNK_ALIGNMENT boundary:
+//	AssetPackageHeader
+//	chunks...
+//	AssetTocEntry[m_chunkCount]
+// The table of contents is hashed in the header and each chunk's bytes are hashed in its entry. Opening only reads the
+// header and TOC, a chunk is checked the first time it's used, so a big package doesn't get paged in just to be opened.
+struct AssetPackageHeader
+{
+	uint32_t m_magic;
+	uint32_t m_fileVersion;
+	uint32_t m_chunkCount;
+	uint32_t m_padding;
+	uint64_t m_tocOffset;
+	uint64_t m_tocHash;
+};
+
+struct AssetTocEntry
+{
+	char m_name[48]; // null terminated
+	AssetChunkType m_type;
+	uint32_t m_padding;
+	uint64_t m_offset; // from the start of the file
+	uint64_t m_size;
+	uint64_t m_hash;
+};
+
+// a Mesh chunk starts with this, vertex and index data follow at the given offsets from the start of the chunk
+struct MeshChunkHeader
+{
+	uint32_t m_vertexStride;
+	uint32_t m_vertexCount;
+	uint32_t m_indexCount;
+	uint32_t m_indexSize; // 2 or 4
+	uint64_t m_vertexDataOffset;
+	uint64_t m_indexDataOffset;
+};
+
+// a Texture chunk starts with this, mip 0 first then each smaller level tightly packed
+struct TextureChunkHeader
+{
+	uint32_t m_width;
+	uint32_t m_height;
+	VkFormat m_format;
+	uint32_t m_mipLevels;
+	uint64_t m_dataOffset;
+	uint64_t m_dataSize;
+};
+
+static_assert(sizeof(AssetPackageHeader) == 32 && sizeof(AssetTocEntry) == 80 && sizeof(MeshChunkHeader) == 32 && sizeof(TextureChunkHeader) == 32,
+	"Package structs are written straight to disk, their layout mustn't change");
+
+// pointers straight into the mapping, valid while the package stays open
+struct PackagedMesh
+{
+	const MeshChunkHeader* m_header;
+	const void* m_vertices;
+	const void* m_indices;
+
+	VkIndexType GetIndexType() const { return m_header->m_indexSize == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32; }
+};
+
+struct PackagedTexture
+{
+	const TextureChunkHeader* m_header;
+	const void* m_data;
+};
+
+struct PackagedBlob
+{
+	const void* m_data;
+	size_t m_size;
+};
+
+static constexpr uint32_t S_ASSET_PACKAGE_MAGIC = 0x4B505645; // "EVPK"
+static constexpr uint32_t S_ASSET_PACKAGE_VERSION = 1;
+static constexpr uint64_t S_ASSET_PACKAGE_CHUNK_ALIGNMENT = 64;
+
+// A package opened with mmap. Meshes and textures come back as pointers into the mapping so they can go straight into
+// staging memory (UploadManager::UploadToBuffer() copies from wherever it's given) without being read or parsed into
+// anything in between. Anything malformed throws. Once Open() has returned the Find functions are safe to call from several
+// threads at once (startup loads shaders and meshes in parallel), a corrupt chunk throws without closing the package under them.
+class AssetPackage
+{
+public:
+	void Open(const std::string& path)
+	{
+		if (!m_file.Open(path))
+		{
+			throw std::runtime_error("Failed to map asset package " + path);
+		}
+		m_path = path;
+
+		AssetPackageHeader header = {};
+		if (m_file.GetSize() < sizeof(header))
+		{
+			Reject("truncated header");
+		}
+		std::memcpy(&header, m_file.GetData(), sizeof(header));
+		if (header.m_magic != S_ASSET_PACKAGE_MAGIC || header.m_fileVersion != S_ASSET_PACKAGE_VERSION)
+		{
+			Reject("unknown file format");
+		}
+		const uint64_t tocSize = static_cast<uint64_t>(header.m_chunkCount) * sizeof(AssetTocEntry);
+		if (header.m_tocOffset % alignof(AssetTocEntry) != 0 || header.m_tocOffset > m_file.GetSize() || tocSize > m_file.GetSize() - header.m_tocOffset)
+		{
+			Reject("table of contents out of bounds");
+		}
+		if (HashBytesFnv1a(m_file.GetData() + header.m_tocOffset, static_cast<size_t>(tocSize)) != header.m_tocHash)
+		{
+			Reject("table of contents checksum mismatch");
+		}
+
+		m_toc = reinterpret_cast<const AssetTocEntry*>(m_file.GetData() + header.m_tocOffset);
+		m_chunkCount = header.m_chunkCount;
+		m_chunkVerified = std::make_unique<std::atomic<bool>[]>(m_chunkCount);
+		for (uint32_t i = 0; i < m_chunkCount; ++i)
+		{
+			m_chunkVerified[i].store(false, std::memory_order_relaxed);
+		}
+		for (uint32_t i = 0; i < m_chunkCount; ++i)
+		{
+			const AssetTocEntry& entry = m_toc[i];
+			if (entry.m_offset % S_ASSET_PACKAGE_CHUNK_ALIGNMENT != 0 || entry.m_offset > header.m_tocOffset || entry.m_size > header.m_tocOffset - entry.m_offset
+				|| std::memchr(entry.m_name, 0, sizeof(entry.m_name)) == nullptr)
+			{
+				Reject("chunk " + std::to_string(i) + " out of bounds");
+			}
+		}
+		std::cout << "Opened asset package " << path << ": " << m_chunkCount << " chunks, " << m_file.GetSize() << " bytes mapped" << std::endl;
+	}
+
+	void Close()
+	{
+		m_file.Close();
+		m_toc = nullptr;
+		m_chunkCount = 0;
+		m_chunkVerified.reset();
+	}
+
+	bool IsOpen() const { return m_file.IsOpen(); }
+
+	const AssetTocEntry* FindChunk(const std::string& name, AssetChunkType type) const
+	{
+		for (uint32_t i = 0; i < m_chunkCount; ++i)
+		{
+			if (m_toc[i].m_type == type && name == m_toc[i].m_name)
+			{
+				return &m_toc[i];
+			}
+		}
+		return nullptr;
+	}
+
+	// nullptr/empty results when the package doesn't have it, throws when it has it but it's corrupt
+	bool FindMesh(const std::string& name, PackagedMesh& meshOut)
+	{
+		const AssetTocEntry* entry = FindChunk(name, AssetChunkType::Mesh);
+		if (!entry)
+		{
+			return false;
+		}
+		if (!ParseMeshChunk(GetChunkData(*entry), entry->m_size, meshOut))
+		{
+			RejectChunk(name + " mesh data out of bounds");
+		}
+		return true;
+	}
+
+	// for a mesh chunk that's been copied out of the package (or built with AssetPackageWriter::BuildMeshChunk()), false if it's malformed
+	static bool ParseMeshChunk(const uint8_t* chunk, uint64_t chunkSize, PackagedMesh& meshOut)
+	{
+		if (chunkSize < sizeof(MeshChunkHeader))
+		{
+			return false;
+		}
+		meshOut.m_header = reinterpret_cast<const MeshChunkHeader*>(chunk);
+		const MeshChunkHeader& mesh = *meshOut.m_header;
+		if ((mesh.m_indexSize != sizeof(uint16_t) && mesh.m_indexSize != sizeof(uint32_t))
+			|| !InRange(chunkSize, mesh.m_vertexDataOffset, static_cast<uint64_t>(mesh.m_vertexCount) * mesh.m_vertexStride)
+			|| !InRange(chunkSize, mesh.m_indexDataOffset, static_cast<uint64_t>(mesh.m_indexCount) * mesh.m_indexSize))
+		{
+			return false;
+		}
+		meshOut.m_vertices = chunk + mesh.m_vertexDataOffset;
+		meshOut.m_indices = chunk + mesh.m_indexDataOffset;
+		return true;
+	}
+
+	// just the header, unchecked, for sizing things before the mesh itself is loaded
+	bool PeekMeshHeader(const std::string& name, MeshChunkHeader& headerOut) const
+	{
+		const AssetTocEntry* entry = FindChunk(name, AssetChunkType::Mesh);
+		if (!entry || entry->m_size < sizeof(MeshChunkHeader))
+		{
+			return false;
+		}
+		std::memcpy(&headerOut, m_file.GetData() + entry->m_offset, sizeof(headerOut));
+		return true;
+	}
+
+	// the chunk's bytes without checking them, safe from any thread. For streaming, which checks them with VerifyChunk() off the main thread
+	PackagedBlob GetUncheckedChunk(const AssetTocEntry& entry) const
+	{
+		return { m_file.GetData() + entry.m_offset, static_cast<size_t>(entry.m_size) };
+	}
+
+	static bool VerifyChunk(const AssetTocEntry& entry, const void* data, size_t size)
+	{
+		return size == entry.m_size && HashBytesFnv1a(data, size) == entry.m_hash;
+	}
+
+	bool FindTexture(const std::string& name, PackagedTexture& textureOut)
+	{
+		const AssetTocEntry* entry = FindChunk(name, AssetChunkType::Texture);
+		if (!entry)
+		{
+			return false;
+		}
+		const uint8_t* chunk = GetChunkData(*entry);
+		if (entry->m_size < sizeof(TextureChunkHeader))
+		{
+			RejectChunk(name + " truncated texture header");
+		}
+		textureOut.m_header = reinterpret_cast<const TextureChunkHeader*>(chunk);
+		if (!InRange(entry->m_size, textureOut.m_header->m_dataOffset, textureOut.m_header->m_dataSize))
+		{
+			RejectChunk(name + " texture data out of bounds");
+		}
+		textureOut.m_data = chunk + textureOut.m_header->m_dataOffset;
+		return true;
+	}
+
+	bool FindShader(const std::string& name, PackagedBlob& shaderOut)
+	{
+		const AssetTocEntry* entry = FindChunk(name, AssetChunkType::Shader);
+		if (!entry)
+		{
+			return false;
+		}
+		shaderOut.m_data = GetChunkData(*entry);
+		shaderOut.m_size = static_cast<size_t>(entry->m_size);
+		return true;
+	}
+
+private:
+	// checks the chunk's hash the first time it's asked for, which is also what pages it in. Two threads asking at once both check it
+	const uint8_t* GetChunkData(const AssetTocEntry& entry)
+	{
+		const uint8_t* chunk = m_file.GetData() + entry.m_offset;
+		const size_t chunkIndex = static_cast<size_t>(&entry - m_toc);
+		if (!m_chunkVerified[chunkIndex].load(std::memory_order_acquire))
+		{
+			if (!VerifyChunk(entry, chunk, static_cast<size_t>(entry.m_size)))
+			{
+				RejectChunk(std::string(entry.m_name) + " checksum mismatch");
+			}
+			m_chunkVerified[chunkIndex].store(true, std::memory_order_release);
+		}
+		return chunk;
+	}
+
+	static bool InRange(uint64_t chunkSize, uint64_t offset, uint64_t size)
+	{
+		return offset <= chunkSize && size <= chunkSize - offset;
+	}
+
+	[[noreturn]] void Reject(const std::string& reason)
+	{
+		const std::string path = m_path;
+		Close();
+		throw std::runtime_error("Asset package " + path + " rejected: " + reason);
+	}
+
+	// the rest of the package is still fine, and other threads may be reading it
+	[[noreturn]] void RejectChunk(const std::string& reason) const
+	{
+		throw std::runtime_error("Asset package " + m_path + ": " + reason);
+	}
+
+	MappedFile m_file;
+	std::string m_path;
+	const AssetTocEntry* m_toc = nullptr;
+	uint32_t m_chunkCount = 0;
+	std::unique_ptr<std::atomic<bool>[]> m_chunkVerified;
+};
+
+// Builds a package in memory and writes it out in one go (temp file then rename, like the pipeline cache).
+// For our own tools and the --write-package option, not the load path.
+class AssetPackageWriter
+{
+public:
+	// indices are narrowed to 16 bit when indexSize is 2
+	void AddMesh(const std::string& name, const void* vertices, uint32_t vertexStride, uint32_t nVertices, const std::vector<uint32_t>& indices, uint32_t indexSize)
+	{
+		AddChunk(name, AssetChunkType::Mesh, BuildMeshChunk(vertices, vertexStride, nVertices, indices, indexSize));
+	}
+
+	// a mesh chunk as it'd be in the package, also what the streamer hands around for meshes that are generated rather than loaded
+	static std::vector<uint8_t> BuildMeshChunk(const void* vertices, uint32_t vertexStride, uint32_t nVertices, const std::vector<uint32_t>& indices, uint32_t indexSize)
+	{
+		if (indexSize != sizeof(uint16_t) && indexSize != sizeof(uint32_t))
+		{
+			throw std::runtime_error("Packaged meshes need 16 or 32 bit indices");
+		}
+		MeshChunkHeader mesh = {};
+		mesh.m_vertexStride = vertexStride;
+		mesh.m_vertexCount = nVertices;
+		mesh.m_indexCount = static_cast<uint32_t>(indices.size());
+		mesh.m_indexSize = indexSize;
+		mesh.m_vertexDataOffset = AlignUp(sizeof(MeshChunkHeader), 16);
+		mesh.m_indexDataOffset = AlignUp(mesh.m_vertexDataOffset + static_cast<uint64_t>(nVertices) * vertexStride, 16);
+
+		std::vector<uint8_t> chunk(static_cast<size_t>(mesh.m_indexDataOffset + static_cast<uint64_t>(indices.size()) * indexSize), 0);
+		std::memcpy(chunk.data(), &mesh, sizeof(mesh));
+		std::memcpy(chunk.data() + mesh.m_vertexDataOffset, vertices, static_cast<size_t>(nVertices) * vertexStride);
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			if (indexSize == sizeof(uint16_t))
+			{
+				if (indices[i] > UINT16_MAX)
+				{
+					throw std::runtime_error("Mesh index doesn't fit in 16 bits");
+				}
+				const uint16_t index = static_cast<uint16_t>(indices[i]);
+				std::memcpy(chunk.data() + mesh.m_indexDataOffset + i * sizeof(index), &index, sizeof(index));
+			}
+			else
+			{
+				std::memcpy(chunk.data() + mesh.m_indexDataOffset + i * sizeof(uint32_t), &indices[i], sizeof(uint32_t));
+			}
+		}
+		return chunk;
+	}
+
+	void AddTexture(const std::string& name, uint32_t width, uint32_t height, VkFormat format, uint32_t mipLevels, const void* data, size_t dataSize)
+	{
+		TextureChunkHeader texture = {};
+		texture.m_width = width;
+		texture.m_height = height;
+		texture.m_format = format;
+		texture.m_mipLevels = mipLevels;
+		texture.m_dataOffset = AlignUp(sizeof(TextureChunkHeader), 16);
+		texture.m_dataSize = dataSize;
+
+		std::vector<uint8_t> chunk(static_cast<size_t>(texture.m_dataOffset + dataSize), 0);
+		std::memcpy(chunk.data(), &texture, sizeof(texture));
+		std::memcpy(chunk.data() + texture.m_dataOffset, data, dataSize);
+		AddChunk(name, AssetChunkType::Texture, std::move(chunk));
+	}
+
+	void AddShader(const std::string& name, const std::vector<uint32_t>& spirv)
+	{
+		const uint8_t* spirvBytes = reinterpret_cast<const uint8_t*>(spirv.data());
+		AddChunk(name, AssetChunkType::Shader, std::vector<uint8_t>(spirvBytes, spirvBytes + spirv.size() * sizeof(uint32_t)));
+	}
+
+	void Write(const std::string& path) const
+	{
+		AssetPackageHeader header = {};
+		header.m_magic = S_ASSET_PACKAGE_MAGIC;
+		header.m_fileVersion = S_ASSET_PACKAGE_VERSION;
+		header.m_chunkCount = static_cast<uint32_t>(m_chunks.size());
+
+		std::vector<AssetTocEntry> toc(m_chunks.size());
+		uint64_t offset = AlignUp(sizeof(header), S_ASSET_PACKAGE_CHUNK_ALIGNMENT);
+		for (size_t i = 0; i < m_chunks.size(); ++i)
+		{
+			toc[i] = m_chunks[i].m_entry;
+			toc[i].m_offset = offset;
+			offset = AlignUp(offset + toc[i].m_size, S_ASSET_PACKAGE_CHUNK_ALIGNMENT);
+		}
+		header.m_tocOffset = offset;
+		header.m_tocHash = HashBytesFnv1a(toc.data(), toc.size() * sizeof(AssetTocEntry));
+
+		const std::string tempPath = path + ".tmp";
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+			{
+				throw std::runtime_error("Failed to open " + tempPath + " to write the asset package");
+			}
+			const char padding[S_ASSET_PACKAGE_CHUNK_ALIGNMENT] = {};
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			uint64_t written = sizeof(header);
+			for (size_t i = 0; i < m_chunks.size(); ++i)
+			{
+				file.write(padding, static_cast<std::streamsize>(toc[i].m_offset - written));
+				file.write(reinterpret_cast<const char*>(m_chunks[i].m_data.data()), static_cast<std::streamsize>(m_chunks[i].m_data.size()));
+				written = toc[i].m_offset + toc[i].m_size;
+			}
+			file.write(padding, static_cast<std::streamsize>(header.m_tocOffset - written));
+			file.write(reinterpret_cast<const char*>(toc.data()), static_cast<std::streamsize>(toc.size() * sizeof(AssetTocEntry)));
+			file.flush();
+			if (!file)
+			{
+				file.close();
+				std::error_code ignored;
+				std::filesystem::remove(tempPath, ignored);
+				throw std::runtime_error("Failed to write the asset package to " + tempPath);
+			}
+		}
+
+		std::error_code renameError;
+		std::filesystem::rename(tempPath, path, renameError);
+		if (renameError)
+		{
+			std::error_code ignored;
+			std::filesystem::remove(tempPath, ignored);
+			throw std::runtime_error("Failed to replace " + path + ": " + renameError.message());
+		}
+	}
+
+private:
+	struct Chunk
+	{
+		AssetTocEntry m_entry;
+		std::vector<uint8_t> m_data;
+	};
+
+	void AddChunk(const std::string& name, AssetChunkType type, std::vector<uint8_t> data)
+	{
+		Chunk chunk = {};
+		if (name.size() >= sizeof(chunk.m_entry.m_name))
+		{
+			throw std::runtime_error("Asset name too long for the package: " + name);
+		}
+		std::memcpy(chunk.m_entry.m_name, name.c_str(), name.size() + 1);
+		chunk.m_entry.m_type = type;
+		chunk.m_entry.m_size = data.size();
+		chunk.m_entry.m_hash = HashBytesFnv1a(data.data(), data.size());
+		chunk.m_data = std::move(data);
+		m_chunks.push_back(std::move(chunk));
+	}
+
+	std::vector<Chunk> m_chunks;
+};
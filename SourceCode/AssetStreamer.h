@@ -0,0 +1,304 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <iostream>
+#include <cstdint>
+
+enum class AssetResidency : uint32_t
+{
+	NotRequested,
+	Queued, // waiting for an I/O thread
+	Reading,
+	Read, // waiting for a decode thread
+	Decoding,
+	Decoded, // waiting for upload budget
+	Uploading, // partly uploaded, carries on next frame
+	Resident,
+	Failed,
+};
+
+// what the streaming queues are sorted on, roughly the size on screen: bigger and closer goes first
+inline float ComputeStreamingPriority(float boundsRadius, float distanceToCamera)
+{
+	return boundsRadius / (std::max)(distanceToCamera, (std::max)(boundsRadius, 1e-6f));
+}
+
+// Loads assets in the background in three stages:
+//	I/O threads run the read function (file reads, or faulting in pages of a mapped package)
+//	decode threads run the decode function (decompression, mesh processing, anything CPU heavy)
+//	ProcessUploads() on the main thread runs the upload function, never going over the per frame byte budget by more than it has to
+// Each queue is a priority heap, Request() again with a new priority reorders anything that hasn't started that stage yet.
+// GetResidency() can be called from any thread, once it says Resident everything the upload function did is visible to the caller.
+// The decode stage has its own threads rather than going through the JobSystem so a long decode can't end up running inside
+// a frame's Wait() and stall it.
+class AssetStreamer
+{
+public:
+	using ReadFunction = std::function<void(uint32_t assetId, std::vector<uint8_t>& dataOut)>;
+	using DecodeFunction = std::function<void(uint32_t assetId, std::vector<uint8_t>& data)>; // in place
+	// uploads data from offset on, at most maxBytes unless a single piece is bigger, and returns how many bytes that covered.
+	// The asset is resident once the offsets reach data.size()
+	using UploadFunction = std::function<uint64_t(uint32_t assetId, const std::vector<uint8_t>& data, uint64_t offset, uint64_t maxBytes)>;
+
+	static constexpr uint64_t S_DEFAULT_UPLOAD_BUDGET_PER_FRAME = 4ull * 1024 * 1024;
+
+	AssetStreamer()
+		: m_nAssets(0)
+		, m_uploadBudgetPerFrame(S_DEFAULT_UPLOAD_BUDGET_PER_FRAME)
+		, m_stopThreads(false)
+		, m_uploadingAsset(S_NO_ASSET)
+		, m_uploadOffset(0)
+		, m_bytesUploaded(0)
+		, m_bytesUploadedLastFrame(0)
+		, m_nResident(0)
+	{}
+
+	AssetStreamer(const AssetStreamer&) = delete;
+	AssetStreamer& operator=(const AssetStreamer&) = delete;
+
+	~AssetStreamer()
+	{
+		Shutdown();
+	}
+
+	void Init(uint32_t nAssets, uint32_t nIoThreads, uint32_t nDecodeThreads, uint64_t uploadBudgetPerFrame, ReadFunction read, DecodeFunction decode, UploadFunction upload)
+	{
+		m_nAssets = nAssets;
+		m_uploadBudgetPerFrame = (std::max)(uploadBudgetPerFrame, uint64_t(1));
+		m_read = std::move(read);
+		m_decode = std::move(decode);
+		m_upload = std::move(upload);
+
+		m_residency = std::make_unique<std::atomic<AssetResidency>[]>(nAssets);
+		for (uint32_t i = 0; i < nAssets; ++i)
+		{
+			m_residency[i].store(AssetResidency::NotRequested, std::memory_order_relaxed);
+		}
+		m_priorities.assign(nAssets, 0.0f);
+		m_generations.assign(nAssets, 0);
+		m_data.assign(nAssets, std::vector<uint8_t>());
+
+		m_stopThreads = false;
+		for (uint32_t i = 0; i < (std::max)(nIoThreads, 1u); ++i)
+		{
+			m_threads.emplace_back(&AssetStreamer::StageThreadMain, this, AssetResidency::Queued);
+		}
+		for (uint32_t i = 0; i < (std::max)(nDecodeThreads, 1u); ++i)
+		{
+			m_threads.emplace_back(&AssetStreamer::StageThreadMain, this, AssetResidency::Read);
+		}
+	}
+
+	// anything still reading or decoding finishes that first, anything waiting is dropped
+	void Shutdown()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stopThreads = true;
+		}
+		m_readQueueChanged.notify_all();
+		m_decodeQueueChanged.notify_all();
+		for (std::thread& thread : m_threads)
+		{
+			thread.join();
+		}
+		m_threads.clear();
+		m_readQueue.clear();
+		m_decodeQueue.clear();
+		m_readyToUpload.clear();
+		m_data.clear();
+		m_uploadingAsset = S_NO_ASSET;
+	}
+
+	// any thread. Queues the asset if it's not been asked for yet, otherwise updates its priority for whichever queue it's in
+	void Request(uint32_t assetId, float priority)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_priorities[assetId] = priority;
+		const AssetResidency residency = m_residency[assetId].load(std::memory_order_relaxed);
+		if (residency == AssetResidency::NotRequested)
+		{
+			m_residency[assetId].store(AssetResidency::Queued, std::memory_order_relaxed);
+		}
+		else if (residency != AssetResidency::Queued && residency != AssetResidency::Read)
+		{
+			return; // already being worked on, or the upload queue which is sorted when it's used
+		}
+
+		// the old heap entry goes stale rather than being dug out of the heap
+		std::vector<PendingAsset>& queue = residency == AssetResidency::Read ? m_decodeQueue : m_readQueue;
+		queue.push_back({ priority, assetId, ++m_generations[assetId] });
+		std::push_heap(queue.begin(), queue.end());
+		lock.unlock();
+		(residency == AssetResidency::Read ? m_decodeQueueChanged : m_readQueueChanged).notify_one();
+	}
+
+	AssetResidency GetResidency(uint32_t assetId) const { return m_residency[assetId].load(std::memory_order_acquire); }
+	bool IsResident(uint32_t assetId) const { return GetResidency(assetId) == AssetResidency::Resident; }
+
+	// main thread, once a frame before the UploadManager's Flush(). Carries on with a part uploaded asset first, then takes
+	// decoded assets highest priority first until the budget's gone
+	void ProcessUploads()
+	{
+		uint64_t budget = m_uploadBudgetPerFrame;
+		m_bytesUploadedLastFrame = 0;
+		while (budget > 0)
+		{
+			if (m_uploadingAsset == S_NO_ASSET && !TakeHighestPriorityDecoded())
+			{
+				break;
+			}
+
+			const std::vector<uint8_t>& data = m_data[m_uploadingAsset];
+			const uint64_t uploaded = data.empty() ? 0 : m_upload(m_uploadingAsset, data, m_uploadOffset, budget);
+			if (uploaded == 0 && !data.empty())
+			{
+				throw std::runtime_error("Streaming upload made no progress");
+			}
+			m_uploadOffset += uploaded;
+			m_bytesUploadedLastFrame += uploaded;
+			budget -= (std::min)(uploaded, budget);
+
+			if (m_uploadOffset >= data.size())
+			{
+				std::vector<uint8_t>().swap(m_data[m_uploadingAsset]);
+				m_residency[m_uploadingAsset].store(AssetResidency::Resident, std::memory_order_release);
+				m_uploadingAsset = S_NO_ASSET;
+				++m_nResident;
+			}
+		}
+		m_bytesUploaded += m_bytesUploadedLastFrame;
+	}
+
+	uint64_t GetBytesUploaded() const { return m_bytesUploaded; }
+	uint64_t GetBytesUploadedLastFrame() const { return m_bytesUploadedLastFrame; }
+	uint32_t GetResidentCount() const { return m_nResident; }
+
+private:
+	struct PendingAsset
+	{
+		float m_priority;
+		uint32_t m_assetId;
+		uint32_t m_generation;
+
+		bool operator<(const PendingAsset& other) const { return m_priority < other.m_priority; }
+	};
+
+	static constexpr uint32_t S_NO_ASSET = UINT32_MAX;
+
+	bool TakeHighestPriorityDecoded()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_readyToUpload.empty())
+		{
+			return false;
+		}
+		auto highest = std::max_element(m_readyToUpload.begin(), m_readyToUpload.end(), [this](uint32_t a, uint32_t b) { return m_priorities[a] < m_priorities[b]; });
+		m_uploadingAsset = *highest;
+		m_uploadOffset = 0;
+		m_readyToUpload.erase(highest);
+		m_residency[m_uploadingAsset].store(AssetResidency::Uploading, std::memory_order_relaxed);
+		return true;
+	}
+
+	// an I/O thread when waitingState is Queued, a decode thread when it's Read
+	void StageThreadMain(AssetResidency waitingState)
+	{
+		const bool isReadStage = waitingState == AssetResidency::Queued;
+		std::vector<PendingAsset>& queue = isReadStage ? m_readQueue : m_decodeQueue;
+		std::condition_variable& queueChanged = isReadStage ? m_readQueueChanged : m_decodeQueueChanged;
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		for (;;)
+		{
+			queueChanged.wait(lock, [this, &queue]() { return m_stopThreads || !queue.empty(); });
+			if (m_stopThreads)
+			{
+				return;
+			}
+			std::pop_heap(queue.begin(), queue.end());
+			const PendingAsset pending = queue.back();
+			queue.pop_back();
+			if (pending.m_generation != m_generations[pending.m_assetId] || m_residency[pending.m_assetId].load(std::memory_order_relaxed) != waitingState)
+			{
+				continue; // re-prioritised since, there's a newer entry
+			}
+			const uint32_t assetId = pending.m_assetId;
+			m_residency[assetId].store(isReadStage ? AssetResidency::Reading : AssetResidency::Decoding, std::memory_order_relaxed);
+			lock.unlock();
+
+			bool succeeded = true;
+			try
+			{
+				if (isReadStage)
+				{
+					m_read(assetId, m_data[assetId]);
+				}
+				else
+				{
+					m_decode(assetId, m_data[assetId]);
+				}
+			}
+			catch (const std::exception& ex)
+			{
+				std::cerr << "Streaming asset " << assetId << " failed: " << ex.what() << std::endl;
+				succeeded = false;
+			}
+
+			lock.lock();
+			if (!succeeded)
+			{
+				std::vector<uint8_t>().swap(m_data[assetId]);
+				m_residency[assetId].store(AssetResidency::Failed, std::memory_order_release);
+			}
+			else if (isReadStage)
+			{
+				m_residency[assetId].store(AssetResidency::Read, std::memory_order_relaxed);
+				m_decodeQueue.push_back({ m_priorities[assetId], assetId, ++m_generations[assetId] });
+				std::push_heap(m_decodeQueue.begin(), m_decodeQueue.end());
+				m_decodeQueueChanged.notify_one();
+			}
+			else
+			{
+				m_residency[assetId].store(AssetResidency::Decoded, std::memory_order_relaxed);
+				m_readyToUpload.push_back(assetId);
+			}
+		}
+	}
+
+	uint32_t m_nAssets;
+	uint64_t m_uploadBudgetPerFrame;
+	ReadFunction m_read;
+	DecodeFunction m_decode;
+	UploadFunction m_upload;
+
+	std::unique_ptr<std::atomic<AssetResidency>[]> m_residency;
+	std::vector<std::vector<uint8_t>> m_data; // per asset, only ever touched by whichever stage has it
+
+	// everything below is guarded by m_mutex, except the upload state which only the main thread touches
+	std::mutex m_mutex;
+	std::vector<float> m_priorities;
+	std::vector<uint32_t> m_generations;
+	std::vector<PendingAsset> m_readQueue;
+	std::vector<PendingAsset> m_decodeQueue;
+	std::vector<uint32_t> m_readyToUpload;
+	std::condition_variable m_readQueueChanged;
+	std::condition_variable m_decodeQueueChanged;
+	bool m_stopThreads;
+	std::vector<std::thread> m_threads;
+
+	uint32_t m_uploadingAsset;
+	uint64_t m_uploadOffset;
+	uint64_t m_bytesUploaded;
+	uint64_t m_bytesUploadedLastFrame;
+	uint32_t m_nResident;
+};
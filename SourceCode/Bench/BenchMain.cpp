@@ -0,0 +1,379 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <cmath>
+#include <cstdlib>
+
+#include "VulkanApp.h"
+
+#ifdef _WINDOWS
+#include <Psapi.h>
+#endif // _WINDOWS
+
+// Deterministic frame benchmark, runs a fixed set of scripted scenes headless with a fixed time step and writes the results
+// as JSON so runs can be compared (e.g. in CI on lavapipe / SwiftShader to catch regressions).
+// Every scene gets its own VulkanApp so nothing carries over between them apart from the pipeline cache file.
+
+struct BenchScene
+{
+	const char* m_name;
+	uint32_t m_drawCount;
+	uint32_t m_trianglesPerDraw;
+	uint32_t m_resizeEveryNFrames; // 0 for never
+	float m_sceneWorldSize; // screens across, most of the scene is culled when it's more than 1
+	bool m_gpuDriven; // culled and drawn through indirect draws, falls back to CPU draws where the device can't
+	float m_drawScale = 0.5f; // of a grid cell, 3 is 9x overdraw
+	bool m_depthPrepass = false;
+};
+
+static const std::vector<BenchScene> s_benchScenes =
+{
+	{ "1-triangle", 1, 1, 0, 1.0f, false },
+	{ "1M-triangles-1-draw", 1, 1000000, 0, 1.0f, false },
+	{ "1k-draws", 1000, 1, 0, 1.0f, false },
+	{ "100k-draws", 100000, 1, 0, 1.0f, false },
+	{ "1M-triangles-100k-draws", 100000, 10, 0, 1.0f, false },
+	{ "resize-storm", 1000, 16, 2, 1.0f, false },
+	{ "500k-instances-mostly-culled", 500000, 1, 0, 8.0f, false },
+	{ "100k-draws-gpu-driven", 100000, 1, 0, 1.0f, true },
+	{ "500k-instances-mostly-culled-gpu-driven", 500000, 1, 0, 8.0f, true },
+	{ "10k-draws-9x-overdraw", 10000, 16, 0, 1.0f, false, 3.0f, false },
+	{ "10k-draws-9x-overdraw-depth-prepass", 10000, 16, 0, 1.0f, false, 3.0f, true },
+};
+
+struct BenchSettings
+{
+	uint64_t m_frameCount = 300;
+	uint64_t m_warmupFrameCount = 30; // not measured, gets allocations, caches and the job system warmed up
+	uint32_t m_width = 1280;
+	uint32_t m_height = 720;
+	uint32_t m_workerThreadCount = 0;
+	uint32_t m_framesInFlight = 2;
+	std::string m_outputPath = "BenchResults.json";
+	std::vector<std::string> m_sceneNames; // empty for all of them
+};
+
+struct BenchResult
+{
+	std::string m_sceneName;
+	uint32_t m_drawCount = 0;
+	uint64_t m_triangleCount = 0;
+	uint64_t m_frameCount = 0;
+	uint64_t m_resizeCount = 0;
+	double m_meanFrameMs = 0.0;
+	double m_p50FrameMs = 0.0;
+	double m_p99FrameMs = 0.0;
+	double m_maxFrameMs = 0.0;
+	double m_cpuMsPerFrame = 0.0; // process wide, includes the job system and any driver threads
+	std::map<std::string, double> m_cpuPhaseMsPerFrame; // summed over threads
+	std::map<std::string, double> m_gpuPhaseMsPerFrame;
+	double m_submitsPerFrame = 0.0;
+	uint64_t m_deviceMemoryUsedBytes = 0;
+	uint64_t m_deviceMemoryReservedBytes = 0;
+	uint64_t m_peakResidentBytes = 0;
+	double m_initMs = 0.0;
+	double m_timeToFirstFrameMs = 0.0;
+	double m_cpuWaitMs = 0.0; // frame pacer averages
+	double m_gpuWaitMs = 0.0;
+	double m_latencyMs = 0.0;
+};
+
+static uint64_t GetPeakResidentBytes()
+{
+#ifdef _WINDOWS
+	PROCESS_MEMORY_COUNTERS memoryCounters = {};
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &memoryCounters, sizeof(memoryCounters)))
+	{
+		return static_cast<uint64_t>(memoryCounters.PeakWorkingSetSize);
+	}
+	return 0;
+#else
+	std::ifstream statusFile("/proc/self/status");
+	std::string line;
+	while (std::getline(statusFile, line))
+	{
+		if (line.compare(0, 6, "VmHWM:") == 0)
+		{
+			return std::strtoull(line.c_str() + 6, nullptr, 10) * 1024; // in kB
+		}
+	}
+	return 0;
+#endif // _WINDOWS
+}
+
+static double Percentile(const std::vector<double>& sortedValues, double percentile)
+{
+	// nearest rank
+	if (sortedValues.empty())
+	{
+		return 0.0;
+	}
+	const size_t rank = static_cast<size_t>(std::ceil(percentile * sortedValues.size()));
+	return sortedValues[std::min(std::max<size_t>(rank, 1), sortedValues.size()) - 1];
+}
+
+static BenchResult RunScene(const BenchScene& scene, const BenchSettings& benchSettings)
+{
+	VulkanAppSettings appSettings;
+	appSettings.m_headless = true;
+	appSettings.m_width = benchSettings.m_width;
+	appSettings.m_height = benchSettings.m_height;
+	appSettings.m_drawCount = scene.m_drawCount;
+	appSettings.m_trianglesPerDraw = scene.m_trianglesPerDraw;
+	appSettings.m_sceneWorldSize = scene.m_sceneWorldSize;
+	appSettings.m_gpuDrivenRendering = scene.m_gpuDriven;
+	appSettings.m_drawScale = scene.m_drawScale;
+	appSettings.m_depthPrepass = scene.m_depthPrepass;
+	appSettings.m_workerThreadCount = benchSettings.m_workerThreadCount;
+	appSettings.m_framesInFlight = benchSettings.m_framesInFlight;
+	appSettings.m_presentPolicy = PresentPolicy::Throughput; // nothing's waiting on input, frames start as soon as they can
+	appSettings.m_animateScene = true; // gives Update() its per draw work
+	appSettings.m_profilingEnabled = true; // the per phase times come from the profiler's zones
+	appSettings.m_profileOutputPath.clear();
+
+	VulkanApp app(appSettings);
+	app.Init();
+
+	BenchResult result;
+	result.m_sceneName = scene.m_name;
+	result.m_drawCount = scene.m_drawCount;
+	result.m_triangleCount = app.GetTriangleCount();
+	result.m_frameCount = benchSettings.m_frameCount;
+
+	const float frameDeltaSeconds = 1.0f / 60.0f;
+	for (uint64_t i = 0; i < benchSettings.m_warmupFrameCount; ++i)
+	{
+		app.RunFrame(frameDeltaSeconds);
+	}
+	app.WaitIdle();
+
+	const Profiler& profiler = app.GetProfiler();
+	const uint64_t firstMeasuredFrame = profiler.GetFrameIndex() + 1;
+	uint64_t nextEvent = profiler.GetEventCount(); // read every frame so the ring can't wrap under us
+	std::map<std::string, double> cpuPhaseMs;
+	std::map<std::string, double> gpuPhaseMs;
+	const auto accumulateEvents = [&]()
+	{
+		for (const ProfileEvent& profileEvent : profiler.GetEvents(nextEvent, &nextEvent))
+		{
+			if (profileEvent.m_frameIndex >= firstMeasuredFrame)
+			{
+				std::map<std::string, double>& phaseMs = profileEvent.m_isGpuEvent ? gpuPhaseMs : cpuPhaseMs;
+				phaseMs[profileEvent.m_name] += static_cast<double>(profileEvent.m_endNs - profileEvent.m_startNs) / 1000000.0;
+			}
+		}
+	};
+
+	const uint64_t firstSubmit = app.GetQueueSubmitCount();
+	std::vector<double> frameMs;
+	frameMs.reserve(static_cast<size_t>(benchSettings.m_frameCount));
+	const std::clock_t cpuStart = std::clock();
+	for (uint64_t i = 0; i < benchSettings.m_frameCount; ++i)
+	{
+		const std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+		if (scene.m_resizeEveryNFrames > 0 && i % scene.m_resizeEveryNFrames == 0)
+		{
+			// walks through a fixed set of sizes around the requested one, including some very thin ones
+			const uint32_t step = static_cast<uint32_t>(i / scene.m_resizeEveryNFrames);
+			const uint32_t width = benchSettings.m_width / 4 + (step * 197) % benchSettings.m_width;
+			const uint32_t height = (step % 7 == 6) ? 1 : benchSettings.m_height / 4 + (step * 131) % benchSettings.m_height;
+			app.ResizeOffscreenTargets(width, height);
+			++result.m_resizeCount;
+		}
+		app.RunFrame(frameDeltaSeconds);
+		frameMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
+		accumulateEvents();
+	}
+	const std::clock_t cpuEnd = std::clock();
+	app.WaitIdle(); // collects the timestamps of the frames still in flight
+	accumulateEvents();
+
+	const double nFrames = static_cast<double>(std::max<uint64_t>(benchSettings.m_frameCount, 1));
+	result.m_submitsPerFrame = static_cast<double>(app.GetQueueSubmitCount() - firstSubmit) / nFrames;
+	result.m_cpuMsPerFrame = (static_cast<double>(cpuEnd - cpuStart) * 1000.0 / CLOCKS_PER_SEC) / nFrames;
+	for (const std::pair<const std::string, double>& phase : cpuPhaseMs)
+	{
+		result.m_cpuPhaseMsPerFrame[phase.first] = phase.second / nFrames;
+	}
+	for (const std::pair<const std::string, double>& phase : gpuPhaseMs)
+	{
+		result.m_gpuPhaseMsPerFrame[phase.first] = phase.second / nFrames;
+	}
+
+	if (!frameMs.empty())
+	{
+		double totalMs = 0.0;
+		for (double ms : frameMs)
+		{
+			totalMs += ms;
+		}
+		result.m_meanFrameMs = totalMs / frameMs.size();
+		std::sort(frameMs.begin(), frameMs.end());
+		result.m_p50FrameMs = Percentile(frameMs, 0.50);
+		result.m_p99FrameMs = Percentile(frameMs, 0.99);
+		result.m_maxFrameMs = frameMs.back();
+	}
+
+	for (const DeviceHeapStats& heapStats : app.GetDeviceMemoryStats())
+	{
+		result.m_deviceMemoryUsedBytes += heapStats.m_usedBytes;
+		result.m_deviceMemoryReservedBytes += heapStats.m_blockBytes;
+	}
+	result.m_peakResidentBytes = GetPeakResidentBytes();
+	result.m_initMs = app.GetInitMs();
+	result.m_timeToFirstFrameMs = app.GetTimeToFirstFrameMs();
+	result.m_cpuWaitMs = app.GetFramePacer().GetAverageCpuWaitMs();
+	result.m_gpuWaitMs = app.GetFramePacer().GetAverageGpuWaitMs();
+	result.m_latencyMs = app.GetFramePacer().GetAverageLatencyMs();
+
+	app.Shutdown();
+	return result;
+}
+
+static void WritePhaseMap(std::ostream& out, const std::map<std::string, double>& phases)
+{
+	out << "{";
+	bool first = true;
+	for (const std::pair<const std::string, double>& phase : phases)
+	{
+		out << (first ? "" : ", ") << "\"" << phase.first << "\": " << phase.second;
+		first = false;
+	}
+	out << "}";
+}
+
+static void WriteResultsJson(std::ostream& out, const BenchSettings& benchSettings, const std::vector<BenchResult>& results)
+{
+	out << "{\n";
+	out << "  \"frames\": " << benchSettings.m_frameCount << ",\n";
+	out << "  \"warmupFrames\": " << benchSettings.m_warmupFrameCount << ",\n";
+	out << "  \"width\": " << benchSettings.m_width << ",\n";
+	out << "  \"height\": " << benchSettings.m_height << ",\n";
+	out << "  \"framesInFlight\": " << benchSettings.m_framesInFlight << ",\n";
+	out << "  \"scenes\": [\n";
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		const BenchResult& result = results[i];
+		out << "    {\n";
+		out << "      \"name\": \"" << result.m_sceneName << "\",\n";
+		out << "      \"draws\": " << result.m_drawCount << ",\n";
+		out << "      \"triangles\": " << result.m_triangleCount << ",\n";
+		out << "      \"frames\": " << result.m_frameCount << ",\n";
+		out << "      \"resizes\": " << result.m_resizeCount << ",\n";
+		out << "      \"frameMs\": {\"mean\": " << result.m_meanFrameMs << ", \"p50\": " << result.m_p50FrameMs
+			<< ", \"p99\": " << result.m_p99FrameMs << ", \"max\": " << result.m_maxFrameMs << "},\n";
+		out << "      \"cpuMsPerFrame\": " << result.m_cpuMsPerFrame << ",\n";
+		out << "      \"cpuPhaseMsPerFrame\": ";
+		WritePhaseMap(out, result.m_cpuPhaseMsPerFrame);
+		out << ",\n      \"gpuPhaseMsPerFrame\": ";
+		WritePhaseMap(out, result.m_gpuPhaseMsPerFrame);
+		out << ",\n";
+		out << "      \"submitsPerFrame\": " << result.m_submitsPerFrame << ",\n";
+		out << "      \"deviceMemory\": {\"usedBytes\": " << result.m_deviceMemoryUsedBytes << ", \"reservedBytes\": " << result.m_deviceMemoryReservedBytes << "},\n";
+		out << "      \"peakResidentBytes\": " << result.m_peakResidentBytes << ",\n";
+		out << "      \"startupMs\": {\"init\": " << result.m_initMs << ", \"firstFrame\": " << result.m_timeToFirstFrameMs << "},\n";
+		out << "      \"pacingMs\": {\"cpuWait\": " << result.m_cpuWaitMs << ", \"gpuWait\": " << result.m_gpuWaitMs << ", \"latency\": " << result.m_latencyMs << "}\n";
+		out << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	out << "  ]\n";
+	out << "}\n";
+}
+
+static BenchSettings ParseCommandLine(int argc, char** argv)
+{
+	// [--frames N] [--warmup N] [--width N] [--height N] [--worker-threads N] [--frames-in-flight N] [--scene name]... [--output results.json] [--list]
+	BenchSettings settings;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+		if (arg == "--frames" && hasValue)
+		{
+			settings.m_frameCount = std::stoull(argv[++i]);
+		}
+		else if (arg == "--warmup" && hasValue)
+		{
+			settings.m_warmupFrameCount = std::stoull(argv[++i]);
+		}
+		else if (arg == "--width" && hasValue)
+		{
+			settings.m_width = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--height" && hasValue)
+		{
+			settings.m_height = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--worker-threads" && hasValue)
+		{
+			settings.m_workerThreadCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--frames-in-flight" && hasValue)
+		{
+			settings.m_framesInFlight = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--scene" && hasValue)
+		{
+			settings.m_sceneNames.push_back(argv[++i]);
+		}
+		else if (arg == "--output" && hasValue)
+		{
+			settings.m_outputPath = argv[++i];
+		}
+		else if (arg == "--list")
+		{
+			for (const BenchScene& scene : s_benchScenes)
+			{
+				std::cout << scene.m_name << std::endl;
+			}
+			std::exit(EXIT_SUCCESS);
+		}
+		else
+		{
+			std::cerr << "Ignoring unknown argument " << arg << std::endl;
+		}
+	}
+	return settings;
+}
+
+int main(int argc, char** argv)
+{
+	const BenchSettings benchSettings = ParseCommandLine(argc, argv);
+
+	std::vector<BenchResult> results;
+	try
+	{
+		for (const BenchScene& scene : s_benchScenes)
+		{
+			if (!benchSettings.m_sceneNames.empty()
+				&& std::find(benchSettings.m_sceneNames.begin(), benchSettings.m_sceneNames.end(), scene.m_name) == benchSettings.m_sceneNames.end())
+			{
+				continue;
+			}
+			std::cout << "Running " << scene.m_name << std::endl;
+			results.push_back(RunScene(scene, benchSettings));
+			const BenchResult& result = results.back();
+			std::cout << scene.m_name << ": mean " << result.m_meanFrameMs << "ms, p50 " << result.m_p50FrameMs << "ms, p99 " << result.m_p99FrameMs
+				<< "ms, max " << result.m_maxFrameMs << "ms, " << result.m_submitsPerFrame << " submits per frame" << std::endl;
+		}
+	}
+	catch (const std::exception& ex)
+	{
+		std::cerr << ex.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::ofstream outputFile(benchSettings.m_outputPath, std::ios::trunc);
+	if (!outputFile.is_open())
+	{
+		std::cerr << "Failed to open " << benchSettings.m_outputPath << std::endl;
+		return EXIT_FAILURE;
+	}
+	WriteResultsJson(outputFile, benchSettings, results);
+	std::cout << "Wrote " << results.size() << " scene results to " << benchSettings.m_outputPath << std::endl;
+	return 0;
+}
@@ -0,0 +1,298 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+// Hands out slot indices from a fixed size range, freed slots are reused most recent first. Not thread safe
+class BindlessSlotAllocator
+{
+public:
+	static constexpr uint32_t S_INVALID_SLOT = UINT32_MAX;
+
+	BindlessSlotAllocator()
+		: m_capacity(0)
+		, m_highWaterMark(0)
+	{}
+
+	void Init(uint32_t capacity)
+	{
+		m_capacity = capacity;
+		m_highWaterMark = 0;
+		m_freeSlots.clear();
+		m_slotIsFree.assign(capacity, false);
+	}
+
+	// S_INVALID_SLOT when every slot's taken
+	uint32_t Allocate()
+	{
+		if (!m_freeSlots.empty())
+		{
+			const uint32_t slot = m_freeSlots.back();
+			m_freeSlots.pop_back();
+			m_slotIsFree[slot] = false;
+			return slot;
+		}
+		return m_highWaterMark < m_capacity ? m_highWaterMark++ : S_INVALID_SLOT;
+	}
+
+	void Free(uint32_t slot)
+	{
+		if (slot >= m_highWaterMark)
+		{
+			throw std::runtime_error("Freeing a bindless slot that was never allocated");
+		}
+		if (m_slotIsFree[slot])
+		{
+			throw std::runtime_error("Freeing a bindless slot that's already free"); // it'd be handed out to two resources
+		}
+		m_slotIsFree[slot] = true;
+		m_freeSlots.push_back(slot);
+	}
+
+	uint32_t GetCapacity() const { return m_capacity; }
+	uint32_t GetUsedCount() const { return m_highWaterMark - static_cast<uint32_t>(m_freeSlots.size()); }
+
+private:
+	uint32_t m_capacity;
+	uint32_t m_highWaterMark; // every slot below this has been handed out at least once
+	std::vector<uint32_t> m_freeSlots;
+	std::vector<bool> m_slotIsFree; // whether each slot's in m_freeSlots
+};
+
+// One descriptor set holding every sampled image, storage buffer and sampler, so any draw can be batched with any other
+// and shaders pick resources with integer handles rather than each draw binding its own set. Needs VK_EXT_descriptor_indexing
+// (core in 1.2): the arrays are update after bind and partially bound, so slots are written while the set's bound and
+// unused slots don't have to hold anything valid. Declared in GLSL as set S_SET with GL_EXT_nonuniform_qualifier:
+//	layout(set = 1, binding = 0) uniform texture2D bindlessImages[];
+//	layout(set = 1, binding = 1) readonly buffer BindlessBuffer { uint words[]; } bindlessBuffers[];
+//	layout(set = 1, binding = 2) uniform sampler bindlessSamplers[];
+// and sampled with texture(sampler2D(bindlessImages[nonuniformEXT(imageHandle)], bindlessSamplers[samplerHandle]), uv).
+// The storage buffers can be declared as whatever block they hold, DefaultBindless.frag reads the materials that way.
+// A removed slot can be handed straight back out, so only remove once no frame in flight can still index it (the deferred
+// destruction queue's there for that). Not thread safe, like UploadManager it belongs to the thread submitting to the graphics queue.
+class BindlessResourceTable
+{
+public:
+	static constexpr uint32_t S_SET = 1; // set 0 is the frame data ring's
+	static constexpr uint32_t S_SAMPLED_IMAGE_BINDING = 0;
+	static constexpr uint32_t S_STORAGE_BUFFER_BINDING = 1;
+	static constexpr uint32_t S_SAMPLER_BINDING = 2;
+	static constexpr uint32_t S_BINDING_COUNT = 3;
+	static constexpr uint32_t S_INVALID_HANDLE = BindlessSlotAllocator::S_INVALID_SLOT;
+	// upper limits, the device's update after bind limits can lower them
+	static constexpr uint32_t S_MAX_SAMPLED_IMAGES = 16384;
+	static constexpr uint32_t S_MAX_STORAGE_BUFFERS = 16384;
+	static constexpr uint32_t S_MAX_SAMPLERS = 1024;
+
+	BindlessResourceTable()
+		: m_device(nullptr)
+		, m_descriptorSetLayout(nullptr)
+		, m_descriptorPool(nullptr)
+		, m_descriptorSet(nullptr)
+	{}
+
+	BindlessResourceTable(const BindlessResourceTable&) = delete;
+	BindlessResourceTable& operator=(const BindlessResourceTable&) = delete;
+
+	// the features EnableRequiredFeatures() turns on have to have been enabled on the device
+	void Init(VkPhysicalDevice physicalDevice, VkDevice device)
+	{
+		m_device = device;
+
+		VkPhysicalDeviceDescriptorIndexingProperties indexingProperties = {};
+		indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+		VkPhysicalDeviceProperties2 properties2 = {};
+		properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		properties2.pNext = &indexingProperties;
+		vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+
+		// everything's visible to every stage, so the per stage limits apply to the whole table
+		const uint32_t nSamplers = (std::min)({ S_MAX_SAMPLERS, indexingProperties.maxDescriptorSetUpdateAfterBindSamplers, indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers });
+		const uint32_t maxResources = (std::min)(indexingProperties.maxPerStageUpdateAfterBindResources, indexingProperties.maxUpdateAfterBindDescriptorsInAllPools);
+		const uint32_t resourcesLeft = maxResources > nSamplers ? maxResources - nSamplers : 0;
+		const uint32_t nSampledImages = (std::min)({ S_MAX_SAMPLED_IMAGES, indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+			indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages, resourcesLeft / 2 });
+		const uint32_t nStorageBuffers = (std::min)({ S_MAX_STORAGE_BUFFERS, indexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers,
+			indexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers, resourcesLeft - nSampledImages });
+		m_slots[S_SAMPLED_IMAGE_BINDING].Init(nSampledImages);
+		m_slots[S_STORAGE_BUFFER_BINDING].Init(nStorageBuffers);
+		m_slots[S_SAMPLER_BINDING].Init(nSamplers);
+
+		CreateDescriptorSet();
+	}
+
+	void Shutdown()
+	{
+		if (m_device)
+		{
+			vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr); // frees the set with it
+			vkDestroyDescriptorSetLayout(m_device, m_descriptorSetLayout, nullptr);
+		}
+		m_descriptorPool = nullptr;
+		m_descriptorSet = nullptr;
+		m_descriptorSetLayout = nullptr;
+		m_device = nullptr;
+	}
+
+	// what has to be turned on in VkPhysicalDeviceDescriptorIndexingFeatures, true when supported has all of it
+	static bool EnableRequiredFeatures(const VkPhysicalDeviceDescriptorIndexingFeatures& supported, VkPhysicalDeviceDescriptorIndexingFeatures& enabled)
+	{
+		enabled.runtimeDescriptorArray = supported.runtimeDescriptorArray;
+		enabled.descriptorBindingPartiallyBound = supported.descriptorBindingPartiallyBound;
+		enabled.descriptorBindingUpdateUnusedWhilePending = supported.descriptorBindingUpdateUnusedWhilePending;
+		enabled.descriptorBindingSampledImageUpdateAfterBind = supported.descriptorBindingSampledImageUpdateAfterBind; // covers the samplers too
+		enabled.descriptorBindingStorageBufferUpdateAfterBind = supported.descriptorBindingStorageBufferUpdateAfterBind;
+		enabled.shaderSampledImageArrayNonUniformIndexing = supported.shaderSampledImageArrayNonUniformIndexing;
+		enabled.shaderStorageBufferArrayNonUniformIndexing = supported.shaderStorageBufferArrayNonUniformIndexing;
+		return enabled.runtimeDescriptorArray && enabled.descriptorBindingPartiallyBound && enabled.descriptorBindingUpdateUnusedWhilePending
+			&& enabled.descriptorBindingSampledImageUpdateAfterBind && enabled.descriptorBindingStorageBufferUpdateAfterBind
+			&& enabled.shaderSampledImageArrayNonUniformIndexing && enabled.shaderStorageBufferArrayNonUniformIndexing;
+	}
+
+	VkDescriptorSetLayout GetDescriptorSetLayout() const { return m_descriptorSetLayout; }
+	VkDescriptorSet GetDescriptorSet() const { return m_descriptorSet; }
+
+	// each returns the handle the shaders index with, throws when the table's full
+	uint32_t AddSampledImage(VkImageView imageView, VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+	{
+		const uint32_t handle = AllocateSlot(S_SAMPLED_IMAGE_BINDING, "sampled image");
+		UpdateSampledImage(handle, imageView, imageLayout);
+		return handle;
+	}
+
+	void UpdateSampledImage(uint32_t handle, VkImageView imageView, VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+	{
+		VkDescriptorImageInfo imageInfo = {};
+		imageInfo.imageView = imageView;
+		imageInfo.imageLayout = imageLayout;
+		WriteDescriptor(S_SAMPLED_IMAGE_BINDING, handle, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, &imageInfo, nullptr);
+	}
+
+	uint32_t AddStorageBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE)
+	{
+		const uint32_t handle = AllocateSlot(S_STORAGE_BUFFER_BINDING, "storage buffer");
+		UpdateStorageBuffer(handle, buffer, offset, range);
+		return handle;
+	}
+
+	void UpdateStorageBuffer(uint32_t handle, VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE)
+	{
+		VkDescriptorBufferInfo bufferInfo = {};
+		bufferInfo.buffer = buffer;
+		bufferInfo.offset = offset;
+		bufferInfo.range = range;
+		WriteDescriptor(S_STORAGE_BUFFER_BINDING, handle, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr, &bufferInfo);
+	}
+
+	uint32_t AddSampler(VkSampler sampler)
+	{
+		const uint32_t handle = AllocateSlot(S_SAMPLER_BINDING, "sampler");
+		VkDescriptorImageInfo imageInfo = {};
+		imageInfo.sampler = sampler;
+		WriteDescriptor(S_SAMPLER_BINDING, handle, VK_DESCRIPTOR_TYPE_SAMPLER, &imageInfo, nullptr);
+		return handle;
+	}
+
+	// the descriptor's left as it is, partially bound means nothing minds as long as shaders stop indexing it
+	void RemoveSampledImage(uint32_t handle) { m_slots[S_SAMPLED_IMAGE_BINDING].Free(handle); }
+	void RemoveStorageBuffer(uint32_t handle) { m_slots[S_STORAGE_BUFFER_BINDING].Free(handle); }
+	void RemoveSampler(uint32_t handle) { m_slots[S_SAMPLER_BINDING].Free(handle); }
+
+	uint32_t GetSampledImageCount() const { return m_slots[S_SAMPLED_IMAGE_BINDING].GetUsedCount(); }
+	uint32_t GetStorageBufferCount() const { return m_slots[S_STORAGE_BUFFER_BINDING].GetUsedCount(); }
+	uint32_t GetSamplerCount() const { return m_slots[S_SAMPLER_BINDING].GetUsedCount(); }
+	uint32_t GetSampledImageCapacity() const { return m_slots[S_SAMPLED_IMAGE_BINDING].GetCapacity(); }
+	uint32_t GetStorageBufferCapacity() const { return m_slots[S_STORAGE_BUFFER_BINDING].GetCapacity(); }
+	uint32_t GetSamplerCapacity() const { return m_slots[S_SAMPLER_BINDING].GetCapacity(); }
+
+private:
+	uint32_t AllocateSlot(uint32_t binding, const char* resourceType)
+	{
+		const uint32_t slot = m_slots[binding].Allocate();
+		if (slot == S_INVALID_HANDLE)
+		{
+			throw std::runtime_error(std::string("The bindless table is out of ") + resourceType + " slots");
+		}
+		return slot;
+	}
+
+	void WriteDescriptor(uint32_t binding, uint32_t handle, VkDescriptorType descriptorType, const VkDescriptorImageInfo* imageInfo, const VkDescriptorBufferInfo* bufferInfo)
+	{
+		VkWriteDescriptorSet descriptorWrite = {};
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.dstSet = m_descriptorSet;
+		descriptorWrite.dstBinding = binding;
+		descriptorWrite.dstArrayElement = handle;
+		descriptorWrite.descriptorCount = 1;
+		descriptorWrite.descriptorType = descriptorType;
+		descriptorWrite.pImageInfo = imageInfo;
+		descriptorWrite.pBufferInfo = bufferInfo;
+		vkUpdateDescriptorSets(m_device, 1, &descriptorWrite, 0, nullptr);
+	}
+
+	void CreateDescriptorSet()
+	{
+		const std::array<VkDescriptorType, S_BINDING_COUNT> descriptorTypes = { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_SAMPLER };
+		std::array<VkDescriptorSetLayoutBinding, S_BINDING_COUNT> bindings = {};
+		std::array<VkDescriptorBindingFlags, S_BINDING_COUNT> bindingFlags = {};
+		std::array<VkDescriptorPoolSize, S_BINDING_COUNT> poolSizes = {};
+		for (uint32_t binding = 0; binding < S_BINDING_COUNT; ++binding)
+		{
+			bindings[binding].binding = binding;
+			bindings[binding].descriptorType = descriptorTypes[binding];
+			bindings[binding].descriptorCount = (std::max)(m_slots[binding].GetCapacity(), 1u);
+			bindings[binding].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+			bindingFlags[binding] = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+			poolSizes[binding].type = descriptorTypes[binding];
+			poolSizes[binding].descriptorCount = bindings[binding].descriptorCount;
+		}
+
+		VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsCreateInfo = {};
+		bindingFlagsCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+		bindingFlagsCreateInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+		bindingFlagsCreateInfo.pBindingFlags = bindingFlags.data();
+		VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+		setLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		setLayoutCreateInfo.pNext = &bindingFlagsCreateInfo;
+		setLayoutCreateInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+		setLayoutCreateInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+		setLayoutCreateInfo.pBindings = bindings.data();
+		if (vkCreateDescriptorSetLayout(m_device, &setLayoutCreateInfo, nullptr, &m_descriptorSetLayout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create the bindless descriptor set layout");
+		}
+
+		VkDescriptorPoolCreateInfo poolCreateInfo = {};
+		poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolCreateInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+		poolCreateInfo.maxSets = 1;
+		poolCreateInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+		poolCreateInfo.pPoolSizes = poolSizes.data();
+		if (vkCreateDescriptorPool(m_device, &poolCreateInfo, nullptr, &m_descriptorPool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create the bindless descriptor pool");
+		}
+
+		VkDescriptorSetAllocateInfo setAllocInfo = {};
+		setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		setAllocInfo.descriptorPool = m_descriptorPool;
+		setAllocInfo.descriptorSetCount = 1;
+		setAllocInfo.pSetLayouts = &m_descriptorSetLayout;
+		if (vkAllocateDescriptorSets(m_device, &setAllocInfo, &m_descriptorSet) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to allocate the bindless descriptor set");
+		}
+	}
+
+	VkDevice m_device;
+	VkDescriptorSetLayout m_descriptorSetLayout;
+	VkDescriptorPool m_descriptorPool;
+	VkDescriptorSet m_descriptorSet;
+	std::array<BindlessSlotAllocator, S_BINDING_COUNT> m_slots; // by binding
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
+
+// Holds on to GPU objects until every frame that could still be using them has finished, instead of idling the device.
+// Keyed on the graphics queue's timeline: anything enqueued is tagged with the value the last frame submitted signals and
+// destroyed once the timeline's been seen at or past it, the values only go up so that covers the earlier frames too.
+class DeferredDestructionQueue
+{
+public:
+	DeferredDestructionQueue()
+		: m_lastSubmittedFrame(0)
+		, m_lastCompletedFrame(0)
+	{}
+
+	// timelineValue is what the frame's submit signals
+	void OnFrameSubmitted(uint64_t timelineValue)
+	{
+		m_lastSubmittedFrame = std::max(m_lastSubmittedFrame, timelineValue);
+	}
+
+	void Enqueue(std::function<void()>&& destroyFunction)
+	{
+		if (m_lastSubmittedFrame <= m_lastCompletedFrame)
+		{
+			destroyFunction(); // nothing in flight can be referencing it
+			return;
+		}
+		m_pendingDestructions.push_back({ m_lastSubmittedFrame, std::move(destroyFunction) });
+	}
+
+	// completedValue is the timeline's current value, anything tagged with it or earlier is done with
+	void OnFrameCompleted(uint64_t completedValue)
+	{
+		m_lastCompletedFrame = std::max(m_lastCompletedFrame, completedValue);
+		while (!m_pendingDestructions.empty() && m_pendingDestructions.front().m_lastUsedFrame <= m_lastCompletedFrame)
+		{
+			m_pendingDestructions.front().m_destroyFunction();
+			m_pendingDestructions.pop_front();
+		}
+	}
+
+	// only once the device is idle
+	void DestroyAll()
+	{
+		OnFrameCompleted(m_lastSubmittedFrame);
+	}
+
+	size_t GetPendingCount() const { return m_pendingDestructions.size(); }
+
+private:
+	struct PendingDestruction
+	{
+		uint64_t m_lastUsedFrame;
+		std::function<void()> m_destroyFunction;
+	};
+
+	std::deque<PendingDestruction> m_pendingDestructions;
+	uint64_t m_lastSubmittedFrame;
+	uint64_t m_lastCompletedFrame;
+};
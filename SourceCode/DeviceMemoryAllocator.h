@@ -0,0 +1,821 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <cassert>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "Alignment.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif // _MSC_VER
+
+// Sub-allocates buffers and images out of large VkDeviceMemory blocks instead of one vkAllocateMemory per resource.
+// General purpose allocations come from TLSF (two level segregated fit) managed blocks, per frame / transient data
+// can use a DeviceLinearPool that's reset in bulk. Host visible blocks are persistently mapped.
+
+class DeviceLinearPool;
+class DeviceMemoryAllocator;
+
+enum class DeviceResourceTiling
+{
+	Linear, // buffers and linear tiled images
+	Optimal // optimal tiled images, kept apart from linear resources so bufferImageGranularity never needs padding
+};
+
+struct DeviceAllocation
+{
+	VkDeviceMemory m_memory = VK_NULL_HANDLE;
+	VkDeviceSize m_offset = 0;
+	VkDeviceSize m_size = 0;
+	void* m_mappedData = nullptr; // already offset, null if the memory isn't host visible
+	uint32_t m_memoryTypeIndex = 0;
+
+	// book keeping for DeviceMemoryAllocator::Free()
+	void* m_block = nullptr;
+	uint32_t m_nodeIndex = 0;
+
+	bool IsValid() const { return m_memory != VK_NULL_HANDLE; }
+};
+
+struct DeviceHeapStats
+{
+	VkDeviceSize m_heapSize = 0;
+	VkDeviceSize m_blockBytes = 0; // memory allocated from the driver
+	VkDeviceSize m_usedBytes = 0; // memory handed out to resources
+	uint32_t m_blockCount = 0; // vkAllocateMemory calls currently alive
+	uint32_t m_allocationCount = 0;
+	bool m_deviceLocal = false;
+};
+
+static inline uint32_t FindLastSetBit(uint64_t value)
+{
+	assert(value != 0);
+#ifdef _MSC_VER
+	unsigned long index = 0;
+	_BitScanReverse64(&index, value);
+	return static_cast<uint32_t>(index);
+#else
+	return 63u - static_cast<uint32_t>(__builtin_clzll(value));
+#endif // _MSC_VER
+}
+
+static inline uint32_t FindFirstSetBit(uint32_t value)
+{
+	assert(value != 0);
+#ifdef _MSC_VER
+	unsigned long index = 0;
+	_BitScanForward(&index, value);
+	return static_cast<uint32_t>(index);
+#else
+	return static_cast<uint32_t>(__builtin_ctz(value));
+#endif // _MSC_VER
+}
+
+// TLSF book keeping for a single VkDeviceMemory block, O(1) allocate and free with immediate coalescing.
+class TlsfBlockMetadata
+{
+public:
+	static constexpr uint32_t S_SECOND_LEVEL_LOG2 = 4;
+	static constexpr uint32_t S_SECOND_LEVEL_COUNT = 1u << S_SECOND_LEVEL_LOG2;
+	static constexpr uint32_t S_FIRST_LEVEL_COUNT = 64;
+	static constexpr VkDeviceSize S_MIN_ALLOCATION_SIZE = 1u << S_SECOND_LEVEL_LOG2; // keeps the mapping function valid
+	static constexpr uint32_t S_INVALID_NODE = ~0u;
+
+	explicit TlsfBlockMetadata(VkDeviceSize blockSize)
+		: m_firstLevelBitmap(0)
+		, m_usedBytes(0)
+		, m_allocationCount(0)
+		, m_firstFreeNodeSlot(S_INVALID_NODE)
+	{
+		m_secondLevelBitmaps.fill(0);
+		for (std::array<uint32_t, S_SECOND_LEVEL_COUNT>& freeLists : m_freeListHeads)
+		{
+			freeLists.fill(S_INVALID_NODE);
+		}
+		const uint32_t wholeBlock = NewNode();
+		m_nodes[wholeBlock].m_offset = 0;
+		m_nodes[wholeBlock].m_size = blockSize;
+		InsertFreeNode(wholeBlock);
+	}
+
+	// returns S_INVALID_NODE if the block can't fit the request, otherwise the node index and the aligned offset
+	uint32_t Allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& alignedOffset)
+	{
+		size = AlignUp(std::max(size, S_MIN_ALLOCATION_SIZE), S_MIN_ALLOCATION_SIZE);
+		// search with the worst case padding so whatever list we land on is guaranteed to fit
+		const VkDeviceSize searchSize = size + (alignment > S_MIN_ALLOCATION_SIZE ? alignment - 1 : 0);
+		const uint32_t nodeIndex = FindSuitableFreeNode(searchSize);
+		if (nodeIndex == S_INVALID_NODE)
+		{
+			return S_INVALID_NODE;
+		}
+		RemoveFreeNode(nodeIndex);
+
+		Node& node = m_nodes[nodeIndex];
+		alignedOffset = AlignUp(node.m_offset, alignment);
+		const VkDeviceSize usedSize = (alignedOffset - node.m_offset) + size; // front padding stays part of the allocation
+		assert(usedSize <= node.m_size);
+
+		const VkDeviceSize remainder = node.m_size - usedSize;
+		if (remainder >= S_MIN_ALLOCATION_SIZE)
+		{
+			const uint32_t remainderIndex = NewNode(); // may reallocate m_nodes, don't hold references over this
+			Node& usedNode = m_nodes[nodeIndex];
+			Node& remainderNode = m_nodes[remainderIndex];
+			remainderNode.m_offset = usedNode.m_offset + usedSize;
+			remainderNode.m_size = remainder;
+			remainderNode.m_prevPhysical = nodeIndex;
+			remainderNode.m_nextPhysical = usedNode.m_nextPhysical;
+			if (usedNode.m_nextPhysical != S_INVALID_NODE)
+			{
+				m_nodes[usedNode.m_nextPhysical].m_prevPhysical = remainderIndex;
+			}
+			usedNode.m_nextPhysical = remainderIndex;
+			usedNode.m_size = usedSize;
+			InsertFreeNode(remainderIndex);
+		}
+
+		m_usedBytes += m_nodes[nodeIndex].m_size;
+		++m_allocationCount;
+		return nodeIndex;
+	}
+
+	void Free(uint32_t nodeIndex)
+	{
+		assert(nodeIndex < m_nodes.size() && !m_nodes[nodeIndex].m_free);
+		m_usedBytes -= m_nodes[nodeIndex].m_size;
+		--m_allocationCount;
+
+		// merge with free physical neighbours
+		const uint32_t prevIndex = m_nodes[nodeIndex].m_prevPhysical;
+		if (prevIndex != S_INVALID_NODE && m_nodes[prevIndex].m_free)
+		{
+			RemoveFreeNode(prevIndex);
+			nodeIndex = MergeWithNext(prevIndex);
+		}
+		const uint32_t nextIndex = m_nodes[nodeIndex].m_nextPhysical;
+		if (nextIndex != S_INVALID_NODE && m_nodes[nextIndex].m_free)
+		{
+			RemoveFreeNode(nextIndex);
+			nodeIndex = MergeWithNext(nodeIndex);
+		}
+		InsertFreeNode(nodeIndex);
+	}
+
+	VkDeviceSize GetUsedBytes() const { return m_usedBytes; }
+	uint32_t GetAllocationCount() const { return m_allocationCount; }
+	bool IsEmpty() const { return m_allocationCount == 0; }
+
+private:
+	struct Node
+	{
+		VkDeviceSize m_offset = 0;
+		VkDeviceSize m_size = 0;
+		uint32_t m_prevPhysical = S_INVALID_NODE;
+		uint32_t m_nextPhysical = S_INVALID_NODE;
+		uint32_t m_prevFree = S_INVALID_NODE;
+		uint32_t m_nextFree = S_INVALID_NODE; // doubles as the recycled slot list link
+		bool m_free = false;
+	};
+
+	static void MapSize(VkDeviceSize size, uint32_t& firstLevel, uint32_t& secondLevel)
+	{
+		assert(size >= S_MIN_ALLOCATION_SIZE);
+		firstLevel = FindLastSetBit(size);
+		secondLevel = static_cast<uint32_t>(size >> (firstLevel - S_SECOND_LEVEL_LOG2)) ^ S_SECOND_LEVEL_COUNT;
+	}
+
+	uint32_t FindSuitableFreeNode(VkDeviceSize size)
+	{
+		// round up to the next list so every node in it is at least size bytes
+		const uint32_t roundingLevel = FindLastSetBit(size);
+		if (roundingLevel >= S_SECOND_LEVEL_LOG2)
+		{
+			size += (VkDeviceSize(1) << (roundingLevel - S_SECOND_LEVEL_LOG2)) - 1;
+		}
+		uint32_t firstLevel = 0, secondLevel = 0;
+		MapSize(size, firstLevel, secondLevel);
+		if (firstLevel >= S_FIRST_LEVEL_COUNT)
+		{
+			return S_INVALID_NODE;
+		}
+
+		uint32_t secondLevelMap = m_secondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+		if (secondLevelMap == 0)
+		{
+			const uint64_t firstLevelMap = firstLevel + 1 < S_FIRST_LEVEL_COUNT ? m_firstLevelBitmap & (~uint64_t(0) << (firstLevel + 1)) : 0;
+			if (firstLevelMap == 0)
+			{
+				return S_INVALID_NODE;
+			}
+			firstLevel = FindLastSetBit(firstLevelMap & (~firstLevelMap + 1)); // isolate the lowest set bit
+			secondLevelMap = m_secondLevelBitmaps[firstLevel];
+		}
+		secondLevel = FindFirstSetBit(secondLevelMap);
+		return m_freeListHeads[firstLevel][secondLevel];
+	}
+
+	void InsertFreeNode(uint32_t nodeIndex)
+	{
+		Node& node = m_nodes[nodeIndex];
+		uint32_t firstLevel = 0, secondLevel = 0;
+		MapSize(node.m_size, firstLevel, secondLevel);
+		node.m_free = true;
+		node.m_prevFree = S_INVALID_NODE;
+		node.m_nextFree = m_freeListHeads[firstLevel][secondLevel];
+		if (node.m_nextFree != S_INVALID_NODE)
+		{
+			m_nodes[node.m_nextFree].m_prevFree = nodeIndex;
+		}
+		m_freeListHeads[firstLevel][secondLevel] = nodeIndex;
+		m_firstLevelBitmap |= uint64_t(1) << firstLevel;
+		m_secondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+	}
+
+	void RemoveFreeNode(uint32_t nodeIndex)
+	{
+		Node& node = m_nodes[nodeIndex];
+		assert(node.m_free);
+		uint32_t firstLevel = 0, secondLevel = 0;
+		MapSize(node.m_size, firstLevel, secondLevel);
+		if (node.m_prevFree != S_INVALID_NODE)
+		{
+			m_nodes[node.m_prevFree].m_nextFree = node.m_nextFree;
+		}
+		else
+		{
+			m_freeListHeads[firstLevel][secondLevel] = node.m_nextFree;
+			if (node.m_nextFree == S_INVALID_NODE)
+			{
+				m_secondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+				if (m_secondLevelBitmaps[firstLevel] == 0)
+				{
+					m_firstLevelBitmap &= ~(uint64_t(1) << firstLevel);
+				}
+			}
+		}
+		if (node.m_nextFree != S_INVALID_NODE)
+		{
+			m_nodes[node.m_nextFree].m_prevFree = node.m_prevFree;
+		}
+		node.m_free = false;
+		node.m_prevFree = node.m_nextFree = S_INVALID_NODE;
+	}
+
+	uint32_t MergeWithNext(uint32_t nodeIndex)
+	{
+		// absorbs the next physical node into nodeIndex, neither can be in a free list
+		const uint32_t nextIndex = m_nodes[nodeIndex].m_nextPhysical;
+		Node& node = m_nodes[nodeIndex];
+		Node& next = m_nodes[nextIndex];
+		node.m_size += next.m_size;
+		node.m_nextPhysical = next.m_nextPhysical;
+		if (next.m_nextPhysical != S_INVALID_NODE)
+		{
+			m_nodes[next.m_nextPhysical].m_prevPhysical = nodeIndex;
+		}
+		ReleaseNode(nextIndex);
+		return nodeIndex;
+	}
+
+	uint32_t NewNode()
+	{
+		if (m_firstFreeNodeSlot != S_INVALID_NODE)
+		{
+			const uint32_t nodeIndex = m_firstFreeNodeSlot;
+			m_firstFreeNodeSlot = m_nodes[nodeIndex].m_nextFree;
+			m_nodes[nodeIndex] = Node();
+			return nodeIndex;
+		}
+		m_nodes.emplace_back();
+		return static_cast<uint32_t>(m_nodes.size() - 1);
+	}
+
+	void ReleaseNode(uint32_t nodeIndex)
+	{
+		m_nodes[nodeIndex] = Node();
+		m_nodes[nodeIndex].m_nextFree = m_firstFreeNodeSlot;
+		m_firstFreeNodeSlot = nodeIndex;
+	}
+
+	std::vector<Node> m_nodes;
+	std::array<std::array<uint32_t, S_SECOND_LEVEL_COUNT>, S_FIRST_LEVEL_COUNT> m_freeListHeads;
+	std::array<uint32_t, S_FIRST_LEVEL_COUNT> m_secondLevelBitmaps;
+	uint64_t m_firstLevelBitmap;
+	VkDeviceSize m_usedBytes;
+	uint32_t m_allocationCount;
+	uint32_t m_firstFreeNodeSlot;
+};
+
+// Bump allocator over a single block, everything is released at once with Reset(). Meant for data that lives a frame.
+class DeviceLinearPool
+{
+public:
+	DeviceLinearPool(VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryTypeIndex, void* mappedData, VkDeviceSize bufferImageGranularity)
+		: m_memory(memory)
+		, m_size(size)
+		, m_memoryTypeIndex(memoryTypeIndex)
+		, m_mappedData(mappedData)
+		, m_bufferImageGranularity(bufferImageGranularity)
+		, m_head(0)
+		, m_allocationCount(0)
+		, m_lastTiling(DeviceResourceTiling::Linear)
+	{}
+
+	// returns an invalid allocation once the pool is full, callers decide whether to fall back or wait for a Reset()
+	DeviceAllocation Allocate(const VkMemoryRequirements& requirements, DeviceResourceTiling tiling = DeviceResourceTiling::Linear)
+	{
+		VkDeviceSize alignment = requirements.alignment;
+		if (m_allocationCount > 0 && tiling != m_lastTiling)
+		{
+			// linear and optimal resources sharing a page would alias on some hardware
+			alignment = std::max(alignment, m_bufferImageGranularity);
+		}
+		const VkDeviceSize offset = AlignUp(m_head, alignment);
+		DeviceAllocation allocation;
+		if ((requirements.memoryTypeBits & (1u << m_memoryTypeIndex)) == 0 || offset + requirements.size > m_size)
+		{
+			return allocation;
+		}
+		m_head = offset + requirements.size;
+		m_lastTiling = tiling;
+		++m_allocationCount;
+
+		allocation.m_memory = m_memory;
+		allocation.m_offset = offset;
+		allocation.m_size = requirements.size;
+		allocation.m_memoryTypeIndex = m_memoryTypeIndex;
+		allocation.m_mappedData = m_mappedData ? static_cast<uint8_t*>(m_mappedData) + offset : nullptr;
+		return allocation;
+	}
+
+	void Reset()
+	{
+		m_head = 0;
+		m_allocationCount = 0;
+		m_lastTiling = DeviceResourceTiling::Linear;
+	}
+
+	VkDeviceMemory GetMemory() const { return m_memory; }
+	VkDeviceSize GetSize() const { return m_size; }
+	VkDeviceSize GetUsedBytes() const { return m_head; }
+	uint32_t GetAllocationCount() const { return m_allocationCount; }
+	uint32_t GetMemoryTypeIndex() const { return m_memoryTypeIndex; }
+	void* GetMappedData() const { return m_mappedData; }
+
+private:
+	VkDeviceMemory m_memory;
+	VkDeviceSize m_size;
+	uint32_t m_memoryTypeIndex;
+	void* m_mappedData;
+	VkDeviceSize m_bufferImageGranularity;
+	VkDeviceSize m_head;
+	uint32_t m_allocationCount;
+	DeviceResourceTiling m_lastTiling;
+};
+
+class DeviceMemoryAllocator
+{
+public:
+	static constexpr VkDeviceSize S_DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+	static constexpr VkDeviceSize S_SMALL_HEAP_SIZE = 1024ull * 1024 * 1024; // heaps at or below this get blocks of heapSize / 8
+
+	DeviceMemoryAllocator()
+		: m_physicalDevice(nullptr)
+		, m_device(nullptr)
+		, m_memoryProperties()
+		, m_bufferImageGranularity(1)
+		, m_nonCoherentAtomSize(1)
+		, m_maxMemoryAllocationCount(0)
+		, m_liveDeviceAllocations(0)
+	{}
+
+	~DeviceMemoryAllocator()
+	{
+		assert(m_blocks.empty() && m_linearPools.empty()); // Shutdown() needs calling before the device goes away
+	}
+
+	DeviceMemoryAllocator(const DeviceMemoryAllocator&) = delete;
+	DeviceMemoryAllocator& operator=(const DeviceMemoryAllocator&) = delete;
+
+	void Init(VkPhysicalDevice physicalDevice, VkDevice device)
+	{
+		m_physicalDevice = physicalDevice;
+		m_device = device;
+		// these never change for the lifetime of the device, so query them once
+		vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &m_memoryProperties);
+		VkPhysicalDeviceProperties deviceProperties = {};
+		vkGetPhysicalDeviceProperties(m_physicalDevice, &deviceProperties);
+		m_bufferImageGranularity = std::max<VkDeviceSize>(deviceProperties.limits.bufferImageGranularity, 1);
+		m_nonCoherentAtomSize = std::max<VkDeviceSize>(deviceProperties.limits.nonCoherentAtomSize, 1);
+		m_maxMemoryAllocationCount = deviceProperties.limits.maxMemoryAllocationCount;
+	}
+
+	void Shutdown()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (const std::unique_ptr<DeviceLinearPool>& pool : m_linearPools)
+		{
+			FreeDeviceMemory(pool->GetMemory(), pool->GetMappedData() != nullptr);
+		}
+		m_linearPools.clear();
+		for (const std::unique_ptr<Block>& block : m_blocks)
+		{
+			if (block->m_metadata && !block->m_metadata->IsEmpty())
+			{
+				std::cerr << "DeviceMemoryAllocator: " << block->m_metadata->GetAllocationCount() << " allocations leaked" << std::endl;
+			}
+			FreeDeviceMemory(block->m_memory, block->m_mappedData != nullptr);
+		}
+		m_blocks.clear();
+	}
+
+	const VkPhysicalDeviceMemoryProperties& GetMemoryProperties() const { return m_memoryProperties; }
+	VkDeviceSize GetNonCoherentAtomSize() const { return m_nonCoherentAtomSize; }
+
+	uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags requiredProperties, VkMemoryPropertyFlags preferredProperties = 0) const
+	{
+		// try for the preferred flags first, then settle for just the required ones
+		const VkMemoryPropertyFlags wanted = requiredProperties | preferredProperties;
+		for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; ++i)
+		{
+			if ((typeFilter & (1u << i)) && (m_memoryProperties.memoryTypes[i].propertyFlags & wanted) == wanted)
+			{
+				return i;
+			}
+		}
+		for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; ++i)
+		{
+			if ((typeFilter & (1u << i)) && (m_memoryProperties.memoryTypes[i].propertyFlags & requiredProperties) == requiredProperties)
+			{
+				return i;
+			}
+		}
+		throw std::runtime_error("Failed to find memory type that fits the flags");
+	}
+
+	bool IsHostVisible(uint32_t memoryTypeIndex) const
+	{
+		return (m_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+	}
+
+	bool IsHostCoherent(uint32_t memoryTypeIndex) const
+	{
+		return (m_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+	}
+
+	DeviceAllocation Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags requiredProperties, DeviceResourceTiling tiling, VkMemoryPropertyFlags preferredProperties = 0)
+	{
+		const uint32_t memoryTypeIndex = FindMemoryType(requirements.memoryTypeBits, requiredProperties, preferredProperties);
+		const uint32_t heapIndex = m_memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+		const VkDeviceSize blockSize = GetPreferredBlockSize(heapIndex);
+		const uint32_t poolKey = GetPoolKey(memoryTypeIndex, tiling);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (requirements.size > blockSize / 2)
+		{
+			// big resources get their own allocation rather than fragmenting a shared block
+			return AllocateDedicated(requirements.size, memoryTypeIndex, poolKey);
+		}
+
+		for (const std::unique_ptr<Block>& block : m_blocks)
+		{
+			if (block->m_poolKey != poolKey || !block->m_metadata)
+			{
+				continue;
+			}
+			DeviceAllocation allocation = TryAllocateFromBlock(*block, requirements);
+			if (allocation.IsValid())
+			{
+				return allocation;
+			}
+		}
+
+		Block& newBlock = CreateBlock(blockSize, memoryTypeIndex, poolKey);
+		DeviceAllocation allocation = TryAllocateFromBlock(newBlock, requirements);
+		if (!allocation.IsValid())
+		{
+			throw std::runtime_error("Failed to sub-allocate from a new device memory block.");
+		}
+		return allocation;
+	}
+
+	DeviceAllocation AllocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags requiredProperties, VkMemoryPropertyFlags preferredProperties = 0)
+	{
+		VkMemoryRequirements bufMemRequirements = {};
+		vkGetBufferMemoryRequirements(m_device, buffer, &bufMemRequirements);
+		DeviceAllocation allocation = Allocate(bufMemRequirements, requiredProperties, DeviceResourceTiling::Linear, preferredProperties);
+		if (vkBindBufferMemory(m_device, buffer, allocation.m_memory, allocation.m_offset) != VK_SUCCESS)
+		{
+			Free(allocation);
+			throw std::runtime_error("Failed to bind buffer memory.");
+		}
+		return allocation;
+	}
+
+	DeviceAllocation AllocateForImage(VkImage image, VkMemoryPropertyFlags requiredProperties, DeviceResourceTiling tiling = DeviceResourceTiling::Optimal, VkMemoryPropertyFlags preferredProperties = 0)
+	{
+		VkMemoryRequirements imageMemRequirements = {};
+		vkGetImageMemoryRequirements(m_device, image, &imageMemRequirements);
+		DeviceAllocation allocation = Allocate(imageMemRequirements, requiredProperties, tiling, preferredProperties);
+		if (vkBindImageMemory(m_device, image, allocation.m_memory, allocation.m_offset) != VK_SUCCESS)
+		{
+			Free(allocation);
+			throw std::runtime_error("Failed to bind image memory.");
+		}
+		return allocation;
+	}
+
+	void Free(DeviceAllocation& allocation)
+	{
+		if (!allocation.IsValid())
+		{
+			return;
+		}
+		std::lock_guard<std::mutex> lock(m_mutex);
+		Block* block = static_cast<Block*>(allocation.m_block);
+		assert(block != nullptr); // linear pool allocations are released with DeviceLinearPool::Reset()
+		if (!block->m_metadata)
+		{
+			DestroyBlock(block);
+		}
+		else
+		{
+			block->m_metadata->Free(allocation.m_nodeIndex);
+			if (block->m_metadata->IsEmpty())
+			{
+				ReleaseEmptyBlock(block);
+			}
+		}
+		allocation = DeviceAllocation();
+	}
+
+	// flush / invalidate for memory that isn't HOST_COHERENT, the range is widened to nonCoherentAtomSize
+	void FlushAllocation(const DeviceAllocation& allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE)
+	{
+		if (IsHostCoherent(allocation.m_memoryTypeIndex))
+		{
+			return;
+		}
+		VkMappedMemoryRange range = GetAtomAlignedRange(allocation, offset, size);
+		vkFlushMappedMemoryRanges(m_device, 1, &range);
+	}
+
+	void InvalidateAllocation(const DeviceAllocation& allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE)
+	{
+		if (IsHostCoherent(allocation.m_memoryTypeIndex))
+		{
+			return;
+		}
+		VkMappedMemoryRange range = GetAtomAlignedRange(allocation, offset, size);
+		vkInvalidateMappedMemoryRanges(m_device, 1, &range);
+	}
+
+	DeviceLinearPool* CreateLinearPool(VkDeviceSize size, uint32_t memoryTypeBits, VkMemoryPropertyFlags requiredProperties, VkMemoryPropertyFlags preferredProperties = 0)
+	{
+		const uint32_t memoryTypeIndex = FindMemoryType(memoryTypeBits, requiredProperties, preferredProperties);
+		std::lock_guard<std::mutex> lock(m_mutex);
+		void* mappedData = nullptr;
+		VkDeviceMemory memory = AllocateDeviceMemory(size, memoryTypeIndex, mappedData);
+		m_linearPools.push_back(std::make_unique<DeviceLinearPool>(memory, size, memoryTypeIndex, mappedData, m_bufferImageGranularity));
+		return m_linearPools.back().get();
+	}
+
+	void DestroyLinearPool(DeviceLinearPool* pool)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::vector<std::unique_ptr<DeviceLinearPool>>::iterator it = std::find_if(m_linearPools.begin(), m_linearPools.end(), [pool](const std::unique_ptr<DeviceLinearPool>& p) { return p.get() == pool; });
+		if (it != m_linearPools.end())
+		{
+			FreeDeviceMemory(pool->GetMemory(), pool->GetMappedData() != nullptr);
+			m_linearPools.erase(it);
+		}
+	}
+
+	std::vector<DeviceHeapStats> GetHeapStats() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::vector<DeviceHeapStats> stats(m_memoryProperties.memoryHeapCount);
+		for (uint32_t i = 0; i < m_memoryProperties.memoryHeapCount; ++i)
+		{
+			stats[i].m_heapSize = m_memoryProperties.memoryHeaps[i].size;
+			stats[i].m_deviceLocal = (m_memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+		}
+		for (const std::unique_ptr<Block>& block : m_blocks)
+		{
+			DeviceHeapStats& heapStats = stats[m_memoryProperties.memoryTypes[block->m_memoryTypeIndex].heapIndex];
+			heapStats.m_blockBytes += block->m_size;
+			++heapStats.m_blockCount;
+			if (block->m_metadata)
+			{
+				heapStats.m_usedBytes += block->m_metadata->GetUsedBytes();
+				heapStats.m_allocationCount += block->m_metadata->GetAllocationCount();
+			}
+			else
+			{
+				heapStats.m_usedBytes += block->m_size;
+				++heapStats.m_allocationCount;
+			}
+		}
+		for (const std::unique_ptr<DeviceLinearPool>& pool : m_linearPools)
+		{
+			DeviceHeapStats& heapStats = stats[m_memoryProperties.memoryTypes[pool->GetMemoryTypeIndex()].heapIndex];
+			heapStats.m_blockBytes += pool->GetSize();
+			heapStats.m_usedBytes += pool->GetUsedBytes();
+			++heapStats.m_blockCount;
+			heapStats.m_allocationCount += pool->GetAllocationCount();
+		}
+		return stats;
+	}
+
+	void PrintStats(std::ostream& out) const
+	{
+		const std::vector<DeviceHeapStats> stats = GetHeapStats();
+		uint32_t liveDeviceAllocations = 0;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			liveDeviceAllocations = m_liveDeviceAllocations;
+		}
+		const double mebibyte = 1024.0 * 1024.0;
+		out << "Device memory (" << liveDeviceAllocations << " of " << m_maxMemoryAllocationCount << " vkAllocateMemory allocations in use)" << std::endl;
+		for (size_t i = 0; i < stats.size(); ++i)
+		{
+			out << "  heap " << i << (stats[i].m_deviceLocal ? " (device local)" : "") << ": "
+				<< stats[i].m_usedBytes / mebibyte << "MiB used in " << stats[i].m_allocationCount << " allocations, "
+				<< stats[i].m_blockBytes / mebibyte << "MiB in " << stats[i].m_blockCount << " blocks, heap size "
+				<< stats[i].m_heapSize / mebibyte << "MiB" << std::endl;
+		}
+	}
+
+private:
+	struct Block
+	{
+		VkDeviceMemory m_memory = VK_NULL_HANDLE;
+		VkDeviceSize m_size = 0;
+		uint32_t m_memoryTypeIndex = 0;
+		uint32_t m_poolKey = 0;
+		void* m_mappedData = nullptr;
+		std::unique_ptr<TlsfBlockMetadata> m_metadata; // null for dedicated allocations
+	};
+
+	uint32_t GetPoolKey(uint32_t memoryTypeIndex, DeviceResourceTiling tiling) const
+	{
+		// with a granularity of 1 linear and optimal resources can share blocks freely
+		const bool separateOptimal = m_bufferImageGranularity > 1 && tiling == DeviceResourceTiling::Optimal;
+		return memoryTypeIndex * 2 + (separateOptimal ? 1 : 0);
+	}
+
+	VkDeviceSize GetPreferredBlockSize(uint32_t heapIndex) const
+	{
+		const VkDeviceSize heapSize = m_memoryProperties.memoryHeaps[heapIndex].size;
+		return heapSize <= S_SMALL_HEAP_SIZE ? AlignUp(heapSize / 8, 32) : S_DEFAULT_BLOCK_SIZE;
+	}
+
+	DeviceAllocation TryAllocateFromBlock(Block& block, const VkMemoryRequirements& requirements)
+	{
+		DeviceAllocation allocation;
+		VkDeviceSize alignedOffset = 0;
+		const VkDeviceSize alignment = IsHostVisible(block.m_memoryTypeIndex) ? std::max(requirements.alignment, m_nonCoherentAtomSize) : requirements.alignment;
+		const uint32_t nodeIndex = block.m_metadata->Allocate(requirements.size, alignment, alignedOffset);
+		if (nodeIndex == TlsfBlockMetadata::S_INVALID_NODE)
+		{
+			return allocation;
+		}
+		allocation.m_memory = block.m_memory;
+		allocation.m_offset = alignedOffset;
+		allocation.m_size = requirements.size;
+		allocation.m_memoryTypeIndex = block.m_memoryTypeIndex;
+		allocation.m_mappedData = block.m_mappedData ? static_cast<uint8_t*>(block.m_mappedData) + alignedOffset : nullptr;
+		allocation.m_block = &block;
+		allocation.m_nodeIndex = nodeIndex;
+		return allocation;
+	}
+
+	DeviceAllocation AllocateDedicated(VkDeviceSize size, uint32_t memoryTypeIndex, uint32_t poolKey)
+	{
+		std::unique_ptr<Block> block = std::make_unique<Block>();
+		block->m_memory = AllocateDeviceMemory(size, memoryTypeIndex, block->m_mappedData);
+		block->m_size = size;
+		block->m_memoryTypeIndex = memoryTypeIndex;
+		block->m_poolKey = poolKey;
+
+		DeviceAllocation allocation;
+		allocation.m_memory = block->m_memory;
+		allocation.m_offset = 0;
+		allocation.m_size = size;
+		allocation.m_memoryTypeIndex = memoryTypeIndex;
+		allocation.m_mappedData = block->m_mappedData;
+		allocation.m_block = block.get();
+		m_blocks.push_back(std::move(block));
+		return allocation;
+	}
+
+	Block& CreateBlock(VkDeviceSize size, uint32_t memoryTypeIndex, uint32_t poolKey)
+	{
+		std::unique_ptr<Block> block = std::make_unique<Block>();
+		block->m_memory = AllocateDeviceMemory(size, memoryTypeIndex, block->m_mappedData);
+		block->m_size = size;
+		block->m_memoryTypeIndex = memoryTypeIndex;
+		block->m_poolKey = poolKey;
+		block->m_metadata = std::make_unique<TlsfBlockMetadata>(size);
+		m_blocks.push_back(std::move(block));
+		return *m_blocks.back();
+	}
+
+	void ReleaseEmptyBlock(Block* emptyBlock)
+	{
+		// hang on to one empty block per pool so a resource being recreated doesn't hit the driver every time
+		for (const std::unique_ptr<Block>& block : m_blocks)
+		{
+			if (block.get() != emptyBlock && block->m_poolKey == emptyBlock->m_poolKey && block->m_metadata && block->m_metadata->IsEmpty())
+			{
+				DestroyBlock(emptyBlock);
+				return;
+			}
+		}
+	}
+
+	void DestroyBlock(Block* blockToDestroy)
+	{
+		std::vector<std::unique_ptr<Block>>::iterator it = std::find_if(m_blocks.begin(), m_blocks.end(), [blockToDestroy](const std::unique_ptr<Block>& block) { return block.get() == blockToDestroy; });
+		assert(it != m_blocks.end());
+		FreeDeviceMemory((*it)->m_memory, (*it)->m_mappedData != nullptr);
+		m_blocks.erase(it);
+	}
+
+	VkDeviceMemory AllocateDeviceMemory(VkDeviceSize size, uint32_t memoryTypeIndex, void*& mappedData)
+	{
+		if (m_maxMemoryAllocationCount != 0 && m_liveDeviceAllocations >= m_maxMemoryAllocationCount)
+		{
+			throw std::runtime_error("Reached maxMemoryAllocationCount.");
+		}
+		VkMemoryAllocateInfo vkMallocInfo = {};
+		vkMallocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		vkMallocInfo.allocationSize = size;
+		vkMallocInfo.memoryTypeIndex = memoryTypeIndex;
+
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		if (vkAllocateMemory(m_device, &vkMallocInfo, nullptr, &memory) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to allocate device memory block.");
+		}
+		++m_liveDeviceAllocations;
+
+		mappedData = nullptr;
+		if (IsHostVisible(memoryTypeIndex) && vkMapMemory(m_device, memory, 0, VK_WHOLE_SIZE, 0, &mappedData) != VK_SUCCESS)
+		{
+			vkFreeMemory(m_device, memory, nullptr);
+			--m_liveDeviceAllocations;
+			throw std::runtime_error("Failed to map device memory block.");
+		}
+		return memory;
+	}
+
+	void FreeDeviceMemory(VkDeviceMemory memory, bool mapped)
+	{
+		if (mapped)
+		{
+			vkUnmapMemory(m_device, memory);
+		}
+		vkFreeMemory(m_device, memory, nullptr);
+		--m_liveDeviceAllocations;
+	}
+
+	VkMappedMemoryRange GetAtomAlignedRange(const DeviceAllocation& allocation, VkDeviceSize offset, VkDeviceSize size) const
+	{
+		VkMappedMemoryRange range = {};
+		range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+		range.memory = allocation.m_memory;
+		const VkDeviceSize start = allocation.m_offset + offset;
+		const VkDeviceSize end = size == VK_WHOLE_SIZE ? allocation.m_offset + allocation.m_size : start + size;
+		range.offset = (start / m_nonCoherentAtomSize) * m_nonCoherentAtomSize;
+		range.size = AlignUp(end - range.offset, m_nonCoherentAtomSize);
+		const Block* block = static_cast<const Block*>(allocation.m_block);
+		if (block != nullptr && range.offset + range.size > block->m_size)
+		{
+			range.size = VK_WHOLE_SIZE; // only possible at the tail of a dedicated allocation
+		}
+		return range;
+	}
+
+	VkPhysicalDevice m_physicalDevice;
+	VkDevice m_device;
+	VkPhysicalDeviceMemoryProperties m_memoryProperties;
+	VkDeviceSize m_bufferImageGranularity;
+	VkDeviceSize m_nonCoherentAtomSize;
+	uint32_t m_maxMemoryAllocationCount;
+	uint32_t m_liveDeviceAllocations;
+
+	mutable std::mutex m_mutex;
+	std::vector<std::unique_ptr<Block>> m_blocks;
+	std::vector<std::unique_ptr<DeviceLinearPool>> m_linearPools;
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+// SPIR-V compiled into the executable by cmake/CompileShaders.cmake, looked up by the same path the .spv would be loaded from
+// so nothing else needs to know whether the shaders were embedded. Stored as words so it can go straight into
+// VkShaderModuleCreateInfo::pCode without a copy or a misaligned cast.
+struct EmbeddedShader
+{
+	const char* m_path;
+	const uint32_t* m_code;
+	size_t m_size; // bytes
+};
+
+#ifdef VULKAN_ENGINE_EMBEDDED_SHADERS
+#include "EmbeddedShaderTable.inc"
+#endif
+
+// nullptr if the shader wasn't embedded, or nothing was (no glslc at build time)
+inline const EmbeddedShader* FindEmbeddedShader(const std::string& shaderFilePath)
+{
+#ifdef VULKAN_ENGINE_EMBEDDED_SHADERS
+	for (const EmbeddedShader& shader : s_embeddedShaders)
+	{
+		if (shaderFilePath == shader.m_path)
+		{
+			return &shader;
+		}
+	}
+#endif
+	(void)shaderFilePath;
+	return nullptr;
+}
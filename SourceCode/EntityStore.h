@@ -0,0 +1,418 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <array>
+#include <unordered_map>
+#include <algorithm>
+#include <type_traits>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+#include <new>
+
+#include <glm/glm.hpp>
+
+#include "Alignment.h"
+#include "JobSystem.h"
+
+// Entity component storage grouped by archetype (the exact set of components an entity has).
+// An archetype keeps its entities packed into fixed size chunks with each component in its own contiguous array, so a system
+// that only reads positions and velocities only streams those two arrays through the cache. Removal swaps the archetype's last
+// entity into the hole so chunks never have gaps. Handles are a slot index plus a generation, they stay valid while the entity
+// moves around inside its archetype and stale ones are caught rather than aliasing whatever reused the slot.
+
+struct PositionComponent
+{
+	glm::vec3 m_position;
+};
+
+struct RotationComponent
+{
+	glm::vec4 m_rotation; // quaternion, xyz imaginary, w real
+};
+
+struct ScaleComponent
+{
+	glm::vec3 m_scale;
+};
+
+struct VelocityComponent
+{
+	glm::vec3 m_velocity; // units per second
+};
+
+struct MeshComponent
+{
+	uint32_t m_meshHandle;
+};
+
+struct MaterialComponent
+{
+	uint32_t m_materialHandle;
+};
+
+enum class ComponentType : uint32_t
+{
+	Position,
+	Rotation,
+	Scale,
+	Velocity,
+	Mesh,
+	Material,
+	Count
+};
+
+using ComponentMask = uint32_t;
+
+template <typename T> struct ComponentTraits;
+template <> struct ComponentTraits<PositionComponent> { static constexpr ComponentType S_TYPE = ComponentType::Position; };
+template <> struct ComponentTraits<RotationComponent> { static constexpr ComponentType S_TYPE = ComponentType::Rotation; };
+template <> struct ComponentTraits<ScaleComponent> { static constexpr ComponentType S_TYPE = ComponentType::Scale; };
+template <> struct ComponentTraits<VelocityComponent> { static constexpr ComponentType S_TYPE = ComponentType::Velocity; };
+template <> struct ComponentTraits<MeshComponent> { static constexpr ComponentType S_TYPE = ComponentType::Mesh; };
+template <> struct ComponentTraits<MaterialComponent> { static constexpr ComponentType S_TYPE = ComponentType::Material; };
+
+template <typename... Components>
+constexpr ComponentMask MakeComponentMask()
+{
+	return (0u | ... | (1u << static_cast<uint32_t>(ComponentTraits<Components>::S_TYPE)));
+}
+
+struct Entity
+{
+	static constexpr uint32_t S_INVALID_INDEX = UINT32_MAX;
+
+	uint32_t m_index = S_INVALID_INDEX;
+	uint32_t m_generation = 0;
+
+	bool IsValid() const { return m_index != S_INVALID_INDEX; }
+	bool operator==(const Entity& other) const { return m_index == other.m_index && m_generation == other.m_generation; }
+	bool operator!=(const Entity& other) const { return !(*this == other); }
+};
+
+class EntityStore
+{
+public:
+	static constexpr size_t S_CHUNK_BYTES = 64 * 1024; // a handful of chunks per worker at 1M entities, small enough to stay in L2
+	static constexpr size_t S_CHUNK_ALIGNMENT = 64; // every component array starts on its own cache line
+	static constexpr uint32_t S_MIN_CHUNK_CAPACITY = 64;
+
+	EntityStore()
+		: m_nEntities(0)
+	{}
+
+	EntityStore(const EntityStore&) = delete;
+	EntityStore& operator=(const EntityStore&) = delete;
+
+	// components start zeroed apart from rotation (identity) and scale (one)
+	Entity CreateEntity(ComponentMask componentMask)
+	{
+		const uint32_t archetypeIndex = FindOrCreateArchetype(componentMask);
+		Archetype& archetype = *m_archetypes[archetypeIndex];
+
+		uint32_t slotIndex = 0;
+		if (!m_freeSlots.empty())
+		{
+			slotIndex = m_freeSlots.back();
+			m_freeSlots.pop_back();
+		}
+		else
+		{
+			if (m_slots.size() >= Entity::S_INVALID_INDEX)
+			{
+				throw std::runtime_error("Out of entity slots");
+			}
+			slotIndex = static_cast<uint32_t>(m_slots.size());
+			m_slots.push_back({});
+		}
+
+		const uint32_t row = archetype.m_nEntities++;
+		if (row / archetype.m_chunkCapacity >= archetype.m_chunks.size())
+		{
+			archetype.m_chunks.push_back(std::make_unique<Chunk>(archetype.m_chunkBytes));
+		}
+		uint8_t* chunkData = archetype.m_chunks[row / archetype.m_chunkCapacity]->m_data;
+		const uint32_t chunkRow = row % archetype.m_chunkCapacity;
+		for (uint32_t type = 0; type < S_COMPONENT_TYPE_COUNT; ++type)
+		{
+			if (archetype.m_componentMask & (1u << type))
+			{
+				InitialiseComponent(static_cast<ComponentType>(type), chunkData + archetype.m_componentOffsets[type] + chunkRow * S_COMPONENT_SIZES[type]);
+			}
+		}
+		reinterpret_cast<uint32_t*>(chunkData + archetype.m_slotIndexOffset)[chunkRow] = slotIndex;
+
+		EntitySlot& slot = m_slots[slotIndex];
+		slot.m_archetypeIndex = archetypeIndex;
+		slot.m_row = row;
+		slot.m_alive = true;
+		++m_nEntities;
+		return { slotIndex, slot.m_generation };
+	}
+
+	void DestroyEntity(Entity entity)
+	{
+		if (!IsAlive(entity))
+		{
+			return;
+		}
+		EntitySlot& slot = m_slots[entity.m_index];
+		Archetype& archetype = *m_archetypes[slot.m_archetypeIndex];
+
+		// the archetype's last entity fills the hole
+		const uint32_t lastRow = --archetype.m_nEntities;
+		if (slot.m_row != lastRow)
+		{
+			uint8_t* dstChunk = archetype.m_chunks[slot.m_row / archetype.m_chunkCapacity]->m_data;
+			const uint8_t* srcChunk = archetype.m_chunks[lastRow / archetype.m_chunkCapacity]->m_data;
+			const uint32_t dstRow = slot.m_row % archetype.m_chunkCapacity;
+			const uint32_t srcRow = lastRow % archetype.m_chunkCapacity;
+			for (uint32_t type = 0; type < S_COMPONENT_TYPE_COUNT; ++type)
+			{
+				if (archetype.m_componentMask & (1u << type))
+				{
+					const size_t componentSize = S_COMPONENT_SIZES[type];
+					std::memcpy(dstChunk + archetype.m_componentOffsets[type] + dstRow * componentSize,
+						srcChunk + archetype.m_componentOffsets[type] + srcRow * componentSize, componentSize);
+				}
+			}
+			const uint32_t movedSlotIndex = reinterpret_cast<const uint32_t*>(srcChunk + archetype.m_slotIndexOffset)[srcRow];
+			reinterpret_cast<uint32_t*>(dstChunk + archetype.m_slotIndexOffset)[dstRow] = movedSlotIndex;
+			m_slots[movedSlotIndex].m_row = slot.m_row;
+		}
+
+		slot.m_alive = false;
+		++slot.m_generation; // any handle still out there is now stale
+		m_freeSlots.push_back(entity.m_index);
+		--m_nEntities;
+	}
+
+	bool IsAlive(Entity entity) const
+	{
+		return entity.m_index < m_slots.size() && m_slots[entity.m_index].m_alive && m_slots[entity.m_index].m_generation == entity.m_generation;
+	}
+
+	// nullptr if the entity is gone or doesn't have the component, only valid until the next create or destroy
+	template <typename T>
+	T* GetComponent(Entity entity)
+	{
+		if (!IsAlive(entity))
+		{
+			return nullptr;
+		}
+		const EntitySlot& slot = m_slots[entity.m_index];
+		Archetype& archetype = *m_archetypes[slot.m_archetypeIndex];
+		const uint32_t type = static_cast<uint32_t>(ComponentTraits<T>::S_TYPE);
+		if (!(archetype.m_componentMask & (1u << type)))
+		{
+			return nullptr;
+		}
+		return GetComponentArray<T>(archetype, slot.m_row / archetype.m_chunkCapacity) + slot.m_row % archetype.m_chunkCapacity;
+	}
+
+	// saves the chunk allocations one at a time when building a big scene
+	void Reserve(ComponentMask componentMask, size_t nEntities)
+	{
+		Archetype& archetype = *m_archetypes[FindOrCreateArchetype(componentMask)];
+		const size_t nChunks = (nEntities + archetype.m_chunkCapacity - 1) / archetype.m_chunkCapacity;
+		while (archetype.m_chunks.size() < nChunks)
+		{
+			archetype.m_chunks.push_back(std::make_unique<Chunk>(archetype.m_chunkBytes));
+		}
+		m_slots.reserve(m_slots.size() + nEntities);
+	}
+
+	size_t GetEntityCount() const { return m_nEntities; }
+
+	template <typename... Components>
+	size_t CountEntitiesWith() const
+	{
+		constexpr ComponentMask requiredMask = MakeComponentMask<Components...>();
+		size_t nEntities = 0;
+		for (const std::unique_ptr<Archetype>& archetype : m_archetypes)
+		{
+			if ((archetype->m_componentMask & requiredMask) == requiredMask)
+			{
+				nEntities += archetype->m_nEntities;
+			}
+		}
+		return nEntities;
+	}
+
+	// calls function(firstEntity, count, Components*...) for each chunk of entities having all of Components, firstEntity counts
+	// up across the calls so it can index a flat output array, the order holds until an entity is created or destroyed
+	template <typename... Components, typename Function>
+	void ForEachChunk(const Function& function)
+	{
+		for (const ChunkRange& range : GatherChunks<Components...>())
+		{
+			function(range.m_firstEntity, range.m_count, GetComponentArray<Components>(*range.m_archetype, range.m_chunkIndex)...);
+		}
+	}
+
+	// same as ForEachChunk() with the chunks spread over the job system, function gets called from several threads at once
+	template <typename... Components, typename Function>
+	void ParallelForEachChunk(JobSystem& jobSystem, const Function& function)
+	{
+		const std::vector<ChunkRange> ranges = GatherChunks<Components...>();
+		jobSystem.ParallelFor(ranges.size(), 1, [this, &ranges, &function](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				const ChunkRange& range = ranges[i];
+				function(range.m_firstEntity, range.m_count, GetComponentArray<Components>(*range.m_archetype, range.m_chunkIndex)...);
+			}
+		});
+	}
+
+private:
+	static constexpr uint32_t S_COMPONENT_TYPE_COUNT = static_cast<uint32_t>(ComponentType::Count);
+	static constexpr size_t S_COMPONENT_SIZES[S_COMPONENT_TYPE_COUNT] =
+	{
+		sizeof(PositionComponent),
+		sizeof(RotationComponent),
+		sizeof(ScaleComponent),
+		sizeof(VelocityComponent),
+		sizeof(MeshComponent),
+		sizeof(MaterialComponent),
+	};
+
+	static_assert(std::is_trivially_copyable<PositionComponent>::value && std::is_trivially_copyable<RotationComponent>::value
+		&& std::is_trivially_copyable<ScaleComponent>::value && std::is_trivially_copyable<VelocityComponent>::value
+		&& std::is_trivially_copyable<MeshComponent>::value && std::is_trivially_copyable<MaterialComponent>::value,
+		"components are moved around with memcpy");
+
+	struct Chunk
+	{
+		explicit Chunk(size_t nBytes)
+			: m_data(static_cast<uint8_t*>(::operator new(nBytes, std::align_val_t(S_CHUNK_ALIGNMENT))))
+		{}
+
+		~Chunk()
+		{
+			::operator delete(m_data, std::align_val_t(S_CHUNK_ALIGNMENT));
+		}
+
+		Chunk(const Chunk&) = delete;
+		Chunk& operator=(const Chunk&) = delete;
+
+		uint8_t* m_data;
+	};
+
+	struct Archetype
+	{
+		ComponentMask m_componentMask = 0;
+		uint32_t m_chunkCapacity = 0;
+		size_t m_chunkBytes = 0;
+		std::array<size_t, S_COMPONENT_TYPE_COUNT> m_componentOffsets = {}; // where each component's array starts in a chunk
+		size_t m_slotIndexOffset = 0; // back references from rows to slots, to fix the slot up when a row moves
+		uint32_t m_nEntities = 0; // rows [0, m_nEntities) are live, packed from the first chunk on
+		std::vector<std::unique_ptr<Chunk>> m_chunks; // anything past the live rows is kept for reuse
+	};
+
+	struct EntitySlot
+	{
+		uint32_t m_generation = 0;
+		uint32_t m_archetypeIndex = 0;
+		uint32_t m_row = 0;
+		bool m_alive = false;
+	};
+
+	struct ChunkRange
+	{
+		Archetype* m_archetype;
+		size_t m_chunkIndex;
+		size_t m_firstEntity;
+		size_t m_count;
+	};
+
+	static void InitialiseComponent(ComponentType type, void* component)
+	{
+		switch (type)
+		{
+		case ComponentType::Rotation:
+			static_cast<RotationComponent*>(component)->m_rotation = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+			break;
+		case ComponentType::Scale:
+			static_cast<ScaleComponent*>(component)->m_scale = glm::vec3(1.0f);
+			break;
+		default:
+			std::memset(component, 0, S_COMPONENT_SIZES[static_cast<uint32_t>(type)]);
+			break;
+		}
+	}
+
+	template <typename T>
+	static T* GetComponentArray(Archetype& archetype, size_t chunkIndex)
+	{
+		return reinterpret_cast<T*>(archetype.m_chunks[chunkIndex]->m_data + archetype.m_componentOffsets[static_cast<uint32_t>(ComponentTraits<T>::S_TYPE)]);
+	}
+
+	uint32_t FindOrCreateArchetype(ComponentMask componentMask)
+	{
+		const auto found = m_archetypeLookup.find(componentMask);
+		if (found != m_archetypeLookup.end())
+		{
+			return found->second;
+		}
+
+		std::unique_ptr<Archetype> archetype = std::make_unique<Archetype>();
+		archetype->m_componentMask = componentMask;
+		size_t entityBytes = sizeof(uint32_t); // the slot back reference
+		for (uint32_t type = 0; type < S_COMPONENT_TYPE_COUNT; ++type)
+		{
+			if (componentMask & (1u << type))
+			{
+				entityBytes += S_COMPONENT_SIZES[type];
+			}
+		}
+		archetype->m_chunkCapacity = std::max(static_cast<uint32_t>(S_CHUNK_BYTES / entityBytes), S_MIN_CHUNK_CAPACITY);
+
+		// every array padded out to a cache line so two arrays never share one
+		size_t offset = 0;
+		for (uint32_t type = 0; type < S_COMPONENT_TYPE_COUNT; ++type)
+		{
+			if (componentMask & (1u << type))
+			{
+				archetype->m_componentOffsets[type] = offset;
+				offset = static_cast<size_t>(AlignUp(offset + S_COMPONENT_SIZES[type] * archetype->m_chunkCapacity, S_CHUNK_ALIGNMENT));
+			}
+		}
+		archetype->m_slotIndexOffset = offset;
+		archetype->m_chunkBytes = static_cast<size_t>(AlignUp(offset + sizeof(uint32_t) * archetype->m_chunkCapacity, S_CHUNK_ALIGNMENT));
+
+		const uint32_t archetypeIndex = static_cast<uint32_t>(m_archetypes.size());
+		m_archetypes.push_back(std::move(archetype));
+		m_archetypeLookup.emplace(componentMask, archetypeIndex);
+		return archetypeIndex;
+	}
+
+	template <typename... Components>
+	std::vector<ChunkRange> GatherChunks()
+	{
+		constexpr ComponentMask requiredMask = MakeComponentMask<Components...>();
+		std::vector<ChunkRange> ranges;
+		size_t firstEntity = 0;
+		for (std::unique_ptr<Archetype>& archetype : m_archetypes)
+		{
+			if ((archetype->m_componentMask & requiredMask) != requiredMask)
+			{
+				continue;
+			}
+			for (size_t chunkIndex = 0; chunkIndex * archetype->m_chunkCapacity < archetype->m_nEntities; ++chunkIndex)
+			{
+				const size_t count = std::min<size_t>(archetype->m_chunkCapacity, archetype->m_nEntities - chunkIndex * archetype->m_chunkCapacity);
+				ranges.push_back({ archetype.get(), chunkIndex, firstEntity, count });
+				firstEntity += count;
+			}
+		}
+		return ranges;
+	}
+
+	std::vector<std::unique_ptr<Archetype>> m_archetypes;
+	std::unordered_map<ComponentMask, uint32_t> m_archetypeLookup;
+	std::vector<EntitySlot> m_slots;
+	std::vector<uint32_t> m_freeSlots;
+	size_t m_nEntities;
+};
@@ -0,0 +1,254 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <atomic>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "DeviceMemoryAllocator.h"
+
+// a sub-range of the frame's part of the ring, pass m_dynamicOffset to vkCmdBindDescriptorSets for the binding it was allocated for
+struct FrameDataAllocation
+{
+	void* m_data = nullptr; // persistently mapped, write it before the frame's submitted
+	uint32_t m_dynamicOffset = 0;
+};
+
+// Transient per frame uniform and storage data. One persistently mapped buffer split into a region per frame in flight, each
+// handed out linearly (an atomic bump, so the recording threads can allocate at the same time) and reset whole when the frame
+// slot comes round again. A region is only reused once the graphics timeline has passed the value the slot's last frame signalled.
+// Everything's bound through one descriptor set with a dynamic uniform buffer and a dynamic storage buffer over the whole ring,
+// so allocating needs no descriptor updates, just a new dynamic offset when the set's bound.
+class FrameDataRing
+{
+public:
+	// bindings in the set, the shaders' set 0
+	static constexpr uint32_t S_UNIFORM_BINDING = 0;
+	static constexpr uint32_t S_STORAGE_BINDING = 1;
+	static constexpr uint32_t S_BINDING_COUNT = 2;
+	// how much the descriptors can see from each dynamic offset, so the most that can go in one allocation.
+	// The uniform range is the smallest maxUniformBufferRange the spec allows, the storage range's well under its minimum
+	static constexpr VkDeviceSize S_UNIFORM_RANGE = 16 * 1024;
+	static constexpr VkDeviceSize S_STORAGE_RANGE = 256 * 1024;
+	static constexpr VkDeviceSize S_DEFAULT_BYTES_PER_FRAME = 1024 * 1024;
+
+	FrameDataRing()
+		: m_device(nullptr)
+		, m_allocator(nullptr)
+		, m_buffer(nullptr)
+		, m_descriptorSetLayout(nullptr)
+		, m_descriptorPool(nullptr)
+		, m_descriptorSet(nullptr)
+		, m_alignment(256)
+		, m_bytesPerFrame(0)
+		, m_currentFrame(0)
+		, m_frameBytesUsed(0)
+	{}
+
+	FrameDataRing(const FrameDataRing&) = delete;
+	FrameDataRing& operator=(const FrameDataRing&) = delete;
+
+	void Init(VkPhysicalDevice physicalDevice, VkDevice device, DeviceMemoryAllocator& allocator, uint32_t nFramesInFlight, VkDeviceSize bytesPerFrame = S_DEFAULT_BYTES_PER_FRAME)
+	{
+		m_device = device;
+		m_allocator = &allocator;
+
+		VkPhysicalDeviceProperties deviceProperties = {};
+		vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+		m_alignment = (std::max)({ deviceProperties.limits.minUniformBufferOffsetAlignment, deviceProperties.limits.minStorageBufferOffsetAlignment, static_cast<VkDeviceSize>(16) });
+		m_bytesPerFrame = AlignUp((std::max)(bytesPerFrame, S_STORAGE_RANGE), m_alignment);
+
+		m_frames.assign((std::max)(nFramesInFlight, 1u), FrameRegion());
+		for (size_t i = 0; i < m_frames.size(); ++i)
+		{
+			m_frames[i].m_start = m_bytesPerFrame * i;
+		}
+
+		// the tail past the last region is only there so a binding's range from the last offset stays inside the buffer
+		VkBufferCreateInfo bufCreateInfo = {};
+		bufCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufCreateInfo.size = m_bytesPerFrame * m_frames.size() + (std::max)(S_UNIFORM_RANGE, S_STORAGE_RANGE);
+		bufCreateInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+		bufCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		if (vkCreateBuffer(m_device, &bufCreateInfo, nullptr, &m_buffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create the frame data ring buffer");
+		}
+		// device local as well when there's a heap that's both (ReBAR, UMA), the GPU reads everything in here once a frame at most
+		m_allocation = m_allocator->AllocateForBuffer(m_buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		CreateDescriptorSet();
+	}
+
+	void Shutdown()
+	{
+		if (m_device)
+		{
+			vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr); // frees the set with it
+			vkDestroyDescriptorSetLayout(m_device, m_descriptorSetLayout, nullptr);
+			vkDestroyBuffer(m_device, m_buffer, nullptr);
+			m_allocator->Free(m_allocation);
+		}
+		m_descriptorPool = nullptr;
+		m_descriptorSet = nullptr;
+		m_descriptorSetLayout = nullptr;
+		m_buffer = nullptr;
+		m_frames.clear();
+		m_device = nullptr;
+	}
+
+	VkDescriptorSetLayout GetDescriptorSetLayout() const { return m_descriptorSetLayout; }
+	VkDescriptorSet GetDescriptorSet() const { return m_descriptorSet; }
+	VkDeviceSize GetBytesPerFrame() const { return m_bytesPerFrame; }
+	VkDeviceSize GetFrameBytesUsed() const { return (std::min)(m_frameBytesUsed.load(std::memory_order_relaxed), m_bytesPerFrame); }
+
+	// once the frame slot's been waited on, completedTimelineValue is the graphics timeline value it's known to have reached
+	void BeginFrame(size_t frameSlot, uint64_t completedTimelineValue)
+	{
+		if (completedTimelineValue < m_frames[frameSlot].m_timelineValue)
+		{
+			throw std::runtime_error("Frame data reused before the GPU finished with it");
+		}
+		m_currentFrame = frameSlot;
+		m_frameBytesUsed.store(0, std::memory_order_relaxed);
+	}
+
+	// thread safe, can be called from the recording threads
+	FrameDataAllocation AllocateUniform(VkDeviceSize size)
+	{
+		if (size > S_UNIFORM_RANGE)
+		{
+			throw std::runtime_error("Frame uniform data of " + std::to_string(size) + " bytes is more than a binding can see");
+		}
+		return Allocate(size);
+	}
+
+	FrameDataAllocation AllocateStorage(VkDeviceSize size)
+	{
+		if (size > S_STORAGE_RANGE)
+		{
+			throw std::runtime_error("Frame storage data of " + std::to_string(size) + " bytes is more than a binding can see");
+		}
+		return Allocate(size);
+	}
+
+	// after the frame's recorded, before it's submitted
+	void Flush()
+	{
+		const VkDeviceSize bytesUsed = GetFrameBytesUsed();
+		if (bytesUsed > 0)
+		{
+			m_allocator->FlushAllocation(m_allocation, m_frames[m_currentFrame].m_start, bytesUsed);
+		}
+	}
+
+	void OnFrameSubmitted(uint64_t timelineValue)
+	{
+		m_frames[m_currentFrame].m_timelineValue = timelineValue;
+	}
+
+private:
+	struct FrameRegion
+	{
+		VkDeviceSize m_start = 0;
+		uint64_t m_timelineValue = 0; // graphics timeline value of the last frame that used the region
+	};
+
+	FrameDataAllocation Allocate(VkDeviceSize size)
+	{
+		const VkDeviceSize alignedSize = AlignUp((std::max)(size, static_cast<VkDeviceSize>(1)), m_alignment);
+		const VkDeviceSize offset = m_frameBytesUsed.fetch_add(alignedSize, std::memory_order_relaxed);
+		if (offset + alignedSize > m_bytesPerFrame)
+		{
+			throw std::runtime_error("Out of frame data, " + std::to_string(m_bytesPerFrame) + " bytes per frame isn't enough");
+		}
+		const VkDeviceSize ringOffset = m_frames[m_currentFrame].m_start + offset;
+		FrameDataAllocation allocation;
+		allocation.m_data = static_cast<uint8_t*>(m_allocation.m_mappedData) + ringOffset;
+		allocation.m_dynamicOffset = static_cast<uint32_t>(ringOffset);
+		return allocation;
+	}
+
+	void CreateDescriptorSet()
+	{
+		std::array<VkDescriptorSetLayoutBinding, S_BINDING_COUNT> bindings = {};
+		bindings[S_UNIFORM_BINDING].binding = S_UNIFORM_BINDING;
+		bindings[S_UNIFORM_BINDING].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		bindings[S_STORAGE_BINDING].binding = S_STORAGE_BINDING;
+		bindings[S_STORAGE_BINDING].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+		for (VkDescriptorSetLayoutBinding& binding : bindings)
+		{
+			binding.descriptorCount = 1;
+			binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+		}
+		VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+		setLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		setLayoutCreateInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+		setLayoutCreateInfo.pBindings = bindings.data();
+		if (vkCreateDescriptorSetLayout(m_device, &setLayoutCreateInfo, nullptr, &m_descriptorSetLayout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create the frame data descriptor set layout");
+		}
+
+		std::array<VkDescriptorPoolSize, S_BINDING_COUNT> poolSizes = {};
+		poolSizes[S_UNIFORM_BINDING].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		poolSizes[S_UNIFORM_BINDING].descriptorCount = 1;
+		poolSizes[S_STORAGE_BINDING].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+		poolSizes[S_STORAGE_BINDING].descriptorCount = 1;
+		VkDescriptorPoolCreateInfo poolCreateInfo = {};
+		poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolCreateInfo.maxSets = 1;
+		poolCreateInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+		poolCreateInfo.pPoolSizes = poolSizes.data();
+		if (vkCreateDescriptorPool(m_device, &poolCreateInfo, nullptr, &m_descriptorPool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create the frame data descriptor pool");
+		}
+
+		VkDescriptorSetAllocateInfo setAllocInfo = {};
+		setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		setAllocInfo.descriptorPool = m_descriptorPool;
+		setAllocInfo.descriptorSetCount = 1;
+		setAllocInfo.pSetLayouts = &m_descriptorSetLayout;
+		if (vkAllocateDescriptorSets(m_device, &setAllocInfo, &m_descriptorSet) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to allocate the frame data descriptor set");
+		}
+
+		// written once, every allocation after this is just a dynamic offset into it
+		std::array<VkDescriptorBufferInfo, S_BINDING_COUNT> bufferInfos = {};
+		bufferInfos[S_UNIFORM_BINDING].range = S_UNIFORM_RANGE;
+		bufferInfos[S_STORAGE_BINDING].range = S_STORAGE_RANGE;
+		std::array<VkWriteDescriptorSet, S_BINDING_COUNT> descriptorWrites = {};
+		for (uint32_t binding = 0; binding < S_BINDING_COUNT; ++binding)
+		{
+			bufferInfos[binding].buffer = m_buffer;
+			bufferInfos[binding].offset = 0;
+			descriptorWrites[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descriptorWrites[binding].dstSet = m_descriptorSet;
+			descriptorWrites[binding].dstBinding = binding;
+			descriptorWrites[binding].descriptorCount = 1;
+			descriptorWrites[binding].descriptorType = bindings[binding].descriptorType;
+			descriptorWrites[binding].pBufferInfo = &bufferInfos[binding];
+		}
+		vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	}
+
+	VkDevice m_device;
+	DeviceMemoryAllocator* m_allocator;
+	VkBuffer m_buffer;
+	DeviceAllocation m_allocation;
+	VkDescriptorSetLayout m_descriptorSetLayout;
+	VkDescriptorPool m_descriptorPool;
+	VkDescriptorSet m_descriptorSet;
+	VkDeviceSize m_alignment; // covers both uniform and storage offsets
+	VkDeviceSize m_bytesPerFrame;
+	std::vector<FrameRegion> m_frames;
+	size_t m_currentFrame;
+	std::atomic<VkDeviceSize> m_frameBytesUsed; // can go past m_bytesPerFrame when an allocation fails
+};
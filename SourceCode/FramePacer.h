@@ -0,0 +1,188 @@
+#pragma once
+
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <cstdint>
+
+#include "Profiler.h"
+
+enum class PresentPolicy : uint32_t
+{
+	LowLatency, // MAILBOX, or FIFO without it, and the CPU starts each frame as late as it can without the GPU running dry
+	Throughput, // IMMEDIATE, or MAILBOX, or FIFO, and every frame starts as soon as the CPU can start it
+};
+
+// Times the CPU side of each frame and decides when the next one starts. Per frame it measures:
+//	CPU wait, time blocked waiting for the frame slot and in the acquire, so the CPU waiting on the GPU or the display
+//	GPU wait, a lower bound on the GPU sitting idle waiting for the CPU: when everything submitted had already finished as the
+//		frame started, it's been idle at least from then until this frame's submit
+//	acquire to present, how long the CPU holds on to a swap chain image
+//	latency, frame start (before input's polled) to present, or to submit headless
+// A CPU that keeps waiting on the GPU means frames are queued up ahead of it, each built from older input than it needed to be.
+// With LowLatency that wait gets moved to the start of the frame, before input's polled, by sleeping there for most of it;
+// S_WAIT_MARGIN_NS is left in so jitter doesn't starve the GPU, and the delay halves on any frame the GPU went idle.
+// Throughput never delays. Not thread safe, it's driven from the thread running the frames.
+class FramePacer
+{
+public:
+	static constexpr uint32_t S_MIN_FRAMES_IN_FLIGHT = 1;
+	static constexpr uint32_t S_MAX_FRAMES_IN_FLIGHT = 4;
+	static constexpr uint64_t S_WAIT_MARGIN_NS = 500000;
+	static constexpr uint64_t S_MAX_DELAY_NS = 50000000;
+	static constexpr double S_DELAY_GAIN = 0.25; // fraction of the average CPU wait over the margin added to the delay each frame
+	static constexpr double S_SMOOTHING = 0.1; // weight of the newest frame in the averages
+
+	FramePacer()
+		: m_policy(PresentPolicy::LowLatency)
+		, m_delayNs(0)
+		, m_frameStartMarked(false)
+		, m_frameStartNs(0)
+		, m_gpuIdleSinceNs(0)
+		, m_acquiredNs(0)
+		, m_submittedNs(0)
+		, m_presentedNs(0)
+		, m_frameCpuWaitNs(0)
+		, m_frameGpuWaitNs(0)
+		, m_averageCpuWaitNs(0.0)
+		, m_averageGpuWaitNs(0.0)
+		, m_averageAcquireToPresentNs(0.0)
+		, m_averageLatencyNs(0.0)
+		, m_nFrames(0)
+	{}
+
+	void Init(PresentPolicy policy)
+	{
+		m_policy = policy;
+		m_delayNs = 0;
+		m_nFrames = 0;
+	}
+
+	PresentPolicy GetPolicy() const { return m_policy; }
+
+	// sleeps off the pacing delay, call before input's polled. Optional, BeginFrame() marks the start without it
+	void WaitForFrameStart()
+	{
+		if (m_policy == PresentPolicy::LowLatency && m_delayNs > 0)
+		{
+			std::this_thread::sleep_for(std::chrono::nanoseconds(m_delayNs));
+		}
+		m_frameStartNs = Profiler::NowNs();
+		m_frameStartMarked = true;
+	}
+
+	void BeginFrame()
+	{
+		if (!m_frameStartMarked)
+		{
+			m_frameStartNs = Profiler::NowNs();
+		}
+		m_frameStartMarked = false;
+		m_gpuIdleSinceNs = 0;
+		m_acquiredNs = 0;
+		m_submittedNs = 0;
+		m_presentedNs = 0;
+		m_frameCpuWaitNs = 0;
+		m_frameGpuWaitNs = 0;
+	}
+
+	// everything submitted so far has finished
+	void OnGpuIdle()
+	{
+		if (m_gpuIdleSinceNs == 0)
+		{
+			m_gpuIdleSinceNs = Profiler::NowNs();
+		}
+	}
+
+	void AddCpuWait(uint64_t waitNs) { m_frameCpuWaitNs += waitNs; }
+	void OnAcquired() { m_acquiredNs = Profiler::NowNs(); }
+
+	void OnSubmitted()
+	{
+		m_submittedNs = Profiler::NowNs();
+		if (m_gpuIdleSinceNs != 0)
+		{
+			m_frameGpuWaitNs = m_submittedNs - m_gpuIdleSinceNs;
+		}
+	}
+
+	void OnPresented() { m_presentedNs = Profiler::NowNs(); }
+
+	// after the frame's been submitted (and presented), works out the next frame's delay
+	void EndFrame()
+	{
+		const uint64_t endNs = m_presentedNs != 0 ? m_presentedNs : m_submittedNs;
+		if (endNs == 0)
+		{
+			return; // nothing got submitted, e.g. the swap chain was out of date
+		}
+		Accumulate(m_averageCpuWaitNs, static_cast<double>(m_frameCpuWaitNs));
+		Accumulate(m_averageGpuWaitNs, static_cast<double>(m_frameGpuWaitNs));
+		Accumulate(m_averageLatencyNs, static_cast<double>(endNs - m_frameStartNs));
+		if (m_presentedNs != 0 && m_acquiredNs != 0)
+		{
+			Accumulate(m_averageAcquireToPresentNs, static_cast<double>(m_presentedNs - m_acquiredNs));
+		}
+		++m_nFrames;
+
+		if (m_policy != PresentPolicy::LowLatency)
+		{
+			return;
+		}
+		if (m_frameGpuWaitNs > 0)
+		{
+			m_delayNs /= 2; // started too late, the GPU ran dry
+			return;
+		}
+		const double delayNs = static_cast<double>(m_delayNs) + (m_averageCpuWaitNs - static_cast<double>(S_WAIT_MARGIN_NS)) * S_DELAY_GAIN;
+		m_delayNs = static_cast<uint64_t>((std::min)((std::max)(delayNs, 0.0), static_cast<double>(S_MAX_DELAY_NS)));
+	}
+
+	double GetDelayMs() const { return NsToMs(static_cast<double>(m_delayNs)); }
+	double GetAverageCpuWaitMs() const { return NsToMs(m_averageCpuWaitNs); }
+	double GetAverageGpuWaitMs() const { return NsToMs(m_averageGpuWaitNs); }
+	double GetAverageAcquireToPresentMs() const { return NsToMs(m_averageAcquireToPresentNs); }
+	double GetAverageLatencyMs() const { return NsToMs(m_averageLatencyNs); }
+
+	void PrintStats(std::ostream& out) const
+	{
+		if (m_nFrames == 0)
+		{
+			return;
+		}
+		const std::ios::fmtflags oldFlags = out.flags();
+		const std::streamsize oldPrecision = out.precision();
+		out << std::fixed << std::setprecision(2) << "Frame pacing (" << (m_policy == PresentPolicy::LowLatency ? "low latency" : "throughput") << "): latency "
+			<< GetAverageLatencyMs() << "ms, acquire to present " << GetAverageAcquireToPresentMs() << "ms, CPU wait " << GetAverageCpuWaitMs()
+			<< "ms, GPU wait " << GetAverageGpuWaitMs() << "ms, start delay " << GetDelayMs() << "ms" << std::endl;
+		out.flags(oldFlags);
+		out.precision(oldPrecision);
+	}
+
+private:
+	void Accumulate(double& average, double value) const
+	{
+		average = m_nFrames == 0 ? value : average + (value - average) * S_SMOOTHING;
+	}
+
+	static double NsToMs(double ns) { return ns / 1000000.0; }
+
+	PresentPolicy m_policy;
+	uint64_t m_delayNs;
+	bool m_frameStartMarked;
+	uint64_t m_frameStartNs;
+	uint64_t m_gpuIdleSinceNs; // 0 unless the GPU was seen idle this frame
+	uint64_t m_acquiredNs;
+	uint64_t m_submittedNs;
+	uint64_t m_presentedNs;
+	uint64_t m_frameCpuWaitNs;
+	uint64_t m_frameGpuWaitNs;
+	double m_averageCpuWaitNs;
+	double m_averageGpuWaitNs;
+	double m_averageAcquireToPresentNs;
+	double m_averageLatencyNs;
+	uint64_t m_nFrames;
+};
@@ -0,0 +1,373 @@
+#pragma once
+
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "JobSystem.h"
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define FRUSTUM_CULLER_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif // _MSC_VER
+#endif
+
+#if defined(FRUSTUM_CULLER_X86) && !defined(_MSC_VER)
+#define FRUSTUM_CULLER_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define FRUSTUM_CULLER_TARGET_AVX2
+#endif
+
+// Frustum culling over structure of arrays bounds, every instance has a bounding sphere (cheap, rejects most of what's off
+// screen) and an AABB (tighter, only tested for whatever the spheres let through). The kernels test 8 instances at a time with
+// AVX2 when the CPU has it, 4 with SSE otherwise and fall back to scalar code off x86. Batches run in parallel on the job system
+// and the result is one compact list of visible instance indices, in the same order as the bounds.
+
+// world space bounds, one entry per instance in each array
+struct CullingBounds
+{
+	std::vector<float> m_centreX;
+	std::vector<float> m_centreY;
+	std::vector<float> m_centreZ;
+	std::vector<float> m_radius;
+	std::vector<float> m_extentX; // AABB half extents around the same centre
+	std::vector<float> m_extentY;
+	std::vector<float> m_extentZ;
+
+	void Resize(size_t nInstances)
+	{
+		m_centreX.resize(nInstances);
+		m_centreY.resize(nInstances);
+		m_centreZ.resize(nInstances);
+		m_radius.resize(nInstances);
+		m_extentX.resize(nInstances);
+		m_extentY.resize(nInstances);
+		m_extentZ.resize(nInstances);
+	}
+
+	size_t Size() const { return m_centreX.size(); }
+
+	void Copy(size_t index, const CullingBounds& source, size_t sourceIndex)
+	{
+		m_centreX[index] = source.m_centreX[sourceIndex];
+		m_centreY[index] = source.m_centreY[sourceIndex];
+		m_centreZ[index] = source.m_centreZ[sourceIndex];
+		m_radius[index] = source.m_radius[sourceIndex];
+		m_extentX[index] = source.m_extentX[sourceIndex];
+		m_extentY[index] = source.m_extentY[sourceIndex];
+		m_extentZ[index] = source.m_extentZ[sourceIndex];
+	}
+
+	void Set(size_t index, const glm::vec3& centre, const glm::vec3& halfExtents)
+	{
+		m_centreX[index] = centre.x;
+		m_centreY[index] = centre.y;
+		m_centreZ[index] = centre.z;
+		m_extentX[index] = halfExtents.x;
+		m_extentY[index] = halfExtents.y;
+		m_extentZ[index] = halfExtents.z;
+		m_radius[index] = std::sqrt(halfExtents.x * halfExtents.x + halfExtents.y * halfExtents.y + halfExtents.z * halfExtents.z);
+	}
+};
+
+// planes point inwards, a point p is inside when dot(plane.xyz, p) + plane.w >= 0 for all of them
+struct Frustum
+{
+	glm::vec4 m_planes[6];
+
+	// Vulkan clip space, depth from 0 to 1
+	static Frustum FromViewProjection(const glm::mat4& viewProjection)
+	{
+		const glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+		const glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+		const glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+		const glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+		Frustum frustum;
+		frustum.m_planes[0] = row3 + row0; // left
+		frustum.m_planes[1] = row3 - row0; // right
+		frustum.m_planes[2] = row3 + row1; // top (y points down in Vulkan clip space)
+		frustum.m_planes[3] = row3 - row1; // bottom
+		frustum.m_planes[4] = row2; // near
+		frustum.m_planes[5] = row3 - row2; // far
+		for (glm::vec4& plane : frustum.m_planes)
+		{
+			const float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+			plane = length > 0.0f ? plane / length : plane;
+		}
+		return frustum;
+	}
+};
+
+class FrustumCuller
+{
+public:
+	enum class InstructionSet
+	{
+		Scalar,
+		Sse,
+		Avx2
+	};
+
+	static constexpr size_t S_INSTANCES_PER_BATCH = 4096; // a multiple of 8 so only the last batch has a partial SIMD tail
+
+	FrustumCuller()
+		: m_instructionSet(DetectInstructionSet())
+		, m_lastCullMs(0.0)
+	{}
+
+	// returns the indices of the visible instances in ascending order, valid until the next call
+	const std::vector<uint32_t>& Cull(JobSystem& jobSystem, const Frustum& frustum, const CullingBounds& bounds)
+	{
+		const auto cullStart = std::chrono::high_resolution_clock::now();
+		const size_t nInstances = bounds.Size();
+		const size_t nBatches = (nInstances + S_INSTANCES_PER_BATCH - 1) / S_INSTANCES_PER_BATCH;
+		m_visibleIndices.resize(nInstances);
+		m_batchVisibleCounts.resize(nBatches);
+
+		// each batch writes its visible indices at its own start, then they're packed down
+		jobSystem.ParallelFor(nBatches, 1, [this, &frustum, &bounds, nInstances](size_t firstBatch, size_t endBatch)
+		{
+			for (size_t batch = firstBatch; batch < endBatch; ++batch)
+			{
+				const size_t begin = batch * S_INSTANCES_PER_BATCH;
+				const size_t end = std::min(begin + S_INSTANCES_PER_BATCH, nInstances);
+				m_batchVisibleCounts[batch] = CullRange(frustum, bounds, begin, end, m_visibleIndices.data() + begin);
+			}
+		});
+
+		size_t nVisible = 0;
+		for (size_t batch = 0; batch < nBatches; ++batch)
+		{
+			const size_t batchStart = batch * S_INSTANCES_PER_BATCH;
+			if (nVisible != batchStart)
+			{
+				std::copy(m_visibleIndices.begin() + batchStart, m_visibleIndices.begin() + batchStart + m_batchVisibleCounts[batch], m_visibleIndices.begin() + nVisible);
+			}
+			nVisible += m_batchVisibleCounts[batch];
+		}
+		m_visibleIndices.resize(nVisible);
+		m_lastCullMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - cullStart).count();
+		return m_visibleIndices;
+	}
+
+	// writes the visible indices from [begin, end) to visibleOut, returns how many there were
+	size_t CullRange(const Frustum& frustum, const CullingBounds& bounds, size_t begin, size_t end, uint32_t* visibleOut) const
+	{
+#ifdef FRUSTUM_CULLER_X86
+		if (m_instructionSet == InstructionSet::Avx2)
+		{
+			return CullRangeAvx2(frustum, bounds, begin, end, visibleOut);
+		}
+		if (m_instructionSet == InstructionSet::Sse)
+		{
+			return CullRangeSse(frustum, bounds, begin, end, visibleOut);
+		}
+#endif // FRUSTUM_CULLER_X86
+		return CullRangeScalar(frustum, bounds, begin, end, visibleOut);
+	}
+
+	// can't go above what the CPU supports, lets the kernels be compared against each other
+	void SetInstructionSet(InstructionSet instructionSet)
+	{
+		m_instructionSet = std::min(instructionSet, DetectInstructionSet());
+	}
+
+	InstructionSet GetInstructionSet() const { return m_instructionSet; }
+
+	static const char* GetInstructionSetName(InstructionSet instructionSet)
+	{
+		switch (instructionSet)
+		{
+		case InstructionSet::Avx2: return "AVX2";
+		case InstructionSet::Sse: return "SSE";
+		default: return "scalar";
+		}
+	}
+
+	double GetLastCullMs() const { return m_lastCullMs; }
+
+	static InstructionSet DetectInstructionSet()
+	{
+#ifdef FRUSTUM_CULLER_X86
+#ifdef _MSC_VER
+		int cpuInfo[4] = {};
+		__cpuid(cpuInfo, 0);
+		if (cpuInfo[0] >= 7)
+		{
+			__cpuid(cpuInfo, 1);
+			const bool osSavesYmm = (cpuInfo[2] & (1 << 27)) && (cpuInfo[2] & (1 << 28)) && ((_xgetbv(0) & 0x6) == 0x6); // OSXSAVE, AVX and the OS saving the YMM registers
+			__cpuidex(cpuInfo, 7, 0);
+			if (osSavesYmm && (cpuInfo[1] & (1 << 5)))
+			{
+				return InstructionSet::Avx2;
+			}
+		}
+		return InstructionSet::Sse;
+#else
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2") ? InstructionSet::Avx2 : InstructionSet::Sse;
+#endif // _MSC_VER
+#else
+		return InstructionSet::Scalar;
+#endif // FRUSTUM_CULLER_X86
+	}
+
+private:
+	static size_t CullRangeScalar(const Frustum& frustum, const CullingBounds& bounds, size_t begin, size_t end, uint32_t* visibleOut)
+	{
+		size_t nVisible = 0;
+		for (size_t i = begin; i < end; ++i)
+		{
+			bool visible = true;
+			for (int plane = 0; plane < 6 && visible; ++plane)
+			{
+				const glm::vec4& p = frustum.m_planes[plane];
+				const float distance = p.x * bounds.m_centreX[i] + p.y * bounds.m_centreY[i] + p.z * bounds.m_centreZ[i] + p.w;
+				const float projectedExtent = std::abs(p.x) * bounds.m_extentX[i] + std::abs(p.y) * bounds.m_extentY[i] + std::abs(p.z) * bounds.m_extentZ[i];
+				visible = distance > -bounds.m_radius[i] && distance > -projectedExtent;
+			}
+			visibleOut[nVisible] = static_cast<uint32_t>(i);
+			nVisible += visible ? 1 : 0;
+		}
+		return nVisible;
+	}
+
+	static uint32_t CountTrailingZeros(uint32_t value)
+	{
+#ifdef _MSC_VER
+		unsigned long index = 0;
+		_BitScanForward(&index, value);
+		return static_cast<uint32_t>(index);
+#else
+		return static_cast<uint32_t>(__builtin_ctz(value));
+#endif // _MSC_VER
+	}
+
+#ifdef FRUSTUM_CULLER_X86
+	static size_t CullRangeSse(const Frustum& frustum, const CullingBounds& bounds, size_t begin, size_t end, uint32_t* visibleOut)
+	{
+		__m128 planeX[6], planeY[6], planeZ[6], planeW[6], planeAbsX[6], planeAbsY[6], planeAbsZ[6];
+		for (int plane = 0; plane < 6; ++plane)
+		{
+			const glm::vec4& p = frustum.m_planes[plane];
+			planeX[plane] = _mm_set1_ps(p.x);
+			planeY[plane] = _mm_set1_ps(p.y);
+			planeZ[plane] = _mm_set1_ps(p.z);
+			planeW[plane] = _mm_set1_ps(p.w);
+			planeAbsX[plane] = _mm_set1_ps(std::abs(p.x));
+			planeAbsY[plane] = _mm_set1_ps(std::abs(p.y));
+			planeAbsZ[plane] = _mm_set1_ps(std::abs(p.z));
+		}
+
+		size_t nVisible = 0;
+		size_t i = begin;
+		for (; i + 4 <= end; i += 4)
+		{
+			const __m128 centreX = _mm_loadu_ps(&bounds.m_centreX[i]);
+			const __m128 centreY = _mm_loadu_ps(&bounds.m_centreY[i]);
+			const __m128 centreZ = _mm_loadu_ps(&bounds.m_centreZ[i]);
+			const __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&bounds.m_radius[i]));
+
+			__m128 distances[6];
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int plane = 0; plane < 6; ++plane)
+			{
+				distances[plane] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[plane], centreX), _mm_mul_ps(planeY[plane], centreY)),
+					_mm_add_ps(_mm_mul_ps(planeZ[plane], centreZ), planeW[plane]));
+				inside = _mm_and_ps(inside, _mm_cmpgt_ps(distances[plane], negRadius));
+			}
+			uint32_t visibleMask = static_cast<uint32_t>(_mm_movemask_ps(inside));
+			if (visibleMask == 0)
+			{
+				continue; // the common case when most of the scene is off screen
+			}
+
+			const __m128 extentX = _mm_loadu_ps(&bounds.m_extentX[i]);
+			const __m128 extentY = _mm_loadu_ps(&bounds.m_extentY[i]);
+			const __m128 extentZ = _mm_loadu_ps(&bounds.m_extentZ[i]);
+			for (int plane = 0; plane < 6; ++plane)
+			{
+				const __m128 projectedExtent = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeAbsX[plane], extentX), _mm_mul_ps(planeAbsY[plane], extentY)),
+					_mm_mul_ps(planeAbsZ[plane], extentZ));
+				inside = _mm_and_ps(inside, _mm_cmpgt_ps(distances[plane], _mm_sub_ps(_mm_setzero_ps(), projectedExtent)));
+			}
+			visibleMask = static_cast<uint32_t>(_mm_movemask_ps(inside));
+			while (visibleMask)
+			{
+				visibleOut[nVisible++] = static_cast<uint32_t>(i + CountTrailingZeros(visibleMask));
+				visibleMask &= visibleMask - 1;
+			}
+		}
+		return nVisible + CullRangeScalar(frustum, bounds, i, end, visibleOut + nVisible);
+	}
+
+	FRUSTUM_CULLER_TARGET_AVX2
+	static size_t CullRangeAvx2(const Frustum& frustum, const CullingBounds& bounds, size_t begin, size_t end, uint32_t* visibleOut)
+	{
+		__m256 planeX[6], planeY[6], planeZ[6], planeW[6], planeAbsX[6], planeAbsY[6], planeAbsZ[6];
+		for (int plane = 0; plane < 6; ++plane)
+		{
+			const glm::vec4& p = frustum.m_planes[plane];
+			planeX[plane] = _mm256_set1_ps(p.x);
+			planeY[plane] = _mm256_set1_ps(p.y);
+			planeZ[plane] = _mm256_set1_ps(p.z);
+			planeW[plane] = _mm256_set1_ps(p.w);
+			planeAbsX[plane] = _mm256_set1_ps(std::abs(p.x));
+			planeAbsY[plane] = _mm256_set1_ps(std::abs(p.y));
+			planeAbsZ[plane] = _mm256_set1_ps(std::abs(p.z));
+		}
+
+		size_t nVisible = 0;
+		size_t i = begin;
+		for (; i + 8 <= end; i += 8)
+		{
+			const __m256 centreX = _mm256_loadu_ps(&bounds.m_centreX[i]);
+			const __m256 centreY = _mm256_loadu_ps(&bounds.m_centreY[i]);
+			const __m256 centreZ = _mm256_loadu_ps(&bounds.m_centreZ[i]);
+			const __m256 negRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&bounds.m_radius[i]));
+
+			__m256 distances[6];
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (int plane = 0; plane < 6; ++plane)
+			{
+				distances[plane] = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeX[plane], centreX), _mm256_mul_ps(planeY[plane], centreY)),
+					_mm256_add_ps(_mm256_mul_ps(planeZ[plane], centreZ), planeW[plane]));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(distances[plane], negRadius, _CMP_GT_OQ));
+			}
+			uint32_t visibleMask = static_cast<uint32_t>(_mm256_movemask_ps(inside));
+			if (visibleMask == 0)
+			{
+				continue;
+			}
+
+			const __m256 extentX = _mm256_loadu_ps(&bounds.m_extentX[i]);
+			const __m256 extentY = _mm256_loadu_ps(&bounds.m_extentY[i]);
+			const __m256 extentZ = _mm256_loadu_ps(&bounds.m_extentZ[i]);
+			for (int plane = 0; plane < 6; ++plane)
+			{
+				const __m256 projectedExtent = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeAbsX[plane], extentX), _mm256_mul_ps(planeAbsY[plane], extentY)),
+					_mm256_mul_ps(planeAbsZ[plane], extentZ));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(distances[plane], _mm256_sub_ps(_mm256_setzero_ps(), projectedExtent), _CMP_GT_OQ));
+			}
+			visibleMask = static_cast<uint32_t>(_mm256_movemask_ps(inside));
+			while (visibleMask)
+			{
+				visibleOut[nVisible++] = static_cast<uint32_t>(i + CountTrailingZeros(visibleMask));
+				visibleMask &= visibleMask - 1;
+			}
+		}
+		return nVisible + CullRangeScalar(frustum, bounds, i, end, visibleOut + nVisible);
+	}
+#endif // FRUSTUM_CULLER_X86
+
+	InstructionSet m_instructionSet;
+	std::vector<uint32_t> m_visibleIndices;
+	std::vector<size_t> m_batchVisibleCounts;
+	double m_lastCullMs;
+};
@@ -0,0 +1,286 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "DeviceMemoryAllocator.h"
+#include "UploadManager.h"
+
+// where a mesh lives in the mega-buffers, matches MeshInfo in CullInstances.comp (std430)
+struct MeshInfo
+{
+	uint32_t m_indexCount;
+	uint32_t m_firstIndex;
+	int32_t m_vertexOffset; // in vertices, added to every index
+	uint32_t m_vertexCount;
+};
+
+// All static geometry shares one vertex and one index buffer, meshes are ranges within them handed out front to back.
+// Indices are 16 or 32 bit for the whole buffer, picked at Init. Callers always hand over 32 bit indices and they get narrowed here.
+// A mesh handle is its index in the mesh table, which is mirrored into a storage buffer so the GPU can build draws from handles.
+// Sized up front, meshes can't be removed. Not thread safe, goes through the UploadManager like everything else uploaded.
+// Optionally the positions are also kept in a stream of their own, so position only passes (the depth pre-pass) don't fetch the rest of the vertex.
+class GeometryBuffers
+{
+public:
+	static constexpr uint32_t S_DEFAULT_MAX_MESHES = 1024;
+
+	GeometryBuffers()
+		: m_device(nullptr)
+		, m_allocator(nullptr)
+		, m_uploadManager(nullptr)
+		, m_vertexBuffer(nullptr)
+		, m_indexBuffer(nullptr)
+		, m_meshTableBuffer(nullptr)
+		, m_meshTableIsConcurrent(false)
+		, m_positionBuffer(nullptr)
+		, m_indexType(VK_INDEX_TYPE_UINT32)
+		, m_vertexStride(0)
+		, m_positionOffset(0)
+		, m_positionSize(0)
+		, m_maxVertices(0)
+		, m_maxIndices(0)
+		, m_maxMeshes(0)
+		, m_nVertices(0)
+		, m_nIndices(0)
+	{}
+
+	GeometryBuffers(const GeometryBuffers&) = delete;
+	GeometryBuffers& operator=(const GeometryBuffers&) = delete;
+
+	// meshTableQueueFamilies is every queue family that reads the mesh table when that's more than one (the cull on an async compute queue),
+	// the table is shared CONCURRENT between them rather than having its ownership passed back and forth
+	void Init(VkDevice device, DeviceMemoryAllocator& allocator, UploadManager& uploadManager, uint32_t vertexStride, uint32_t maxVertices, uint32_t maxIndices,
+		VkIndexType indexType = VK_INDEX_TYPE_UINT32, uint32_t maxMeshes = S_DEFAULT_MAX_MESHES, const std::vector<uint32_t>& meshTableQueueFamilies = {})
+	{
+		if (indexType != VK_INDEX_TYPE_UINT16 && indexType != VK_INDEX_TYPE_UINT32)
+		{
+			throw std::runtime_error("Geometry buffers only support 16 or 32 bit indices");
+		}
+
+		m_device = device;
+		m_allocator = &allocator;
+		m_uploadManager = &uploadManager;
+		m_indexType = indexType;
+		m_vertexStride = vertexStride;
+		m_maxVertices = (std::max)(maxVertices, 1u);
+		m_maxIndices = (std::max)(maxIndices, 1u);
+		m_maxMeshes = (std::max)(maxMeshes, 1u);
+		m_meshTableIsConcurrent = meshTableQueueFamilies.size() > 1;
+		m_meshes.reserve(m_maxMeshes); // never reallocates, so a MeshInfo reference stays good while more meshes are added
+
+		CreateBuffer(static_cast<VkDeviceSize>(m_maxVertices) * m_vertexStride, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, m_vertexBuffer, m_vertexBufferAllocation);
+		CreateBuffer(static_cast<VkDeviceSize>(m_maxIndices) * GetIndexSize(), VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, m_indexBuffer, m_indexBufferAllocation);
+		CreateBuffer(static_cast<VkDeviceSize>(m_maxMeshes) * sizeof(MeshInfo), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, m_meshTableBuffer, m_meshTableAllocation,
+			m_meshTableIsConcurrent ? meshTableQueueFamilies : std::vector<uint32_t>());
+	}
+
+	// every vertex's positionSize bytes at positionOffset also go into the position stream, in the same order so the meshes'
+	// offsets and the index buffer work for both. Has to be before any meshes are added
+	void InitPositionStream(uint32_t positionOffset, uint32_t positionSize)
+	{
+		if (!m_meshes.empty() || positionSize == 0 || positionOffset + positionSize > m_vertexStride)
+		{
+			throw std::runtime_error("The position stream has to be set up before any meshes, from within the vertex");
+		}
+		m_positionOffset = positionOffset;
+		m_positionSize = positionSize;
+		CreateBuffer(static_cast<VkDeviceSize>(m_maxVertices) * m_positionSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, m_positionBuffer, m_positionBufferAllocation);
+	}
+
+	void Shutdown()
+	{
+		DestroyBuffer(m_vertexBuffer, m_vertexBufferAllocation);
+		DestroyBuffer(m_positionBuffer, m_positionBufferAllocation);
+		DestroyBuffer(m_indexBuffer, m_indexBufferAllocation);
+		DestroyBuffer(m_meshTableBuffer, m_meshTableAllocation);
+		m_meshes.clear();
+		m_nVertices = 0;
+		m_nIndices = 0;
+	}
+
+	// vertices are m_vertexStride bytes each, indices are relative to the mesh's first vertex. returns the mesh handle
+	uint32_t AddMesh(const void* vertices, uint32_t nVertices, const uint32_t* indices, uint32_t nIndices)
+	{
+		return AddMesh(vertices, nVertices, indices, VK_INDEX_TYPE_UINT32, nIndices);
+	}
+
+	// as above with indices of either size, when they match the buffer's index type they're uploaded straight from where they are
+	// (e.g. a mapped asset package), otherwise they're converted first
+	uint32_t AddMesh(const void* vertices, uint32_t nVertices, const void* indices, VkIndexType sourceIndexType, uint32_t nIndices)
+	{
+		const uint32_t meshHandle = AllocateMesh(nVertices, nIndices);
+		UploadVertices(meshHandle, 0, vertices, nVertices);
+		UploadIndices(meshHandle, 0, indices, sourceIndexType, nIndices);
+		return meshHandle;
+	}
+
+	// reserves space for a mesh whose data gets uploaded later, possibly a piece at a time over several frames (see AssetStreamer).
+	// Nothing should draw it until all of it has been uploaded
+	uint32_t AllocateMesh(uint32_t nVertices, uint32_t nIndices)
+	{
+		if (m_meshes.size() >= m_maxMeshes || nVertices > m_maxVertices - m_nVertices || nIndices > m_maxIndices - m_nIndices)
+		{
+			throw std::runtime_error("Mesh doesn't fit in the geometry buffers");
+		}
+
+		MeshInfo mesh = {};
+		mesh.m_indexCount = nIndices;
+		mesh.m_firstIndex = m_nIndices;
+		mesh.m_vertexOffset = static_cast<int32_t>(m_nVertices);
+		mesh.m_vertexCount = nVertices;
+
+		const uint32_t meshHandle = static_cast<uint32_t>(m_meshes.size());
+		m_uploadManager->UploadToBuffer(m_meshTableBuffer, static_cast<VkDeviceSize>(meshHandle) * sizeof(MeshInfo), &mesh, sizeof(MeshInfo),
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, m_meshTableIsConcurrent);
+
+		m_meshes.push_back(mesh);
+		m_nVertices += nVertices;
+		m_nIndices += nIndices;
+		return meshHandle;
+	}
+
+	void UploadVertices(uint32_t meshHandle, uint32_t firstVertex, const void* vertices, uint32_t nVertices)
+	{
+		const MeshInfo& mesh = m_meshes[meshHandle];
+		if (firstVertex > mesh.m_vertexCount || nVertices > mesh.m_vertexCount - firstVertex)
+		{
+			throw std::runtime_error("Vertex upload outside of the mesh");
+		}
+		m_uploadManager->UploadToBuffer(m_vertexBuffer, (static_cast<VkDeviceSize>(mesh.m_vertexOffset) + firstVertex) * m_vertexStride, vertices, static_cast<VkDeviceSize>(nVertices) * m_vertexStride,
+			VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+
+		if (m_positionBuffer)
+		{
+			// the upload copies it into the staging ring straight away so the scratch can be reused
+			m_positionScratch.resize(static_cast<size_t>(nVertices) * m_positionSize);
+			const uint8_t* srcVertices = static_cast<const uint8_t*>(vertices);
+			for (uint32_t i = 0; i < nVertices; ++i)
+			{
+				std::memcpy(&m_positionScratch[static_cast<size_t>(i) * m_positionSize], srcVertices + static_cast<size_t>(i) * m_vertexStride + m_positionOffset, m_positionSize);
+			}
+			m_uploadManager->UploadToBuffer(m_positionBuffer, (static_cast<VkDeviceSize>(mesh.m_vertexOffset) + firstVertex) * m_positionSize, m_positionScratch.data(),
+				m_positionScratch.size(), VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+		}
+	}
+
+	void UploadIndices(uint32_t meshHandle, uint32_t firstIndex, const void* indices, VkIndexType sourceIndexType, uint32_t nIndices)
+	{
+		const MeshInfo& mesh = m_meshes[meshHandle];
+		if (firstIndex > mesh.m_indexCount || nIndices > mesh.m_indexCount - firstIndex)
+		{
+			throw std::runtime_error("Index upload outside of the mesh");
+		}
+
+		const void* indexData = indices;
+		std::vector<uint16_t> narrowedIndices;
+		std::vector<uint32_t> widenedIndices;
+		if (sourceIndexType == VK_INDEX_TYPE_UINT32 && m_indexType == VK_INDEX_TYPE_UINT16)
+		{
+			const uint32_t* sourceIndices = static_cast<const uint32_t*>(indices);
+			narrowedIndices.resize(nIndices);
+			for (uint32_t i = 0; i < nIndices; ++i)
+			{
+				if (sourceIndices[i] > UINT16_MAX)
+				{
+					throw std::runtime_error("Mesh index doesn't fit in a 16 bit index buffer");
+				}
+				narrowedIndices[i] = static_cast<uint16_t>(sourceIndices[i]);
+			}
+			indexData = narrowedIndices.data();
+		}
+		else if (sourceIndexType == VK_INDEX_TYPE_UINT16 && m_indexType == VK_INDEX_TYPE_UINT32)
+		{
+			const uint16_t* sourceIndices = static_cast<const uint16_t*>(indices);
+			widenedIndices.assign(sourceIndices, sourceIndices + nIndices);
+			indexData = widenedIndices.data();
+		}
+
+		m_uploadManager->UploadToBuffer(m_indexBuffer, (static_cast<VkDeviceSize>(mesh.m_firstIndex) + firstIndex) * GetIndexSize(), indexData, static_cast<VkDeviceSize>(nIndices) * GetIndexSize(),
+			VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT);
+	}
+
+	const MeshInfo& GetMesh(uint32_t meshHandle) const { return m_meshes[meshHandle]; }
+	uint32_t GetMeshCount() const { return static_cast<uint32_t>(m_meshes.size()); }
+
+	VkBuffer GetVertexBuffer() const { return m_vertexBuffer; }
+	VkBuffer GetPositionBuffer() const { return m_positionBuffer; } // null without InitPositionStream()
+	VkBuffer GetIndexBuffer() const { return m_indexBuffer; }
+	VkBuffer GetMeshTableBuffer() const { return m_meshTableBuffer; }
+	VkIndexType GetIndexType() const { return m_indexType; }
+	uint32_t GetIndexSize() const { return m_indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t); }
+
+	// every mesh draws from the same two buffers, so this only needs doing once per command buffer
+	void Bind(VkCommandBuffer commandBuffer) const
+	{
+		const VkDeviceSize offset = 0;
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_vertexBuffer, &offset);
+		vkCmdBindIndexBuffer(commandBuffer, m_indexBuffer, 0, m_indexType);
+	}
+
+	// as Bind() but with the position stream as the vertex buffer
+	void BindPositions(VkCommandBuffer commandBuffer) const
+	{
+		const VkDeviceSize offset = 0;
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_positionBuffer, &offset);
+		vkCmdBindIndexBuffer(commandBuffer, m_indexBuffer, 0, m_indexType);
+	}
+
+private:
+	void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer, DeviceAllocation& allocation, const std::vector<uint32_t>& concurrentQueueFamilies = {})
+	{
+		VkBufferCreateInfo bufCreateInfo = {};
+		bufCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufCreateInfo.size = size;
+		bufCreateInfo.usage = usage;
+		bufCreateInfo.sharingMode = concurrentQueueFamilies.empty() ? VK_SHARING_MODE_EXCLUSIVE : VK_SHARING_MODE_CONCURRENT;
+		bufCreateInfo.queueFamilyIndexCount = static_cast<uint32_t>(concurrentQueueFamilies.size());
+		bufCreateInfo.pQueueFamilyIndices = concurrentQueueFamilies.empty() ? nullptr : concurrentQueueFamilies.data();
+		if (vkCreateBuffer(m_device, &bufCreateInfo, nullptr, &buffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create a geometry buffer");
+		}
+		allocation = m_allocator->AllocateForBuffer(buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	}
+
+	void DestroyBuffer(VkBuffer& buffer, DeviceAllocation& allocation)
+	{
+		if (buffer)
+		{
+			vkDestroyBuffer(m_device, buffer, nullptr);
+			m_allocator->Free(allocation);
+			buffer = nullptr;
+		}
+	}
+
+	VkDevice m_device;
+	DeviceMemoryAllocator* m_allocator;
+	UploadManager* m_uploadManager;
+
+	VkBuffer m_vertexBuffer;
+	DeviceAllocation m_vertexBufferAllocation;
+	VkBuffer m_indexBuffer;
+	DeviceAllocation m_indexBufferAllocation;
+	VkBuffer m_meshTableBuffer;
+	DeviceAllocation m_meshTableAllocation;
+	bool m_meshTableIsConcurrent;
+	VkBuffer m_positionBuffer;
+	DeviceAllocation m_positionBufferAllocation;
+
+	VkIndexType m_indexType;
+	uint32_t m_vertexStride;
+	uint32_t m_positionOffset;
+	uint32_t m_positionSize;
+	uint32_t m_maxVertices;
+	uint32_t m_maxIndices;
+	uint32_t m_maxMeshes;
+	uint32_t m_nVertices;
+	uint32_t m_nIndices;
+	std::vector<MeshInfo> m_meshes;
+	std::vector<uint8_t> m_positionScratch;
+};
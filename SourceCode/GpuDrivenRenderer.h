@@ -0,0 +1,433 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.h>
+
+#include "DeviceMemoryAllocator.h"
+#include "PipelineCache.h"
+#include "GeometryBuffers.h"
+#include "FrustumCuller.h"
+
+// one per instance, matches InstanceData in CullInstances.comp and GpuDriven.vert (std430)
+struct GpuInstanceData
+{
+	glm::vec4 m_boundsCentreAndRadius;
+	glm::vec3 m_boundsExtents; // AABB half extents, the mesh spans -0.5 to 0.5 so these are half the draw's scale
+	uint32_t m_meshHandle;
+};
+static_assert(sizeof(GpuInstanceData) == 32, "GpuInstanceData has to match the std430 layout in the shaders");
+
+// matches the push constant block in CullInstances.comp
+struct GpuCullPushConstants
+{
+	glm::vec4 m_frustumPlanes[6];
+	uint32_t m_instanceCount;
+	uint32_t m_compactDraws; // append visible draws and count them, otherwise every instance keeps its slot and culled ones draw nothing
+};
+
+// matches the push constant block in GpuDriven.vert
+struct GpuDrawPushConstants
+{
+	glm::vec4 m_cameraPosition; // xy
+};
+
+// Culls on the GPU and draws the whole scene with a handful of indirect draws. Each frame the instances go into a host visible
+// storage buffer, a compute pass tests them against the frustum and writes a VkDrawIndexedIndirectCommand per visible instance
+// (firstInstance being the instance, so the vertex shader finds its data through gl_InstanceIndex) plus a draw count, which
+// vkCmdDrawIndexedIndirectCount consumes directly. Without VK_KHR_draw_indirect_count every instance keeps a command and the
+// culled ones get an instanceCount of 0. Needs the multiDrawIndirect and drawIndirectFirstInstance features.
+// The instance, command and count buffers are per frame in flight, the descriptor set is shared by the compute and graphics pipelines.
+class GpuDrivenRenderer
+{
+public:
+	static constexpr uint32_t S_CULL_GROUP_SIZE = 64; // local_size_x in CullInstances.comp
+
+	GpuDrivenRenderer()
+		: m_device(nullptr)
+		, m_allocator(nullptr)
+		, m_geometryBuffers(nullptr)
+		, m_descriptorSetLayout(nullptr)
+		, m_descriptorPool(nullptr)
+		, m_cullPipelineLayout(nullptr)
+		, m_cullPipeline(nullptr)
+		, m_drawPipelineLayout(nullptr)
+		, m_drawIndexedIndirectCount(nullptr)
+		, m_maxInstances(0)
+		, m_maxDrawIndirectCount(1)
+	{}
+
+	GpuDrivenRenderer(const GpuDrivenRenderer&) = delete;
+	GpuDrivenRenderer& operator=(const GpuDrivenRenderer&) = delete;
+
+	// drawIndexedIndirectCount is null when VK_KHR_draw_indirect_count isn't enabled. concurrentQueueFamilies is the graphics and compute
+	// families when the cull runs on an async compute queue, the per frame buffers are shared between them rather than changing owner every frame
+	void Init(VkDevice device, DeviceMemoryAllocator& allocator, PipelineCache& pipelineCache, const GeometryBuffers& geometryBuffers, const std::vector<uint32_t>& cullShaderCode,
+		uint32_t nFramesInFlight, uint32_t maxInstances, uint32_t maxDrawIndirectCount, PFN_vkCmdDrawIndexedIndirectCountKHR drawIndexedIndirectCount,
+		const std::vector<uint32_t>& concurrentQueueFamilies = {})
+	{
+		m_device = device;
+		m_allocator = &allocator;
+		m_geometryBuffers = &geometryBuffers;
+		m_maxInstances = (std::max)(maxInstances, 1u);
+		m_maxDrawIndirectCount = (std::max)(maxDrawIndirectCount, 1u);
+		m_drawIndexedIndirectCount = drawIndexedIndirectCount;
+		m_concurrentQueueFamilies = concurrentQueueFamilies.size() > 1 ? concurrentQueueFamilies : std::vector<uint32_t>();
+
+		CreateDescriptorSetLayout();
+		CreatePipelineLayouts();
+		CreateCullPipeline(pipelineCache, cullShaderCode);
+
+		m_frames.resize(nFramesInFlight);
+		for (FrameResources& frame : m_frames)
+		{
+			// host visible so the CPU writes the instances in place, device local as well when there's a heap that's both (ReBAR, UMA)
+			CreateBuffer(static_cast<VkDeviceSize>(m_maxInstances) * sizeof(GpuInstanceData), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.m_instanceBuffer, frame.m_instanceAllocation);
+			CreateBuffer(static_cast<VkDeviceSize>(m_maxInstances) * sizeof(VkDrawIndexedIndirectCommand), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, frame.m_drawCommandBuffer, frame.m_drawCommandAllocation);
+			CreateBuffer(sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, frame.m_drawCountBuffer, frame.m_drawCountAllocation);
+		}
+		CreateDescriptorSets();
+	}
+
+	void Shutdown()
+	{
+		for (FrameResources& frame : m_frames)
+		{
+			DestroyBuffer(frame.m_instanceBuffer, frame.m_instanceAllocation);
+			DestroyBuffer(frame.m_drawCommandBuffer, frame.m_drawCommandAllocation);
+			DestroyBuffer(frame.m_drawCountBuffer, frame.m_drawCountAllocation);
+		}
+		m_frames.clear();
+		m_concurrentQueueFamilies.clear();
+		if (m_device)
+		{
+			vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr); // frees the sets with it
+			vkDestroyPipeline(m_device, m_cullPipeline, nullptr);
+			vkDestroyPipelineLayout(m_device, m_cullPipelineLayout, nullptr);
+			vkDestroyPipelineLayout(m_device, m_drawPipelineLayout, nullptr);
+			vkDestroyDescriptorSetLayout(m_device, m_descriptorSetLayout, nullptr);
+		}
+		m_descriptorPool = nullptr;
+		m_cullPipeline = nullptr;
+		m_cullPipelineLayout = nullptr;
+		m_drawPipelineLayout = nullptr;
+		m_descriptorSetLayout = nullptr;
+		m_device = nullptr;
+	}
+
+	// the graphics pipeline lives with the render pass it's made for, it just has to be created with this layout
+	VkPipelineLayout GetDrawPipelineLayout() const { return m_drawPipelineLayout; }
+	bool UsesDrawIndirectCount() const { return m_drawIndexedIndirectCount != nullptr; }
+
+	// the cull packs the visible draws at the front for a single count draw. When that draw can't cover every instance the
+	// fallback loop draws every slot, so each instance has to keep its own slot (culled ones draw nothing)
+	bool UsesCompactDraws(uint32_t nInstances) const { return UsesDrawIndirectCount() && nInstances <= m_maxDrawIndirectCount; }
+	uint32_t GetMaxInstances() const { return m_maxInstances; }
+
+	// only once the frame slot has been waited on, the GPU may still be reading the slot's instances otherwise
+	void WriteInstances(size_t frameSlot, const std::vector<GpuInstanceData>& instances)
+	{
+		if (instances.size() > m_maxInstances)
+		{
+			throw std::runtime_error("More instances than the GPU driven renderer was sized for");
+		}
+		if (instances.empty())
+		{
+			return;
+		}
+		const FrameResources& frame = m_frames[frameSlot];
+		std::memcpy(frame.m_instanceAllocation.m_mappedData, instances.data(), instances.size() * sizeof(GpuInstanceData));
+		m_allocator->FlushAllocation(frame.m_instanceAllocation, 0, instances.size() * sizeof(GpuInstanceData));
+	}
+
+	// outside of a render pass, ahead of RecordDraws() for the same slot. Either on the graphics command buffer or on the compute queue,
+	// in which case the graphics submit has to wait for the compute one at DRAW_INDIRECT
+	void RecordCull(VkCommandBuffer commandBuffer, size_t frameSlot, const Frustum& frustum, uint32_t nInstances)
+	{
+		const FrameResources& frame = m_frames[frameSlot];
+		const bool compactDraws = UsesCompactDraws(nInstances);
+		if (compactDraws)
+		{
+			vkCmdFillBuffer(commandBuffer, frame.m_drawCountBuffer, 0, sizeof(uint32_t), 0);
+			VkBufferMemoryBarrier countResetBarrier = MakeBufferBarrier(frame.m_drawCountBuffer, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1, &countResetBarrier, 0, nullptr);
+		}
+		if (nInstances == 0)
+		{
+			return;
+		}
+
+		GpuCullPushConstants cullConstants = {};
+		std::copy(std::begin(frustum.m_planes), std::end(frustum.m_planes), cullConstants.m_frustumPlanes);
+		cullConstants.m_instanceCount = nInstances;
+		cullConstants.m_compactDraws = compactDraws ? 1 : 0;
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipelineLayout, 0, 1, &frame.m_descriptorSet, 0, nullptr);
+		vkCmdPushConstants(commandBuffer, m_cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(GpuCullPushConstants), &cullConstants);
+		vkCmdDispatch(commandBuffer, (nInstances + S_CULL_GROUP_SIZE - 1) / S_CULL_GROUP_SIZE, 1, 1);
+
+		std::array<VkBufferMemoryBarrier, 2> indirectBarriers =
+		{
+			MakeBufferBarrier(frame.m_drawCommandBuffer, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT),
+			MakeBufferBarrier(frame.m_drawCountBuffer, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT),
+		};
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 0, nullptr,
+			compactDraws ? 2 : 1, indirectBarriers.data(), 0, nullptr);
+	}
+
+	// inside the render pass with the graphics pipeline already bound. positionsOnly draws from the geometry's position stream, for the depth pre-pass
+	void RecordDraws(VkCommandBuffer commandBuffer, size_t frameSlot, uint32_t nInstances, const glm::vec2& cameraPosition, bool positionsOnly = false)
+	{
+		if (nInstances == 0)
+		{
+			return;
+		}
+		const FrameResources& frame = m_frames[frameSlot];
+		GpuDrawPushConstants drawConstants = {};
+		drawConstants.m_cameraPosition = glm::vec4(cameraPosition.x, cameraPosition.y, 0.0f, 0.0f);
+
+		if (positionsOnly)
+		{
+			m_geometryBuffers->BindPositions(commandBuffer);
+		}
+		else
+		{
+			m_geometryBuffers->Bind(commandBuffer);
+		}
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_drawPipelineLayout, 0, 1, &frame.m_descriptorSet, 0, nullptr);
+		vkCmdPushConstants(commandBuffer, m_drawPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(GpuDrawPushConstants), &drawConstants);
+
+		const uint32_t commandStride = sizeof(VkDrawIndexedIndirectCommand);
+		if (UsesCompactDraws(nInstances))
+		{
+			m_drawIndexedIndirectCount(commandBuffer, frame.m_drawCommandBuffer, 0, frame.m_drawCountBuffer, 0, nInstances, commandStride);
+			return;
+		}
+		// one command per instance, split up if the device caps how many one call can draw
+		for (uint32_t firstDraw = 0; firstDraw < nInstances; firstDraw += m_maxDrawIndirectCount)
+		{
+			const uint32_t nDraws = (std::min)(nInstances - firstDraw, m_maxDrawIndirectCount);
+			vkCmdDrawIndexedIndirect(commandBuffer, frame.m_drawCommandBuffer, static_cast<VkDeviceSize>(firstDraw) * commandStride, nDraws, commandStride);
+		}
+	}
+
+private:
+	struct FrameResources
+	{
+		VkBuffer m_instanceBuffer = nullptr;
+		DeviceAllocation m_instanceAllocation;
+		VkBuffer m_drawCommandBuffer = nullptr;
+		DeviceAllocation m_drawCommandAllocation;
+		VkBuffer m_drawCountBuffer = nullptr;
+		DeviceAllocation m_drawCountAllocation;
+		VkDescriptorSet m_descriptorSet = nullptr;
+	};
+
+	// bindings match CullInstances.comp, the vertex shader only reads the instances
+	static constexpr uint32_t S_INSTANCES_BINDING = 0;
+	static constexpr uint32_t S_MESH_TABLE_BINDING = 1;
+	static constexpr uint32_t S_DRAW_COMMANDS_BINDING = 2;
+	static constexpr uint32_t S_DRAW_COUNT_BINDING = 3;
+	static constexpr uint32_t S_BINDING_COUNT = 4;
+
+	void CreateDescriptorSetLayout()
+	{
+		std::array<VkDescriptorSetLayoutBinding, S_BINDING_COUNT> bindings = {};
+		for (uint32_t i = 0; i < S_BINDING_COUNT; ++i)
+		{
+			bindings[i].binding = i;
+			bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			bindings[i].descriptorCount = 1;
+			bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		}
+		bindings[S_INSTANCES_BINDING].stageFlags |= VK_SHADER_STAGE_VERTEX_BIT;
+
+		VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+		setLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		setLayoutCreateInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+		setLayoutCreateInfo.pBindings = bindings.data();
+		if (vkCreateDescriptorSetLayout(m_device, &setLayoutCreateInfo, nullptr, &m_descriptorSetLayout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create the GPU driven descriptor set layout");
+		}
+	}
+
+	void CreatePipelineLayouts()
+	{
+		VkPushConstantRange pushConstantRange = {};
+		pushConstantRange.offset = 0;
+
+		VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+		pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutCreateInfo.setLayoutCount = 1;
+		pipelineLayoutCreateInfo.pSetLayouts = &m_descriptorSetLayout;
+		pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+		pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		pushConstantRange.size = sizeof(GpuCullPushConstants);
+		if (vkCreatePipelineLayout(m_device, &pipelineLayoutCreateInfo, nullptr, &m_cullPipelineLayout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create the cull pipeline layout");
+		}
+
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		pushConstantRange.size = sizeof(GpuDrawPushConstants);
+		if (vkCreatePipelineLayout(m_device, &pipelineLayoutCreateInfo, nullptr, &m_drawPipelineLayout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create the GPU driven draw pipeline layout");
+		}
+	}
+
+	void CreateCullPipeline(PipelineCache& pipelineCache, const std::vector<uint32_t>& cullShaderCode)
+	{
+		VkShaderModuleCreateInfo moduleCreateInfo = {};
+		moduleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		moduleCreateInfo.codeSize = cullShaderCode.size() * sizeof(uint32_t);
+		moduleCreateInfo.pCode = cullShaderCode.data();
+		VkShaderModule cullShaderModule = nullptr;
+		if (vkCreateShaderModule(m_device, &moduleCreateInfo, nullptr, &cullShaderModule) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create the cull shader module");
+		}
+
+		VkComputePipelineCreateInfo pipelineCreateInfo = {};
+		pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipelineCreateInfo.stage.module = cullShaderModule;
+		pipelineCreateInfo.stage.pName = "main";
+		pipelineCreateInfo.layout = m_cullPipelineLayout;
+		pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+		pipelineCreateInfo.basePipelineIndex = -1;
+
+		const auto createStart = std::chrono::high_resolution_clock::now();
+		const VkResult createResult = vkCreateComputePipelines(m_device, pipelineCache.GetHandle(), 1, &pipelineCreateInfo, nullptr, &m_cullPipeline);
+		vkDestroyShaderModule(m_device, cullShaderModule, nullptr); // not needed once the pipeline exists
+		if (createResult != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create the cull pipeline.");
+		}
+		pipelineCache.RecordPipelineCreation("CullInstances", std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - createStart).count());
+	}
+
+	void CreateDescriptorSets()
+	{
+		const uint32_t nFrames = static_cast<uint32_t>(m_frames.size());
+		VkDescriptorPoolSize poolSize = {};
+		poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		poolSize.descriptorCount = S_BINDING_COUNT * nFrames;
+
+		VkDescriptorPoolCreateInfo poolCreateInfo = {};
+		poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolCreateInfo.maxSets = nFrames;
+		poolCreateInfo.poolSizeCount = 1;
+		poolCreateInfo.pPoolSizes = &poolSize;
+		if (vkCreateDescriptorPool(m_device, &poolCreateInfo, nullptr, &m_descriptorPool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create the GPU driven descriptor pool");
+		}
+
+		std::vector<VkDescriptorSetLayout> setLayouts(nFrames, m_descriptorSetLayout);
+		std::vector<VkDescriptorSet> descriptorSets(nFrames);
+		VkDescriptorSetAllocateInfo setAllocInfo = {};
+		setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		setAllocInfo.descriptorPool = m_descriptorPool;
+		setAllocInfo.descriptorSetCount = nFrames;
+		setAllocInfo.pSetLayouts = setLayouts.data();
+		if (vkAllocateDescriptorSets(m_device, &setAllocInfo, descriptorSets.data()) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to allocate the GPU driven descriptor sets");
+		}
+
+		for (uint32_t i = 0; i < nFrames; ++i)
+		{
+			FrameResources& frame = m_frames[i];
+			frame.m_descriptorSet = descriptorSets[i];
+			std::array<VkDescriptorBufferInfo, S_BINDING_COUNT> bufferInfos = {};
+			bufferInfos[S_INSTANCES_BINDING].buffer = frame.m_instanceBuffer;
+			bufferInfos[S_MESH_TABLE_BINDING].buffer = m_geometryBuffers->GetMeshTableBuffer();
+			bufferInfos[S_DRAW_COMMANDS_BINDING].buffer = frame.m_drawCommandBuffer;
+			bufferInfos[S_DRAW_COUNT_BINDING].buffer = frame.m_drawCountBuffer;
+
+			std::array<VkWriteDescriptorSet, S_BINDING_COUNT> descriptorWrites = {};
+			for (uint32_t binding = 0; binding < S_BINDING_COUNT; ++binding)
+			{
+				bufferInfos[binding].offset = 0;
+				bufferInfos[binding].range = VK_WHOLE_SIZE;
+				descriptorWrites[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				descriptorWrites[binding].dstSet = frame.m_descriptorSet;
+				descriptorWrites[binding].dstBinding = binding;
+				descriptorWrites[binding].descriptorCount = 1;
+				descriptorWrites[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+				descriptorWrites[binding].pBufferInfo = &bufferInfos[binding];
+			}
+			vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+		}
+	}
+
+	void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags requiredProperties, VkMemoryPropertyFlags preferredProperties, VkBuffer& buffer, DeviceAllocation& allocation)
+	{
+		VkBufferCreateInfo bufCreateInfo = {};
+		bufCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufCreateInfo.size = size;
+		bufCreateInfo.usage = usage;
+		bufCreateInfo.sharingMode = m_concurrentQueueFamilies.empty() ? VK_SHARING_MODE_EXCLUSIVE : VK_SHARING_MODE_CONCURRENT;
+		bufCreateInfo.queueFamilyIndexCount = static_cast<uint32_t>(m_concurrentQueueFamilies.size());
+		bufCreateInfo.pQueueFamilyIndices = m_concurrentQueueFamilies.empty() ? nullptr : m_concurrentQueueFamilies.data();
+		if (vkCreateBuffer(m_device, &bufCreateInfo, nullptr, &buffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create a GPU driven rendering buffer");
+		}
+		allocation = m_allocator->AllocateForBuffer(buffer, requiredProperties, preferredProperties);
+	}
+
+	void DestroyBuffer(VkBuffer& buffer, DeviceAllocation& allocation)
+	{
+		if (buffer)
+		{
+			vkDestroyBuffer(m_device, buffer, nullptr);
+			m_allocator->Free(allocation);
+			buffer = nullptr;
+		}
+	}
+
+	static VkBufferMemoryBarrier MakeBufferBarrier(VkBuffer buffer, VkAccessFlags srcAccess, VkAccessFlags dstAccess)
+	{
+		VkBufferMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = srcAccess;
+		barrier.dstAccessMask = dstAccess;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.buffer = buffer;
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+		return barrier;
+	}
+
+	VkDevice m_device;
+	DeviceMemoryAllocator* m_allocator;
+	const GeometryBuffers* m_geometryBuffers;
+	VkDescriptorSetLayout m_descriptorSetLayout;
+	VkDescriptorPool m_descriptorPool;
+	VkPipelineLayout m_cullPipelineLayout;
+	VkPipeline m_cullPipeline;
+	VkPipelineLayout m_drawPipelineLayout;
+	PFN_vkCmdDrawIndexedIndirectCountKHR m_drawIndexedIndirectCount;
+	uint32_t m_maxInstances;
+	uint32_t m_maxDrawIndirectCount;
+	std::vector<uint32_t> m_concurrentQueueFamilies; // empty for EXCLUSIVE
+	std::vector<FrameResources> m_frames;
+};
@@ -0,0 +1,269 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+// core in 1.2, from VK_KHR_timeline_semaphore before that
+struct TimelineSemaphoreFunctions
+{
+	PFN_vkGetSemaphoreCounterValue m_getSemaphoreCounterValue = nullptr;
+	PFN_vkWaitSemaphores m_waitSemaphores = nullptr;
+
+	bool IsSupported() const { return m_getSemaphoreCounterValue && m_waitSemaphores; }
+};
+
+// something a submit has to wait for before dstStages, either a point on another queue's timeline or a binary semaphore (value ignored,
+// only the swap chain's are binary)
+struct GpuQueueWait
+{
+	VkSemaphore m_semaphore;
+	uint64_t m_value;
+	VkPipelineStageFlags m_dstStages;
+};
+
+// A VkQueue plus a timeline semaphore that every submit to it signals with the next value, so whether a submit has finished is
+// a compare against GetCompletedValue() and another queue can wait on any earlier submit without a semaphore of its own.
+// Also hands out one time primary command buffers from its own pool, recycled once the timeline passes the submit they went in.
+// The values replace fences everywhere: the frame slots, upload batches and deferred destruction all keep the value of the
+// submit they're waiting on. Not thread safe, like the queue itself everything goes through one thread.
+class GpuQueue
+{
+public:
+	GpuQueue()
+		: m_device(nullptr)
+		, m_queue(nullptr)
+		, m_familyIndex(0)
+		, m_name("")
+		, m_timeline(nullptr)
+		, m_commandPool(nullptr)
+		, m_lastSubmittedValue(0)
+		, m_nSubmits(0)
+	{}
+
+	GpuQueue(const GpuQueue&) = delete;
+	GpuQueue& operator=(const GpuQueue&) = delete;
+
+	void Init(VkDevice device, VkQueue queue, uint32_t familyIndex, const char* name, const TimelineSemaphoreFunctions& timelineFunctions)
+	{
+		m_device = device;
+		m_queue = queue;
+		m_familyIndex = familyIndex;
+		m_name = name;
+		m_timelineFunctions = timelineFunctions;
+		m_lastSubmittedValue = 0;
+		if (queue == nullptr)
+		{
+			throw std::runtime_error(std::string("failed to get the ") + name + " queue!");
+		}
+		if (!m_timelineFunctions.IsSupported())
+		{
+			throw std::runtime_error("GpuQueue needs timeline semaphores");
+		}
+
+		VkSemaphoreTypeCreateInfo semaphoreTypeCreateInfo = {};
+		semaphoreTypeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+		semaphoreTypeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		semaphoreTypeCreateInfo.initialValue = 0;
+		VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+		semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphoreCreateInfo.pNext = &semaphoreTypeCreateInfo;
+		if (vkCreateSemaphore(m_device, &semaphoreCreateInfo, nullptr, &m_timeline) != VK_SUCCESS)
+		{
+			throw std::runtime_error(std::string("Failed to create the ") + name + " queue's timeline semaphore");
+		}
+
+		VkCommandPoolCreateInfo cmdPoolCreateInfo = {};
+		cmdPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		cmdPoolCreateInfo.queueFamilyIndex = familyIndex;
+		cmdPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		if (vkCreateCommandPool(m_device, &cmdPoolCreateInfo, nullptr, &m_commandPool) != VK_SUCCESS)
+		{
+			throw std::runtime_error(std::string("Failed to create the ") + name + " queue's command pool");
+		}
+	}
+
+	// after the device has gone idle
+	void Shutdown()
+	{
+		if (m_commandPool)
+		{
+			vkDestroyCommandPool(m_device, m_commandPool, nullptr); // frees the command buffers with it
+			m_commandPool = nullptr;
+		}
+		if (m_timeline)
+		{
+			vkDestroySemaphore(m_device, m_timeline, nullptr);
+			m_timeline = nullptr;
+		}
+		m_inFlightCommandBuffers.clear();
+		m_freeCommandBuffers.clear();
+		m_recordingCommandBuffers.clear();
+		m_queue = nullptr;
+	}
+
+	bool IsValid() const { return m_queue != nullptr; }
+	VkQueue GetHandle() const { return m_queue; }
+	uint32_t GetFamilyIndex() const { return m_familyIndex; }
+	const char* GetName() const { return m_name; }
+	uint64_t GetSubmitCount() const { return m_nSubmits; }
+
+	VkSemaphore GetTimelineSemaphore() const { return m_timeline; }
+	uint64_t GetLastSubmittedValue() const { return m_lastSubmittedValue; }
+
+	uint64_t GetCompletedValue() const
+	{
+		uint64_t value = 0;
+		if (m_timelineFunctions.m_getSemaphoreCounterValue(m_device, m_timeline, &value) != VK_SUCCESS)
+		{
+			throw std::runtime_error(std::string("Lost the ") + m_name + " queue's timeline, device lost?");
+		}
+		return value;
+	}
+
+	void WaitForValue(uint64_t value, uint64_t timeoutNs = UINT64_MAX) const
+	{
+		if (value == 0)
+		{
+			return;
+		}
+		VkSemaphoreWaitInfo waitInfo = {};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &m_timeline;
+		waitInfo.pValues = &value;
+		if (m_timelineFunctions.m_waitSemaphores(m_device, &waitInfo, timeoutNs) == VK_ERROR_DEVICE_LOST)
+		{
+			throw std::runtime_error(std::string("Device lost waiting on the ") + m_name + " queue");
+		}
+	}
+
+	// for another queue's submit to wait on this one reaching value
+	GpuQueueWait MakeWait(uint64_t value, VkPipelineStageFlags dstStages) const { return { m_timeline, value, dstStages }; }
+
+	// a primary command buffer from this queue's pool, already begun
+	VkCommandBuffer BeginCommandBuffer()
+	{
+		const uint64_t completedValue = GetCompletedValue();
+		while (!m_inFlightCommandBuffers.empty() && m_inFlightCommandBuffers.front().m_value <= completedValue)
+		{
+			m_freeCommandBuffers.push_back(m_inFlightCommandBuffers.front().m_commandBuffer);
+			m_inFlightCommandBuffers.pop_front();
+		}
+
+		VkCommandBuffer commandBuffer = nullptr;
+		if (!m_freeCommandBuffers.empty())
+		{
+			commandBuffer = m_freeCommandBuffers.back();
+			m_freeCommandBuffers.pop_back();
+			vkResetCommandBuffer(commandBuffer, 0);
+		}
+		else
+		{
+			VkCommandBufferAllocateInfo cmdBufferAllocInfo = {};
+			cmdBufferAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			cmdBufferAllocInfo.commandPool = m_commandPool;
+			cmdBufferAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			cmdBufferAllocInfo.commandBufferCount = 1;
+			if (vkAllocateCommandBuffers(m_device, &cmdBufferAllocInfo, &commandBuffer) != VK_SUCCESS)
+			{
+				throw std::runtime_error(std::string("Failed to allocate a ") + m_name + " queue command buffer");
+			}
+		}
+
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+		{
+			throw std::runtime_error(std::string("Failed the start recording a ") + m_name + " queue command buffer!");
+		}
+		m_recordingCommandBuffers.push_back(commandBuffer);
+		return commandBuffer;
+	}
+
+	// signals the binary semaphores (for present) as well as the timeline, returns the timeline value this submit signals.
+	// Command buffers from BeginCommandBuffer() have to have been ended, they go back to the pool once the value's reached
+	uint64_t Submit(const std::vector<VkCommandBuffer>& commandBuffers, const std::vector<GpuQueueWait>& waits,
+		const std::vector<VkSemaphore>& binarySignals = {})
+	{
+		const uint64_t signalValue = m_lastSubmittedValue + 1;
+
+		std::vector<VkSemaphore> waitSemaphores;
+		std::vector<uint64_t> waitValues;
+		std::vector<VkPipelineStageFlags> waitStages;
+		for (const GpuQueueWait& wait : waits)
+		{
+			if (wait.m_semaphore)
+			{
+				waitSemaphores.push_back(wait.m_semaphore);
+				waitValues.push_back(wait.m_value);
+				waitStages.push_back(wait.m_dstStages);
+			}
+		}
+		std::vector<VkSemaphore> signalSemaphores = binarySignals;
+		std::vector<uint64_t> signalValues(signalSemaphores.size(), 0);
+		signalSemaphores.push_back(m_timeline);
+		signalValues.push_back(signalValue);
+
+		VkTimelineSemaphoreSubmitInfo timelineSubmitInfo = {};
+		timelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timelineSubmitInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+		timelineSubmitInfo.pWaitSemaphoreValues = waitValues.data();
+		timelineSubmitInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+		timelineSubmitInfo.pSignalSemaphoreValues = signalValues.data();
+
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.pNext = &timelineSubmitInfo;
+		submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+		submitInfo.pWaitSemaphores = waitSemaphores.data();
+		submitInfo.pWaitDstStageMask = waitStages.data();
+		submitInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+		submitInfo.pCommandBuffers = commandBuffers.data();
+		submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+		submitInfo.pSignalSemaphores = signalSemaphores.data();
+		if (vkQueueSubmit(m_queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+		{
+			throw std::runtime_error(std::string("Failed to submit to the ") + m_name + " queue.");
+		}
+
+		m_lastSubmittedValue = signalValue;
+		++m_nSubmits;
+		for (VkCommandBuffer commandBuffer : commandBuffers)
+		{
+			auto recording = std::find(m_recordingCommandBuffers.begin(), m_recordingCommandBuffers.end(), commandBuffer);
+			if (recording != m_recordingCommandBuffers.end())
+			{
+				m_inFlightCommandBuffers.push_back({ commandBuffer, signalValue });
+				m_recordingCommandBuffers.erase(recording);
+			}
+		}
+		return signalValue;
+	}
+
+private:
+	struct InFlightCommandBuffer
+	{
+		VkCommandBuffer m_commandBuffer;
+		uint64_t m_value;
+	};
+
+	VkDevice m_device;
+	VkQueue m_queue;
+	uint32_t m_familyIndex;
+	const char* m_name;
+	TimelineSemaphoreFunctions m_timelineFunctions;
+	VkSemaphore m_timeline;
+	VkCommandPool m_commandPool;
+	uint64_t m_lastSubmittedValue;
+	uint64_t m_nSubmits;
+	std::vector<VkCommandBuffer> m_recordingCommandBuffers;
+	std::deque<InFlightCommandBuffer> m_inFlightCommandBuffers;
+	std::vector<VkCommandBuffer> m_freeCommandBuffers;
+};
@@ -0,0 +1,432 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <cstdint>
+
+// Tracks a group of jobs, Wait() on it returns once every job added against it has run.
+// The first exception thrown by one of its jobs is rethrown from Wait().
+class JobCounter
+{
+public:
+	JobCounter()
+		: m_nPendingJobs(0)
+		, m_hasException(false)
+	{}
+
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+
+	bool IsDone() const { return m_nPendingJobs.load(std::memory_order_acquire) == 0; }
+
+private:
+	friend class JobSystem;
+
+	void SetException(std::exception_ptr exception)
+	{
+		std::lock_guard<std::mutex> lock(m_exceptionMutex);
+		if (!m_hasException)
+		{
+			m_exception = exception;
+			m_hasException = true;
+		}
+	}
+
+	std::atomic<uint32_t> m_nPendingJobs;
+	std::mutex m_exceptionMutex;
+	std::exception_ptr m_exception;
+	bool m_hasException;
+};
+
+// Fixed pool of worker threads, each with its own work stealing deque.
+// A thread pushes and pops jobs at the bottom of its own deque (LIFO, cache friendly for nested work) and idle threads steal
+// from the top of someone else's. The thread that calls Init() is worker 0 and runs jobs whenever it waits on a counter,
+// any other thread can still hand out jobs, they go into a locked injection queue that the workers also check.
+class JobSystem
+{
+public:
+	JobSystem()
+		: m_stopWorkers(false)
+		, m_nSleepingWorkers(0)
+		, m_nInjectedJobs(0)
+	{}
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	~JobSystem()
+	{
+		Shutdown();
+	}
+
+	// nWorkerThreads doesn't include the calling thread, 0 for one per remaining core
+	void Init(uint32_t nWorkerThreads = 0)
+	{
+		if (nWorkerThreads == 0)
+		{
+			nWorkerThreads = (std::max)(std::thread::hardware_concurrency(), 2u) - 1;
+		}
+		m_deques.clear();
+		for (uint32_t i = 0; i < nWorkerThreads + 1; ++i)
+		{
+			m_deques.push_back(std::make_unique<WorkStealingDeque>());
+		}
+		s_threadWorkerIndex = 0;
+		s_threadOwner = this;
+
+		m_stopWorkers = false;
+		m_workers.reserve(nWorkerThreads);
+		for (uint32_t i = 1; i <= nWorkerThreads; ++i)
+		{
+			m_workers.emplace_back(&JobSystem::WorkerThreadMain, this, i);
+		}
+	}
+
+	void Shutdown()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_sleepMutex);
+			m_stopWorkers = true;
+		}
+		m_wakeWorkers.notify_all();
+		for (std::thread& worker : m_workers)
+		{
+			worker.join();
+		}
+		m_workers.clear();
+
+		// anything never run still needs freeing
+		for (std::unique_ptr<WorkStealingDeque>& deque : m_deques)
+		{
+			while (Job* job = deque->Steal())
+			{
+				delete job;
+			}
+		}
+		m_deques.clear();
+		for (Job* job : m_injectedJobs)
+		{
+			delete job;
+		}
+		m_injectedJobs.clear();
+	}
+
+	// worker threads plus the thread that owns the job system
+	uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_deques.size()); }
+
+	void Run(std::function<void()>&& task, JobCounter* counter = nullptr)
+	{
+		Job* job = new Job{ std::move(task), counter };
+		if (counter)
+		{
+			counter->m_nPendingJobs.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		const uint32_t workerIndex = GetCurrentWorkerIndex();
+		if (workerIndex == S_NOT_A_WORKER)
+		{
+			std::lock_guard<std::mutex> lock(m_injectionMutex);
+			m_injectedJobs.push_back(job);
+			m_nInjectedJobs.fetch_add(1, std::memory_order_release);
+		}
+		else if (!m_deques[workerIndex]->Push(job))
+		{
+			Execute(job); // deque's full, running it here is as good as anywhere
+			return;
+		}
+
+		if (m_nSleepingWorkers.load(std::memory_order_acquire) > 0)
+		{
+			m_wakeWorkers.notify_one();
+		}
+	}
+
+	// runs other jobs while waiting rather than blocking the thread
+	void Wait(JobCounter& counter)
+	{
+		const uint32_t workerIndex = GetCurrentWorkerIndex();
+		while (!counter.IsDone())
+		{
+			Job* job = FindJob(workerIndex);
+			if (job)
+			{
+				Execute(job);
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+		if (counter.m_hasException)
+		{
+			std::exception_ptr exception = counter.m_exception;
+			counter.m_exception = nullptr;
+			counter.m_hasException = false;
+			std::rethrow_exception(exception);
+		}
+	}
+
+	// calls function(begin, end) over [0, count) split into batches of at least minBatchSize, returns once they're all done
+	template <typename Function>
+	void ParallelFor(size_t count, size_t minBatchSize, const Function& function)
+	{
+		if (count == 0)
+		{
+			return;
+		}
+		minBatchSize = (std::max)(minBatchSize, static_cast<size_t>(1));
+		const size_t maxBatches = static_cast<size_t>(GetThreadCount()) * S_BATCHES_PER_THREAD; // a few per thread so stealing can even things out
+		const size_t nBatches = (std::min)((count + minBatchSize - 1) / minBatchSize, maxBatches);
+		if (nBatches <= 1)
+		{
+			function(static_cast<size_t>(0), count);
+			return;
+		}
+
+		JobCounter counter;
+		for (size_t batch = 1; batch < nBatches; ++batch)
+		{
+			const size_t begin = (count * batch) / nBatches;
+			const size_t end = (count * (batch + 1)) / nBatches;
+			Run([&function, begin, end]() { function(begin, end); }, &counter);
+		}
+
+		std::exception_ptr exception = nullptr;
+		try
+		{
+			function(static_cast<size_t>(0), count / nBatches);
+		}
+		catch (...)
+		{
+			exception = std::current_exception(); // the other batches still reference function, let them finish
+		}
+		Wait(counter);
+		if (exception)
+		{
+			std::rethrow_exception(exception);
+		}
+	}
+
+private:
+	struct Job
+	{
+		std::function<void()> m_task;
+		JobCounter* m_counter;
+	};
+
+	// Chase-Lev deque (the C11 memory model version from Le et al. 2013) with a fixed capacity.
+	// Only the owning thread calls Push() and Pop(), any thread can Steal().
+	class WorkStealingDeque
+	{
+	public:
+		static constexpr int64_t S_CAPACITY = 4096; // power of two
+
+		WorkStealingDeque()
+			: m_top(0)
+			, m_bottom(0)
+		{
+			for (std::atomic<Job*>& slot : m_jobs)
+			{
+				slot.store(nullptr, std::memory_order_relaxed);
+			}
+		}
+
+		bool Push(Job* job)
+		{
+			const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+			const int64_t top = m_top.load(std::memory_order_acquire);
+			if (bottom - top >= S_CAPACITY)
+			{
+				return false;
+			}
+			m_jobs[bottom & (S_CAPACITY - 1)].store(job, std::memory_order_relaxed);
+			m_bottom.store(bottom + 1, std::memory_order_release); // publishes the job to thieves
+			return true;
+		}
+
+		Job* Pop()
+		{
+			const int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+			m_bottom.store(bottom, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t top = m_top.load(std::memory_order_relaxed);
+			if (top > bottom)
+			{
+				m_bottom.store(bottom + 1, std::memory_order_relaxed); // was empty
+				return nullptr;
+			}
+
+			Job* job = m_jobs[bottom & (S_CAPACITY - 1)].load(std::memory_order_relaxed);
+			if (top == bottom)
+			{
+				// last one, race any thieves for it
+				if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				{
+					job = nullptr;
+				}
+				m_bottom.store(bottom + 1, std::memory_order_relaxed);
+			}
+			return job;
+		}
+
+		Job* Steal()
+		{
+			int64_t top = m_top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			const int64_t bottom = m_bottom.load(std::memory_order_acquire);
+			if (top >= bottom)
+			{
+				return nullptr;
+			}
+			Job* job = m_jobs[top & (S_CAPACITY - 1)].load(std::memory_order_relaxed);
+			if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				return nullptr; // lost to another thief or the owner
+			}
+			return job;
+		}
+
+	private:
+		// kept on separate cache lines, thieves hammer m_top while the owner works m_bottom
+		alignas(64) std::atomic<int64_t> m_top;
+		alignas(64) std::atomic<int64_t> m_bottom;
+		alignas(64) std::array<std::atomic<Job*>, S_CAPACITY> m_jobs;
+	};
+
+	static constexpr uint32_t S_NOT_A_WORKER = UINT32_MAX;
+	static constexpr size_t S_BATCHES_PER_THREAD = 4;
+	static constexpr uint32_t S_IDLE_SPINS_BEFORE_SLEEP = 64;
+
+	uint32_t GetCurrentWorkerIndex() const
+	{
+		return s_threadOwner == this ? s_threadWorkerIndex : S_NOT_A_WORKER;
+	}
+
+	Job* FindJob(uint32_t workerIndex)
+	{
+		if (workerIndex != S_NOT_A_WORKER)
+		{
+			if (Job* job = m_deques[workerIndex]->Pop())
+			{
+				return job;
+			}
+		}
+
+		if (m_nInjectedJobs.load(std::memory_order_acquire) > 0)
+		{
+			std::lock_guard<std::mutex> lock(m_injectionMutex);
+			if (!m_injectedJobs.empty())
+			{
+				Job* job = m_injectedJobs.front();
+				m_injectedJobs.pop_front();
+				m_nInjectedJobs.fetch_sub(1, std::memory_order_release);
+				return job;
+			}
+		}
+
+		// start from a random victim so the thieves don't all pile onto worker 0
+		const uint32_t nDeques = static_cast<uint32_t>(m_deques.size());
+		const uint32_t firstVictim = NextRandom() % nDeques;
+		for (uint32_t i = 0; i < nDeques; ++i)
+		{
+			const uint32_t victim = (firstVictim + i) % nDeques;
+			if (victim == workerIndex)
+			{
+				continue;
+			}
+			if (Job* job = m_deques[victim]->Steal())
+			{
+				return job;
+			}
+		}
+		return nullptr;
+	}
+
+	void Execute(Job* job)
+	{
+		try
+		{
+			job->m_task();
+		}
+		catch (...)
+		{
+			if (job->m_counter)
+			{
+				job->m_counter->SetException(std::current_exception());
+			}
+			else
+			{
+				std::cerr << "Unhandled exception in a job with no counter to report it to" << std::endl;
+			}
+		}
+		if (job->m_counter)
+		{
+			job->m_counter->m_nPendingJobs.fetch_sub(1, std::memory_order_acq_rel);
+		}
+		delete job;
+	}
+
+	void WorkerThreadMain(uint32_t workerIndex)
+	{
+		s_threadWorkerIndex = workerIndex;
+		s_threadOwner = this;
+		uint32_t nIdleSpins = 0;
+		while (!m_stopWorkers.load(std::memory_order_acquire))
+		{
+			if (Job* job = FindJob(workerIndex))
+			{
+				Execute(job);
+				nIdleSpins = 0;
+				continue;
+			}
+			if (++nIdleSpins < S_IDLE_SPINS_BEFORE_SLEEP)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			// the timeout covers a push that lands between FindJob() failing and going to sleep
+			std::unique_lock<std::mutex> lock(m_sleepMutex);
+			m_nSleepingWorkers.fetch_add(1, std::memory_order_acq_rel);
+			m_wakeWorkers.wait_for(lock, std::chrono::milliseconds(1));
+			m_nSleepingWorkers.fetch_sub(1, std::memory_order_acq_rel);
+			nIdleSpins = 0;
+		}
+	}
+
+	static uint32_t NextRandom()
+	{
+		// xorshift, only used to pick steal victims
+		thread_local uint32_t state = static_cast<uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id())) | 1u;
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+
+	inline static thread_local uint32_t s_threadWorkerIndex = S_NOT_A_WORKER;
+	inline static thread_local const JobSystem* s_threadOwner = nullptr;
+
+	std::vector<std::unique_ptr<WorkStealingDeque>> m_deques;
+	std::vector<std::thread> m_workers;
+	std::atomic<bool> m_stopWorkers;
+
+	std::mutex m_sleepMutex;
+	std::condition_variable m_wakeWorkers;
+	std::atomic<uint32_t> m_nSleepingWorkers;
+
+	std::mutex m_injectionMutex;
+	std::deque<Job*> m_injectedJobs;
+	std::atomic<uint32_t> m_nInjectedJobs;
+};
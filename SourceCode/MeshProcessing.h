@@ -0,0 +1,413 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "PipelineCache.h" // HashBytesFnv1a
+
+// Offline style mesh processing, run once on a mesh before it's uploaded:
+//  1. DeduplicateVertices() turns a plain triangle list into unique vertices plus an index buffer
+//  2. OptimiseVertexCache() reorders triangles so recently transformed vertices get reused (Forsyth's linear speed algorithm)
+//  3. OptimiseOverdraw() reorders clusters of those triangles so outward facing ones draw first, without giving up much cache efficiency
+//  4. OptimiseVertexFetch() reorders the vertices into the order they're first used so fetches walk memory forwards
+// ProcessMesh() runs all four and measures the result with AnalyseVertexCache().
+
+template <typename TVertex>
+struct IndexedMesh
+{
+	std::vector<TVertex> m_vertices;
+	std::vector<uint32_t> m_indices; // triangle list, 16 bit is enough when there are no more than 65536 vertices
+};
+
+struct VertexCacheStats
+{
+	double m_acmr = 0.0; // average cache miss ratio, vertices transformed per triangle. 0.5 is ideal on a big regular grid, 3 is no reuse at all
+	double m_atvr = 0.0; // average transformed vertex ratio, vertices transformed per unique vertex. 1 is ideal
+};
+
+// vertex cache simulation to measure against, a FIFO roughly the size of a real post transform cache
+static constexpr uint32_t S_VERTEX_CACHE_ANALYSIS_SIZE = 16;
+
+inline VertexCacheStats AnalyseVertexCache(const std::vector<uint32_t>& indices, size_t nVertices, uint32_t cacheSize = S_VERTEX_CACHE_ANALYSIS_SIZE)
+{
+	VertexCacheStats stats;
+	if (indices.empty() || nVertices == 0)
+	{
+		return stats;
+	}
+	// a vertex is still in the FIFO if fewer than cacheSize misses have happened since it went in
+	std::vector<uint64_t> insertedAt(nVertices, 0);
+	uint64_t nMisses = 0;
+	for (uint32_t index : indices)
+	{
+		if (insertedAt[index] == 0 || nMisses - insertedAt[index] >= cacheSize)
+		{
+			++nMisses;
+			insertedAt[index] = nMisses;
+		}
+	}
+	stats.m_acmr = static_cast<double>(nMisses) / static_cast<double>(indices.size() / 3);
+	stats.m_atvr = static_cast<double>(nMisses) / static_cast<double>(nVertices);
+	return stats;
+}
+
+// vertices are compared bytewise, so any padding in TVertex has to be zeroed
+template <typename TVertex>
+IndexedMesh<TVertex> DeduplicateVertices(const std::vector<TVertex>& triangleList)
+{
+	static_assert(std::is_trivially_copyable<TVertex>::value, "vertices are hashed and compared as bytes");
+	IndexedMesh<TVertex> mesh;
+	mesh.m_indices.resize(triangleList.size());
+	mesh.m_vertices.reserve(triangleList.size() / 2);
+
+	// open addressing, at most half full
+	size_t tableSize = 1;
+	while (tableSize < triangleList.size() * 2)
+	{
+		tableSize *= 2;
+	}
+	const uint32_t emptySlot = UINT32_MAX;
+	std::vector<uint32_t> table(tableSize, emptySlot);
+	for (size_t i = 0; i < triangleList.size(); ++i)
+	{
+		const TVertex& vertex = triangleList[i];
+		size_t slot = static_cast<size_t>(HashBytesFnv1a(&vertex, sizeof(TVertex))) & (tableSize - 1);
+		while (table[slot] != emptySlot && std::memcmp(&mesh.m_vertices[table[slot]], &vertex, sizeof(TVertex)) != 0)
+		{
+			slot = (slot + 1) & (tableSize - 1);
+		}
+		if (table[slot] == emptySlot)
+		{
+			table[slot] = static_cast<uint32_t>(mesh.m_vertices.size());
+			mesh.m_vertices.push_back(vertex);
+		}
+		mesh.m_indices[i] = table[slot];
+	}
+	mesh.m_vertices.shrink_to_fit();
+	return mesh;
+}
+
+// Tom Forsyth, "Linear-Speed Vertex Cache Optimisation". Greedily emits the triangle with the best score, vertices score higher
+// the more recently they were used (the last triangle's a little less, it's likely to be evicted soon) and the fewer triangles they have left
+inline std::vector<uint32_t> OptimiseVertexCache(const std::vector<uint32_t>& indices, size_t nVertices)
+{
+	constexpr int32_t cacheSize = 32;
+	constexpr float cacheDecayPower = 1.5f;
+	constexpr float lastTriangleScore = 0.75f;
+	constexpr float valenceBoostScale = 2.0f;
+	constexpr float valenceBoostPower = 0.5f;
+
+	const size_t nTriangles = indices.size() / 3;
+	if (nTriangles == 0)
+	{
+		return indices;
+	}
+
+	// triangles using each vertex, CSR style
+	std::vector<uint32_t> triangleOffsets(nVertices + 1, 0);
+	for (uint32_t index : indices)
+	{
+		++triangleOffsets[index + 1];
+	}
+	for (size_t i = 0; i < nVertices; ++i)
+	{
+		triangleOffsets[i + 1] += triangleOffsets[i];
+	}
+	std::vector<uint32_t> remainingTriangles(nVertices); // valence still to emit
+	for (size_t i = 0; i < nVertices; ++i)
+	{
+		remainingTriangles[i] = triangleOffsets[i + 1] - triangleOffsets[i];
+	}
+	std::vector<uint32_t> vertexTriangles(indices.size());
+	{
+		std::vector<uint32_t> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			vertexTriangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+	}
+
+	const auto vertexScore = [&](int32_t cachePosition, uint32_t remaining) -> float
+	{
+		if (remaining == 0)
+		{
+			return -1.0f; // nothing left to draw with it
+		}
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			score = cachePosition < 3 ? lastTriangleScore : std::pow(1.0f - static_cast<float>(cachePosition - 3) / (cacheSize - 3), cacheDecayPower);
+		}
+		return score + valenceBoostScale * std::pow(static_cast<float>(remaining), -valenceBoostPower);
+	};
+
+	std::vector<int32_t> cachePositions(nVertices, -1);
+	std::vector<float> vertexScores(nVertices);
+	for (size_t i = 0; i < nVertices; ++i)
+	{
+		vertexScores[i] = vertexScore(-1, remainingTriangles[i]);
+	}
+	std::vector<float> triangleScores(nTriangles);
+	for (size_t t = 0; t < nTriangles; ++t)
+	{
+		triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+	}
+	std::vector<bool> emitted(nTriangles, false);
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> newCache;
+	cache.reserve(cacheSize + 3);
+	newCache.reserve(cacheSize + 3);
+	size_t nextUnemittedTriangle = 0;
+	int64_t bestTriangle = -1;
+	for (size_t nEmitted = 0; nEmitted < nTriangles; ++nEmitted)
+	{
+		if (bestTriangle < 0)
+		{
+			// nothing in the cache has anything left, carry on from the first triangle not drawn yet
+			while (emitted[nextUnemittedTriangle])
+			{
+				++nextUnemittedTriangle;
+			}
+			bestTriangle = static_cast<int64_t>(nextUnemittedTriangle);
+		}
+		const size_t triangle = static_cast<size_t>(bestTriangle);
+		emitted[triangle] = true;
+
+		// the triangle's vertices go to the front of the LRU cache
+		newCache.clear();
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			const uint32_t vertex = indices[triangle * 3 + corner];
+			result.push_back(vertex);
+			newCache.push_back(vertex);
+			--remainingTriangles[vertex];
+			// takes the triangle out of the vertex's list so it isn't rescored
+			const uint32_t first = triangleOffsets[vertex];
+			const uint32_t end = first + remainingTriangles[vertex] + 1;
+			for (uint32_t i = first; i < end; ++i)
+			{
+				if (vertexTriangles[i] == triangle)
+				{
+					std::swap(vertexTriangles[i], vertexTriangles[end - 1]);
+					break;
+				}
+			}
+		}
+		for (uint32_t vertex : cache)
+		{
+			if (vertex != newCache[0] && vertex != newCache[1] && vertex != newCache[2])
+			{
+				newCache.push_back(vertex);
+			}
+		}
+		std::swap(cache, newCache);
+
+		// rescore everything that moved in (or fell out of) the cache, and the triangles left using those vertices
+		bestTriangle = -1;
+		float bestScore = -1.0f;
+		for (size_t i = 0; i < cache.size(); ++i)
+		{
+			const uint32_t vertex = cache[i];
+			const int32_t cachePosition = i < static_cast<size_t>(cacheSize) ? static_cast<int32_t>(i) : -1;
+			cachePositions[vertex] = cachePosition;
+			const float newScore = vertexScore(cachePosition, remainingTriangles[vertex]);
+			const float scoreDelta = newScore - vertexScores[vertex];
+			vertexScores[vertex] = newScore;
+			const uint32_t first = triangleOffsets[vertex];
+			for (uint32_t j = first; j < first + remainingTriangles[vertex]; ++j)
+			{
+				const uint32_t adjacentTriangle = vertexTriangles[j];
+				triangleScores[adjacentTriangle] += scoreDelta;
+				if (triangleScores[adjacentTriangle] > bestScore)
+				{
+					bestScore = triangleScores[adjacentTriangle];
+					bestTriangle = adjacentTriangle;
+				}
+			}
+		}
+		if (cache.size() > static_cast<size_t>(cacheSize))
+		{
+			cache.resize(cacheSize);
+		}
+	}
+	return result;
+}
+
+// Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw". Splits the cache optimised order
+// into clusters wherever that costs less than threshold times the cache misses, then draws the clusters facing furthest out first
+// so the ones behind them tend to fail the depth test. positions is indexed by vertex
+inline std::vector<uint32_t> OptimiseOverdraw(const std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions, float threshold = 1.05f)
+{
+	const size_t nTriangles = indices.size() / 3;
+	if (nTriangles < 2)
+	{
+		return indices;
+	}
+
+	// hard boundaries where a triangle misses on all three vertices, the cache optimiser has started a new patch there
+	std::vector<uint64_t> insertedAt(positions.size(), 0);
+	uint64_t nMisses = 0;
+	std::vector<uint32_t> triangleMisses(nTriangles);
+	for (size_t t = 0; t < nTriangles; ++t)
+	{
+		uint32_t misses = 0;
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			const uint32_t index = indices[t * 3 + corner];
+			if (insertedAt[index] == 0 || nMisses - insertedAt[index] >= S_VERTEX_CACHE_ANALYSIS_SIZE)
+			{
+				++nMisses;
+				++misses;
+				insertedAt[index] = nMisses;
+			}
+		}
+		triangleMisses[t] = misses;
+	}
+
+	// soft boundaries inside each patch, wherever the cluster so far is about as cache efficient as the whole patch
+	std::vector<uint32_t> clusterStarts;
+	size_t patchStart = 0;
+	while (patchStart < nTriangles)
+	{
+		size_t patchEnd = patchStart + 1;
+		uint32_t patchMisses = triangleMisses[patchStart];
+		while (patchEnd < nTriangles && triangleMisses[patchEnd] != 3)
+		{
+			patchMisses += triangleMisses[patchEnd];
+			++patchEnd;
+		}
+		const double patchAcmr = static_cast<double>(patchMisses) / static_cast<double>(patchEnd - patchStart);
+		clusterStarts.push_back(static_cast<uint32_t>(patchStart));
+		size_t clusterStart = patchStart;
+		uint32_t clusterMisses = 0;
+		for (size_t t = patchStart; t < patchEnd; ++t)
+		{
+			clusterMisses += triangleMisses[t];
+			const double clusterAcmr = static_cast<double>(clusterMisses) / static_cast<double>(t + 1 - clusterStart);
+			if (t + 1 < patchEnd && clusterAcmr <= patchAcmr * threshold && t + 1 - clusterStart >= 8)
+			{
+				clusterStart = t + 1;
+				clusterMisses = 0;
+				clusterStarts.push_back(static_cast<uint32_t>(clusterStart));
+			}
+		}
+		patchStart = patchEnd;
+	}
+	const size_t nClusters = clusterStarts.size();
+	clusterStarts.push_back(static_cast<uint32_t>(nTriangles));
+
+	// area weighted centroids and normals
+	glm::vec3 meshCentroid(0.0f);
+	float meshArea = 0.0f;
+	std::vector<glm::vec3> clusterCentroids(nClusters, glm::vec3(0.0f));
+	std::vector<glm::vec3> clusterNormals(nClusters, glm::vec3(0.0f));
+	for (size_t cluster = 0; cluster < nClusters; ++cluster)
+	{
+		float clusterArea = 0.0f;
+		for (size_t t = clusterStarts[cluster]; t < clusterStarts[cluster + 1]; ++t)
+		{
+			const glm::vec3& p0 = positions[indices[t * 3]];
+			const glm::vec3& p1 = positions[indices[t * 3 + 1]];
+			const glm::vec3& p2 = positions[indices[t * 3 + 2]];
+			const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			const float area = glm::length(normal);
+			const glm::vec3 centroid = (p0 + p1 + p2) / 3.0f;
+			clusterCentroids[cluster] += centroid * area;
+			clusterNormals[cluster] += normal;
+			clusterArea += area;
+		}
+		meshCentroid += clusterCentroids[cluster];
+		meshArea += clusterArea;
+		clusterCentroids[cluster] = clusterArea > 0.0f ? clusterCentroids[cluster] / clusterArea : clusterCentroids[cluster];
+	}
+	meshCentroid = meshArea > 0.0f ? meshCentroid / meshArea : meshCentroid;
+
+	std::vector<float> sortKeys(nClusters);
+	for (size_t cluster = 0; cluster < nClusters; ++cluster)
+	{
+		const float normalLength = glm::length(clusterNormals[cluster]);
+		const glm::vec3 normal = normalLength > 0.0f ? clusterNormals[cluster] / normalLength : glm::vec3(0.0f);
+		sortKeys[cluster] = glm::dot(clusterCentroids[cluster] - meshCentroid, normal);
+	}
+	std::vector<uint32_t> clusterOrder(nClusters);
+	for (size_t cluster = 0; cluster < nClusters; ++cluster)
+	{
+		clusterOrder[cluster] = static_cast<uint32_t>(cluster);
+	}
+	// stable so flat meshes, where every key is 0, keep the cache optimised order
+	std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&sortKeys](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	for (uint32_t cluster : clusterOrder)
+	{
+		result.insert(result.end(), indices.begin() + clusterStarts[cluster] * 3, indices.begin() + clusterStarts[cluster + 1] * 3);
+	}
+	return result;
+}
+
+// renumbers the vertices in the order the indices first use them, anything unused is dropped
+template <typename TVertex>
+void OptimiseVertexFetch(IndexedMesh<TVertex>& mesh)
+{
+	std::vector<uint32_t> remap(mesh.m_vertices.size(), UINT32_MAX);
+	std::vector<TVertex> vertices;
+	vertices.reserve(mesh.m_vertices.size());
+	for (uint32_t& index : mesh.m_indices)
+	{
+		if (remap[index] == UINT32_MAX)
+		{
+			remap[index] = static_cast<uint32_t>(vertices.size());
+			vertices.push_back(mesh.m_vertices[index]);
+		}
+		index = remap[index];
+	}
+	mesh.m_vertices = std::move(vertices);
+}
+
+struct MeshProcessingStats
+{
+	size_t m_nInputVertices = 0;
+	size_t m_nUniqueVertices = 0;
+	VertexCacheStats m_before; // deduplicated but in the original triangle order
+	VertexCacheStats m_after;
+	double m_processMs = 0.0;
+};
+
+// getPosition(const TVertex&) -> glm::vec3, for the overdraw pass
+template <typename TVertex, typename TGetPosition>
+IndexedMesh<TVertex> ProcessMesh(const std::vector<TVertex>& triangleList, TGetPosition getPosition, MeshProcessingStats* statsOut = nullptr)
+{
+	const auto processStart = std::chrono::high_resolution_clock::now();
+	IndexedMesh<TVertex> mesh = DeduplicateVertices(triangleList);
+	const VertexCacheStats before = AnalyseVertexCache(mesh.m_indices, mesh.m_vertices.size());
+
+	mesh.m_indices = OptimiseVertexCache(mesh.m_indices, mesh.m_vertices.size());
+	std::vector<glm::vec3> positions(mesh.m_vertices.size());
+	for (size_t i = 0; i < positions.size(); ++i)
+	{
+		positions[i] = getPosition(mesh.m_vertices[i]);
+	}
+	mesh.m_indices = OptimiseOverdraw(mesh.m_indices, positions);
+	OptimiseVertexFetch(mesh);
+
+	if (statsOut)
+	{
+		statsOut->m_nInputVertices = triangleList.size();
+		statsOut->m_nUniqueVertices = mesh.m_vertices.size();
+		statsOut->m_before = before;
+		statsOut->m_after = AnalyseVertexCache(mesh.m_indices, mesh.m_vertices.size());
+		statsOut->m_processMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - processStart).count();
+	}
+	return mesh;
+}
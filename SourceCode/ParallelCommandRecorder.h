@@ -0,0 +1,207 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "JobSystem.h"
+
+// Records a frame's draws into secondary command buffers, one batch of draws per job on the job system.
+// Every batch gets its own TRANSIENT command pool per frame in flight (pools can't be used from two threads at once and a batch
+// only ever runs on one), the pools for a frame are reset wholesale at the start of that frame rather than buffer by buffer.
+// Record() can be called more than once a frame (one per subpass drawn with secondaries), each call gets its own secondaries.
+class ParallelCommandRecorder
+{
+public:
+	// records items [begin, end) into the secondary command buffer, which has already been begun
+	using RecordFunction = std::function<void(VkCommandBuffer commandBuffer, size_t begin, size_t end)>;
+
+	static constexpr size_t S_MIN_ITEMS_PER_BATCH = 128; // below this the hand off costs more than the recording
+
+	ParallelCommandRecorder()
+		: m_device(nullptr)
+		, m_jobSystem(nullptr)
+		, m_nMaxBatches(0)
+		, m_nActiveBatches(0)
+		, m_currentFrameSlot(0)
+		, m_nRecordsThisFrame(0)
+		, m_frameRecordMs(0.0)
+	{}
+
+	ParallelCommandRecorder(const ParallelCommandRecorder&) = delete;
+	ParallelCommandRecorder& operator=(const ParallelCommandRecorder&) = delete;
+
+	// one batch per job system thread, so at most that many threads record at once
+	void Init(VkDevice device, JobSystem& jobSystem, uint32_t queueFamilyIndex, uint32_t nFramesInFlight)
+	{
+		m_device = device;
+		m_jobSystem = &jobSystem;
+		m_nMaxBatches = std::max(jobSystem.GetThreadCount(), 1u);
+		m_nActiveBatches = m_nMaxBatches;
+
+		VkCommandPoolCreateInfo cmdPoolCreateInfo = {};
+		cmdPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		cmdPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+		cmdPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT; // reset as a whole every frame
+
+		m_frames.resize(nFramesInFlight);
+		for (FrameResources& frame : m_frames)
+		{
+			frame.m_commandPools.resize(m_nMaxBatches);
+			frame.m_secondaryCommandBuffers.resize(m_nMaxBatches);
+			for (uint32_t i = 0; i < m_nMaxBatches; ++i)
+			{
+				if (vkCreateCommandPool(m_device, &cmdPoolCreateInfo, nullptr, &frame.m_commandPools[i]) != VK_SUCCESS)
+				{
+					throw std::runtime_error("Failed to create a recording batch's command pool");
+				}
+			}
+			AllocateSecondaries(frame, m_nMaxBatches, 1); // enough for a frame that records once, more are allocated the first time they're needed
+		}
+	}
+
+	void Shutdown()
+	{
+		for (FrameResources& frame : m_frames)
+		{
+			for (VkCommandPool commandPool : frame.m_commandPools)
+			{
+				vkDestroyCommandPool(m_device, commandPool, nullptr); // frees the command buffers too
+			}
+		}
+		m_frames.clear();
+	}
+
+	// caps how many threads record at once, lets the benchmark sweep thread counts without rebuilding anything
+	void SetActiveThreadCount(uint32_t nThreads)
+	{
+		m_nActiveBatches = std::clamp(nThreads, 1u, m_nMaxBatches);
+	}
+
+	uint32_t GetActiveThreadCount() const { return m_nActiveBatches; }
+	uint32_t GetMaxThreadCount() const { return m_nMaxBatches; }
+
+	// the frame slot must have been waited on, everything recorded in it last time round is thrown away
+	void BeginFrame(size_t frameSlot)
+	{
+		m_currentFrameSlot = frameSlot;
+		for (VkCommandPool commandPool : m_frames[frameSlot].m_commandPools)
+		{
+			vkResetCommandPool(m_device, commandPool, 0);
+		}
+		m_nRecordsThisFrame = 0;
+		m_frameRecordMs = 0.0;
+		m_usedCommandBuffers.clear();
+	}
+
+	// splits nItems into contiguous batches, returns the secondary command buffers to execute in order, good until the next call
+	const std::vector<VkCommandBuffer>& Record(const VkCommandBufferInheritanceInfo& inheritanceInfo, size_t nItems, const RecordFunction& recordFunction)
+	{
+		const auto recordStart = std::chrono::high_resolution_clock::now();
+		const size_t nUsefulBatches = std::max<size_t>(1, (nItems + S_MIN_ITEMS_PER_BATCH - 1) / S_MIN_ITEMS_PER_BATCH);
+		const uint32_t nBatches = static_cast<uint32_t>(std::min<size_t>(m_nActiveBatches, nUsefulBatches));
+		FrameResources& frame = m_frames[m_currentFrameSlot];
+		AllocateSecondaries(frame, nBatches, m_nRecordsThisFrame + 1); // before the jobs start, they only touch their own pool's
+
+		JobCounter counter;
+		for (uint32_t batch = 1; batch < nBatches; ++batch)
+		{
+			m_jobSystem->Run([this, batch, nBatches, nItems, &inheritanceInfo, &recordFunction]()
+			{
+				RecordBatch(batch, nBatches, nItems, inheritanceInfo, recordFunction);
+			}, &counter);
+		}
+
+		std::exception_ptr exception = nullptr;
+		try
+		{
+			RecordBatch(0, nBatches, nItems, inheritanceInfo, recordFunction);
+		}
+		catch (...)
+		{
+			exception = std::current_exception(); // the other batches still reference the inheritance info, let them finish
+		}
+		m_jobSystem->Wait(counter);
+		if (exception)
+		{
+			std::rethrow_exception(exception);
+		}
+
+		m_usedCommandBuffers.resize(nBatches);
+		for (uint32_t batch = 0; batch < nBatches; ++batch)
+		{
+			m_usedCommandBuffers[batch] = frame.m_secondaryCommandBuffers[batch][m_nRecordsThisFrame];
+		}
+		++m_nRecordsThisFrame;
+		m_frameRecordMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - recordStart).count();
+		return m_usedCommandBuffers;
+	}
+
+	// wall time of the Record() calls since BeginFrame()
+	double GetFrameRecordMs() const { return m_frameRecordMs; }
+
+private:
+	struct FrameResources
+	{
+		std::vector<VkCommandPool> m_commandPools; // one per batch
+		std::vector<std::vector<VkCommandBuffer>> m_secondaryCommandBuffers; // per batch, one for each Record() call a frame has needed so far, from the matching pool
+	};
+
+	void AllocateSecondaries(FrameResources& frame, uint32_t nBatches, size_t nRecords)
+	{
+		VkCommandBufferAllocateInfo cmdBufferAllocInfo = {};
+		cmdBufferAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		cmdBufferAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+		cmdBufferAllocInfo.commandBufferCount = 1;
+		for (uint32_t batch = 0; batch < nBatches; ++batch)
+		{
+			std::vector<VkCommandBuffer>& commandBuffers = frame.m_secondaryCommandBuffers[batch];
+			while (commandBuffers.size() < nRecords)
+			{
+				cmdBufferAllocInfo.commandPool = frame.m_commandPools[batch];
+				VkCommandBuffer commandBuffer = nullptr;
+				if (vkAllocateCommandBuffers(m_device, &cmdBufferAllocInfo, &commandBuffer) != VK_SUCCESS)
+				{
+					throw std::runtime_error("Failed to allocate a secondary command buffer");
+				}
+				commandBuffers.push_back(commandBuffer);
+			}
+		}
+	}
+
+	void RecordBatch(uint32_t batch, uint32_t nBatches, size_t nItems, const VkCommandBufferInheritanceInfo& inheritanceInfo, const RecordFunction& recordFunction)
+	{
+		const size_t begin = (nItems * batch) / nBatches;
+		const size_t end = (nItems * (batch + 1)) / nBatches;
+		VkCommandBuffer commandBuffer = m_frames[m_currentFrameSlot].m_secondaryCommandBuffers[batch][m_nRecordsThisFrame];
+
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		beginInfo.pInheritanceInfo = &inheritanceInfo;
+		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed the start recording a secondary command buffer!");
+		}
+		recordFunction(commandBuffer, begin, end);
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to finish recording a secondary command buffer");
+		}
+	}
+
+	VkDevice m_device;
+	JobSystem* m_jobSystem;
+	uint32_t m_nMaxBatches;
+	uint32_t m_nActiveBatches;
+	std::vector<FrameResources> m_frames;
+	size_t m_currentFrameSlot;
+	size_t m_nRecordsThisFrame; // Record() calls since BeginFrame(), which secondaries the next one uses
+	std::vector<VkCommandBuffer> m_usedCommandBuffers;
+	double m_frameRecordMs;
+};
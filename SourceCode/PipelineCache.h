@@ -0,0 +1,314 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <chrono>
+#include <mutex>
+#include <filesystem>
+#include <system_error>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+// 64 bit FNV-1a, good enough to catch truncated or corrupted files
+inline uint64_t HashBytesFnv1a(const void* data, size_t size, uint64_t hash = 14695981039346656037ull)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+// VkPipelineCache that survives between runs.
+// The file is our own header (device identity + checksum) followed by the driver's cache blob. Anything that doesn't match the
+// current device and driver is thrown away rather than handed to the driver. On save whatever is on disk gets merged in first,
+// so several runs (or several instances) accumulate into one cache, then it's written to a temp file and renamed over the old one.
+class PipelineCache
+{
+public:
+	PipelineCache()
+		: m_device(nullptr)
+		, m_pipelineCache(nullptr)
+		, m_deviceProperties()
+		, m_loadedFromDisk(false)
+		, m_loadedDataHash(0)
+		, m_nPipelinesCreated(0)
+		, m_totalCreateMs(0.0)
+	{}
+
+	PipelineCache(const PipelineCache&) = delete;
+	PipelineCache& operator=(const PipelineCache&) = delete;
+
+	// an empty path keeps the cache in memory only
+	void Init(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& filePath)
+	{
+		m_device = device;
+		m_filePath = filePath;
+		vkGetPhysicalDeviceProperties(physicalDevice, &m_deviceProperties);
+
+		const auto loadStart = std::chrono::high_resolution_clock::now();
+		std::vector<uint8_t> initialData;
+		std::string rejectReason = "no cache file";
+		if (!m_filePath.empty())
+		{
+			m_loadedFromDisk = ReadCacheFile(m_filePath, initialData, rejectReason);
+		}
+
+		VkPipelineCacheCreateInfo cacheCreateInfo = {};
+		cacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		cacheCreateInfo.initialDataSize = initialData.size();
+		cacheCreateInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+		if (vkCreatePipelineCache(m_device, &cacheCreateInfo, nullptr, &m_pipelineCache) != VK_SUCCESS)
+		{
+			if (!m_loadedFromDisk)
+			{
+				throw std::runtime_error("Failed to create pipeline cache");
+			}
+			// the driver didn't like the data even though the header matched, start from empty
+			m_loadedFromDisk = false;
+			rejectReason = "driver rejected the cached data";
+			cacheCreateInfo.initialDataSize = 0;
+			cacheCreateInfo.pInitialData = nullptr;
+			if (vkCreatePipelineCache(m_device, &cacheCreateInfo, nullptr, &m_pipelineCache) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to create pipeline cache");
+			}
+		}
+		m_loadedDataHash = m_loadedFromDisk ? HashBytesFnv1a(initialData.data(), initialData.size()) : 0;
+
+		const double loadMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - loadStart).count();
+		if (m_loadedFromDisk)
+		{
+			std::cout << "Pipeline cache hit: loaded " << initialData.size() << " bytes from " << m_filePath << " in " << loadMs << "ms" << std::endl;
+		}
+		else
+		{
+			std::cout << "Pipeline cache miss (" << rejectReason << "), starting cold" << std::endl;
+		}
+	}
+
+	// merges with whatever is on disk now and writes the result, safe to call more than once
+	void Save()
+	{
+		if (!m_pipelineCache || m_filePath.empty())
+		{
+			return;
+		}
+
+		// another run may have written the file since we loaded it
+		std::vector<uint8_t> diskData;
+		std::string rejectReason;
+		if (ReadCacheFile(m_filePath, diskData, rejectReason) && HashBytesFnv1a(diskData.data(), diskData.size()) != m_loadedDataHash)
+		{
+			VkPipelineCacheCreateInfo cacheCreateInfo = {};
+			cacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+			cacheCreateInfo.initialDataSize = diskData.size();
+			cacheCreateInfo.pInitialData = diskData.data();
+			VkPipelineCache diskCache = nullptr;
+			if (vkCreatePipelineCache(m_device, &cacheCreateInfo, nullptr, &diskCache) == VK_SUCCESS)
+			{
+				vkMergePipelineCaches(m_device, m_pipelineCache, 1, &diskCache);
+				vkDestroyPipelineCache(m_device, diskCache, nullptr);
+			}
+		}
+
+		size_t dataSize = 0;
+		if (vkGetPipelineCacheData(m_device, m_pipelineCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0)
+		{
+			return;
+		}
+		std::vector<uint8_t> cacheData(dataSize);
+		if (vkGetPipelineCacheData(m_device, m_pipelineCache, &dataSize, cacheData.data()) != VK_SUCCESS)
+		{
+			std::cerr << "Failed to get pipeline cache data, not saving it" << std::endl;
+			return;
+		}
+		cacheData.resize(dataSize);
+
+		const uint64_t dataHash = HashBytesFnv1a(cacheData.data(), cacheData.size());
+		if (dataHash == m_loadedDataHash)
+		{
+			return; // nothing new was compiled
+		}
+
+		if (WriteCacheFile(cacheData, dataHash))
+		{
+			m_loadedDataHash = dataHash;
+			std::cout << "Pipeline cache: saved " << cacheData.size() << " bytes to " << m_filePath << std::endl;
+		}
+	}
+
+	void Shutdown()
+	{
+		if (m_pipelineCache)
+		{
+			vkDestroyPipelineCache(m_device, m_pipelineCache, nullptr);
+			m_pipelineCache = nullptr;
+		}
+	}
+
+	VkPipelineCache GetHandle() const { return m_pipelineCache; }
+
+	bool IsWarm() const { return m_loadedFromDisk; }
+
+	// pipelines can be created on several threads at once (the VkPipelineCache itself is internally synchronised)
+	void RecordPipelineCreation(const char* pipelineName, double createMs)
+	{
+		std::lock_guard<std::mutex> lock(m_statsMutex);
+		++m_nPipelinesCreated;
+		m_totalCreateMs += createMs;
+		std::cout << pipelineName << " pipeline created in " << createMs << "ms (" << (m_loadedFromDisk ? "warm" : "cold") << " pipeline cache)" << std::endl;
+	}
+
+	double GetTotalPipelineCreateMs() const { return m_totalCreateMs; }
+	uint32_t GetPipelinesCreatedCount() const { return m_nPipelinesCreated; }
+
+private:
+	struct FileHeader
+	{
+		uint32_t m_magic;
+		uint32_t m_fileVersion;
+		uint32_t m_vendorID;
+		uint32_t m_deviceID;
+		uint32_t m_driverVersion;
+		uint8_t m_pipelineCacheUUID[VK_UUID_SIZE];
+		uint32_t m_padding;
+		uint64_t m_dataSize;
+		uint64_t m_dataHash;
+	};
+
+	static constexpr uint32_t S_FILE_MAGIC = 0x43505645; // "EVPC"
+	static constexpr uint32_t S_FILE_VERSION = 1;
+
+	bool ReadCacheFile(const std::string& path, std::vector<uint8_t>& cacheData, std::string& rejectReason) const
+	{
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file.is_open())
+		{
+			rejectReason = "no cache file";
+			return false;
+		}
+		const std::streamoff fileSize = file.tellg();
+		file.seekg(0);
+
+		FileHeader header = {};
+		if (fileSize < static_cast<std::streamoff>(sizeof(header)) || !file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+		{
+			rejectReason = "truncated header";
+			return false;
+		}
+		if (header.m_magic != S_FILE_MAGIC || header.m_fileVersion != S_FILE_VERSION)
+		{
+			rejectReason = "unknown file format";
+			return false;
+		}
+		if (header.m_vendorID != m_deviceProperties.vendorID || header.m_deviceID != m_deviceProperties.deviceID
+			|| std::memcmp(header.m_pipelineCacheUUID, m_deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+		{
+			rejectReason = "written by a different device";
+			return false;
+		}
+		if (header.m_driverVersion != m_deviceProperties.driverVersion)
+		{
+			rejectReason = "written by a different driver version";
+			return false;
+		}
+		if (header.m_dataSize != static_cast<uint64_t>(fileSize) - sizeof(header))
+		{
+			rejectReason = "size mismatch";
+			return false;
+		}
+
+		cacheData.resize(static_cast<size_t>(header.m_dataSize));
+		if (!file.read(reinterpret_cast<char*>(cacheData.data()), static_cast<std::streamsize>(cacheData.size())))
+		{
+			rejectReason = "truncated data";
+			return false;
+		}
+		if (HashBytesFnv1a(cacheData.data(), cacheData.size()) != header.m_dataHash)
+		{
+			rejectReason = "checksum mismatch";
+			return false;
+		}
+
+		// the driver's own header, the driver should do this as well but not all of them do
+		VkPipelineCacheHeaderVersionOne driverHeader = {};
+		if (cacheData.size() < sizeof(driverHeader))
+		{
+			rejectReason = "truncated driver header";
+			return false;
+		}
+		std::memcpy(&driverHeader, cacheData.data(), sizeof(driverHeader));
+		if (driverHeader.headerSize < sizeof(driverHeader) || driverHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+			|| driverHeader.vendorID != m_deviceProperties.vendorID || driverHeader.deviceID != m_deviceProperties.deviceID
+			|| std::memcmp(driverHeader.pipelineCacheUUID, m_deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+		{
+			rejectReason = "driver header mismatch";
+			return false;
+		}
+		return true;
+	}
+
+	bool WriteCacheFile(const std::vector<uint8_t>& cacheData, uint64_t dataHash) const
+	{
+		FileHeader header = {};
+		header.m_magic = S_FILE_MAGIC;
+		header.m_fileVersion = S_FILE_VERSION;
+		header.m_vendorID = m_deviceProperties.vendorID;
+		header.m_deviceID = m_deviceProperties.deviceID;
+		header.m_driverVersion = m_deviceProperties.driverVersion;
+		std::memcpy(header.m_pipelineCacheUUID, m_deviceProperties.pipelineCacheUUID, VK_UUID_SIZE);
+		header.m_dataSize = cacheData.size();
+		header.m_dataHash = dataHash;
+
+		// write then rename so a crash mid write can't leave a half written cache behind
+		const std::string tempPath = m_filePath + ".tmp";
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+			{
+				std::cerr << "Failed to open " << tempPath << " to save the pipeline cache" << std::endl;
+				return false;
+			}
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(reinterpret_cast<const char*>(cacheData.data()), static_cast<std::streamsize>(cacheData.size()));
+			file.flush();
+			if (!file)
+			{
+				std::cerr << "Failed to write the pipeline cache to " << tempPath << std::endl;
+				file.close();
+				std::error_code ignored;
+				std::filesystem::remove(tempPath, ignored);
+				return false;
+			}
+		}
+
+		std::error_code renameError;
+		std::filesystem::rename(tempPath, m_filePath, renameError);
+		if (renameError)
+		{
+			std::cerr << "Failed to replace " << m_filePath << ": " << renameError.message() << std::endl;
+			std::error_code ignored;
+			std::filesystem::remove(tempPath, ignored);
+			return false;
+		}
+		return true;
+	}
+
+	VkDevice m_device;
+	VkPipelineCache m_pipelineCache;
+	VkPhysicalDeviceProperties m_deviceProperties;
+	std::string m_filePath;
+	bool m_loadedFromDisk;
+	uint64_t m_loadedDataHash;
+	uint32_t m_nPipelinesCreated;
+	double m_totalCreateMs;
+	std::mutex m_statsMutex;
+};
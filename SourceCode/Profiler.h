@@ -0,0 +1,528 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#ifdef _WINDOWS
+#include <Windows.h>
+#endif // _WINDOWS
+
+// CPU zones and GPU timestamp queries, streamed into a ring buffer and exported as a Chrome trace (chrome://tracing or
+// ui.perfetto.dev) or CSV. GPU times are moved into the CPU's steady_clock domain, with VK_EXT_calibrated_timestamps when the
+// device has it and otherwise by lining the frame's first GPU timestamp up with its submit.
+// Disabled at runtime a zone costs a branch, define VULKAN_ENGINE_NO_PROFILING to compile them out altogether.
+
+struct ProfileEvent
+{
+	const char* m_name; // string literals only, nothing is copied
+	uint64_t m_startNs;
+	uint64_t m_endNs;
+	uint64_t m_frameIndex;
+	uint32_t m_threadIndex; // unused for GPU events
+	bool m_isGpuEvent;
+};
+
+class Profiler
+{
+public:
+	static constexpr size_t S_EVENT_RING_CAPACITY = 1 << 16; // power of two, oldest events are overwritten
+	static constexpr uint32_t S_MAX_GPU_ZONES_PER_FRAME = 256;
+	static constexpr uint32_t S_INVALID_GPU_ZONE = UINT32_MAX;
+	static constexpr uint64_t S_RECALIBRATION_INTERVAL_FRAMES = 120; // the clocks drift apart over time
+
+	Profiler()
+		: m_enabled(false)
+		, m_device(nullptr)
+		, m_gpuTimingSupported(false)
+		, m_timestampPeriodNs(1.0)
+		, m_timestampMask(~0ull)
+		, m_vkGetCalibratedTimestamps(nullptr)
+		, m_hostTimeDomain(VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT)
+		, m_hostTicksPerSecond(1000000000ull)
+		, m_gpuToCpuOffsetNs(0)
+		, m_isCalibrated(false)
+		, m_currentFrameSlot(0)
+		, m_currentFrameIndex(0)
+		, m_eventSlots(std::make_unique<EventSlot[]>(S_EVENT_RING_CAPACITY))
+		, m_nEventsWritten(0)
+	{}
+
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+
+	// calibratedTimestampsEnabled should only be true if VK_EXT_calibrated_timestamps was enabled on the device
+	void Init(bool enabled, VkInstance instance, VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamilyIndex, uint32_t nFramesInFlight, bool calibratedTimestampsEnabled)
+	{
+		m_enabled = enabled;
+		m_device = device;
+		if (!m_enabled)
+		{
+			return;
+		}
+
+		VkPhysicalDeviceProperties deviceProperties = {};
+		vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+		uint32_t nQueueFamilies = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &nQueueFamilies, nullptr);
+		std::vector<VkQueueFamilyProperties> queueFamilies(nQueueFamilies);
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &nQueueFamilies, queueFamilies.data());
+		const uint32_t timestampValidBits = queueFamilyIndex < nQueueFamilies ? queueFamilies[queueFamilyIndex].timestampValidBits : 0;
+
+		m_gpuTimingSupported = timestampValidBits > 0 && deviceProperties.limits.timestampPeriod > 0.0f;
+		if (!m_gpuTimingSupported)
+		{
+			std::cout << "Profiler: the graphics queue doesn't support timestamps, CPU zones only" << std::endl;
+			return;
+		}
+		m_timestampPeriodNs = deviceProperties.limits.timestampPeriod;
+		m_timestampMask = timestampValidBits >= 64 ? ~0ull : ((1ull << timestampValidBits) - 1);
+
+		VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+		queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolCreateInfo.queryCount = S_MAX_GPU_ZONES_PER_FRAME * 2;
+		for (uint32_t i = 0; i < nFramesInFlight; ++i)
+		{
+			std::unique_ptr<GpuFrame> frame = std::make_unique<GpuFrame>();
+			if (vkCreateQueryPool(m_device, &queryPoolCreateInfo, nullptr, &frame->m_queryPool) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to create timestamp query pool");
+			}
+			m_gpuFrames.push_back(std::move(frame));
+		}
+
+		if (calibratedTimestampsEnabled)
+		{
+			InitCalibration(instance, physicalDevice);
+		}
+		std::cout << "Profiler: GPU timestamps " << (m_vkGetCalibratedTimestamps ? "calibrated against the CPU clock" : "aligned to submits (no calibrated timestamps)") << std::endl;
+	}
+
+	void Shutdown()
+	{
+		for (std::unique_ptr<GpuFrame>& frame : m_gpuFrames)
+		{
+			vkDestroyQueryPool(m_device, frame->m_queryPool, nullptr);
+		}
+		m_gpuFrames.clear();
+	}
+
+	bool IsEnabled() const { return m_enabled; }
+
+	// counts BeginFrame() calls, events are tagged with it
+	uint64_t GetFrameIndex() const { return m_currentFrameIndex.load(std::memory_order_relaxed); }
+
+	static uint64_t NowNs()
+	{
+		// steady_clock is CLOCK_MONOTONIC / QueryPerformanceCounter, the same domains the calibrated timestamps use
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	// safe from any thread
+	void RecordCpuZone(const char* name, uint64_t startNs, uint64_t endNs)
+	{
+		RecordEvent({ name, startNs, endNs, m_currentFrameIndex.load(std::memory_order_relaxed), GetThreadIndex(), false });
+	}
+
+	// for zones timed on another thread and recorded afterwards, threadIndex from GetThreadIndex() on that thread
+	void RecordCpuZone(const char* name, uint64_t startNs, uint64_t endNs, uint32_t threadIndex)
+	{
+		RecordEvent({ name, startNs, endNs, m_currentFrameIndex.load(std::memory_order_relaxed), threadIndex, false });
+	}
+
+	// small and dense per thread, what events are tagged with
+	static uint32_t GetThreadIndex()
+	{
+		static std::atomic<uint32_t> s_nThreads{ 0 };
+		thread_local const uint32_t threadIndex = s_nThreads.fetch_add(1, std::memory_order_relaxed);
+		return threadIndex;
+	}
+
+	// after the frame slot has been waited on, picks up the GPU results from the last frame that used the slot
+	void BeginFrame(size_t frameSlot)
+	{
+		if (!m_enabled)
+		{
+			return;
+		}
+		const uint64_t frameIndex = m_currentFrameIndex.fetch_add(1, std::memory_order_relaxed) + 1;
+		if (!m_gpuTimingSupported)
+		{
+			return;
+		}
+		CollectGpuFrame(*m_gpuFrames[frameSlot]);
+		if (frameIndex % S_RECALIBRATION_INTERVAL_FRAMES == 1)
+		{
+			Calibrate();
+		}
+
+		m_currentFrameSlot = frameSlot;
+		GpuFrame& frame = *m_gpuFrames[frameSlot];
+		frame.m_nZones.store(0, std::memory_order_relaxed);
+		frame.m_frameIndex = frameIndex;
+		frame.m_submitted = false;
+	}
+
+	// in the frame's primary command buffer before any GPU zone and outside a render pass
+	void ResetQueries(VkCommandBuffer commandBuffer)
+	{
+		if (m_enabled && m_gpuTimingSupported)
+		{
+			vkCmdResetQueryPool(commandBuffer, m_gpuFrames[m_currentFrameSlot]->m_queryPool, 0, S_MAX_GPU_ZONES_PER_FRAME * 2);
+		}
+	}
+
+	// safe from any thread recording for the current frame
+	uint32_t BeginGpuZone(VkCommandBuffer commandBuffer, const char* name)
+	{
+		if (!m_enabled || !m_gpuTimingSupported)
+		{
+			return S_INVALID_GPU_ZONE;
+		}
+		GpuFrame& frame = *m_gpuFrames[m_currentFrameSlot];
+		const uint32_t zone = frame.m_nZones.fetch_add(1, std::memory_order_relaxed);
+		if (zone >= S_MAX_GPU_ZONES_PER_FRAME)
+		{
+			return S_INVALID_GPU_ZONE;
+		}
+		frame.m_zoneNames[zone] = name;
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.m_queryPool, zone * 2);
+		return zone;
+	}
+
+	void EndGpuZone(VkCommandBuffer commandBuffer, uint32_t zone)
+	{
+		if (zone != S_INVALID_GPU_ZONE)
+		{
+			vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_gpuFrames[m_currentFrameSlot]->m_queryPool, zone * 2 + 1);
+		}
+	}
+
+	// right after the frame's vkQueueSubmit, used to line the clocks up when there's no calibration
+	void OnFrameSubmitted()
+	{
+		if (m_enabled && m_gpuTimingSupported)
+		{
+			GpuFrame& frame = *m_gpuFrames[m_currentFrameSlot];
+			frame.m_submitNs = NowNs();
+			frame.m_submitted = true;
+		}
+	}
+
+	// the device must be idle, collects whatever frames are still outstanding
+	void CollectAll()
+	{
+		for (std::unique_ptr<GpuFrame>& frame : m_gpuFrames)
+		{
+			CollectGpuFrame(*frame);
+		}
+	}
+
+	// only while nothing is recording zones, picks the format from the extension (.csv, anything else is a Chrome trace)
+	bool Export(const std::string& path) const
+	{
+		const bool csv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+		std::ofstream file(path, std::ios::trunc);
+		if (!file.is_open())
+		{
+			std::cerr << "Failed to open " << path << " to write the profile to" << std::endl;
+			return false;
+		}
+
+		const std::vector<ProfileEvent> events = GetEvents();
+		const uint64_t firstNs = events.empty() ? 0 : std::min_element(events.begin(), events.end(),
+			[](const ProfileEvent& a, const ProfileEvent& b) { return a.m_startNs < b.m_startNs; })->m_startNs;
+		if (csv)
+		{
+			WriteCsv(file, events, firstNs);
+		}
+		else
+		{
+			WriteChromeTrace(file, events, firstNs);
+		}
+		std::cout << "Profiler: wrote " << events.size() << " events to " << path << std::endl;
+		return static_cast<bool>(file);
+	}
+
+	// total ever recorded, pass it to GetEvents() later to only get what's been recorded since
+	uint64_t GetEventCount() const { return m_nEventsWritten.load(std::memory_order_acquire); }
+
+	// oldest first, anything the ring has since overwritten is gone. Safe while other threads are recording: it stops at the first
+	// event that's been counted but not finished being written, nextEvent gets where to carry on from next time
+	std::vector<ProfileEvent> GetEvents(uint64_t firstEvent = 0, uint64_t* nextEvent = nullptr) const
+	{
+		const uint64_t nWritten = m_nEventsWritten.load(std::memory_order_acquire);
+		const uint64_t oldestEvent = std::max(firstEvent, nWritten - std::min<uint64_t>(nWritten, S_EVENT_RING_CAPACITY));
+		std::vector<ProfileEvent> events;
+		events.reserve(static_cast<size_t>(nWritten - std::min(oldestEvent, nWritten)));
+		uint64_t i = oldestEvent;
+		for (; i < nWritten; ++i)
+		{
+			const EventSlot& slot = m_eventSlots[i & (S_EVENT_RING_CAPACITY - 1)];
+			const uint64_t sequence = slot.m_sequence.load(std::memory_order_acquire);
+			if (sequence > i + 1)
+			{
+				continue; // lapped, a later event's already in the slot
+			}
+			if (sequence != i + 1)
+			{
+				break; // still being written
+			}
+			const ProfileEvent profileEvent = slot.m_event;
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slot.m_sequence.load(std::memory_order_relaxed) == sequence) // otherwise it was overwritten while it was copied
+			{
+				events.push_back(profileEvent);
+			}
+		}
+		if (nextEvent)
+		{
+			*nextEvent = i;
+		}
+		return events;
+	}
+
+private:
+	struct GpuFrame
+	{
+		VkQueryPool m_queryPool = nullptr;
+		std::atomic<uint32_t> m_nZones{ 0 };
+		const char* m_zoneNames[S_MAX_GPU_ZONES_PER_FRAME] = {};
+		uint64_t m_frameIndex = 0;
+		uint64_t m_submitNs = 0;
+		bool m_submitted = false;
+	};
+
+	struct EventSlot
+	{
+		std::atomic<uint64_t> m_sequence{ 0 }; // the event's index + 1 once it's been written, 0 while it's being written
+		ProfileEvent m_event = {};
+	};
+
+	void RecordEvent(const ProfileEvent& profileEvent)
+	{
+		const uint64_t eventIndex = m_nEventsWritten.fetch_add(1, std::memory_order_relaxed);
+		EventSlot& slot = m_eventSlots[eventIndex & (S_EVENT_RING_CAPACITY - 1)];
+		// like a seqlock, readers see the slot go invalid before any of the event changes and the new index once all of it has
+		slot.m_sequence.store(0, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		slot.m_event = profileEvent;
+		slot.m_sequence.store(eventIndex + 1, std::memory_order_release);
+	}
+
+	void CollectGpuFrame(GpuFrame& frame)
+	{
+		if (!m_enabled || !m_gpuTimingSupported || !frame.m_submitted)
+		{
+			return;
+		}
+		frame.m_submitted = false;
+		const uint32_t nZones = std::min(frame.m_nZones.load(std::memory_order_relaxed), S_MAX_GPU_ZONES_PER_FRAME);
+		if (nZones == 0)
+		{
+			return;
+		}
+
+		std::vector<uint64_t> timestamps(nZones * 2);
+		const VkResult result = vkGetQueryPoolResults(m_device, frame.m_queryPool, 0, nZones * 2, timestamps.size() * sizeof(uint64_t),
+			timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+		if (result != VK_SUCCESS)
+		{
+			return; // VK_NOT_READY shouldn't happen after the slot's been waited on, drop the frame rather than stall
+		}
+
+		if (!m_isCalibrated)
+		{
+			// the GPU can't have started before the submit, so that's the best guess at where its first timestamp sits
+			const uint64_t firstGpuNs = ToGpuNs(*std::min_element(timestamps.begin(), timestamps.end()));
+			m_gpuToCpuOffsetNs = static_cast<int64_t>(frame.m_submitNs) - static_cast<int64_t>(firstGpuNs);
+			m_isCalibrated = true;
+		}
+		for (uint32_t zone = 0; zone < nZones; ++zone)
+		{
+			const uint64_t startNs = static_cast<uint64_t>(static_cast<int64_t>(ToGpuNs(timestamps[zone * 2])) + m_gpuToCpuOffsetNs);
+			const uint64_t endNs = static_cast<uint64_t>(static_cast<int64_t>(ToGpuNs(timestamps[zone * 2 + 1])) + m_gpuToCpuOffsetNs);
+			RecordEvent({ frame.m_zoneNames[zone], startNs, std::max(startNs, endNs), frame.m_frameIndex, 0, true });
+		}
+	}
+
+	uint64_t ToGpuNs(uint64_t timestamp) const
+	{
+		return static_cast<uint64_t>(static_cast<double>(timestamp & m_timestampMask) * m_timestampPeriodNs);
+	}
+
+	void InitCalibration(VkInstance instance, VkPhysicalDevice physicalDevice)
+	{
+		PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT getTimeDomains = reinterpret_cast<PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT>(
+			vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceCalibrateableTimeDomainsEXT"));
+		PFN_vkGetCalibratedTimestampsEXT getCalibratedTimestamps = reinterpret_cast<PFN_vkGetCalibratedTimestampsEXT>(
+			vkGetDeviceProcAddr(m_device, "vkGetCalibratedTimestampsEXT"));
+		if (!getTimeDomains || !getCalibratedTimestamps)
+		{
+			return;
+		}
+
+#ifdef _WINDOWS
+		m_hostTimeDomain = VK_TIME_DOMAIN_QUERY_PERFORMANCE_COUNTER_EXT;
+		LARGE_INTEGER frequency = {};
+		QueryPerformanceFrequency(&frequency);
+		m_hostTicksPerSecond = static_cast<uint64_t>(frequency.QuadPart);
+#else
+		m_hostTimeDomain = VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT;
+		m_hostTicksPerSecond = 1000000000ull;
+#endif // _WINDOWS
+
+		uint32_t nTimeDomains = 0;
+		getTimeDomains(physicalDevice, &nTimeDomains, nullptr);
+		std::vector<VkTimeDomainEXT> timeDomains(nTimeDomains);
+		getTimeDomains(physicalDevice, &nTimeDomains, timeDomains.data());
+		const bool hasDeviceDomain = std::find(timeDomains.begin(), timeDomains.end(), VK_TIME_DOMAIN_DEVICE_EXT) != timeDomains.end();
+		const bool hasHostDomain = std::find(timeDomains.begin(), timeDomains.end(), m_hostTimeDomain) != timeDomains.end();
+		if (hasDeviceDomain && hasHostDomain)
+		{
+			m_vkGetCalibratedTimestamps = getCalibratedTimestamps;
+			Calibrate();
+		}
+	}
+
+	void Calibrate()
+	{
+		if (!m_vkGetCalibratedTimestamps)
+		{
+			m_isCalibrated = false; // realign against the next collected frame
+			return;
+		}
+		VkCalibratedTimestampInfoEXT timestampInfos[2] = {};
+		timestampInfos[0].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+		timestampInfos[0].timeDomain = VK_TIME_DOMAIN_DEVICE_EXT;
+		timestampInfos[1].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+		timestampInfos[1].timeDomain = m_hostTimeDomain;
+		uint64_t timestamps[2] = {};
+		uint64_t maxDeviation = 0;
+		if (m_vkGetCalibratedTimestamps(m_device, 2, timestampInfos, timestamps, &maxDeviation) != VK_SUCCESS)
+		{
+			return;
+		}
+		const uint64_t hostNs = m_hostTicksPerSecond == 1000000000ull ? timestamps[1]
+			: static_cast<uint64_t>(static_cast<double>(timestamps[1]) * (1000000000.0 / static_cast<double>(m_hostTicksPerSecond)));
+		m_gpuToCpuOffsetNs = static_cast<int64_t>(hostNs) - static_cast<int64_t>(ToGpuNs(timestamps[0]));
+		m_isCalibrated = true;
+	}
+
+	static void WriteChromeTrace(std::ofstream& file, const std::vector<ProfileEvent>& events, uint64_t firstNs)
+	{
+		// complete ("X") events in microseconds, CPU threads under one process and the GPU queue under another
+		file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"CPU\"}},\n";
+		file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"GPU\"}},\n";
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Graphics queue\"}}";
+		for (const ProfileEvent& profileEvent : events)
+		{
+			file << ",\n{\"name\":\"" << profileEvent.m_name << "\",\"cat\":\"" << (profileEvent.m_isGpuEvent ? "gpu" : "cpu")
+				<< "\",\"ph\":\"X\",\"pid\":" << (profileEvent.m_isGpuEvent ? 1 : 0) << ",\"tid\":" << profileEvent.m_threadIndex
+				<< ",\"ts\":" << static_cast<double>(profileEvent.m_startNs - firstNs) / 1000.0
+				<< ",\"dur\":" << static_cast<double>(profileEvent.m_endNs - profileEvent.m_startNs) / 1000.0
+				<< ",\"args\":{\"frame\":" << profileEvent.m_frameIndex << "}}";
+		}
+		file << "\n]}\n";
+	}
+
+	static void WriteCsv(std::ofstream& file, const std::vector<ProfileEvent>& events, uint64_t firstNs)
+	{
+		file << "source,name,thread,frame,start_us,duration_us\n";
+		for (const ProfileEvent& profileEvent : events)
+		{
+			file << (profileEvent.m_isGpuEvent ? "gpu" : "cpu") << ',' << profileEvent.m_name << ',' << profileEvent.m_threadIndex << ','
+				<< profileEvent.m_frameIndex << ',' << static_cast<double>(profileEvent.m_startNs - firstNs) / 1000.0 << ','
+				<< static_cast<double>(profileEvent.m_endNs - profileEvent.m_startNs) / 1000.0 << '\n';
+		}
+	}
+
+	bool m_enabled;
+	VkDevice m_device;
+
+	bool m_gpuTimingSupported;
+	double m_timestampPeriodNs;
+	uint64_t m_timestampMask;
+	std::vector<std::unique_ptr<GpuFrame>> m_gpuFrames;
+
+	PFN_vkGetCalibratedTimestampsEXT m_vkGetCalibratedTimestamps;
+	VkTimeDomainEXT m_hostTimeDomain;
+	uint64_t m_hostTicksPerSecond;
+	int64_t m_gpuToCpuOffsetNs;
+	bool m_isCalibrated;
+
+	size_t m_currentFrameSlot;
+	std::atomic<uint64_t> m_currentFrameIndex;
+	std::unique_ptr<EventSlot[]> m_eventSlots;
+	std::atomic<uint64_t> m_nEventsWritten;
+};
+
+// RAII zones, nothing but a branch when the profiler is disabled
+class CpuProfileZone
+{
+public:
+	CpuProfileZone(Profiler& profiler, const char* name)
+		: m_profiler(profiler.IsEnabled() ? &profiler : nullptr)
+		, m_name(name)
+		, m_startNs(m_profiler ? Profiler::NowNs() : 0)
+	{}
+
+	~CpuProfileZone()
+	{
+		if (m_profiler)
+		{
+			m_profiler->RecordCpuZone(m_name, m_startNs, Profiler::NowNs());
+		}
+	}
+
+	CpuProfileZone(const CpuProfileZone&) = delete;
+	CpuProfileZone& operator=(const CpuProfileZone&) = delete;
+
+private:
+	Profiler* m_profiler;
+	const char* m_name;
+	uint64_t m_startNs;
+};
+
+class GpuProfileZone
+{
+public:
+	GpuProfileZone(Profiler& profiler, VkCommandBuffer commandBuffer, const char* name)
+		: m_profiler(profiler)
+		, m_commandBuffer(commandBuffer)
+		, m_zone(profiler.BeginGpuZone(commandBuffer, name))
+	{}
+
+	~GpuProfileZone()
+	{
+		m_profiler.EndGpuZone(m_commandBuffer, m_zone);
+	}
+
+	GpuProfileZone(const GpuProfileZone&) = delete;
+	GpuProfileZone& operator=(const GpuProfileZone&) = delete;
+
+private:
+	Profiler& m_profiler;
+	VkCommandBuffer m_commandBuffer;
+	uint32_t m_zone;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#ifdef VULKAN_ENGINE_NO_PROFILING
+#define PROFILE_CPU_ZONE(profiler, name)
+#define PROFILE_GPU_ZONE(profiler, commandBuffer, name)
+#else
+#define PROFILE_CPU_ZONE(profiler, name) CpuProfileZone PROFILE_CONCAT(cpuProfileZone, __LINE__)(profiler, name)
+#define PROFILE_GPU_ZONE(profiler, commandBuffer, name) GpuProfileZone PROFILE_CONCAT(gpuProfileZone, __LINE__)(profiler, commandBuffer, name)
+#endif // VULKAN_ENGINE_NO_PROFILING
@@ -0,0 +1,1256 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <map>
+#include <unordered_map>
+#include <functional>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "DeviceMemoryAllocator.h"
+#include "DeferredDestructionQueue.h"
+
+// what a pass is handed when it's recorded, graphics passes are already inside their render pass on their own subpass.
+// The render pass, subpass and frame buffer are there for secondary command buffer inheritance
+struct RenderGraphPassContext
+{
+	VkCommandBuffer m_commandBuffer;
+	VkRenderPass m_renderPass; // null for transfer passes
+	uint32_t m_subpass;
+	VkFramebuffer m_framebuffer; // null for transfer passes
+	VkExtent2D m_extent;
+};
+
+// The frame as a graph of passes. Passes are declared in the order they run, along with the images they read and write,
+// and Compile() works out everything that used to be written by hand:
+// - passes nothing needs are culled, working back from the imported images (the graph's outputs) and passes with side effects
+// - runs of graphics passes become subpasses of one render pass so tile based GPUs can keep the attachments on chip between them,
+//   a pass sampling an image written earlier in the run starts a new render pass since that can't be done per pixel
+// - layout transitions go on the attachment descriptions and subpass dependencies where they can, what's left becomes pipeline barriers
+// - load and store ops come from whether the contents are needed before and after
+// - transient images that are never live at the same time share memory, ones that never leave a render pass get lazily allocated memory
+// Compiled plans are cached on a hash of the topology, so declaring the same graph again (or going back to an earlier one)
+// doesn't rebuild anything, and per frame there's only binding the imported images and Execute().
+// Every image is the graph's extent and transient images don't keep their contents between frames. Not thread safe
+class RenderGraph
+{
+public:
+	using ResourceId = uint32_t;
+	using PassId = uint32_t;
+	using RecordFunction = std::function<void(const RenderGraphPassContext&)>;
+
+	static constexpr uint32_t S_INVALID_ID = UINT32_MAX;
+
+	RenderGraph()
+		: m_device(nullptr)
+		, m_allocator(nullptr)
+		, m_deferredDestructionQueue(nullptr)
+		, m_plan(nullptr)
+		, m_extent({ 0, 0 })
+	{}
+
+	RenderGraph(const RenderGraph&) = delete;
+	RenderGraph& operator=(const RenderGraph&) = delete;
+
+	// anything the graph replaces while frames could still be using it goes through deferredDestructionQueue
+	void Init(VkDevice device, DeviceMemoryAllocator& allocator, DeferredDestructionQueue& deferredDestructionQueue)
+	{
+		m_device = device;
+		m_allocator = &allocator;
+		m_deferredDestructionQueue = &deferredDestructionQueue;
+	}
+
+	// only once the device is idle
+	void Shutdown()
+	{
+		if (!m_device)
+		{
+			return;
+		}
+		for (const std::pair<const FramebufferKey, VkFramebuffer>& framebuffer : m_framebuffers)
+		{
+			vkDestroyFramebuffer(m_device, framebuffer.second, nullptr);
+		}
+		m_framebuffers.clear();
+		DestroyRealisation(m_realisation);
+		m_realisation = Realisation();
+		for (const std::pair<const uint64_t, std::unique_ptr<CompiledPlan>>& plan : m_plans)
+		{
+			for (const CompiledRenderPass& renderPass : plan.second->m_renderPasses)
+			{
+				vkDestroyRenderPass(m_device, renderPass.m_renderPass, nullptr);
+			}
+		}
+		m_plans.clear();
+		m_plan = nullptr;
+		m_resources.clear();
+		m_passes.clear();
+		m_device = nullptr;
+	}
+
+	// starts declaring the graph again, compiled plans are kept for Compile() to find
+	void Reset()
+	{
+		m_resources.clear();
+		m_passes.clear();
+	}
+
+	// an image from outside the graph, bound with SetImportedImage() each frame. It's in initialLayout when the graph starts
+	// and is left in finalLayout, VK_IMAGE_LAYOUT_UNDEFINED leaves it however the last pass to use it did
+	ResourceId ImportImage(const char* name, VkFormat format, VkImageLayout initialLayout, VkImageLayout finalLayout)
+	{
+		return AddResource(name, format, true, initialLayout, finalLayout);
+	}
+
+	// owned by the graph and only valid during the frame, created with whatever usage the passes declare
+	ResourceId CreateTransientImage(const char* name, VkFormat format)
+	{
+		return AddResource(name, format, false, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED);
+	}
+
+	PassId AddGraphicsPass(const char* name, RecordFunction&& record, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE)
+	{
+		return AddPass(name, true, std::move(record), contents);
+	}
+
+	// copies and the like, recorded outside of any render pass
+	PassId AddTransferPass(const char* name, RecordFunction&& record)
+	{
+		return AddPass(name, false, std::move(record), VK_SUBPASS_CONTENTS_INLINE);
+	}
+
+	void WriteColour(PassId pass, ResourceId resource, VkAttachmentLoadOp loadOp, VkClearColorValue clearColour = {})
+	{
+		VkClearValue clearValue = {};
+		clearValue.color = clearColour;
+		AddUse(pass, resource, UseKind::ColourWrite, loadOp, clearValue, 0);
+	}
+
+	void WriteDepth(PassId pass, ResourceId resource, VkAttachmentLoadOp loadOp, VkClearDepthStencilValue clearDepth = { 1.0f, 0 })
+	{
+		VkClearValue clearValue = {};
+		clearValue.depthStencil = clearDepth;
+		AddUse(pass, resource, UseKind::DepthWrite, loadOp, clearValue, 0);
+	}
+
+	// depth tested against but not written
+	void ReadDepth(PassId pass, ResourceId resource)
+	{
+		AddUse(pass, resource, UseKind::DepthRead, VK_ATTACHMENT_LOAD_OP_LOAD, VkClearValue(), 0);
+	}
+
+	void ReadInputAttachment(PassId pass, ResourceId resource)
+	{
+		AddUse(pass, resource, UseKind::InputAttachment, VK_ATTACHMENT_LOAD_OP_LOAD, VkClearValue(), 0);
+	}
+
+	void ReadSampled(PassId pass, ResourceId resource, VkPipelineStageFlags stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT)
+	{
+		AddUse(pass, resource, UseKind::Sampled, VK_ATTACHMENT_LOAD_OP_LOAD, VkClearValue(), stages);
+	}
+
+	void ReadTransfer(PassId pass, ResourceId resource)
+	{
+		AddUse(pass, resource, UseKind::TransferRead, VK_ATTACHMENT_LOAD_OP_LOAD, VkClearValue(), 0);
+	}
+
+	// never culled, for passes writing to things the graph can't see like a read back buffer
+	void SetSideEffects(PassId pass)
+	{
+		GetPass(pass).m_sideEffects = true;
+	}
+
+	// whether the pass records inline or executes secondaries, doesn't change the topology
+	void SetSubpassContents(PassId pass, VkSubpassContents contents)
+	{
+		GetPass(pass).m_contents = contents;
+	}
+
+	// true when the plan changed, pipelines created against the old plan's render passes need creating again
+	bool Compile()
+	{
+		const uint64_t hash = HashTopology();
+		if (m_plan && m_plan->m_hash == hash)
+		{
+			return false;
+		}
+		std::unordered_map<uint64_t, std::unique_ptr<CompiledPlan>>::iterator plan = m_plans.find(hash);
+		if (plan == m_plans.end())
+		{
+			plan = m_plans.emplace(hash, BuildPlan(hash)).first;
+		}
+		m_plan = plan->second.get();
+		return true;
+	}
+
+	// for pipeline creation, only valid once compiled
+	VkRenderPass GetRenderPass(PassId pass) const
+	{
+		const uint32_t renderPass = GetPlan().m_passRenderPass[pass];
+		return renderPass != S_INVALID_ID ? m_plan->m_renderPasses[renderPass].m_renderPass : VK_NULL_HANDLE;
+	}
+
+	uint32_t GetSubpass(PassId pass) const { return GetPlan().m_passSubpass[pass]; }
+	bool IsPassCulled(PassId pass) const { return !GetPlan().m_passLive[pass]; }
+	uint32_t GetRenderPassCount() const { return static_cast<uint32_t>(GetPlan().m_renderPasses.size()); }
+	uint32_t GetBarrierCount() const { return GetPlan().m_barrierCount; }
+	size_t GetCachedPlanCount() const { return m_plans.size(); }
+	// the transient images' memory once realised, with and without the aliasing
+	VkDeviceSize GetTransientBytes() const { return m_realisation.m_bytes; }
+	VkDeviceSize GetUnaliasedTransientBytes() const { return m_realisation.m_unaliasedBytes; }
+
+	// transients are created again the next Execute() after this changes
+	void SetExtent(VkExtent2D extent)
+	{
+		m_extent = extent;
+	}
+
+	void SetImportedImage(ResourceId resource, VkImage image, VkImageView view)
+	{
+		Resource& importedResource = m_resources.at(resource);
+		if (!importedResource.m_imported)
+		{
+			throw std::runtime_error("Render graph image " + importedResource.m_name + " isn't imported");
+		}
+		importedResource.m_image = image;
+		importedResource.m_view = view;
+	}
+
+	// before destroying any view handed to SetImportedImage(), drops the frame buffers made with them
+	void OnImportedImagesChanged()
+	{
+		ReleaseFramebuffers();
+	}
+
+	VkImage GetImage(ResourceId resource) const
+	{
+		const Resource& imageResource = m_resources.at(resource);
+		return imageResource.m_imported ? imageResource.m_image : m_realisation.m_images.at(resource);
+	}
+
+	void Execute(VkCommandBuffer commandBuffer)
+	{
+		const CompiledPlan& plan = GetPlan();
+		Realise();
+
+		RenderGraphPassContext context = {};
+		context.m_commandBuffer = commandBuffer;
+		context.m_extent = m_extent;
+		for (const Step& step : plan.m_steps)
+		{
+			RecordBarriers(commandBuffer, step.m_barriersBefore);
+			if (step.m_renderPass == S_INVALID_ID)
+			{
+				context.m_renderPass = VK_NULL_HANDLE;
+				context.m_subpass = 0;
+				context.m_framebuffer = VK_NULL_HANDLE;
+				m_passes[step.m_passes.front()].m_record(context);
+			}
+			else
+			{
+				const CompiledRenderPass& renderPass = plan.m_renderPasses[step.m_renderPass];
+				m_scratchClearValues.clear();
+				for (const std::pair<PassId, uint32_t>& clearUse : renderPass.m_clearUses)
+				{
+					m_scratchClearValues.push_back(clearUse.first != S_INVALID_ID ? m_passes[clearUse.first].m_uses[clearUse.second].m_clearValue : VkClearValue());
+				}
+
+				VkRenderPassBeginInfo renderPassBeginInfo = {};
+				renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+				renderPassBeginInfo.renderPass = renderPass.m_renderPass;
+				renderPassBeginInfo.framebuffer = GetFramebuffer(renderPass);
+				renderPassBeginInfo.renderArea.offset = { 0, 0 };
+				renderPassBeginInfo.renderArea.extent = m_extent;
+				renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(m_scratchClearValues.size());
+				renderPassBeginInfo.pClearValues = m_scratchClearValues.data();
+
+				context.m_renderPass = renderPass.m_renderPass;
+				context.m_framebuffer = renderPassBeginInfo.framebuffer;
+				for (uint32_t subpass = 0; subpass < step.m_passes.size(); ++subpass)
+				{
+					const Pass& pass = m_passes[step.m_passes[subpass]];
+					if (subpass == 0)
+					{
+						vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, pass.m_contents);
+					}
+					else
+					{
+						vkCmdNextSubpass(commandBuffer, pass.m_contents);
+					}
+					context.m_subpass = subpass;
+					pass.m_record(context);
+				}
+				vkCmdEndRenderPass(commandBuffer);
+			}
+			RecordBarriers(commandBuffer, step.m_barriersAfter);
+		}
+	}
+
+private:
+	enum class UseKind : uint8_t
+	{
+		ColourWrite,
+		DepthWrite,
+		DepthRead,
+		InputAttachment,
+		Sampled,
+		TransferRead
+	};
+
+	struct Resource
+	{
+		std::string m_name;
+		VkFormat m_format;
+		VkImageAspectFlags m_aspect;
+		bool m_imported;
+		VkImageLayout m_initialLayout;
+		VkImageLayout m_finalLayout;
+		VkImage m_image; // imported only, the transients' are in the realisation
+		VkImageView m_view;
+	};
+
+	struct Use
+	{
+		ResourceId m_resource;
+		UseKind m_kind;
+		VkAttachmentLoadOp m_loadOp; // writes only
+		VkClearValue m_clearValue;
+		VkPipelineStageFlags m_sampledStages;
+	};
+
+	struct Pass
+	{
+		std::string m_name;
+		bool m_graphics;
+		bool m_sideEffects;
+		VkSubpassContents m_contents;
+		RecordFunction m_record;
+		std::vector<Use> m_uses;
+	};
+
+	// how a use touches its image
+	struct UseAccess
+	{
+		VkImageLayout m_layout;
+		VkPipelineStageFlags m_stages;
+		VkAccessFlags m_access;
+		VkAccessFlags m_writeAccess; // what a later use has to wait on, 0 for reads
+		bool m_attachment;
+	};
+
+	struct Barrier
+	{
+		ResourceId m_resource;
+		VkImageLayout m_oldLayout;
+		VkImageLayout m_newLayout;
+		VkPipelineStageFlags m_srcStages;
+		VkPipelineStageFlags m_dstStages;
+		VkAccessFlags m_srcAccess;
+		VkAccessFlags m_dstAccess;
+	};
+
+	// a render pass or a single transfer pass
+	struct Step
+	{
+		std::vector<PassId> m_passes; // in subpass order
+		uint32_t m_renderPass; // into CompiledPlan::m_renderPasses, S_INVALID_ID for a transfer pass
+		std::vector<Barrier> m_barriersBefore;
+		std::vector<Barrier> m_barriersAfter;
+	};
+
+	struct CompiledRenderPass
+	{
+		VkRenderPass m_renderPass;
+		std::vector<ResourceId> m_attachments;
+		std::vector<std::pair<PassId, uint32_t>> m_clearUses; // per attachment the pass and use its clear value comes from, S_INVALID_ID when it isn't cleared
+	};
+
+	struct TransientImage
+	{
+		ResourceId m_resource;
+		VkImageUsageFlags m_usage;
+		uint32_t m_firstStep;
+		uint32_t m_lastStep;
+		bool m_lazy; // never leaves its render pass, gets lazily allocated memory of its own rather than being aliased
+	};
+
+	struct CompiledPlan
+	{
+		uint64_t m_hash;
+		std::vector<Step> m_steps;
+		std::vector<CompiledRenderPass> m_renderPasses;
+		std::vector<bool> m_passLive;
+		std::vector<uint32_t> m_passRenderPass; // S_INVALID_ID for culled and transfer passes
+		std::vector<uint32_t> m_passSubpass;
+		std::vector<TransientImage> m_transients;
+		uint32_t m_barrierCount;
+	};
+
+	// the transient images of a plan at an extent
+	struct Realisation
+	{
+		const CompiledPlan* m_plan = nullptr;
+		VkExtent2D m_extent = { 0, 0 };
+		std::vector<VkImage> m_images; // by resource, null for imported ones
+		std::vector<VkImageView> m_views;
+		std::vector<DeviceAllocation> m_allocations;
+		VkDeviceSize m_bytes = 0;
+		VkDeviceSize m_unaliasedBytes = 0;
+	};
+
+	using FramebufferKey = std::pair<VkRenderPass, std::vector<VkImageView>>;
+
+	ResourceId AddResource(const char* name, VkFormat format, bool imported, VkImageLayout initialLayout, VkImageLayout finalLayout)
+	{
+		Resource resource = {};
+		resource.m_name = name;
+		resource.m_format = format;
+		resource.m_aspect = GetAspect(format);
+		resource.m_imported = imported;
+		resource.m_initialLayout = initialLayout;
+		resource.m_finalLayout = finalLayout;
+		m_resources.push_back(resource);
+		return static_cast<ResourceId>(m_resources.size() - 1);
+	}
+
+	PassId AddPass(const char* name, bool graphics, RecordFunction&& record, VkSubpassContents contents)
+	{
+		Pass pass;
+		pass.m_name = name;
+		pass.m_graphics = graphics;
+		pass.m_sideEffects = false;
+		pass.m_contents = contents;
+		pass.m_record = std::move(record);
+		m_passes.push_back(std::move(pass));
+		return static_cast<PassId>(m_passes.size() - 1);
+	}
+
+	void AddUse(PassId passId, ResourceId resource, UseKind kind, VkAttachmentLoadOp loadOp, const VkClearValue& clearValue, VkPipelineStageFlags sampledStages)
+	{
+		Pass& pass = GetPass(passId);
+		if (resource >= m_resources.size())
+		{
+			throw std::runtime_error("Render graph pass " + pass.m_name + " uses an image that hasn't been declared");
+		}
+		if (pass.m_graphics != (kind != UseKind::TransferRead))
+		{
+			throw std::runtime_error("Render graph pass " + pass.m_name + " uses " + m_resources[resource].m_name + " in a way its kind of pass can't");
+		}
+		const bool depth = (m_resources[resource].m_aspect & VK_IMAGE_ASPECT_DEPTH_BIT) != 0;
+		if ((kind == UseKind::ColourWrite && depth) || ((kind == UseKind::DepthWrite || kind == UseKind::DepthRead) && !depth))
+		{
+			throw std::runtime_error("Render graph pass " + pass.m_name + " uses " + m_resources[resource].m_name + " as the wrong kind of attachment");
+		}
+		for (const Use& use : pass.m_uses)
+		{
+			const bool depthUse = use.m_kind == UseKind::DepthWrite || use.m_kind == UseKind::DepthRead;
+			if (use.m_resource == resource || (depthUse && (kind == UseKind::DepthWrite || kind == UseKind::DepthRead)))
+			{
+				throw std::runtime_error("Render graph pass " + pass.m_name + " uses " + m_resources[resource].m_name + " twice, or has two depth attachments");
+			}
+		}
+		Use use = {};
+		use.m_resource = resource;
+		use.m_kind = kind;
+		use.m_loadOp = loadOp;
+		use.m_clearValue = clearValue;
+		use.m_sampledStages = sampledStages;
+		pass.m_uses.push_back(use);
+	}
+
+	Pass& GetPass(PassId pass)
+	{
+		if (pass >= m_passes.size())
+		{
+			throw std::runtime_error("Render graph pass doesn't exist");
+		}
+		return m_passes[pass];
+	}
+
+	const CompiledPlan& GetPlan() const
+	{
+		if (!m_plan)
+		{
+			throw std::runtime_error("The render graph hasn't been compiled");
+		}
+		return *m_plan;
+	}
+
+	static VkImageAspectFlags GetAspect(VkFormat format)
+	{
+		switch (format)
+		{
+		case VK_FORMAT_D16_UNORM:
+		case VK_FORMAT_X8_D24_UNORM_PACK32:
+		case VK_FORMAT_D32_SFLOAT:
+			return VK_IMAGE_ASPECT_DEPTH_BIT;
+		case VK_FORMAT_D16_UNORM_S8_UINT:
+		case VK_FORMAT_D24_UNORM_S8_UINT:
+		case VK_FORMAT_D32_SFLOAT_S8_UINT:
+			return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+		default:
+			return VK_IMAGE_ASPECT_COLOR_BIT;
+		}
+	}
+
+	static bool IsWrite(const Use& use) { return use.m_kind == UseKind::ColourWrite || use.m_kind == UseKind::DepthWrite; }
+	// whether the use needs what was in the image before
+	static bool IsRead(const Use& use) { return !IsWrite(use) || use.m_loadOp == VK_ATTACHMENT_LOAD_OP_LOAD; }
+
+	UseAccess GetUseAccess(const Use& use) const
+	{
+		const bool depth = (m_resources[use.m_resource].m_aspect & VK_IMAGE_ASPECT_DEPTH_BIT) != 0;
+		const VkImageLayout readOnlyLayout = depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		const VkPipelineStageFlags depthStages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		switch (use.m_kind)
+		{
+		case UseKind::ColourWrite:
+		{
+			const VkAccessFlags load = use.m_loadOp == VK_ATTACHMENT_LOAD_OP_LOAD ? VK_ACCESS_COLOR_ATTACHMENT_READ_BIT : 0;
+			return { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, load | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, true };
+		}
+		case UseKind::DepthWrite:
+			return { VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, depthStages, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+				VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, true };
+		case UseKind::DepthRead:
+			return { VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, depthStages, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT, 0, true };
+		case UseKind::InputAttachment:
+			return { readOnlyLayout, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_INPUT_ATTACHMENT_READ_BIT, 0, true };
+		case UseKind::Sampled:
+			return { readOnlyLayout, use.m_sampledStages, VK_ACCESS_SHADER_READ_BIT, 0, false };
+		case UseKind::TransferRead:
+		default:
+			return { VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, 0, false };
+		}
+	}
+
+	static VkImageUsageFlags GetUsage(UseKind kind)
+	{
+		switch (kind)
+		{
+		case UseKind::ColourWrite: return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+		case UseKind::DepthWrite:
+		case UseKind::DepthRead: return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+		case UseKind::InputAttachment: return VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+		case UseKind::Sampled: return VK_IMAGE_USAGE_SAMPLED_BIT;
+		case UseKind::TransferRead:
+		default: return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		}
+	}
+
+	static void HashValue(uint64_t& hash, uint64_t value)
+	{
+		// FNV-1a a byte at a time
+		for (uint32_t i = 0; i < sizeof(value); ++i)
+		{
+			hash ^= (value >> (i * 8)) & 0xff;
+			hash *= 1099511628211ull;
+		}
+	}
+
+	// everything the compiled plan depends on, names, record functions and clear values can change without a rebuild
+	uint64_t HashTopology() const
+	{
+		uint64_t hash = 14695981039346656037ull;
+		HashValue(hash, m_resources.size());
+		for (const Resource& resource : m_resources)
+		{
+			HashValue(hash, static_cast<uint64_t>(resource.m_format));
+			HashValue(hash, resource.m_imported ? 1 : 0);
+			HashValue(hash, static_cast<uint64_t>(resource.m_initialLayout));
+			HashValue(hash, static_cast<uint64_t>(resource.m_finalLayout));
+		}
+		HashValue(hash, m_passes.size());
+		for (const Pass& pass : m_passes)
+		{
+			HashValue(hash, (pass.m_graphics ? 1 : 0) | (pass.m_sideEffects ? 2 : 0));
+			HashValue(hash, pass.m_uses.size());
+			for (const Use& use : pass.m_uses)
+			{
+				HashValue(hash, use.m_resource);
+				HashValue(hash, static_cast<uint64_t>(use.m_kind));
+				HashValue(hash, static_cast<uint64_t>(use.m_loadOp));
+				HashValue(hash, use.m_sampledStages);
+			}
+		}
+		return hash;
+	}
+
+	// works back from the outputs, a pass is live if something live needs what it writes. Fully overwriting an image means
+	// nothing before it needs to have written it
+	std::vector<bool> CullPasses() const
+	{
+		std::vector<bool> live(m_passes.size(), false);
+		std::vector<bool> needed(m_resources.size(), false);
+		for (ResourceId resource = 0; resource < m_resources.size(); ++resource)
+		{
+			needed[resource] = m_resources[resource].m_imported;
+		}
+		for (size_t passIndex = m_passes.size(); passIndex-- > 0;)
+		{
+			const Pass& pass = m_passes[passIndex];
+			bool isLive = pass.m_sideEffects;
+			for (const Use& use : pass.m_uses)
+			{
+				isLive = isLive || (IsWrite(use) && needed[use.m_resource]);
+			}
+			if (!isLive)
+			{
+				continue;
+			}
+			live[passIndex] = true;
+			for (const Use& use : pass.m_uses)
+			{
+				if (IsWrite(use) && !IsRead(use))
+				{
+					needed[use.m_resource] = false;
+				}
+			}
+			for (const Use& use : pass.m_uses)
+			{
+				if (IsRead(use))
+				{
+					needed[use.m_resource] = true;
+				}
+			}
+		}
+		return live;
+	}
+
+	// an image can't be sampled and an attachment in the same render pass, sampling isn't a per pixel dependency
+	bool CanJoinRenderPass(const Step& step, const Pass& pass) const
+	{
+		for (const Use& use : pass.m_uses)
+		{
+			const bool sampled = use.m_kind == UseKind::Sampled;
+			for (PassId stepPass : step.m_passes)
+			{
+				for (const Use& stepUse : m_passes[stepPass].m_uses)
+				{
+					if (stepUse.m_resource == use.m_resource && sampled != (stepUse.m_kind == UseKind::Sampled))
+					{
+						return false;
+					}
+				}
+			}
+		}
+		return true;
+	}
+
+	std::unique_ptr<CompiledPlan> BuildPlan(uint64_t hash) const
+	{
+		struct UseRef
+		{
+			PassId m_pass;
+			uint32_t m_use;
+			uint32_t m_step;
+		};
+
+		std::unique_ptr<CompiledPlan> plan = std::make_unique<CompiledPlan>();
+		plan->m_hash = hash;
+		plan->m_passLive = CullPasses();
+		plan->m_passRenderPass.assign(m_passes.size(), S_INVALID_ID);
+		plan->m_passSubpass.assign(m_passes.size(), 0);
+		plan->m_barrierCount = 0;
+
+		// in declaration order, runs of graphics passes merged into render passes
+		uint32_t nRenderPasses = 0;
+		for (PassId passId = 0; passId < m_passes.size(); ++passId)
+		{
+			const Pass& pass = m_passes[passId];
+			if (!plan->m_passLive[passId])
+			{
+				continue;
+			}
+			if (pass.m_graphics && pass.m_uses.empty())
+			{
+				throw std::runtime_error("Render graph pass " + pass.m_name + " has no attachments");
+			}
+			const bool joins = pass.m_graphics && !plan->m_steps.empty() && plan->m_steps.back().m_renderPass != S_INVALID_ID && CanJoinRenderPass(plan->m_steps.back(), pass);
+			if (!joins)
+			{
+				Step step;
+				step.m_renderPass = pass.m_graphics ? nRenderPasses++ : S_INVALID_ID;
+				plan->m_steps.push_back(std::move(step));
+			}
+			Step& step = plan->m_steps.back();
+			step.m_passes.push_back(passId);
+			if (pass.m_graphics)
+			{
+				plan->m_passRenderPass[passId] = step.m_renderPass;
+				plan->m_passSubpass[passId] = static_cast<uint32_t>(step.m_passes.size() - 1);
+			}
+		}
+
+		std::vector<std::vector<UseRef>> resourceUses(m_resources.size());
+		for (uint32_t stepIndex = 0; stepIndex < plan->m_steps.size(); ++stepIndex)
+		{
+			for (PassId passId : plan->m_steps[stepIndex].m_passes)
+			{
+				for (uint32_t useIndex = 0; useIndex < m_passes[passId].m_uses.size(); ++useIndex)
+				{
+					resourceUses[m_passes[passId].m_uses[useIndex].m_resource].push_back({ passId, useIndex, stepIndex });
+				}
+			}
+		}
+
+		// transient images, aliased ones can share memory with any other so their first use of a frame waits on everything aliased did
+		UseAccess aliasedAccess = { VK_IMAGE_LAYOUT_UNDEFINED, 0, 0, 0, false };
+		std::vector<bool> lazyResources(m_resources.size(), false);
+		for (ResourceId resource = 0; resource < m_resources.size(); ++resource)
+		{
+			const std::vector<UseRef>& uses = resourceUses[resource];
+			if (m_resources[resource].m_imported || uses.empty())
+			{
+				continue;
+			}
+			TransientImage transient = {};
+			transient.m_resource = resource;
+			transient.m_firstStep = uses.front().m_step;
+			transient.m_lastStep = uses.back().m_step;
+			transient.m_lazy = transient.m_firstStep == transient.m_lastStep;
+			for (const UseRef& useRef : uses)
+			{
+				const Use& use = m_passes[useRef.m_pass].m_uses[useRef.m_use];
+				transient.m_usage |= GetUsage(use.m_kind);
+				transient.m_lazy = transient.m_lazy && GetUseAccess(use).m_attachment;
+			}
+			if (transient.m_lazy)
+			{
+				transient.m_usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+				lazyResources[resource] = true;
+			}
+			else
+			{
+				for (const UseRef& useRef : uses)
+				{
+					const UseAccess access = GetUseAccess(m_passes[useRef.m_pass].m_uses[useRef.m_use]);
+					aliasedAccess.m_stages |= access.m_stages;
+					aliasedAccess.m_writeAccess |= access.m_writeAccess;
+				}
+			}
+			plan->m_transients.push_back(transient);
+		}
+
+		// the render passes' attachments, in the order the subpasses first use them
+		struct AttachmentState
+		{
+			uint32_t m_attachment;
+			uint32_t m_firstSubpass;
+			uint32_t m_lastSubpass;
+		};
+		std::vector<std::vector<VkAttachmentDescription>> attachmentDescriptions(nRenderPasses);
+		std::vector<std::vector<std::vector<VkAttachmentReference>>> colourRefs(nRenderPasses);
+		std::vector<std::vector<std::vector<VkAttachmentReference>>> inputRefs(nRenderPasses);
+		std::vector<std::vector<VkAttachmentReference>> depthRefs(nRenderPasses);
+		std::vector<std::map<std::pair<uint32_t, uint32_t>, VkSubpassDependency>> dependencies(nRenderPasses);
+		std::vector<std::map<ResourceId, AttachmentState>> attachmentStates(nRenderPasses);
+		plan->m_renderPasses.resize(nRenderPasses);
+		for (const Step& step : plan->m_steps)
+		{
+			if (step.m_renderPass == S_INVALID_ID)
+			{
+				continue;
+			}
+			const uint32_t nSubpasses = static_cast<uint32_t>(step.m_passes.size());
+			colourRefs[step.m_renderPass].resize(nSubpasses);
+			inputRefs[step.m_renderPass].resize(nSubpasses);
+			depthRefs[step.m_renderPass].assign(nSubpasses, { VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED });
+			for (uint32_t subpass = 0; subpass < nSubpasses; ++subpass)
+			{
+				for (const Use& use : m_passes[step.m_passes[subpass]].m_uses)
+				{
+					const UseAccess access = GetUseAccess(use);
+					if (!access.m_attachment)
+					{
+						continue;
+					}
+					std::map<ResourceId, AttachmentState>& states = attachmentStates[step.m_renderPass];
+					std::map<ResourceId, AttachmentState>::iterator state = states.find(use.m_resource);
+					if (state == states.end())
+					{
+						const uint32_t attachment = static_cast<uint32_t>(attachmentDescriptions[step.m_renderPass].size());
+						state = states.emplace(use.m_resource, AttachmentState{ attachment, subpass, subpass }).first;
+						VkAttachmentDescription description = {};
+						description.format = m_resources[use.m_resource].m_format;
+						description.samples = VK_SAMPLE_COUNT_1_BIT;
+						attachmentDescriptions[step.m_renderPass].push_back(description);
+						plan->m_renderPasses[step.m_renderPass].m_attachments.push_back(use.m_resource);
+						plan->m_renderPasses[step.m_renderPass].m_clearUses.push_back({ S_INVALID_ID, 0 });
+					}
+					state->second.m_lastSubpass = subpass;
+
+					const VkAttachmentReference reference = { state->second.m_attachment, access.m_layout };
+					if (use.m_kind == UseKind::ColourWrite)
+					{
+						colourRefs[step.m_renderPass][subpass].push_back(reference);
+					}
+					else if (use.m_kind == UseKind::InputAttachment)
+					{
+						inputRefs[step.m_renderPass][subpass].push_back(reference);
+					}
+					else
+					{
+						depthRefs[step.m_renderPass][subpass] = reference;
+					}
+				}
+			}
+		}
+
+		const auto addDependency = [&dependencies](uint32_t renderPass, uint32_t srcSubpass, uint32_t dstSubpass, const UseAccess& src, const UseAccess& dst, bool byRegion)
+		{
+			std::map<std::pair<uint32_t, uint32_t>, VkSubpassDependency>::iterator dependency = dependencies[renderPass].find({ srcSubpass, dstSubpass });
+			if (dependency == dependencies[renderPass].end())
+			{
+				VkSubpassDependency newDependency = {};
+				newDependency.srcSubpass = srcSubpass;
+				newDependency.dstSubpass = dstSubpass;
+				newDependency.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+				dependency = dependencies[renderPass].emplace(std::make_pair(srcSubpass, dstSubpass), newDependency).first;
+			}
+			dependency->second.srcStageMask |= src.m_stages;
+			dependency->second.srcAccessMask |= src.m_writeAccess;
+			dependency->second.dstStageMask |= dst.m_stages;
+			dependency->second.dstAccessMask |= dst.m_access;
+			if (!byRegion)
+			{
+				dependency->second.dependencyFlags = 0; // only region local if everything it covers is
+			}
+		};
+
+		// walk each image's uses in order, every hand over between two uses becomes a subpass dependency, an attachment
+		// layout or a barrier, depending on where the two uses are
+		for (ResourceId resource = 0; resource < m_resources.size(); ++resource)
+		{
+			const std::vector<UseRef>& uses = resourceUses[resource];
+			if (uses.empty())
+			{
+				continue;
+			}
+			const Resource& imageResource = m_resources[resource];
+
+			// the first use of a frame follows on from everything the frame before did with it, on the same queue. An aliased
+			// transient follows on from whatever last used its memory, which could be any of them
+			UseAccess previousFrameAccess = aliasedAccess;
+			if (imageResource.m_imported || lazyResources[resource])
+			{
+				previousFrameAccess.m_stages = 0;
+				previousFrameAccess.m_writeAccess = 0;
+				for (const UseRef& useRef : uses)
+				{
+					const UseAccess access = GetUseAccess(m_passes[useRef.m_pass].m_uses[useRef.m_use]);
+					previousFrameAccess.m_stages |= access.m_stages;
+					previousFrameAccess.m_writeAccess |= access.m_writeAccess;
+				}
+			}
+			previousFrameAccess.m_layout = imageResource.m_imported ? imageResource.m_initialLayout : VK_IMAGE_LAYOUT_UNDEFINED;
+			previousFrameAccess.m_attachment = false;
+
+			for (size_t useIndex = 0; useIndex < uses.size(); ++useIndex)
+			{
+				const UseRef& useRef = uses[useIndex];
+				const Use& use = m_passes[useRef.m_pass].m_uses[useRef.m_use];
+				const UseAccess access = GetUseAccess(use);
+				const bool hasPrevious = useIndex > 0;
+				const UseRef* previousRef = hasPrevious ? &uses[useIndex - 1] : nullptr;
+				const UseAccess previous = hasPrevious ? GetUseAccess(m_passes[previousRef->m_pass].m_uses[previousRef->m_use]) : previousFrameAccess;
+				const bool contentsDefined = hasPrevious || (imageResource.m_imported && imageResource.m_initialLayout != VK_IMAGE_LAYOUT_UNDEFINED);
+				Step& step = plan->m_steps[useRef.m_step];
+
+				if (hasPrevious && previousRef->m_step == useRef.m_step)
+				{
+					// both attachments of the same render pass, or both sampled by it which needs nothing more
+					if (access.m_attachment && (previous.m_writeAccess != 0 || access.m_writeAccess != 0 || previous.m_layout != access.m_layout))
+					{
+						addDependency(step.m_renderPass, plan->m_passSubpass[previousRef->m_pass], plan->m_passSubpass[useRef.m_pass], previous, access, true);
+					}
+					continue;
+				}
+
+				if (access.m_attachment)
+				{
+					// first use in this render pass, the render pass does the transition from wherever the last use left it
+					const AttachmentState& state = attachmentStates[step.m_renderPass].at(resource);
+					VkAttachmentDescription& description = attachmentDescriptions[step.m_renderPass][state.m_attachment];
+					description.initialLayout = previous.m_layout;
+					description.loadOp = IsWrite(use) && use.m_loadOp != VK_ATTACHMENT_LOAD_OP_LOAD ? use.m_loadOp
+						: (contentsDefined ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_DONT_CARE);
+					if (description.loadOp == VK_ATTACHMENT_LOAD_OP_CLEAR)
+					{
+						plan->m_renderPasses[step.m_renderPass].m_clearUses[state.m_attachment] = { useRef.m_pass, useRef.m_use };
+					}
+					addDependency(step.m_renderPass, VK_SUBPASS_EXTERNAL, plan->m_passSubpass[useRef.m_pass], previous, access, false);
+				}
+				else if (hasPrevious && previous.m_attachment)
+				{
+					// the render pass the last use was in moves it to this use's layout on the way out
+					const Step& previousStep = plan->m_steps[previousRef->m_step];
+					const AttachmentState& state = attachmentStates[previousStep.m_renderPass].at(resource);
+					attachmentDescriptions[previousStep.m_renderPass][state.m_attachment].finalLayout = access.m_layout;
+					addDependency(previousStep.m_renderPass, plan->m_passSubpass[previousRef->m_pass], VK_SUBPASS_EXTERNAL, previous, access, false);
+				}
+				else if (previous.m_layout != access.m_layout || previous.m_writeAccess != 0 || access.m_writeAccess != 0)
+				{
+					step.m_barriersBefore.push_back({ resource, previous.m_layout, access.m_layout, previous.m_stages, access.m_stages, previous.m_writeAccess, access.m_access });
+				}
+			}
+
+			// where the image's left at the end of the frame, and whether the last render pass to use it has to store it
+			const UseRef& lastRef = uses.back();
+			const UseAccess lastAccess = GetUseAccess(m_passes[lastRef.m_pass].m_uses[lastRef.m_use]);
+			const VkImageLayout finalLayout = imageResource.m_imported && imageResource.m_finalLayout != VK_IMAGE_LAYOUT_UNDEFINED ? imageResource.m_finalLayout : lastAccess.m_layout;
+			for (size_t useIndex = 0; useIndex < uses.size(); ++useIndex)
+			{
+				const Step& step = plan->m_steps[uses[useIndex].m_step];
+				const bool lastInStep = useIndex + 1 == uses.size() || uses[useIndex + 1].m_step != uses[useIndex].m_step;
+				if (step.m_renderPass == S_INVALID_ID || !lastInStep)
+				{
+					continue;
+				}
+				const UseAccess access = GetUseAccess(m_passes[uses[useIndex].m_pass].m_uses[uses[useIndex].m_use]);
+				if (!access.m_attachment)
+				{
+					continue;
+				}
+				const AttachmentState& state = attachmentStates[step.m_renderPass].at(resource);
+				VkAttachmentDescription& description = attachmentDescriptions[step.m_renderPass][state.m_attachment];
+				const bool usedLater = useIndex + 1 < uses.size();
+				description.storeOp = usedLater || imageResource.m_imported ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+				if (!usedLater)
+				{
+					description.finalLayout = finalLayout;
+				}
+				else if (GetUseAccess(m_passes[uses[useIndex + 1].m_pass].m_uses[uses[useIndex + 1].m_use]).m_attachment)
+				{
+					description.finalLayout = access.m_layout; // the next render pass takes it from here
+				}
+			}
+			if (!lastAccess.m_attachment && finalLayout != lastAccess.m_layout)
+			{
+				plan->m_steps[lastRef.m_step].m_barriersAfter.push_back({ resource, lastAccess.m_layout, finalLayout, lastAccess.m_stages, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, lastAccess.m_writeAccess, 0 });
+			}
+		}
+
+		for (const Step& step : plan->m_steps)
+		{
+			plan->m_barrierCount += static_cast<uint32_t>(step.m_barriersBefore.size() + step.m_barriersAfter.size());
+			if (step.m_renderPass == S_INVALID_ID)
+			{
+				continue;
+			}
+
+			// attachments a subpass in the middle doesn't use still have to survive it
+			const uint32_t nSubpasses = static_cast<uint32_t>(step.m_passes.size());
+			std::vector<std::vector<uint32_t>> preserveRefs(nSubpasses);
+			for (const std::pair<const ResourceId, AttachmentState>& state : attachmentStates[step.m_renderPass])
+			{
+				for (uint32_t subpass = state.second.m_firstSubpass + 1; subpass < state.second.m_lastSubpass; ++subpass)
+				{
+					const bool referenced = std::any_of(m_passes[step.m_passes[subpass]].m_uses.begin(), m_passes[step.m_passes[subpass]].m_uses.end(),
+						[&state](const Use& use) { return use.m_resource == state.first; });
+					if (!referenced)
+					{
+						preserveRefs[subpass].push_back(state.second.m_attachment);
+					}
+				}
+			}
+
+			std::vector<VkSubpassDescription> subpasses(nSubpasses);
+			for (uint32_t subpass = 0; subpass < nSubpasses; ++subpass)
+			{
+				VkSubpassDescription& description = subpasses[subpass];
+				description.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+				description.colorAttachmentCount = static_cast<uint32_t>(colourRefs[step.m_renderPass][subpass].size());
+				description.pColorAttachments = colourRefs[step.m_renderPass][subpass].data();
+				description.inputAttachmentCount = static_cast<uint32_t>(inputRefs[step.m_renderPass][subpass].size());
+				description.pInputAttachments = inputRefs[step.m_renderPass][subpass].data();
+				description.pDepthStencilAttachment = depthRefs[step.m_renderPass][subpass].attachment != VK_ATTACHMENT_UNUSED ? &depthRefs[step.m_renderPass][subpass] : nullptr;
+				description.preserveAttachmentCount = static_cast<uint32_t>(preserveRefs[subpass].size());
+				description.pPreserveAttachments = preserveRefs[subpass].data();
+			}
+
+			std::vector<VkAttachmentDescription>& attachments = attachmentDescriptions[step.m_renderPass];
+			for (VkAttachmentDescription& attachment : attachments)
+			{
+				const bool stencil = (GetAspect(attachment.format) & VK_IMAGE_ASPECT_STENCIL_BIT) != 0;
+				attachment.stencilLoadOp = stencil ? attachment.loadOp : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+				attachment.stencilStoreOp = stencil ? attachment.storeOp : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			}
+			std::vector<VkSubpassDependency> subpassDependencies;
+			for (const std::pair<const std::pair<uint32_t, uint32_t>, VkSubpassDependency>& dependency : dependencies[step.m_renderPass])
+			{
+				subpassDependencies.push_back(dependency.second);
+			}
+
+			VkRenderPassCreateInfo renderPassCreateInfo = {};
+			renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+			renderPassCreateInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+			renderPassCreateInfo.pAttachments = attachments.data();
+			renderPassCreateInfo.subpassCount = nSubpasses;
+			renderPassCreateInfo.pSubpasses = subpasses.data();
+			renderPassCreateInfo.dependencyCount = static_cast<uint32_t>(subpassDependencies.size());
+			renderPassCreateInfo.pDependencies = subpassDependencies.data();
+			if (vkCreateRenderPass(m_device, &renderPassCreateInfo, nullptr, &plan->m_renderPasses[step.m_renderPass].m_renderPass) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to create a render graph render pass");
+			}
+		}
+		return plan;
+	}
+
+	// creates the current plan's transient images for the current extent if they aren't already
+	void Realise()
+	{
+		if (m_realisation.m_plan == m_plan && m_realisation.m_extent.width == m_extent.width && m_realisation.m_extent.height == m_extent.height)
+		{
+			return;
+		}
+		ReleaseFramebuffers();
+		if (m_realisation.m_plan)
+		{
+			std::shared_ptr<Realisation> oldRealisation = std::make_shared<Realisation>(std::move(m_realisation));
+			m_deferredDestructionQueue->Enqueue([this, oldRealisation]() { DestroyRealisation(*oldRealisation); });
+		}
+
+		m_realisation = Realisation();
+		m_realisation.m_plan = m_plan;
+		m_realisation.m_extent = m_extent;
+		m_realisation.m_images.assign(m_resources.size(), VK_NULL_HANDLE);
+		m_realisation.m_views.assign(m_resources.size(), VK_NULL_HANDLE);
+
+		std::vector<VkMemoryRequirements> requirements(m_plan->m_transients.size());
+		for (size_t i = 0; i < m_plan->m_transients.size(); ++i)
+		{
+			const TransientImage& transient = m_plan->m_transients[i];
+			VkImageCreateInfo imageCreateInfo = {};
+			imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+			imageCreateInfo.format = m_resources[transient.m_resource].m_format;
+			imageCreateInfo.extent = { m_extent.width, m_extent.height, 1 };
+			imageCreateInfo.mipLevels = 1;
+			imageCreateInfo.arrayLayers = 1;
+			imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+			imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+			imageCreateInfo.usage = transient.m_usage;
+			imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			if (vkCreateImage(m_device, &imageCreateInfo, nullptr, &m_realisation.m_images[transient.m_resource]) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to create render graph image " + m_resources[transient.m_resource].m_name);
+			}
+			vkGetImageMemoryRequirements(m_device, m_realisation.m_images[transient.m_resource], &requirements[i]);
+			m_realisation.m_unaliasedBytes += requirements[i].size;
+		}
+
+		// biggest first, each into the first slot with nothing live at the same time. The lazy ones are mostly never backed at all
+		// so they're left to themselves
+		std::vector<size_t> order(m_plan->m_transients.size());
+		for (size_t i = 0; i < order.size(); ++i)
+		{
+			order[i] = i;
+		}
+		std::stable_sort(order.begin(), order.end(), [&requirements](size_t a, size_t b) { return requirements[a].size > requirements[b].size; });
+		struct AliasSlot
+		{
+			VkMemoryRequirements m_requirements;
+			bool m_lazy;
+			std::vector<size_t> m_transients;
+		};
+		std::vector<AliasSlot> slots;
+		for (size_t transientIndex : order)
+		{
+			const TransientImage& transient = m_plan->m_transients[transientIndex];
+			AliasSlot* chosenSlot = nullptr;
+			for (AliasSlot& slot : slots)
+			{
+				const bool overlaps = std::any_of(slot.m_transients.begin(), slot.m_transients.end(), [this, &transient](size_t other)
+				{
+					const TransientImage& otherTransient = m_plan->m_transients[other];
+					return transient.m_firstStep <= otherTransient.m_lastStep && otherTransient.m_firstStep <= transient.m_lastStep;
+				});
+				if (!transient.m_lazy && !slot.m_lazy && !overlaps && (slot.m_requirements.memoryTypeBits & requirements[transientIndex].memoryTypeBits) != 0)
+				{
+					chosenSlot = &slot;
+					break;
+				}
+			}
+			if (!chosenSlot)
+			{
+				slots.push_back({ requirements[transientIndex], transient.m_lazy, {} });
+				chosenSlot = &slots.back();
+			}
+			chosenSlot->m_requirements.size = (std::max)(chosenSlot->m_requirements.size, requirements[transientIndex].size);
+			chosenSlot->m_requirements.alignment = (std::max)(chosenSlot->m_requirements.alignment, requirements[transientIndex].alignment);
+			chosenSlot->m_requirements.memoryTypeBits &= requirements[transientIndex].memoryTypeBits;
+			chosenSlot->m_transients.push_back(transientIndex);
+		}
+
+		for (const AliasSlot& slot : slots)
+		{
+			const DeviceAllocation allocation = m_allocator->Allocate(slot.m_requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, DeviceResourceTiling::Optimal,
+				slot.m_lazy ? VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT : 0);
+			m_realisation.m_allocations.push_back(allocation);
+			m_realisation.m_bytes += slot.m_requirements.size;
+			for (size_t transientIndex : slot.m_transients)
+			{
+				const ResourceId resource = m_plan->m_transients[transientIndex].m_resource;
+				if (vkBindImageMemory(m_device, m_realisation.m_images[resource], allocation.m_memory, allocation.m_offset) != VK_SUCCESS)
+				{
+					throw std::runtime_error("Failed to bind render graph image memory");
+				}
+
+				VkImageViewCreateInfo viewCreateInfo = {};
+				viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+				viewCreateInfo.image = m_realisation.m_images[resource];
+				viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+				viewCreateInfo.format = m_resources[resource].m_format;
+				viewCreateInfo.subresourceRange.aspectMask = m_resources[resource].m_aspect;
+				viewCreateInfo.subresourceRange.levelCount = 1;
+				viewCreateInfo.subresourceRange.layerCount = 1;
+				if (vkCreateImageView(m_device, &viewCreateInfo, nullptr, &m_realisation.m_views[resource]) != VK_SUCCESS)
+				{
+					throw std::runtime_error("Failed to create render graph image view " + m_resources[resource].m_name);
+				}
+			}
+		}
+	}
+
+	void DestroyRealisation(Realisation& realisation)
+	{
+		for (size_t i = 0; i < realisation.m_images.size(); ++i)
+		{
+			if (realisation.m_views[i])
+			{
+				vkDestroyImageView(m_device, realisation.m_views[i], nullptr);
+			}
+			if (realisation.m_images[i])
+			{
+				vkDestroyImage(m_device, realisation.m_images[i], nullptr);
+			}
+		}
+		for (DeviceAllocation& allocation : realisation.m_allocations)
+		{
+			m_allocator->Free(allocation);
+		}
+		realisation.m_images.clear();
+		realisation.m_views.clear();
+		realisation.m_allocations.clear();
+	}
+
+	void ReleaseFramebuffers()
+	{
+		if (m_framebuffers.empty())
+		{
+			return;
+		}
+		std::vector<VkFramebuffer> framebuffers;
+		for (const std::pair<const FramebufferKey, VkFramebuffer>& framebuffer : m_framebuffers)
+		{
+			framebuffers.push_back(framebuffer.second);
+		}
+		m_framebuffers.clear();
+		VkDevice device = m_device;
+		m_deferredDestructionQueue->Enqueue([device, framebuffers]()
+		{
+			for (VkFramebuffer framebuffer : framebuffers)
+			{
+				vkDestroyFramebuffer(device, framebuffer, nullptr);
+			}
+		});
+	}
+
+	// made the first time a render pass is used with a set of views, only the imported images change between frames
+	VkFramebuffer GetFramebuffer(const CompiledRenderPass& renderPass)
+	{
+		FramebufferKey key;
+		key.first = renderPass.m_renderPass;
+		key.second.reserve(renderPass.m_attachments.size());
+		for (ResourceId resource : renderPass.m_attachments)
+		{
+			const Resource& attachment = m_resources[resource];
+			const VkImageView view = attachment.m_imported ? attachment.m_view : m_realisation.m_views[resource];
+			if (!view)
+			{
+				throw std::runtime_error("Render graph image " + attachment.m_name + " hasn't been given an image");
+			}
+			key.second.push_back(view);
+		}
+		std::map<FramebufferKey, VkFramebuffer>::iterator framebuffer = m_framebuffers.find(key);
+		if (framebuffer != m_framebuffers.end())
+		{
+			return framebuffer->second;
+		}
+
+		VkFramebufferCreateInfo framebufferCreateInfo = {};
+		framebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferCreateInfo.renderPass = renderPass.m_renderPass;
+		framebufferCreateInfo.attachmentCount = static_cast<uint32_t>(key.second.size());
+		framebufferCreateInfo.pAttachments = key.second.data();
+		framebufferCreateInfo.width = m_extent.width;
+		framebufferCreateInfo.height = m_extent.height;
+		framebufferCreateInfo.layers = 1;
+		VkFramebuffer newFramebuffer = VK_NULL_HANDLE;
+		if (vkCreateFramebuffer(m_device, &framebufferCreateInfo, nullptr, &newFramebuffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create a render graph frame buffer");
+		}
+		m_framebuffers.emplace(std::move(key), newFramebuffer);
+		return newFramebuffer;
+	}
+
+	// all of a step's barriers go in the one call
+	void RecordBarriers(VkCommandBuffer commandBuffer, const std::vector<Barrier>& barriers)
+	{
+		if (barriers.empty())
+		{
+			return;
+		}
+		m_scratchBarriers.clear();
+		VkPipelineStageFlags srcStages = 0;
+		VkPipelineStageFlags dstStages = 0;
+		for (const Barrier& barrier : barriers)
+		{
+			VkImageMemoryBarrier imageBarrier = {};
+			imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			imageBarrier.srcAccessMask = barrier.m_srcAccess;
+			imageBarrier.dstAccessMask = barrier.m_dstAccess;
+			imageBarrier.oldLayout = barrier.m_oldLayout;
+			imageBarrier.newLayout = barrier.m_newLayout;
+			imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			imageBarrier.image = GetImage(barrier.m_resource);
+			imageBarrier.subresourceRange.aspectMask = m_resources[barrier.m_resource].m_aspect;
+			imageBarrier.subresourceRange.levelCount = 1;
+			imageBarrier.subresourceRange.layerCount = 1;
+			m_scratchBarriers.push_back(imageBarrier);
+			srcStages |= barrier.m_srcStages;
+			dstStages |= barrier.m_dstStages;
+		}
+		vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 0, nullptr, 0, nullptr,
+			static_cast<uint32_t>(m_scratchBarriers.size()), m_scratchBarriers.data());
+	}
+
+	VkDevice m_device;
+	DeviceMemoryAllocator* m_allocator;
+	DeferredDestructionQueue* m_deferredDestructionQueue;
+
+	// the graph as declared
+	std::vector<Resource> m_resources;
+	std::vector<Pass> m_passes;
+
+	std::unordered_map<uint64_t, std::unique_ptr<CompiledPlan>> m_plans; // by topology hash
+	const CompiledPlan* m_plan;
+	VkExtent2D m_extent;
+	Realisation m_realisation;
+	std::map<FramebufferKey, VkFramebuffer> m_framebuffers;
+
+	// reused every Execute() so recording doesn't allocate
+	std::vector<VkClearValue> m_scratchClearValues;
+	std::vector<VkImageMemoryBarrier> m_scratchBarriers;
+};
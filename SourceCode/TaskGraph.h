@@ -0,0 +1,255 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <functional>
+#include <initializer_list>
+#include <exception>
+#include <stdexcept>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <cstdint>
+
+#include "JobSystem.h"
+#include "Profiler.h"
+
+// One shot graph of tasks run on the JobSystem, each task starts as soon as everything it depends on has finished.
+// Used for startup so the independent bits of InitVulkan() overlap rather than running one after another.
+// Tasks can only depend on tasks added before them, so there can't be a cycle. If a task throws nothing that depends on it
+// runs, anything already running finishes, anything not started yet is skipped and Run() rethrows the first exception.
+// Every task is timed, PrintReport() shows where the time went and what the critical path was.
+class TaskGraph
+{
+public:
+	using TaskId = uint32_t;
+
+	TaskGraph()
+		: m_runStartNs(0)
+		, m_runEndNs(0)
+		, m_failed(false)
+	{}
+
+	TaskGraph(const TaskGraph&) = delete;
+	TaskGraph& operator=(const TaskGraph&) = delete;
+
+	TaskId AddTask(const char* name, std::function<void()>&& function, std::initializer_list<TaskId> dependencies = {})
+	{
+		return AddTask(name, std::move(function), std::vector<TaskId>(dependencies));
+	}
+
+	TaskId AddTask(const char* name, std::function<void()>&& function, const std::vector<TaskId>& dependencies)
+	{
+		const TaskId taskId = static_cast<TaskId>(m_tasks.size());
+		std::unique_ptr<Task> task = std::make_unique<Task>();
+		task->m_name = name;
+		task->m_function = std::move(function);
+		for (TaskId dependency : dependencies)
+		{
+			if (dependency >= taskId)
+			{
+				throw std::runtime_error(std::string("Task ") + name + " depends on a task that hasn't been added yet");
+			}
+			task->m_dependencies.push_back(dependency);
+			m_tasks[dependency]->m_dependents.push_back(taskId);
+		}
+		m_tasks.push_back(std::move(task));
+		return taskId;
+	}
+
+	// from the thread that owns the job system, which runs tasks too while it waits
+	void Run(JobSystem& jobSystem)
+	{
+		m_failed = false;
+		m_exception = nullptr;
+		for (std::unique_ptr<Task>& task : m_tasks)
+		{
+			task->m_nPendingDependencies.store(static_cast<uint32_t>(task->m_dependencies.size()), std::memory_order_relaxed);
+			task->m_ran = false;
+		}
+
+		m_runStartNs = Profiler::NowNs();
+		JobCounter counter;
+		for (TaskId taskId = 0; taskId < m_tasks.size(); ++taskId)
+		{
+			if (m_tasks[taskId]->m_dependencies.empty())
+			{
+				Schedule(jobSystem, counter, taskId);
+			}
+		}
+		jobSystem.Wait(counter); // tasks catch their own exceptions, this won't throw
+		m_runEndNs = Profiler::NowNs();
+
+		if (m_exception)
+		{
+			std::rethrow_exception(m_exception);
+		}
+	}
+
+	// wall time of the last Run()
+	double GetElapsedMs() const { return NsToMs(m_runEndNs - m_runStartNs); }
+
+	// the longest chain of dependent tasks, nothing can make Run() quicker than this without making those tasks quicker
+	double GetCriticalPathMs(std::vector<TaskId>* pathOut = nullptr) const
+	{
+		// ids are already in dependency order
+		std::vector<uint64_t> finishNs(m_tasks.size(), 0);
+		std::vector<TaskId> slowestDependency(m_tasks.size(), S_NO_TASK);
+		TaskId lastOnPath = S_NO_TASK;
+		for (TaskId taskId = 0; taskId < m_tasks.size(); ++taskId)
+		{
+			const Task& task = *m_tasks[taskId];
+			uint64_t startNs = 0;
+			for (TaskId dependency : task.m_dependencies)
+			{
+				if (finishNs[dependency] >= startNs)
+				{
+					startNs = finishNs[dependency];
+					slowestDependency[taskId] = dependency;
+				}
+			}
+			finishNs[taskId] = startNs + (task.m_ran ? task.m_endNs - task.m_startNs : 0);
+			if (lastOnPath == S_NO_TASK || finishNs[taskId] > finishNs[lastOnPath])
+			{
+				lastOnPath = taskId;
+			}
+		}
+
+		if (pathOut)
+		{
+			pathOut->clear();
+			for (TaskId taskId = lastOnPath; taskId != S_NO_TASK; taskId = slowestDependency[taskId])
+			{
+				pathOut->push_back(taskId);
+			}
+			std::reverse(pathOut->begin(), pathOut->end());
+		}
+		return lastOnPath == S_NO_TASK ? 0.0 : NsToMs(finishNs[lastOnPath]);
+	}
+
+	void PrintReport(std::ostream& out, const char* graphName) const
+	{
+		std::vector<TaskId> order;
+		for (TaskId taskId = 0; taskId < m_tasks.size(); ++taskId)
+		{
+			if (m_tasks[taskId]->m_ran)
+			{
+				order.push_back(taskId);
+			}
+		}
+		std::sort(order.begin(), order.end(), [this](TaskId a, TaskId b) { return m_tasks[a]->m_startNs < m_tasks[b]->m_startNs; });
+
+		double totalTaskMs = 0.0;
+		out << graphName << " task timings (start, duration):" << std::endl;
+		const std::ios::fmtflags oldFlags = out.flags();
+		const std::streamsize oldPrecision = out.precision();
+		out << std::fixed << std::setprecision(2);
+		for (TaskId taskId : order)
+		{
+			const Task& task = *m_tasks[taskId];
+			const double durationMs = NsToMs(task.m_endNs - task.m_startNs);
+			totalTaskMs += durationMs;
+			out << "  " << std::left << std::setw(24) << task.m_name << std::right << std::setw(9) << NsToMs(task.m_startNs - m_runStartNs) << "ms "
+				<< std::setw(9) << durationMs << "ms" << std::endl;
+		}
+
+		std::vector<TaskId> criticalPath;
+		const double criticalPathMs = GetCriticalPathMs(&criticalPath);
+		out << graphName << " took " << GetElapsedMs() << "ms, " << totalTaskMs << "ms of tasks, critical path " << criticalPathMs << "ms:";
+		for (size_t i = 0; i < criticalPath.size(); ++i)
+		{
+			out << (i == 0 ? " " : " > ") << m_tasks[criticalPath[i]]->m_name;
+		}
+		out << std::endl;
+		out.flags(oldFlags);
+		out.precision(oldPrecision);
+	}
+
+	// adds every task that ran as a CPU zone on the thread it ran on, for once the profiler's been initialised
+	void RecordProfileZones(Profiler& profiler) const
+	{
+		if (!profiler.IsEnabled())
+		{
+			return;
+		}
+		for (const std::unique_ptr<Task>& task : m_tasks)
+		{
+			if (task->m_ran)
+			{
+				profiler.RecordCpuZone(task->m_name, task->m_startNs, task->m_endNs, task->m_threadIndex);
+			}
+		}
+	}
+
+private:
+	static constexpr TaskId S_NO_TASK = UINT32_MAX;
+
+	struct Task
+	{
+		const char* m_name = nullptr;
+		std::function<void()> m_function;
+		std::vector<TaskId> m_dependencies;
+		std::vector<TaskId> m_dependents;
+		std::atomic<uint32_t> m_nPendingDependencies{ 0 };
+		bool m_ran = false;
+		uint64_t m_startNs = 0;
+		uint64_t m_endNs = 0;
+		uint32_t m_threadIndex = 0;
+	};
+
+	static double NsToMs(uint64_t ns) { return static_cast<double>(ns) / 1000000.0; }
+
+	void Schedule(JobSystem& jobSystem, JobCounter& counter, TaskId taskId)
+	{
+		jobSystem.Run([this, &jobSystem, &counter, taskId]() { Execute(jobSystem, counter, taskId); }, &counter);
+	}
+
+	void Execute(JobSystem& jobSystem, JobCounter& counter, TaskId taskId)
+	{
+		Task& task = *m_tasks[taskId];
+		if (m_failed.load(std::memory_order_acquire))
+		{
+			return; // something else failed, no point starting anything new
+		}
+
+		task.m_threadIndex = Profiler::GetThreadIndex();
+		task.m_startNs = Profiler::NowNs();
+		try
+		{
+			task.m_function();
+		}
+		catch (...)
+		{
+			task.m_endNs = Profiler::NowNs();
+			task.m_ran = true;
+			std::lock_guard<std::mutex> lock(m_exceptionMutex);
+			if (!m_exception)
+			{
+				m_exception = std::current_exception();
+			}
+			m_failed.store(true, std::memory_order_release);
+			return;
+		}
+		task.m_endNs = Profiler::NowNs();
+		task.m_ran = true;
+
+		// the last dependency to finish schedules the dependent, the acq_rel makes every dependency's writes visible to it
+		for (TaskId dependent : task.m_dependents)
+		{
+			if (m_tasks[dependent]->m_nPendingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			{
+				Schedule(jobSystem, counter, dependent);
+			}
+		}
+	}
+
+	std::vector<std::unique_ptr<Task>> m_tasks;
+	uint64_t m_runStartNs;
+	uint64_t m_runEndNs;
+	std::atomic<bool> m_failed;
+	std::mutex m_exceptionMutex;
+	std::exception_ptr m_exception;
+};
@@ -0,0 +1,537 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <optional>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "DeviceMemoryAllocator.h"
+#include "GpuQueue.h"
+
+// Streams data into DEVICE_LOCAL buffers and images through a persistently mapped staging ring buffer.
+// Uploads are queued up and go out as a single submit per Flush(), on the dedicated transfer queue when the device has one,
+// with queue family ownership handed over to the graphics queue (unless the buffer is shared CONCURRENT between families).
+// Ring space is reclaimed once the graphics queue's timeline passes each batch's acquire (or copy) submit, and the transfer
+// submit hands over to the graphics one through the transfer queue's timeline, no fences or binary semaphores per batch.
+// Work on other queues that reads uploaded data waits for GetLastGraphicsSubmitValue() on the graphics queue's timeline.
+// Not thread safe, everything here is expected to be called from the thread that submits to the graphics queue.
+class UploadManager
+{
+public:
+	static constexpr VkDeviceSize S_DEFAULT_RING_SIZE = 32ull * 1024 * 1024;
+
+	UploadManager()
+		: m_device(nullptr)
+		, m_allocator(nullptr)
+		, m_graphicsQueue(nullptr)
+		, m_transferQueue(nullptr)
+		, m_transferCommandPool(nullptr)
+		, m_acquireCommandPool(nullptr)
+		, m_ringBuffer(nullptr)
+		, m_ringSize(0)
+		, m_copyOffsetAlignment(16)
+		, m_writePosition(0)
+		, m_retiredPosition(0)
+		, m_bytesUploaded(0)
+		, m_nSubmits(0)
+		, m_lastGraphicsSubmitValue(0)
+	{}
+
+	UploadManager(const UploadManager&) = delete;
+	UploadManager& operator=(const UploadManager&) = delete;
+
+	// transferQueue can be the graphics queue, in which case no ownership transfers are needed
+	void Init(VkPhysicalDevice physicalDevice, VkDevice device, DeviceMemoryAllocator& allocator, GpuQueue& graphicsQueue, GpuQueue& transferQueue, VkDeviceSize ringSize = S_DEFAULT_RING_SIZE)
+	{
+		m_device = device;
+		m_allocator = &allocator;
+		m_graphicsQueue = &graphicsQueue;
+		m_transferQueue = &transferQueue;
+		m_ringSize = ringSize;
+
+		VkPhysicalDeviceProperties deviceProperties = {};
+		vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+		m_copyOffsetAlignment = std::max<VkDeviceSize>(deviceProperties.limits.optimalBufferCopyOffsetAlignment, 16); // 16 covers the texel size of every format we upload
+
+		VkBufferCreateInfo ringCreateInfo = {};
+		ringCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		ringCreateInfo.size = m_ringSize;
+		ringCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		ringCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		if (vkCreateBuffer(m_device, &ringCreateInfo, nullptr, &m_ringBuffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create staging ring buffer");
+		}
+		// write combined rather than cached, the CPU only ever writes into it
+		m_ringAllocation = m_allocator->AllocateForBuffer(m_ringBuffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+		m_transferCommandPool = CreateCommandPool(m_transferQueue->GetFamilyIndex());
+		if (UsesDedicatedTransferQueue())
+		{
+			m_acquireCommandPool = CreateCommandPool(m_graphicsQueue->GetFamilyIndex());
+		}
+	}
+
+	void Shutdown()
+	{
+		WaitIdle();
+		for (UploadBatch& batch : m_freeBatches)
+		{
+			DestroyBatch(batch);
+		}
+		m_freeBatches.clear();
+		if (m_acquireCommandPool)
+		{
+			vkDestroyCommandPool(m_device, m_acquireCommandPool, nullptr);
+			m_acquireCommandPool = nullptr;
+		}
+		if (m_transferCommandPool)
+		{
+			vkDestroyCommandPool(m_device, m_transferCommandPool, nullptr);
+			m_transferCommandPool = nullptr;
+		}
+		if (m_ringBuffer)
+		{
+			vkDestroyBuffer(m_device, m_ringBuffer, nullptr);
+			m_allocator->Free(m_ringAllocation);
+			m_ringBuffer = nullptr;
+		}
+	}
+
+	bool UsesDedicatedTransferQueue() const
+	{
+		return m_transferQueue->GetFamilyIndex() != m_graphicsQueue->GetFamilyIndex();
+	}
+
+	// copies data into the ring straight away, the GPU copy happens on the next Flush()
+	// dstStages / dstAccess describe the first use of the buffer on the graphics queue. A CONCURRENT buffer needs no ownership transfer
+	void UploadToBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size, VkPipelineStageFlags dstStages, VkAccessFlags dstAccess, bool dstIsConcurrent = false)
+	{
+		// anything bigger than a quarter of the ring gets split so it can't wedge the ring
+		const VkDeviceSize maxChunkSize = m_ringSize / 4;
+		const uint8_t* srcBytes = static_cast<const uint8_t*>(data);
+		VkDeviceSize uploaded = 0;
+		while (uploaded < size)
+		{
+			const VkDeviceSize chunkSize = std::min(size - uploaded, maxChunkSize);
+			const VkDeviceSize ringOffset = WriteToRing(srcBytes + uploaded, chunkSize);
+
+			PendingBufferCopy copy = {};
+			copy.m_dstBuffer = dstBuffer;
+			copy.m_region.srcOffset = ringOffset;
+			copy.m_region.dstOffset = dstOffset + uploaded;
+			copy.m_region.size = chunkSize;
+			copy.m_dstStages = dstStages;
+			copy.m_dstAccess = dstAccess;
+			copy.m_dstIsConcurrent = dstIsConcurrent;
+			m_pendingBufferCopies.push_back(copy);
+			uploaded += chunkSize;
+		}
+		m_bytesUploaded += size;
+	}
+
+	// uploads a single mip / layer, the image goes from UNDEFINED to finalLayout so any previous contents are discarded
+	void UploadToImage(VkImage dstImage, const VkImageSubresourceLayers& subresource, VkExtent3D extent, const void* data, VkDeviceSize size, VkImageLayout finalLayout, VkPipelineStageFlags dstStages, VkAccessFlags dstAccess)
+	{
+		if (size > m_ringSize / 2)
+		{
+			throw std::runtime_error("Image upload is larger than the staging ring allows.");
+		}
+		const VkDeviceSize ringOffset = WriteToRing(data, size);
+
+		PendingImageCopy copy = {};
+		copy.m_dstImage = dstImage;
+		copy.m_region.bufferOffset = ringOffset;
+		copy.m_region.bufferRowLength = 0; // tightly packed
+		copy.m_region.bufferImageHeight = 0;
+		copy.m_region.imageSubresource = subresource;
+		copy.m_region.imageOffset = { 0, 0, 0 };
+		copy.m_region.imageExtent = extent;
+		copy.m_finalLayout = finalLayout;
+		copy.m_dstStages = dstStages;
+		copy.m_dstAccess = dstAccess;
+		m_pendingImageCopies.push_back(copy);
+		m_bytesUploaded += size;
+	}
+
+	bool HasPendingUploads() const
+	{
+		return !m_pendingBufferCopies.empty() || !m_pendingImageCopies.empty();
+	}
+
+	// submits everything queued since the last flush as one batch, call before submitting the frame that uses the data
+	void Flush()
+	{
+		RetireCompletedBatches();
+		if (!HasPendingUploads())
+		{
+			return;
+		}
+
+		UploadBatch batch = GetFreeBatch();
+		const bool dedicatedTransfer = UsesDedicatedTransferQueue();
+
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		std::vector<VkBufferMemoryBarrier> bufferBarriers;
+		std::vector<VkImageMemoryBarrier> imageBarriers;
+		VkPipelineStageFlags graphicsDstStages = 0;
+		BuildPostCopyBarriers(bufferBarriers, imageBarriers, graphicsDstStages);
+
+		if (vkBeginCommandBuffer(batch.m_transferCommandBuffer, &beginInfo) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed the start recording an upload command buffer!");
+		}
+		RecordCopies(batch.m_transferCommandBuffer);
+		if (!dedicatedTransfer)
+		{
+			vkCmdPipelineBarrier(batch.m_transferCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, graphicsDstStages, 0,
+				0, nullptr, static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(), static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+		}
+		else
+		{
+			// release half of the ownership transfer, dst access and stage are ignored on this side
+			std::vector<VkBufferMemoryBarrier> releaseBufferBarriers = bufferBarriers;
+			std::vector<VkImageMemoryBarrier> releaseImageBarriers = imageBarriers;
+			for (VkBufferMemoryBarrier& barrier : releaseBufferBarriers)
+			{
+				barrier.dstAccessMask = 0;
+			}
+			for (VkImageMemoryBarrier& barrier : releaseImageBarriers)
+			{
+				barrier.dstAccessMask = 0;
+			}
+			vkCmdPipelineBarrier(batch.m_transferCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+				0, nullptr, static_cast<uint32_t>(releaseBufferBarriers.size()), releaseBufferBarriers.data(), static_cast<uint32_t>(releaseImageBarriers.size()), releaseImageBarriers.data());
+		}
+		if (vkEndCommandBuffer(batch.m_transferCommandBuffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to finish recording upload commands");
+		}
+
+		if (!dedicatedTransfer)
+		{
+			m_lastGraphicsSubmitValue = m_graphicsQueue->Submit({ batch.m_transferCommandBuffer }, {});
+		}
+		else
+		{
+			const uint64_t transferValue = m_transferQueue->Submit({ batch.m_transferCommandBuffer }, {});
+
+			// acquire half, src access is ignored on this side
+			for (VkBufferMemoryBarrier& barrier : bufferBarriers)
+			{
+				barrier.srcAccessMask = 0;
+			}
+			for (VkImageMemoryBarrier& barrier : imageBarriers)
+			{
+				barrier.srcAccessMask = 0;
+			}
+			if (vkBeginCommandBuffer(batch.m_acquireCommandBuffer, &beginInfo) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed the start recording an upload command buffer!");
+			}
+			vkCmdPipelineBarrier(batch.m_acquireCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, graphicsDstStages, 0,
+				0, nullptr, static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(), static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+			if (vkEndCommandBuffer(batch.m_acquireCommandBuffer) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to finish recording upload commands");
+			}
+
+			// the graphics side can only reach its value after the transfer it waited on, so its value covers both submits
+			m_lastGraphicsSubmitValue = m_graphicsQueue->Submit({ batch.m_acquireCommandBuffer }, { m_transferQueue->MakeWait(transferValue, graphicsDstStages) });
+		}
+
+		batch.m_graphicsTimelineValue = m_lastGraphicsSubmitValue;
+		batch.m_ringEndPosition = m_writePosition;
+		m_inFlightBatches.push_back(batch);
+		m_pendingBufferCopies.clear();
+		m_pendingImageCopies.clear();
+		++m_nSubmits;
+	}
+
+	void WaitIdle()
+	{
+		Flush();
+		while (!m_inFlightBatches.empty())
+		{
+			WaitForOldestBatch();
+		}
+	}
+
+	VkDeviceSize GetBytesUploaded() const { return m_bytesUploaded; }
+	uint64_t GetSubmitCount() const { return m_nSubmits; }
+	// the graphics queue timeline value after which everything flushed so far has landed, 0 before the first flush
+	uint64_t GetLastGraphicsSubmitValue() const { return m_lastGraphicsSubmitValue; }
+
+private:
+	struct PendingBufferCopy
+	{
+		VkBuffer m_dstBuffer;
+		VkBufferCopy m_region;
+		VkPipelineStageFlags m_dstStages;
+		VkAccessFlags m_dstAccess;
+		bool m_dstIsConcurrent;
+	};
+
+	struct PendingImageCopy
+	{
+		VkImage m_dstImage;
+		VkBufferImageCopy m_region;
+		VkImageLayout m_finalLayout;
+		VkPipelineStageFlags m_dstStages;
+		VkAccessFlags m_dstAccess;
+	};
+
+	struct UploadBatch
+	{
+		VkCommandBuffer m_transferCommandBuffer = nullptr;
+		VkCommandBuffer m_acquireCommandBuffer = nullptr; // only with a dedicated transfer queue
+		uint64_t m_graphicsTimelineValue = 0; // done with once the graphics queue's timeline reaches this
+		uint64_t m_ringEndPosition = 0; // ring space before this is free once the batch is done with
+	};
+
+	VkCommandPool CreateCommandPool(uint32_t queueFamilyIndex)
+	{
+		VkCommandPoolCreateInfo cmdPoolCreateInfo = {};
+		cmdPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		cmdPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+		cmdPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		VkCommandPool commandPool = nullptr;
+		if (vkCreateCommandPool(m_device, &cmdPoolCreateInfo, nullptr, &commandPool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create upload command pool");
+		}
+		return commandPool;
+	}
+
+	VkDeviceSize WriteToRing(const void* data, VkDeviceSize size)
+	{
+		// positions only ever increase, the physical offset is position % ring size
+		uint64_t position = AlignUp(m_writePosition, m_copyOffsetAlignment);
+		if ((position % m_ringSize) + size > m_ringSize)
+		{
+			position = AlignUp(position, m_ringSize); // doesn't fit before the end, skip to the start of the ring
+		}
+		while (position + size - m_retiredPosition > m_ringSize)
+		{
+			MakeRoomInRing();
+		}
+
+		const VkDeviceSize ringOffset = position % m_ringSize;
+		std::memcpy(static_cast<uint8_t*>(m_ringAllocation.m_mappedData) + ringOffset, data, static_cast<size_t>(size));
+		m_allocator->FlushAllocation(m_ringAllocation, ringOffset, size);
+		m_writePosition = position + size;
+		return ringOffset;
+	}
+
+	void MakeRoomInRing()
+	{
+		// only stalls when uploads outpace the GPU by more than a ring's worth
+		RetireCompletedBatches();
+		if (!m_inFlightBatches.empty())
+		{
+			WaitForOldestBatch();
+		}
+		else if (HasPendingUploads())
+		{
+			Flush();
+		}
+		else
+		{
+			m_retiredPosition = m_writePosition; // nothing references the ring
+		}
+	}
+
+	void RetireCompletedBatches()
+	{
+		if (m_inFlightBatches.empty())
+		{
+			return;
+		}
+		const uint64_t completedValue = m_graphicsQueue->GetCompletedValue();
+		while (!m_inFlightBatches.empty() && m_inFlightBatches.front().m_graphicsTimelineValue <= completedValue)
+		{
+			RetireOldestBatch();
+		}
+	}
+
+	void WaitForOldestBatch()
+	{
+		m_graphicsQueue->WaitForValue(m_inFlightBatches.front().m_graphicsTimelineValue);
+		RetireOldestBatch();
+	}
+
+	void RetireOldestBatch()
+	{
+		UploadBatch& batch = m_inFlightBatches.front();
+		m_retiredPosition = batch.m_ringEndPosition;
+		m_freeBatches.push_back(batch);
+		m_inFlightBatches.pop_front();
+	}
+
+	UploadBatch GetFreeBatch()
+	{
+		if (!m_freeBatches.empty())
+		{
+			UploadBatch batch = m_freeBatches.back();
+			m_freeBatches.pop_back();
+			vkResetCommandBuffer(batch.m_transferCommandBuffer, 0);
+			if (batch.m_acquireCommandBuffer)
+			{
+				vkResetCommandBuffer(batch.m_acquireCommandBuffer, 0);
+			}
+			return batch;
+		}
+
+		UploadBatch batch;
+		VkCommandBufferAllocateInfo cmdBufferAllocInfo = {};
+		cmdBufferAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		cmdBufferAllocInfo.commandPool = m_transferCommandPool;
+		cmdBufferAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		cmdBufferAllocInfo.commandBufferCount = 1;
+		if (vkAllocateCommandBuffers(m_device, &cmdBufferAllocInfo, &batch.m_transferCommandBuffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to allocate upload command buffer");
+		}
+
+		if (UsesDedicatedTransferQueue())
+		{
+			cmdBufferAllocInfo.commandPool = m_acquireCommandPool;
+			if (vkAllocateCommandBuffers(m_device, &cmdBufferAllocInfo, &batch.m_acquireCommandBuffer) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to allocate upload command buffer");
+			}
+		}
+		return batch;
+	}
+
+	void DestroyBatch(UploadBatch& batch)
+	{
+		vkFreeCommandBuffers(m_device, m_transferCommandPool, 1, &batch.m_transferCommandBuffer);
+		if (batch.m_acquireCommandBuffer)
+		{
+			vkFreeCommandBuffers(m_device, m_acquireCommandPool, 1, &batch.m_acquireCommandBuffer);
+		}
+	}
+
+	void RecordCopies(VkCommandBuffer commandBuffer)
+	{
+		for (const PendingBufferCopy& copy : m_pendingBufferCopies)
+		{
+			vkCmdCopyBuffer(commandBuffer, m_ringBuffer, copy.m_dstBuffer, 1, &copy.m_region);
+		}
+
+		if (m_pendingImageCopies.empty())
+		{
+			return;
+		}
+		std::vector<VkImageMemoryBarrier> toTransferDst(m_pendingImageCopies.size());
+		for (size_t i = 0; i < m_pendingImageCopies.size(); ++i)
+		{
+			VkImageMemoryBarrier& barrier = toTransferDst[i];
+			barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = m_pendingImageCopies[i].m_dstImage;
+			barrier.subresourceRange = ToSubresourceRange(m_pendingImageCopies[i].m_region.imageSubresource);
+		}
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(toTransferDst.size()), toTransferDst.data());
+		for (const PendingImageCopy& copy : m_pendingImageCopies)
+		{
+			vkCmdCopyBufferToImage(commandBuffer, m_ringBuffer, copy.m_dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy.m_region);
+		}
+	}
+
+	void BuildPostCopyBarriers(std::vector<VkBufferMemoryBarrier>& bufferBarriers, std::vector<VkImageMemoryBarrier>& imageBarriers, VkPipelineStageFlags& dstStages) const
+	{
+		// with a dedicated transfer queue these get split into the release / acquire pair of an ownership transfer
+		const bool dedicatedTransfer = UsesDedicatedTransferQueue();
+		const uint32_t srcFamily = dedicatedTransfer ? m_transferQueue->GetFamilyIndex() : VK_QUEUE_FAMILY_IGNORED;
+		const uint32_t dstFamily = dedicatedTransfer ? m_graphicsQueue->GetFamilyIndex() : VK_QUEUE_FAMILY_IGNORED;
+		dstStages = 0;
+
+		bufferBarriers.reserve(m_pendingBufferCopies.size());
+		for (const PendingBufferCopy& copy : m_pendingBufferCopies)
+		{
+			VkBufferMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = copy.m_dstAccess;
+			barrier.srcQueueFamilyIndex = copy.m_dstIsConcurrent ? VK_QUEUE_FAMILY_IGNORED : srcFamily; // nothing to hand over, the semaphore covers visibility
+			barrier.dstQueueFamilyIndex = copy.m_dstIsConcurrent ? VK_QUEUE_FAMILY_IGNORED : dstFamily;
+			barrier.buffer = copy.m_dstBuffer;
+			barrier.offset = copy.m_region.dstOffset;
+			barrier.size = copy.m_region.size;
+			bufferBarriers.push_back(barrier);
+			dstStages |= copy.m_dstStages;
+		}
+
+		imageBarriers.reserve(m_pendingImageCopies.size());
+		for (const PendingImageCopy& copy : m_pendingImageCopies)
+		{
+			VkImageMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = copy.m_dstAccess;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.newLayout = copy.m_finalLayout;
+			barrier.srcQueueFamilyIndex = srcFamily;
+			barrier.dstQueueFamilyIndex = dstFamily;
+			barrier.image = copy.m_dstImage;
+			barrier.subresourceRange = ToSubresourceRange(copy.m_region.imageSubresource);
+			imageBarriers.push_back(barrier);
+			dstStages |= copy.m_dstStages;
+		}
+
+		if (dstStages == 0)
+		{
+			dstStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		}
+	}
+
+	static VkImageSubresourceRange ToSubresourceRange(const VkImageSubresourceLayers& layers)
+	{
+		VkImageSubresourceRange range = {};
+		range.aspectMask = layers.aspectMask;
+		range.baseMipLevel = layers.mipLevel;
+		range.levelCount = 1;
+		range.baseArrayLayer = layers.baseArrayLayer;
+		range.layerCount = layers.layerCount;
+		return range;
+	}
+
+	VkDevice m_device;
+	DeviceMemoryAllocator* m_allocator;
+	GpuQueue* m_graphicsQueue;
+	GpuQueue* m_transferQueue;
+	VkCommandPool m_transferCommandPool;
+	VkCommandPool m_acquireCommandPool;
+
+	VkBuffer m_ringBuffer;
+	DeviceAllocation m_ringAllocation;
+	VkDeviceSize m_ringSize;
+	VkDeviceSize m_copyOffsetAlignment;
+	uint64_t m_writePosition;
+	uint64_t m_retiredPosition;
+
+	std::vector<PendingBufferCopy> m_pendingBufferCopies;
+	std::vector<PendingImageCopy> m_pendingImageCopies;
+	std::deque<UploadBatch> m_inFlightBatches;
+	std::vector<UploadBatch> m_freeBatches;
+
+	VkDeviceSize m_bytesUploaded;
+	uint64_t m_nSubmits;
+	uint64_t m_lastGraphicsSubmitValue;
+};
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+
+// A vertex type declares its attributes once by specialising VertexLayoutTraits, after the struct so offsetof works:
+//
+//	template <> struct VertexLayoutTraits<MyVertex>
+//	{
+//		static constexpr std::array<VertexAttribute, 2> S_ATTRIBUTES = { { { 0, VK_FORMAT_R16G16_SNORM, offsetof(MyVertex, m_position) }, ... } };
+//		static constexpr const char* S_VERTEX_SHADER = "Shaders/MyVert.spv"; // the shaders whose inputs match those attributes
+//		static constexpr const char* S_GPU_DRIVEN_VERTEX_SHADER = "Shaders/MyGpuDrivenVert.spv";
+//		static constexpr const char* S_DEPTH_ONLY_VERTEX_SHADER = "Shaders/MyDepthOnlyVert.spv"; // only reads the position, for the depth pre-pass
+//		static constexpr const char* S_GPU_DRIVEN_DEPTH_ONLY_VERTEX_SHADER = "Shaders/MyGpuDrivenDepthOnlyVert.spv";
+//	};
+//
+// VertexLayout<MyVertex> then builds the Vulkan binding and attribute descriptions from that at compile time,
+// and static_asserts that the formats cover the struct exactly (no padding, nothing overlapping or out of bounds).
+// The attribute at S_POSITION_LOCATION is the position, position only passes read it from a stream of its own.
+
+struct VertexAttribute
+{
+	uint32_t m_location;
+	VkFormat m_format;
+	uint32_t m_offset;
+};
+
+template <typename TVertex>
+struct VertexLayoutTraits;
+
+// bytes per element for the formats we use in vertex buffers, 0 for anything else so the layout check fails
+constexpr uint32_t GetVertexFormatSize(VkFormat format)
+{
+	switch (format)
+	{
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+	case VK_FORMAT_A2B10G10R10_SNORM_PACK32:
+	case VK_FORMAT_R16G16_SNORM:
+	case VK_FORMAT_R16G16_SFLOAT:
+	case VK_FORMAT_R32_SFLOAT:
+	case VK_FORMAT_R32_UINT:
+		return 4;
+	case VK_FORMAT_R16G16B16A16_SNORM:
+	case VK_FORMAT_R16G16B16A16_SFLOAT:
+	case VK_FORMAT_R32G32_SFLOAT:
+		return 8;
+	case VK_FORMAT_R32G32B32_SFLOAT:
+		return 12;
+	case VK_FORMAT_R32G32B32A32_SFLOAT:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+template <typename TVertex>
+struct VertexLayout
+{
+	using Traits = VertexLayoutTraits<TVertex>;
+	static constexpr size_t S_ATTRIBUTE_COUNT = Traits::S_ATTRIBUTES.size();
+
+	static constexpr VkVertexInputBindingDescription GetBindingDescription(uint32_t binding = 0)
+	{
+		return { binding, static_cast<uint32_t>(sizeof(TVertex)), VK_VERTEX_INPUT_RATE_VERTEX };
+	}
+
+	static constexpr std::array<VkVertexInputAttributeDescription, S_ATTRIBUTE_COUNT> GetAttributeDescriptions(uint32_t binding = 0)
+	{
+		std::array<VkVertexInputAttributeDescription, S_ATTRIBUTE_COUNT> attribDescs = {};
+		for (size_t i = 0; i < S_ATTRIBUTE_COUNT; ++i)
+		{
+			attribDescs[i] = { Traits::S_ATTRIBUTES[i].m_location, binding, Traits::S_ATTRIBUTES[i].m_format, Traits::S_ATTRIBUTES[i].m_offset };
+		}
+		return attribDescs;
+	}
+
+	static constexpr uint32_t S_POSITION_LOCATION = 0;
+
+	// VK_FORMAT_UNDEFINED if there's no attribute at S_POSITION_LOCATION
+	static constexpr VertexAttribute GetPositionAttribute()
+	{
+		for (size_t i = 0; i < S_ATTRIBUTE_COUNT; ++i)
+		{
+			if (Traits::S_ATTRIBUTES[i].m_location == S_POSITION_LOCATION)
+			{
+				return Traits::S_ATTRIBUTES[i];
+			}
+		}
+		return { S_POSITION_LOCATION, VK_FORMAT_UNDEFINED, 0 };
+	}
+
+	// the positions tightly packed on their own, see GeometryBuffers::InitPositionStream()
+	static constexpr VkVertexInputBindingDescription GetPositionBindingDescription(uint32_t binding = 0)
+	{
+		return { binding, GetVertexFormatSize(GetPositionAttribute().m_format), VK_VERTEX_INPUT_RATE_VERTEX };
+	}
+
+	static constexpr VkVertexInputAttributeDescription GetPositionAttributeDescription(uint32_t binding = 0)
+	{
+		return { S_POSITION_LOCATION, binding, GetPositionAttribute().m_format, 0 };
+	}
+
+	static constexpr const char* GetVertexShaderPath() { return Traits::S_VERTEX_SHADER; }
+	static constexpr const char* GetGpuDrivenVertexShaderPath() { return Traits::S_GPU_DRIVEN_VERTEX_SHADER; }
+	static constexpr const char* GetDepthOnlyVertexShaderPath() { return Traits::S_DEPTH_ONLY_VERTEX_SHADER; }
+	static constexpr const char* GetGpuDrivenDepthOnlyVertexShaderPath() { return Traits::S_GPU_DRIVEN_DEPTH_ONLY_VERTEX_SHADER; }
+
+	// every attribute is a known format, in bounds, not overlapping the next and together they cover every byte
+	static constexpr bool IsTightlyPacked()
+	{
+		uint32_t totalSize = 0;
+		for (size_t i = 0; i < S_ATTRIBUTE_COUNT; ++i)
+		{
+			const uint32_t size = GetVertexFormatSize(Traits::S_ATTRIBUTES[i].m_format);
+			if (size == 0 || Traits::S_ATTRIBUTES[i].m_offset + size > sizeof(TVertex))
+			{
+				return false;
+			}
+			for (size_t j = i + 1; j < S_ATTRIBUTE_COUNT; ++j)
+			{
+				const uint32_t otherSize = GetVertexFormatSize(Traits::S_ATTRIBUTES[j].m_format);
+				if (Traits::S_ATTRIBUTES[i].m_location == Traits::S_ATTRIBUTES[j].m_location
+					|| (Traits::S_ATTRIBUTES[i].m_offset < Traits::S_ATTRIBUTES[j].m_offset + otherSize && Traits::S_ATTRIBUTES[j].m_offset < Traits::S_ATTRIBUTES[i].m_offset + size))
+				{
+					return false;
+				}
+			}
+			totalSize += size;
+		}
+		return totalSize == sizeof(TVertex);
+	}
+};
+
+// packing helpers for the normalised formats, the GPU unpacks these for free in the vertex fetch
+
+inline int16_t PackSnorm16(float value)
+{
+	return static_cast<int16_t>(std::lround((std::min)((std::max)(value, -1.0f), 1.0f) * 32767.0f));
+}
+
+inline uint8_t PackUnorm8(float value)
+{
+	return static_cast<uint8_t>(std::lround((std::min)((std::max)(value, 0.0f), 1.0f) * 255.0f));
+}
+
+// for VK_FORMAT_A2B10G10R10_UNORM_PACK32 normals, mapped from -1..1 to 0..1 (the shader does * 2 - 1) because
+// unlike the unorm version, A2B10G10R10_SNORM_PACK32 isn't guaranteed to be supported as a vertex format
+inline uint32_t PackNormalA2B10G10R10(const glm::vec3& normal)
+{
+	const auto pack10 = [](float value) { return static_cast<uint32_t>(std::lround((std::min)((std::max)(value * 0.5f + 0.5f, 0.0f), 1.0f) * 1023.0f)); };
+	return pack10(normal.x) | (pack10(normal.y) << 10) | (pack10(normal.z) << 20);
+}
@@ -0,0 +1,3017 @@
+#pragma once
+
+#include <optional>
+#include <deque>
+#include <iostream>
+#include <fstream>
+#include <string> // needed for checking validation layers
+#include <array>
+#include <algorithm>
+#include <numeric>
+#include <vector>
+#include <set>
+#include <cassert>
+#include <exception>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <ctime>
+#include <cmath>
+#include <thread>
+
+#include <glm/glm.hpp>
+#define GLFW_INCLUDE_VULKAN
+#ifdef _WINDOWS
+#define VK_USE_PLATFORM_WIN32_KHR
+#define GLFW_EXPOSE_NATIVE_WGL
+#define GLFW_EXPOSE_NATIVE_WIN32
+#endif // _WINDOWS
+#include <GLFW/glfw3.h>
+#include <GLFW/glfw3native.h>
+
+#include "DeviceMemoryAllocator.h"
+#include "GpuQueue.h"
+#include "UploadManager.h"
+#include "PipelineCache.h"
+#include "DeferredDestructionQueue.h"
+#include "JobSystem.h"
+#include "ParallelCommandRecorder.h"
+#include "Profiler.h"
+#include "FramePacer.h"
+#include "EntityStore.h"
+#include "FrustumCuller.h"
+#include "GeometryBuffers.h"
+#include "GpuDrivenRenderer.h"
+#include "FrameDataRing.h"
+#include "BindlessResourceTable.h"
+#include "RenderGraph.h"
+#include "EmbeddedShaders.h"
+#include "TaskGraph.h"
+#include "MeshProcessing.h"
+#include "VertexLayout.h"
+#include "AssetPackage.h"
+#include "AssetStreamer.h"
+
+
+#ifdef _WINDOWS
+#include <Windows.h>
+#endif // _WINDOWS
+
+
+static const std::vector<const char*> s_validationLayers = { "VK_LAYER_KHRONOS_validation" }; // following tutorial structure, refactor once we're got a triangle on screen
+static const std::vector<const char*> s_requiredPhysicalDeviceExtentions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME }; // these constraints are meant to be used on a created device, not during device creation
+static const std::vector<const char*> s_requiredHeadlessPhysicalDeviceExtentions = {}; // offscreen rendering doesn't present, so no swap chain extension
+
+// full precision, 20 bytes
+struct Vertex
+{
+	glm::vec2 position;
+	glm::vec3 colour;
+
+	static Vertex Create(const glm::vec2& position, const glm::vec3& colour) { return { position, colour }; }
+	glm::vec3 GetPosition() const { return glm::vec3(position, 0.0f); }
+};
+
+template <>
+struct VertexLayoutTraits<Vertex>
+{
+	static constexpr std::array<VertexAttribute, 2> S_ATTRIBUTES =
+	{ {
+		{ 0, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, position) },
+		{ 1, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, colour) },
+	} };
+	static constexpr const char* S_VERTEX_SHADER = "Shaders/DefaultVert.spv";
+	static constexpr const char* S_GPU_DRIVEN_VERTEX_SHADER = "Shaders/GpuDrivenVert.spv";
+	static constexpr const char* S_DEPTH_ONLY_VERTEX_SHADER = "Shaders/DepthOnlyVert.spv";
+	static constexpr const char* S_GPU_DRIVEN_DEPTH_ONLY_VERTEX_SHADER = "Shaders/GpuDrivenDepthOnlyVert.spv";
+};
+
+// 8 bytes, meshes span -0.5 to 0.5 so the position is stored doubled to use the whole snorm range and the shaders halve it
+struct PackedVertex
+{
+	int16_t position[2];
+	uint8_t colour[4]; // rgba
+
+	static constexpr float S_POSITION_SCALE = 2.0f;
+
+	static PackedVertex Create(const glm::vec2& position, const glm::vec3& colour)
+	{
+		return { { PackSnorm16(position.x * S_POSITION_SCALE), PackSnorm16(position.y * S_POSITION_SCALE) },
+			{ PackUnorm8(colour.x), PackUnorm8(colour.y), PackUnorm8(colour.z), 255 } };
+	}
+	glm::vec3 GetPosition() const { return glm::vec3(position[0] / 32767.0f, position[1] / 32767.0f, 0.0f) / S_POSITION_SCALE; }
+};
+
+template <>
+struct VertexLayoutTraits<PackedVertex>
+{
+	static constexpr std::array<VertexAttribute, 2> S_ATTRIBUTES =
+	{ {
+		{ 0, VK_FORMAT_R16G16_SNORM, offsetof(PackedVertex, position) },
+		{ 1, VK_FORMAT_R8G8B8A8_UNORM, offsetof(PackedVertex, colour) },
+	} };
+	static constexpr const char* S_VERTEX_SHADER = "Shaders/DefaultPackedVert.spv";
+	static constexpr const char* S_GPU_DRIVEN_VERTEX_SHADER = "Shaders/GpuDrivenPackedVert.spv";
+	static constexpr const char* S_DEPTH_ONLY_VERTEX_SHADER = "Shaders/DepthOnlyPackedVert.spv";
+	static constexpr const char* S_GPU_DRIVEN_DEPTH_ONLY_VERTEX_SHADER = "Shaders/GpuDrivenDepthOnlyPackedVert.spv";
+};
+
+// picked at compile time, the pipelines and shaders follow from the layout. DeduplicateVertices() compares bytewise so no padding allowed
+#ifdef VULKAN_ENGINE_FULL_PRECISION_VERTICES
+using SceneVertex = Vertex;
+#else
+using SceneVertex = PackedVertex;
+#endif
+static_assert(VertexLayout<SceneVertex>::IsTightlyPacked(), "SceneVertex's attributes don't match the struct");
+static_assert(VertexLayout<SceneVertex>::GetPositionBindingDescription().stride != 0, "SceneVertex needs a position for the depth pre-pass");
+
+// matches FrameConstants in Default.vert (std140), one per frame from the frame data ring
+struct FrameConstants
+{
+	glm::vec4 m_cameraPosition; // xy
+};
+
+// matches DrawData in Default.vert (std430), the CPU draws' per draw data goes into the frame data ring
+struct DrawConstants
+{
+	glm::vec4 m_positionAndScale; // xy world position, zw scale
+	float m_depth; // 0 is nearest
+	uint32_t m_materialBuffer; // bindless handle of the material table, only read when the bindless table's enabled
+	uint32_t m_material; // index into it
+	float m_padding; // the struct's aligned to a vec4 in the shaders
+};
+static_assert(sizeof(DrawConstants) == 32, "DrawConstants has to match the std430 layout in the shaders");
+
+// matches MaterialData in DefaultBindless.frag (std430), the scene's materials sit in one storage buffer in the bindless table
+struct MaterialData
+{
+	glm::vec4 m_tint; // multiplies the vertex colour
+};
+
+// what Update() hands over to the frame being drawn
+struct FrameDrawState
+{
+	std::vector<DrawConstants> m_drawItems; // CPU draws, only what survived culling
+	std::vector<uint32_t> m_drawItemMeshes; // mesh handle per draw item
+	std::vector<GpuInstanceData> m_gpuInstances; // GPU driven, every instance, the compute pass does the culling
+	Frustum m_frustum;
+	glm::vec2 m_cameraPosition;
+};
+
+struct VulkanAppSettings
+{
+	uint32_t m_width = 800;
+	uint32_t m_height = 600;
+	uint32_t m_framesInFlight = 2; // frames the CPU can get ahead of the GPU, 1 to 4, fewer is lower latency and more keeps the GPU busier
+	PresentPolicy m_presentPolicy = PresentPolicy::LowLatency; // picks the present mode and whether the frame pacer delays frame starts
+
+	// headless mode renders into offscreen images, no window, surface, swap chain or present queue
+	bool m_headless = false;
+	uint32_t m_offscreenImageCount = 3; // images in flight, clamped to at least the number of frames processed at once
+	uint64_t m_headlessFrameCount = 1000; // headless runs stop after this many frames
+	bool m_readbackFrames = false; // copy each rendered frame back to host memory
+	std::string m_readbackOutputPath; // if set the last read back frame is written here as a .ppm
+
+	std::string m_pipelineCachePath = "PipelineCache.bin"; // empty to not keep the pipeline cache between runs
+	std::string m_assetPackagePath; // if set the scene mesh and any shaders it has are mapped from this package rather than generated or read from Shaders/
+	std::string m_writeAssetPackagePath; // if set the generated scene mesh and the shaders are written to a package here
+	bool m_streamAssets = false; // load the scene mesh in the background and upload it over several frames, the triangle's drawn until it's there
+
+	uint32_t m_drawCount = 1; // the triangle is drawn this many times in a grid, each one its own draw call
+	uint32_t m_trianglesPerDraw = 1; // more than one splits the triangle's square into a grid of smaller ones, for heavier scenes
+	float m_drawScale = 0.5f; // each draw's size relative to its grid cell, above 1 they overlap and the scene has overdraw
+	bool m_depthPrepass = false; // lay down the scene's depth with a position only pass first so the scene pass only shades visible fragments
+	uint32_t m_workerThreadCount = 0; // job system threads on top of the main thread, 0 for one per remaining core
+	uint32_t m_recordingThreadCount = 0; // caps the threads recording command buffers at once, 0 for all of the job system's
+	bool m_animateScene = false; // give every draw a velocity so Update() has something to do
+	float m_sceneWorldSize = 1.0f; // screens across, the draws are spread over the whole world and culled to what the camera sees
+	bool m_gpuDrivenRendering = false; // cull on the GPU and draw the scene with a few indirect draws instead of a draw call each, needs multiDrawIndirect
+	bool m_asyncCompute = true; // with GPU driven rendering, cull on a compute only queue alongside the graphics queue when there is one
+	bool m_bindlessResources = true; // one update after bind descriptor set for every image, buffer and sampler, needs descriptor indexing
+	bool m_recordingThreadSweep = false; // headless only, repeats the run for 1, 2, 4... recording threads and reports the record time of each
+
+	bool m_profilingEnabled = false; // CPU zones and GPU timestamps per frame
+	std::string m_profileOutputPath = "Profile.json"; // written on shutdown, a Chrome trace unless it ends in .csv
+};
+
+class VulkanApp
+{
+public:
+	VulkanApp(const VulkanAppSettings& settings)
+		: m_settings(settings)
+		, m_windowWidth(settings.m_width)
+		, m_windowHeight(settings.m_height)
+		, m_window(nullptr)
+		, m_vulkanInstance(nullptr)
+		, m_vulkanPhysicalDevice(nullptr)
+		, m_vulkanLogicalDevice(nullptr)
+		, m_surfaceToDrawTo(nullptr)
+		, m_presentQueue(nullptr)
+		, m_swapChain(nullptr)
+		, m_vertexShaderModule(nullptr)
+		, m_fragmentShaderModule(nullptr)
+		, m_bindlessFragmentShaderModule(nullptr)
+		, m_gpuDrivenVertexShaderModule(nullptr)
+		, m_depthOnlyVertexShaderModule(nullptr)
+		, m_gpuDrivenDepthOnlyVertexShaderModule(nullptr)
+		, m_pipeline(nullptr)
+		, m_pipelineLayout(nullptr)
+		, m_depthPrepassPipeline(nullptr)
+		, m_depthFormat(VK_FORMAT_UNDEFINED)
+		, m_backBuffer(RenderGraph::S_INVALID_ID)
+		, m_depthBuffer(RenderGraph::S_INVALID_ID)
+		, m_depthPrepass(RenderGraph::S_INVALID_ID)
+		, m_scenePass(RenderGraph::S_INVALID_ID)
+		, m_recordingFrameSlot(0)
+		, m_recordingImageIndex(0)
+		, m_calibratedTimestampsEnabled(false)
+		, m_frameConstantsOffset(0)
+		, m_bindlessEnabled(false)
+		, m_materialBuffer(nullptr)
+		, m_materialBufferHandle(BindlessResourceTable::S_INVALID_HANDLE)
+		, m_gpuDrivenEnabled(false)
+		, m_asyncComputeEnabled(false)
+		, m_gpuDrivenPipeline(nullptr)
+		, m_gpuDrivenDepthPrepassPipeline(nullptr)
+		, m_drawIndexedIndirectCount(nullptr)
+		, m_sceneMeshHandle(0)
+		, m_streamedSceneMeshHandle(0)
+		, m_sceneTimeSeconds(0.0)
+		, m_currentDrawState(0)
+		, m_getImageTimeOutNanoSeconds(0)
+		, m_nFramesInFlight((std::min)((std::max)(settings.m_framesInFlight, FramePacer::S_MIN_FRAMES_IN_FLIGHT), FramePacer::S_MAX_FRAMES_IN_FLIGHT))
+		, m_currentFrameSyncObjectIndex(0)
+		, m_frameBufferResized(false)
+		, m_nFrameSubmits(0)
+		, m_initStartNs(0)
+		, m_initMs(0.0)
+		, m_timeToFirstFrameMs(0.0)
+		, m_headlessImageIndex(0)
+		, m_nReadbackFrames(0)
+#if (NDEBUG)
+		, m_useVulkanValidationLayers(false) // release build
+#else
+		, m_useVulkanValidationLayers(true) // debug build
+#endif
+
+	{}
+
+	~VulkanApp()
+	{}
+
+	void Run()
+	{
+		Init();
+		MainLoop();
+		Shutdown();
+	}
+
+	// the benchmark drives frames itself with Init(), RunFrame() and Shutdown() rather than going through Run()
+	void WaitIdle()
+	{
+		vkDeviceWaitIdle(m_vulkanLogicalDevice);
+		m_profiler.CollectAll();
+	}
+
+	// submits to any queue, frames and uploads
+	uint64_t GetQueueSubmitCount() const { return m_nFrameSubmits + m_uploadManager.GetSubmitCount() + m_computeQueue.GetSubmitCount(); }
+	uint64_t GetTriangleCount() const { return static_cast<uint64_t>(m_geometryBuffers.GetMesh(GetDrawnSceneMesh()).m_indexCount / 3) * m_sceneEntities.GetEntityCount(); }
+	const Profiler& GetProfiler() const { return m_profiler; }
+	const FramePacer& GetFramePacer() const { return m_framePacer; }
+	// null when the device doesn't support it or it's been turned off
+	BindlessResourceTable* GetBindlessResources() { return m_bindlessEnabled ? &m_bindlessResources : nullptr; }
+	std::vector<DeviceHeapStats> GetDeviceMemoryStats() const { return m_deviceMemoryAllocator.GetHeapStats(); }
+	VkExtent2D GetRenderExtent() const { return m_swapChainExtent; }
+	double GetInitMs() const { return m_initMs; }
+	double GetTimeToFirstFrameMs() const { return m_timeToFirstFrameMs; } // 0 until a frame's been submitted
+
+private:
+	struct QueueFamilyIndices
+	{
+		std::optional<uint32_t> m_graphicsFamilyIndex;
+		std::optional<uint32_t> m_presentFamilyIndex;
+		std::optional<uint32_t> m_transferFamilyIndex; // only set for a transfer only family, uploads go through the graphics queue otherwise
+		std::optional<uint32_t> m_computeFamilyIndex; // only set for a compute family without graphics, async compute needs one
+
+		bool ValueReady(bool presentFamilyRequired = true)
+		{
+			return m_graphicsFamilyIndex.has_value() && (m_presentFamilyIndex.has_value() || !presentFamilyRequired);
+		}
+	};
+
+	struct SwapChainSupportDetails
+	{
+		VkSurfaceCapabilitiesKHR capabilities;
+		std::vector<VkSurfaceFormatKHR> formats;
+		std::vector<VkPresentModeKHR> presentModes;
+	};
+
+public:
+	void Init()
+	{
+		m_initStartNs = Profiler::NowNs();
+		m_framePacer.Init(m_settings.m_presentPolicy);
+		try
+		{
+			m_jobSystem.Init(m_settings.m_workerThreadCount);
+			std::cout << "Job system running on " << m_jobSystem.GetThreadCount() << " threads" << std::endl;
+			if (!m_settings.m_headless)
+			{
+				InitWindow();
+			}
+			InitVulkan();
+		}
+		catch (const std::exception& ex)
+		{
+#ifdef _WINDOWS
+			OutputDebugString(ex.what());
+#else
+			std::cerr << ex.what() << std::endl;
+#endif
+			throw; // carrying on with a half initialised device just crashes later
+		}
+		m_getImageTimeOutNanoSeconds = UINT64_MAX; // no timeout, 2^64 doesn't fit
+		m_initMs = static_cast<double>(Profiler::NowNs() - m_initStartNs) / 1000000.0;
+	}
+private:
+	void InitWindow()
+	{
+		glfwInit();
+		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+		m_window = glfwCreateWindow(m_windowWidth, m_windowHeight, "Vulkan window", nullptr, nullptr);
+		glfwSetWindowUserPointer(m_window, this);
+		glfwSetFramebufferSizeCallback(m_window, OnFrameBufferResizeCallback);
+	}
+	void InitVulkan()
+	{
+		// a graph rather than a list so the independent steps overlap on the job system: shader modules and pipelines are
+		// created while the swap chain and its views are, the scene mesh is generated while the device is, and so on.
+		// Anything touching the UploadManager is chained since it isn't thread safe, the first Flush() is after the graph
+		TaskGraph startup;
+		VkFormat renderTargetFormat = VK_FORMAT_UNDEFINED;
+		IndexedMesh<SceneVertex> generatedSceneMesh;
+		MeshProcessingStats generatedSceneMeshStats;
+
+		const TaskGraph::TaskId assetPackage = startup.AddTask("OpenAssetPackage", [this]()
+		{
+			if (!m_settings.m_assetPackagePath.empty())
+			{
+				m_assetPackage.Open(m_settings.m_assetPackagePath);
+			}
+		});
+		const TaskGraph::TaskId sceneMesh = startup.AddTask("GenerateSceneMesh", [this, &generatedSceneMesh, &generatedSceneMeshStats]()
+		{
+			if (!m_settings.m_streamAssets && !(m_assetPackage.IsOpen() && m_assetPackage.FindChunk(S_SCENE_MESH_ASSET_NAME, AssetChunkType::Mesh)))
+			{
+				generatedSceneMesh = GenerateSceneMesh(m_settings.m_trianglesPerDraw, generatedSceneMeshStats);
+			}
+		}, { assetPackage });
+
+		const TaskGraph::TaskId instance = startup.AddTask("Instance", [this]()
+		{
+			CreateVulkanInstance();
+			SetupVulkanDebugMessenger();
+		});
+		const TaskGraph::TaskId surface = startup.AddTask("Surface", [this]()
+		{
+			if (!m_settings.m_headless)
+			{
+				CreateSurfaceToDrawTo();
+			}
+		}, { instance });
+		// QueryVulkanExtentions(); // add it back in if we need to check the extention strings
+		const TaskGraph::TaskId device = startup.AddTask("Device", [this]()
+		{
+			SelectVulkanDevice();
+			CreateLogicalVulkanDevice();
+		}, { surface });
+
+		const TaskGraph::TaskId allocator = startup.AddTask("DeviceMemoryAllocator", [this]() { m_deviceMemoryAllocator.Init(m_vulkanPhysicalDevice, m_vulkanLogicalDevice); }, { device });
+		const TaskGraph::TaskId pipelineCache = startup.AddTask("PipelineCache", [this]() { m_pipelineCache.Init(m_vulkanPhysicalDevice, m_vulkanLogicalDevice, m_settings.m_pipelineCachePath); }, { device });
+		const TaskGraph::TaskId profiler = startup.AddTask("Profiler", [this]()
+		{
+			m_profiler.Init(m_settings.m_profilingEnabled, m_vulkanInstance, m_vulkanPhysicalDevice, m_vulkanLogicalDevice, m_graphicsQueueFamilyIndices.m_graphicsFamilyIndex.value(),
+				static_cast<uint32_t>(m_nFramesInFlight), m_calibratedTimestampsEnabled);
+		}, { device });
+		const TaskGraph::TaskId uploadManager = startup.AddTask("UploadManager", [this]()
+		{
+			m_uploadManager.Init(m_vulkanPhysicalDevice, m_vulkanLogicalDevice, m_deviceMemoryAllocator, m_graphicsQueue, GetUploadQueue());
+		}, { allocator });
+
+		// the render graph only needs the format, so it and the pipelines don't have to wait for the swap chain
+		const TaskGraph::TaskId renderTargetFormatTask = startup.AddTask("RenderTargetFormat", [this, &renderTargetFormat]() { renderTargetFormat = SelectRenderTargetFormat(); }, { device });
+		const TaskGraph::TaskId renderTargets = startup.AddTask(m_settings.m_headless ? "OffscreenTargets" : "SwapChain", [this]()
+		{
+			if (m_settings.m_headless)
+			{
+				CreateOffscreenTargets();
+			}
+			else
+			{
+				CreateSwapChain();
+			}
+		}, { renderTargetFormatTask, allocator });
+		startup.AddTask("ImageViews", [this]() { CreateImageViews(); }, { renderTargets });
+		const TaskGraph::TaskId renderGraph = startup.AddTask("RenderGraph", [this, &renderTargetFormat]()
+		{
+			m_renderGraph.Init(m_vulkanLogicalDevice, m_deviceMemoryAllocator, m_deferredDestructionQueue);
+			m_depthFormat = SelectDepthFormat();
+			BuildRenderGraph(renderTargetFormat);
+			std::cout << "Render graph: " << m_renderGraph.GetRenderPassCount() << " render passes, " << m_renderGraph.GetBarrierCount() << " barriers" << std::endl;
+		}, { renderTargetFormatTask });
+		const TaskGraph::TaskId shaderModules = startup.AddTask("ShaderModules", [this]() { CreateShaderModules(); }, { device, assetPackage });
+		const TaskGraph::TaskId frameDataRing = startup.AddTask("FrameDataRing", [this]()
+		{
+			// room for every draw's constants plus the alignment padding between blocks, the depth pre-pass copies them in again
+			const VkDeviceSize drawPasses = m_settings.m_depthPrepass ? 2 : 1;
+			m_frameDataRing.Init(m_vulkanPhysicalDevice, m_vulkanLogicalDevice, m_deviceMemoryAllocator, static_cast<uint32_t>(m_nFramesInFlight),
+				FrameDataRing::S_DEFAULT_BYTES_PER_FRAME + drawPasses * static_cast<VkDeviceSize>(GetSceneDrawCount()) * sizeof(DrawConstants));
+		}, { allocator });
+		const TaskGraph::TaskId bindlessResources = startup.AddTask("BindlessResources", [this]()
+		{
+			if (m_bindlessEnabled)
+			{
+				m_bindlessResources.Init(m_vulkanPhysicalDevice, m_vulkanLogicalDevice);
+				std::cout << "Bindless resource table: " << m_bindlessResources.GetSampledImageCapacity() << " images, " << m_bindlessResources.GetStorageBufferCapacity()
+					<< " buffers, " << m_bindlessResources.GetSamplerCapacity() << " samplers" << std::endl;
+			}
+		}, { device });
+		startup.AddTask("GraphicsPipeline", [this]() { CreateGraphicsPipeline(); }, { shaderModules, renderGraph, pipelineCache, frameDataRing, bindlessResources });
+
+		const TaskGraph::TaskId geometryBuffers = startup.AddTask("GeometryBuffers", [this, &generatedSceneMesh, &generatedSceneMeshStats]()
+		{
+			CreateGeometryBuffers(generatedSceneMesh, generatedSceneMeshStats);
+		}, { uploadManager, sceneMesh });
+		// after the geometry buffers as they both use the upload manager
+		const TaskGraph::TaskId materials = startup.AddTask("Materials", [this]()
+		{
+			if (m_bindlessEnabled)
+			{
+				CreateMaterialBuffer();
+			}
+		}, { geometryBuffers, bindlessResources });
+		// whether it's enabled depends on the device's features, so these are always in the graph and do nothing without it
+		const TaskGraph::TaskId gpuDrivenRenderer = startup.AddTask("GpuDrivenRenderer", [this]()
+		{
+			if (m_gpuDrivenEnabled)
+			{
+				CreateGpuDrivenRenderer();
+			}
+		}, { geometryBuffers, pipelineCache, assetPackage });
+		startup.AddTask("GpuDrivenPipeline", [this]()
+		{
+			if (m_gpuDrivenEnabled)
+			{
+				CreateGpuDrivenPipeline();
+			}
+		}, { gpuDrivenRenderer, shaderModules, renderGraph });
+
+		const TaskGraph::TaskId commandPools = startup.AddTask("CommandPools", [this]() { CreateCommandPool(); }, { device });
+		startup.AddTask("CommandBuffers", [this]() { CreateCommandBuffers(); }, { commandPools });
+		startup.AddTask("Scene", [this]() { CreateScene(); }, { geometryBuffers, materials, gpuDrivenRenderer, profiler });
+		startup.AddTask("SyncObjects", [this]() { CreateVulkanSyncObjects(); }, { device });
+
+		startup.Run(m_jobSystem);
+		m_uploadManager.Flush(); // ordered before the first frame's submit on the graphics queue
+		startup.RecordProfileZones(m_profiler);
+		startup.PrintReport(std::cout, "Startup");
+		if (m_settings.m_headless)
+		{
+			std::cout << "Rendering headless into " << m_swapChainImages.size() << " offscreen images of " << m_swapChainExtent.width << "x" << m_swapChainExtent.height << std::endl;
+		}
+		m_deviceMemoryAllocator.PrintStats(std::cout);
+	}
+
+	bool AreVulkanValidationLayersSupported()
+	{
+		uint32_t nLayers = 0;
+		vkEnumerateInstanceLayerProperties(&nLayers, nullptr);
+
+		std::vector<VkLayerProperties> availableLayers(nLayers);
+		vkEnumerateInstanceLayerProperties(&nLayers, availableLayers.data());
+
+		const std::string targetLayerStr = std::string(s_validationLayers[0]);
+		bool validationLayerFound = false;
+		for (uint32_t i = 0; i < nLayers && !validationLayerFound; ++i)
+		{
+			validationLayerFound = targetLayerStr == availableLayers[i].layerName;
+		}
+		return validationLayerFound;
+	}
+
+	std::vector<const char*> GetRequiredVulkanExtentions()
+	{
+		std::vector<const char*> extCStrs;
+		if (!m_settings.m_headless)
+		{
+			// Message callback
+			uint32_t glfwRequiredExtCount = 0;
+			const char** glfwExtCStrs;
+			glfwExtCStrs = glfwGetRequiredInstanceExtensions(&glfwRequiredExtCount);
+			extCStrs.assign(glfwExtCStrs, glfwExtCStrs + glfwRequiredExtCount);
+		}
+
+		if (AreVulkanValidationLayersSupported())
+		{
+			extCStrs.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+		}
+
+		return extCStrs;
+	}
+
+	void CreateVulkanInstance()
+	{
+		if (m_useVulkanValidationLayers && !AreVulkanValidationLayersSupported())
+		{
+			throw std::runtime_error("tried to run with Vulkan validation layers, this setup doesn't support them.");
+		}
+
+		VkApplicationInfo appInfo = {};
+		appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+		appInfo.pApplicationName = "Vulkan Triangle";
+		appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+		appInfo.pEngineName = "Learning Vulkan Engine";
+		appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+		appInfo.apiVersion = VK_API_VERSION_1_2; // timeline semaphores are core in 1.2, a 1.1 device can still use them through the KHR extension
+
+		VkInstanceCreateInfo instanceCreateInfo = {};
+		instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+		instanceCreateInfo.pApplicationInfo = &appInfo; // tutorial used stack memory, should be ok
+		
+		const std::vector<const char*> requiredExtentions = GetRequiredVulkanExtentions();
+		
+		instanceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(requiredExtentions.size());
+		instanceCreateInfo.ppEnabledExtensionNames = requiredExtentions.data();
+
+		VkDebugUtilsMessengerCreateInfoEXT dbgCreateInfo = {};
+		// declared outside the if so doesn't go out of scope on calling vkCreateInstance()
+
+		if (m_useVulkanValidationLayers)
+		{
+			
+			instanceCreateInfo.enabledLayerCount = static_cast<uint32_t>(s_validationLayers.size());
+			instanceCreateInfo.ppEnabledLayerNames = s_validationLayers.data();
+			PopulateVulkanDebugMessengerCreateInfo(dbgCreateInfo);
+			instanceCreateInfo.pNext = &dbgCreateInfo;
+		}
+		else
+		{
+			instanceCreateInfo.enabledLayerCount = 0;
+			instanceCreateInfo.pNext = nullptr;
+		}
+
+		VkResult instanceCreateRes = vkCreateInstance(&instanceCreateInfo, nullptr, &m_vulkanInstance); // the nullptr would be for an allocator callback function.
+		if (instanceCreateRes != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create Vulkan instance");
+		}
+		std::cout << "Vulkan Instance created successfully" << std::endl;
+	}
+
+	void PopulateVulkanDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo)
+	{
+		createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+		createInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+		createInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+		createInfo.pfnUserCallback = VulkanDebugCallback;
+	}
+
+	void SetupVulkanDebugMessenger()
+	{
+		if (!m_useVulkanValidationLayers)
+			return;
+
+		VkDebugUtilsMessengerCreateInfoEXT createInfo = {};
+		PopulateVulkanDebugMessengerCreateInfo(createInfo);
+
+		if (CreateDebugUtilsMessengerEXT(m_vulkanInstance, &createInfo, nullptr, &m_vulkanDebugMessenger) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to set up a Vulkan debug messenger!");
+		}
+	}
+
+	void QueryVulkanExtentions()
+	{
+		// assumes m_vulkanInstance has been initialised
+		uint32_t nVulkanExtentions = 0;
+		vkEnumerateInstanceExtensionProperties(nullptr, &nVulkanExtentions, nullptr);
+		std::vector<VkExtensionProperties> extensions(nVulkanExtentions);
+		vkEnumerateInstanceExtensionProperties(nullptr, &nVulkanExtentions, extensions.data());
+		std::cout << nVulkanExtentions << " Vulkan extensions detected:\n";
+		for (const VkExtensionProperties& currExt: extensions)
+		{
+			std::cout << currExt.extensionName << std::endl;
+		}
+	}
+
+	void CreateSurfaceToDrawTo()
+	{
+		// this needs to be called before SelectVulkanDevice()
+#ifdef _WINDOWS
+		// m_surfaceToDrawTo
+		VkWin32SurfaceCreateInfoKHR surfaceCreateInfo = {};
+		surfaceCreateInfo.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR;
+		surfaceCreateInfo.hwnd = glfwGetWin32Window(m_window);
+		surfaceCreateInfo.hinstance = GetModuleHandle(nullptr);
+		if (vkCreateWin32SurfaceKHR(m_vulkanInstance, &surfaceCreateInfo, nullptr, &m_surfaceToDrawTo) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create surface to draw to");
+		}
+
+		// glfwCreateWindowSurface() easier way to do the above, function part of glfw...
+
+#else
+		// non windows equivelent code here
+#endif // _WINDOWS
+	}
+
+	void SelectVulkanDevice()
+	{
+		uint32_t deviceCount = 0;
+		vkEnumeratePhysicalDevices(m_vulkanInstance, &deviceCount, nullptr);
+
+		if (deviceCount == 0)
+		{
+			throw std::runtime_error("failed to find GPUs with Vulkan support!");
+		}
+
+		std::vector<VkPhysicalDevice> devices(deviceCount);
+		vkEnumeratePhysicalDevices(m_vulkanInstance, &deviceCount, devices.data());
+
+		uint32_t suitabilityScoreToBeat = 0;
+		uint32_t currentDeviceSuitabilityScore = 0;
+		for (const VkPhysicalDevice& currentDevice : devices)
+		{
+			currentDeviceSuitabilityScore = CalculateVulkanDeviceSuitability(currentDevice);
+			if (suitabilityScoreToBeat < currentDeviceSuitabilityScore)
+			{
+				m_vulkanPhysicalDevice = currentDevice;
+				suitabilityScoreToBeat = currentDeviceSuitabilityScore;
+			}
+		}
+
+		if (m_vulkanPhysicalDevice == nullptr)
+		{
+			throw std::runtime_error("Found Vulkan physical devices, but none were suitable");
+		}
+
+		m_graphicsQueueFamilyIndices = FindQueueFamilies(m_vulkanPhysicalDevice);
+
+		if (!m_graphicsQueueFamilyIndices.ValueReady(!m_settings.m_headless))
+		{
+			throw std::runtime_error("Found Vulkan physical devices, but the device didn't support queue families");
+		}
+	}
+
+	QueueFamilyIndices FindQueueFamilies(VkPhysicalDevice device)
+	{
+		// graphics and present, plus the dedicated transfer and compute families where there are any
+		QueueFamilyIndices indices;
+		uint32_t nQueueFamilies = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(device, &nQueueFamilies, nullptr);
+		if (nQueueFamilies == 0)
+		{
+			throw std::runtime_error("No Vulkan Queue families found");
+		}
+		std::vector<VkQueueFamilyProperties> queueFamilies(nQueueFamilies);
+		vkGetPhysicalDeviceQueueFamilyProperties(device, &nQueueFamilies, queueFamilies.data());
+
+		uint32_t i = 0;
+		for (const VkQueueFamilyProperties& currentQueueFamilyProperties : queueFamilies)
+		{
+			VkBool32  gotPresentSupport = false;
+			if (!m_settings.m_headless)
+			{
+				vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_surfaceToDrawTo, &gotPresentSupport);
+			}
+
+			if (!indices.ValueReady(!m_settings.m_headless))
+			{
+				if (currentQueueFamilyProperties.queueCount > 0 && currentQueueFamilyProperties.queueFlags & VK_QUEUE_GRAPHICS_BIT)
+				{
+					indices.m_graphicsFamilyIndex = i;
+				}
+				if (currentQueueFamilyProperties.queueCount > 0 && gotPresentSupport)
+				{
+					indices.m_presentFamilyIndex = i;
+				}
+			}
+			// the dedicated transfer family maps to the copy engines, keeps uploads off the graphics queue
+			const VkQueueFlags transferOnlyMask = VK_QUEUE_TRANSFER_BIT | VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT;
+			if (!indices.m_transferFamilyIndex.has_value() && currentQueueFamilyProperties.queueCount > 0 && (currentQueueFamilyProperties.queueFlags & transferOnlyMask) == VK_QUEUE_TRANSFER_BIT)
+			{
+				indices.m_transferFamilyIndex = i;
+			}
+			// likewise a compute family without graphics runs alongside the graphics queue rather than being time sliced with it
+			const VkQueueFlags computeOnlyMask = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT;
+			if (!indices.m_computeFamilyIndex.has_value() && currentQueueFamilyProperties.queueCount > 0 && (currentQueueFamilyProperties.queueFlags & computeOnlyMask) == VK_QUEUE_COMPUTE_BIT)
+			{
+				indices.m_computeFamilyIndex = i;
+			}
+			++i;
+		}
+		return indices;
+	}
+
+	uint32_t CalculateVulkanDeviceSuitability(VkPhysicalDevice deviceToCheck)
+	{
+		uint32_t suitabilityScore = 0;
+		VkPhysicalDeviceProperties deviceProperties = {};
+		VkPhysicalDeviceFeatures deviceFeatures = {};
+		vkGetPhysicalDeviceProperties(deviceToCheck, &deviceProperties);
+		vkGetPhysicalDeviceFeatures(deviceToCheck, &deviceFeatures);
+		if (deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
+		{
+			suitabilityScore += 1000;
+		}
+		suitabilityScore += deviceProperties.limits.maxImageDimension2D;
+
+		// return 0 if note good enough checks at end
+		if (!deviceFeatures.geometryShader && !m_settings.m_headless)
+		{
+			suitabilityScore = 0; // software ICDs like SwiftShader don't expose geometry shaders, headless mode doesn't need them
+		}
+
+		const bool deviceMeetsMinSupportExtentions = DeviceHasMinimumExtentionSupportLevel(deviceToCheck);
+		if (!deviceMeetsMinSupportExtentions)
+		{
+			suitabilityScore = 0;
+		}
+
+		// every queue's submits and all the frame synchronisation are on timeline semaphores
+		if (!DeviceSupportsTimelineSemaphores(deviceToCheck))
+		{
+			suitabilityScore = 0;
+		}
+
+		if (!m_settings.m_headless)
+		{
+			bool swapChainSupportNeedsMet = DeviceHasMinimumSwapChainSupportLevel(deviceToCheck);
+			if (!swapChainSupportNeedsMet)
+			{
+				suitabilityScore = 0;
+			}
+		}
+
+		return suitabilityScore;
+	}
+
+	const std::vector<const char*>& GetRequiredDeviceExtentions() const
+	{
+		return m_settings.m_headless ? s_requiredHeadlessPhysicalDeviceExtentions : s_requiredPhysicalDeviceExtentions;
+	}
+
+	bool DeviceHasMinimumExtentionSupportLevel(VkPhysicalDevice deviceToCheck)
+	{
+		const std::vector<const char*>& requiredExtentions = GetRequiredDeviceExtentions();
+		if (requiredExtentions.empty())
+		{
+			return true;
+		}
+		uint32_t nExtentions = 0;
+		vkEnumerateDeviceExtensionProperties(deviceToCheck, nullptr, &nExtentions, nullptr);
+		if (nExtentions == 0)
+		{
+			return false;
+		}
+		std::vector<VkExtensionProperties> extentionsPresent(nExtentions);
+		vkEnumerateDeviceExtensionProperties(deviceToCheck, nullptr, &nExtentions, extentionsPresent.data());
+		std::set<std::string> requiredExtentionsSet(requiredExtentions.begin(), requiredExtentions.end());
+
+		for (const VkExtensionProperties& extention : extentionsPresent)
+		{
+			requiredExtentionsSet.erase(extention.extensionName);
+		}
+
+		return requiredExtentionsSet.empty(); // if the set isn't empty there's a required extention that isn't supported
+	}
+
+	bool DeviceSupportsExtention(VkPhysicalDevice deviceToCheck, const char* extentionName)
+	{
+		uint32_t nExtentions = 0;
+		vkEnumerateDeviceExtensionProperties(deviceToCheck, nullptr, &nExtentions, nullptr);
+		std::vector<VkExtensionProperties> extentionsPresent(nExtentions);
+		vkEnumerateDeviceExtensionProperties(deviceToCheck, nullptr, &nExtentions, extentionsPresent.data());
+		for (const VkExtensionProperties& extention : extentionsPresent)
+		{
+			if (std::strcmp(extention.extensionName, extentionName) == 0)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// core from 1.2, VK_KHR_timeline_semaphore before that, either way still a feature the device has to report
+	bool DeviceSupportsTimelineSemaphores(VkPhysicalDevice deviceToCheck)
+	{
+		VkPhysicalDeviceProperties deviceProperties = {};
+		vkGetPhysicalDeviceProperties(deviceToCheck, &deviceProperties);
+		if (deviceProperties.apiVersion < VK_API_VERSION_1_2 && !DeviceSupportsExtention(deviceToCheck, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME))
+		{
+			return false;
+		}
+		VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeatures = {};
+		timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+		VkPhysicalDeviceFeatures2 supportedFeatures2 = {};
+		supportedFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		supportedFeatures2.pNext = &timelineSemaphoreFeatures;
+		vkGetPhysicalDeviceFeatures2(deviceToCheck, &supportedFeatures2);
+		return timelineSemaphoreFeatures.timelineSemaphore == VK_TRUE;
+	}
+
+	bool DeviceHasMinimumSwapChainSupportLevel(VkPhysicalDevice device)
+	{
+		SwapChainSupportDetails swapChainSupport = QueryPhysicalDeviceSwapChainSupport(device);
+		return !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
+	}
+
+	void CreateLogicalVulkanDevice()
+	{
+		assert(m_graphicsQueueFamilyIndices.ValueReady(!m_settings.m_headless));
+		std::set<uint32_t> queueFamilyIndices = { m_graphicsQueueFamilyIndices.m_graphicsFamilyIndex.value() };
+		if (!m_settings.m_headless)
+		{
+			queueFamilyIndices.insert(m_graphicsQueueFamilyIndices.m_presentFamilyIndex.value());
+		}
+		if (m_graphicsQueueFamilyIndices.m_transferFamilyIndex.has_value())
+		{
+			queueFamilyIndices.insert(m_graphicsQueueFamilyIndices.m_transferFamilyIndex.value());
+		}
+		if (m_graphicsQueueFamilyIndices.m_computeFamilyIndex.has_value())
+		{
+			queueFamilyIndices.insert(m_graphicsQueueFamilyIndices.m_computeFamilyIndex.value());
+		}
+		const float queuePriority = 1.0f;
+		std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
+		for (uint32_t queueFamilyIndex : queueFamilyIndices)
+		{
+			VkDeviceQueueCreateInfo queueCreateInfo = {};
+			queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+			queueCreateInfo.queueFamilyIndex = queueFamilyIndex;
+			queueCreateInfo.queueCount = 1;
+			queueCreateInfo.pQueuePriorities = &queuePriority;
+			queueCreateInfos.push_back(queueCreateInfo);
+		}
+
+		VkPhysicalDeviceFeatures supportedFeatures = {};
+		vkGetPhysicalDeviceFeatures(m_vulkanPhysicalDevice, &supportedFeatures);
+		VkPhysicalDeviceFeatures deviceFeatures = {}; // only what's used
+		m_gpuDrivenEnabled = m_settings.m_gpuDrivenRendering && supportedFeatures.multiDrawIndirect && supportedFeatures.drawIndirectFirstInstance;
+		if (m_settings.m_gpuDrivenRendering && !m_gpuDrivenEnabled)
+		{
+			std::cout << "The device doesn't support multiDrawIndirect and drawIndirectFirstInstance, drawing from the CPU instead" << std::endl;
+		}
+		deviceFeatures.multiDrawIndirect = m_gpuDrivenEnabled ? VK_TRUE : VK_FALSE;
+		deviceFeatures.drawIndirectFirstInstance = m_gpuDrivenEnabled ? VK_TRUE : VK_FALSE;
+
+		// timeline semaphores, required (the device wouldn't have been picked without them), core from 1.2 but still a feature that has to be turned on
+		if (!DeviceSupportsTimelineSemaphores(m_vulkanPhysicalDevice))
+		{
+			throw std::runtime_error("The device doesn't support timeline semaphores");
+		}
+		VkPhysicalDeviceProperties deviceProperties = {};
+		vkGetPhysicalDeviceProperties(m_vulkanPhysicalDevice, &deviceProperties);
+		const bool timelineSemaphoresAreCore = deviceProperties.apiVersion >= VK_API_VERSION_1_2;
+		VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeatures = {};
+		timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+		timelineSemaphoreFeatures.timelineSemaphore = VK_TRUE;
+
+		// async compute needs somewhere to run
+		m_asyncComputeEnabled = m_gpuDrivenEnabled && m_settings.m_asyncCompute && m_graphicsQueueFamilyIndices.m_computeFamilyIndex.has_value();
+
+		// descriptor indexing, optional, without it there's no bindless table. Core from 1.2, before that the extention needs maintenance3 as well
+		const bool descriptorIndexingExtentionNeeded = !timelineSemaphoresAreCore && m_settings.m_bindlessResources
+			&& DeviceSupportsExtention(m_vulkanPhysicalDevice, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) && DeviceSupportsExtention(m_vulkanPhysicalDevice, VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+		VkPhysicalDeviceDescriptorIndexingFeatures descriptorIndexingFeatures = {};
+		descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+		if (m_settings.m_bindlessResources && (timelineSemaphoresAreCore || descriptorIndexingExtentionNeeded))
+		{
+			VkPhysicalDeviceDescriptorIndexingFeatures supportedDescriptorIndexingFeatures = {};
+			supportedDescriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+			VkPhysicalDeviceFeatures2 supportedFeatures2 = {};
+			supportedFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+			supportedFeatures2.pNext = &supportedDescriptorIndexingFeatures;
+			vkGetPhysicalDeviceFeatures2(m_vulkanPhysicalDevice, &supportedFeatures2);
+			m_bindlessEnabled = BindlessResourceTable::EnableRequiredFeatures(supportedDescriptorIndexingFeatures, descriptorIndexingFeatures);
+		}
+		if (m_settings.m_bindlessResources && !m_bindlessEnabled)
+		{
+			std::cout << "The device doesn't support update after bind descriptor indexing, no bindless resource table" << std::endl;
+		}
+		timelineSemaphoreFeatures.pNext = m_bindlessEnabled ? &descriptorIndexingFeatures : nullptr;
+
+		VkDeviceCreateInfo createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		createInfo.pNext = &timelineSemaphoreFeatures;
+		createInfo.pQueueCreateInfos = queueCreateInfos.data();
+		createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
+		createInfo.pEnabledFeatures = &deviceFeatures;
+		std::vector<const char*> enabledExtentions = GetRequiredDeviceExtentions();
+		// optional, without it GPU timestamps are lined up with the CPU clock less precisely
+		m_calibratedTimestampsEnabled = m_settings.m_profilingEnabled && DeviceSupportsExtention(m_vulkanPhysicalDevice, VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME);
+		if (m_calibratedTimestampsEnabled)
+		{
+			enabledExtentions.push_back(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME);
+		}
+		// optional, lets the cull pass hand the draw count straight to the draw instead of every instance getting a (possibly empty) draw
+		const bool drawIndirectCountEnabled = m_gpuDrivenEnabled && DeviceSupportsExtention(m_vulkanPhysicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+		if (drawIndirectCountEnabled)
+		{
+			enabledExtentions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+		}
+		if (!timelineSemaphoresAreCore)
+		{
+			enabledExtentions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+		}
+		if (m_bindlessEnabled && descriptorIndexingExtentionNeeded)
+		{
+			enabledExtentions.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+			enabledExtentions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+		}
+		createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtentions.size());
+		createInfo.ppEnabledExtensionNames = enabledExtentions.empty() ? nullptr : enabledExtentions.data();
+
+		if (m_useVulkanValidationLayers)
+		{
+			createInfo.enabledLayerCount = static_cast<uint32_t>(s_validationLayers.size());
+			createInfo.ppEnabledLayerNames = s_validationLayers.data();
+		}
+		else
+		{
+			createInfo.enabledLayerCount = 0;
+		}
+
+		if (vkCreateDevice(m_vulkanPhysicalDevice, &createInfo, nullptr, &m_vulkanLogicalDevice) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create logical vulkan device!");
+		}
+		if (drawIndirectCountEnabled)
+		{
+			m_drawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(vkGetDeviceProcAddr(m_vulkanLogicalDevice, "vkCmdDrawIndexedIndirectCountKHR"));
+		}
+
+		// the KHR entry points behave the same, they just have different names
+		TimelineSemaphoreFunctions timelineFunctions;
+		timelineFunctions.m_getSemaphoreCounterValue = reinterpret_cast<PFN_vkGetSemaphoreCounterValue>(vkGetDeviceProcAddr(m_vulkanLogicalDevice,
+			timelineSemaphoresAreCore ? "vkGetSemaphoreCounterValue" : "vkGetSemaphoreCounterValueKHR"));
+		timelineFunctions.m_waitSemaphores = reinterpret_cast<PFN_vkWaitSemaphores>(vkGetDeviceProcAddr(m_vulkanLogicalDevice,
+			timelineSemaphoresAreCore ? "vkWaitSemaphores" : "vkWaitSemaphoresKHR"));
+
+		VkQueue graphicsQueue = nullptr;
+		const uint32_t graphicsFamilyIndex = m_graphicsQueueFamilyIndices.m_graphicsFamilyIndex.value();
+		vkGetDeviceQueue(m_vulkanLogicalDevice, graphicsFamilyIndex, 0, &graphicsQueue);
+		m_graphicsQueue.Init(m_vulkanLogicalDevice, graphicsQueue, graphicsFamilyIndex, "graphics", timelineFunctions);
+		if (m_graphicsQueueFamilyIndices.m_transferFamilyIndex.has_value())
+		{
+			VkQueue transferQueue = nullptr;
+			vkGetDeviceQueue(m_vulkanLogicalDevice, m_graphicsQueueFamilyIndices.m_transferFamilyIndex.value(), 0, &transferQueue);
+			m_transferQueue.Init(m_vulkanLogicalDevice, transferQueue, m_graphicsQueueFamilyIndices.m_transferFamilyIndex.value(), "transfer", timelineFunctions);
+			std::cout << "Using a dedicated transfer queue for uploads" << std::endl;
+		}
+		if (m_asyncComputeEnabled)
+		{
+			VkQueue computeQueue = nullptr;
+			vkGetDeviceQueue(m_vulkanLogicalDevice, m_graphicsQueueFamilyIndices.m_computeFamilyIndex.value(), 0, &computeQueue);
+			m_computeQueue.Init(m_vulkanLogicalDevice, computeQueue, m_graphicsQueueFamilyIndices.m_computeFamilyIndex.value(), "compute", timelineFunctions);
+			std::cout << "Culling on a dedicated compute queue" << std::endl;
+		}
+		else if (m_gpuDrivenEnabled && m_settings.m_asyncCompute)
+		{
+			std::cout << "No compute only queue family, culling on the graphics queue" << std::endl;
+		}
+		if (m_settings.m_headless)
+		{
+			return; // nothing to present to
+		}
+		vkGetDeviceQueue(m_vulkanLogicalDevice, m_graphicsQueueFamilyIndices.m_presentFamilyIndex.value(), 0, &m_presentQueue);
+		if (m_presentQueue == nullptr)
+		{
+			throw std::runtime_error("failed to get the present queue!");
+		}		
+		else if (m_graphicsQueue.GetHandle() == m_presentQueue)
+		{
+			std::cout << "The Vulkan Graphics queue and the Present queue are the same queue" << std::endl;
+		}
+	}
+
+	// the transfer queue when there's a dedicated one, otherwise uploads go through the graphics queue
+	GpuQueue& GetUploadQueue() { return m_transferQueue.IsValid() ? m_transferQueue : m_graphicsQueue; }
+
+	SwapChainSupportDetails QueryPhysicalDeviceSwapChainSupport(VkPhysicalDevice physicalDevice)
+	{
+		SwapChainSupportDetails details;
+		vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, m_surfaceToDrawTo, &details.capabilities);
+		uint32_t nSupportedFormats = 0;
+		vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, m_surfaceToDrawTo, &nSupportedFormats, nullptr);
+		if (nSupportedFormats != 0)
+		{
+			details.formats.resize(nSupportedFormats);
+			vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, m_surfaceToDrawTo, &nSupportedFormats, details.formats.data());
+		}
+
+		uint32_t nSupportedPresentModes = 0;
+		vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, m_surfaceToDrawTo, &nSupportedPresentModes, nullptr);
+		if (nSupportedPresentModes != 0)
+		{
+			details.presentModes.resize(nSupportedPresentModes);
+			vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, m_surfaceToDrawTo, &nSupportedPresentModes, details.presentModes.data());
+		}
+
+		return details;
+	}
+
+	static inline VkSurfaceFormatKHR SelectSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats) 
+	{
+		for (const VkSurfaceFormatKHR& format : availableFormats)
+		{
+			if (format.format == VK_FORMAT_B8G8R8A8_UNORM && VK_COLOR_SPACE_SRGB_NONLINEAR_KHR)
+			{
+				return format;
+			}
+		}
+		return availableFormats[0]; // return first element if can't pick the optimal surface format
+	}
+
+	// low latency takes MAILBOX, no tearing and the newest frame's always the one shown. Throughput takes IMMEDIATE so present never
+	// blocks, then MAILBOX. FIFO's always there to fall back on
+	static inline VkPresentModeKHR SelectPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes, PresentPolicy policy)
+	{
+		std::vector<VkPresentModeKHR> preferredModes = { VK_PRESENT_MODE_MAILBOX_KHR };
+		if (policy == PresentPolicy::Throughput)
+		{
+			preferredModes.insert(preferredModes.begin(), VK_PRESENT_MODE_IMMEDIATE_KHR);
+		}
+		for (VkPresentModeKHR preferredMode : preferredModes)
+		{
+			if (std::find(availablePresentModes.begin(), availablePresentModes.end(), preferredMode) != availablePresentModes.end())
+			{
+				return preferredMode;
+			}
+		}
+		return VK_PRESENT_MODE_FIFO_KHR;
+	}
+
+	VkExtent2D ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& surfaceCapabilities)
+	{
+		if (surfaceCapabilities.currentExtent.width != UINT32_MAX)
+		{
+			return surfaceCapabilities.currentExtent; // the surface decides, which it does on most platforms
+		}
+		// brackets round std::max / std::min to dodge the Windows.h macros
+		VkExtent2D extentToUse = { m_windowWidth, m_windowHeight };
+		extentToUse.width = (std::max)(surfaceCapabilities.minImageExtent.width, (std::min)(surfaceCapabilities.maxImageExtent.width, extentToUse.width));
+		extentToUse.height = (std::max)(surfaceCapabilities.minImageExtent.height, (std::min)(surfaceCapabilities.maxImageExtent.height, extentToUse.height));
+		return extentToUse;
+	}
+
+	// what the swap chain (or the offscreen images) will be created with, worked out up front so the render pass doesn't have to wait for them
+	VkFormat SelectRenderTargetFormat()
+	{
+		if (m_settings.m_headless)
+		{
+			return S_OFFSCREEN_IMAGE_FORMAT;
+		}
+		return SelectSwapSurfaceFormat(QueryPhysicalDeviceSwapChainSupport(m_vulkanPhysicalDevice).formats).format;
+	}
+
+	// nothing uses stencil, so the first depth only format the device can render to and the combined ones after
+	VkFormat SelectDepthFormat() const
+	{
+		for (const VkFormat format : { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT, VK_FORMAT_D16_UNORM })
+		{
+			VkFormatProperties formatProperties = {};
+			vkGetPhysicalDeviceFormatProperties(m_vulkanPhysicalDevice, format, &formatProperties);
+			if (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)
+			{
+				return format;
+			}
+		}
+		throw std::runtime_error("The device can't render to any of the depth formats");
+	}
+
+	void CreateSwapChain(VkSwapchainKHR oldSwapChain = VK_NULL_HANDLE)
+	{
+		// validation for the swap chain support will have been used before reaching this function
+		SwapChainSupportDetails supportedSwapChainDetails = QueryPhysicalDeviceSwapChainSupport(m_vulkanPhysicalDevice);
+		VkSurfaceFormatKHR formatToCreateWith = SelectSwapSurfaceFormat(supportedSwapChainDetails.formats);
+		VkPresentModeKHR presentModeToCreateWith = SelectPresentMode(supportedSwapChainDetails.presentModes, m_settings.m_presentPolicy);
+		VkExtent2D extent = ChooseSwapExtent(supportedSwapChainDetails.capabilities);
+		// low latency FIFO keeps to the minimum so fewer frames queue up for the display, anything else needs a spare image to not block
+		const bool minimalSwapChain = m_settings.m_presentPolicy == PresentPolicy::LowLatency && presentModeToCreateWith == VK_PRESENT_MODE_FIFO_KHR;
+		uint32_t imageCountToCreateWith = supportedSwapChainDetails.capabilities.minImageCount + (minimalSwapChain ? 0 : 1);
+		if (supportedSwapChainDetails.capabilities.maxImageCount > 0 && imageCountToCreateWith > supportedSwapChainDetails.capabilities.maxImageCount) {
+			imageCountToCreateWith = supportedSwapChainDetails.capabilities.maxImageCount;
+		}
+		if (oldSwapChain == VK_NULL_HANDLE)
+		{
+			static const char* const s_presentModeNames[] = { "IMMEDIATE", "MAILBOX", "FIFO", "FIFO_RELAXED" };
+			std::cout << "Presenting with " << (presentModeToCreateWith <= VK_PRESENT_MODE_FIFO_RELAXED_KHR ? s_presentModeNames[presentModeToCreateWith] : "?") << " from " << imageCountToCreateWith
+				<< " swap chain images, " << m_nFramesInFlight << " frames in flight" << std::endl;
+		}
+		VkSwapchainCreateInfoKHR swapChainCreateInfo = {};
+		swapChainCreateInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+		swapChainCreateInfo.surface = m_surfaceToDrawTo;
+		swapChainCreateInfo.minImageCount = imageCountToCreateWith;
+		swapChainCreateInfo.imageFormat = formatToCreateWith.format;
+		swapChainCreateInfo.imageColorSpace = formatToCreateWith.colorSpace;
+		swapChainCreateInfo.imageExtent = extent;
+		swapChainCreateInfo.imageArrayLayers = 1;
+		swapChainCreateInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+
+		QueueFamilyIndices indicesStruct = FindQueueFamilies(m_vulkanPhysicalDevice);
+		uint32_t queueIndeices[] = { indicesStruct.m_graphicsFamilyIndex.value(), indicesStruct.m_presentFamilyIndex.value() };
+
+		if (indicesStruct.m_graphicsFamilyIndex != indicesStruct.m_presentFamilyIndex)
+		{
+			swapChainCreateInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
+			swapChainCreateInfo.queueFamilyIndexCount = 2;
+			swapChainCreateInfo.pQueueFamilyIndices = queueIndeices;
+		}
+		else
+		{
+			swapChainCreateInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			swapChainCreateInfo.queueFamilyIndexCount = 0; // Optional
+			swapChainCreateInfo.pQueueFamilyIndices = nullptr; // Optional
+		}
+
+		swapChainCreateInfo.preTransform = supportedSwapChainDetails.capabilities.currentTransform;
+		swapChainCreateInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+		swapChainCreateInfo.presentMode = presentModeToCreateWith;
+		swapChainCreateInfo.clipped = VK_TRUE;
+		swapChainCreateInfo.oldSwapchain = oldSwapChain; // lets the driver hand over resources, the old one is retired either way
+
+#ifdef _WINDOWS
+		// _putenv("DISABLE_VK_LAYER_VALVE_steam_overlay_1=1");
+#endif // _WINDOWS
+
+		// see: https://vulkan-tutorial.com/FAQ
+		if (vkCreateSwapchainKHR(m_vulkanLogicalDevice, &swapChainCreateInfo, nullptr, &m_swapChain) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create swap chain");
+		}
+
+		// get additional swap chain info post creation
+		uint32_t nSwapChainImagesPostCreation = 0;
+		vkGetSwapchainImagesKHR(m_vulkanLogicalDevice, m_swapChain, &nSwapChainImagesPostCreation, nullptr);
+		m_swapChainImages.resize(nSwapChainImagesPostCreation);
+		vkGetSwapchainImagesKHR(m_vulkanLogicalDevice, m_swapChain, &nSwapChainImagesPostCreation, m_swapChainImages.data());
+		m_swapChainImageFormat = formatToCreateWith.format;
+		m_swapChainExtent = extent;
+	}
+
+	void CreateOffscreenTargets()
+	{
+		// headless stand in for CreateSwapChain(), the offscreen images take the place of the swap chain images so the rest of the setup is shared
+		const uint32_t nImages = std::max(m_settings.m_offscreenImageCount, static_cast<uint32_t>(m_nFramesInFlight)); // fewer would let a frame overwrite an image before it's been read back
+		m_swapChainImageFormat = S_OFFSCREEN_IMAGE_FORMAT;
+		m_swapChainExtent = { m_windowWidth, m_windowHeight };
+
+		VkImageCreateInfo imageCreateInfo = {};
+		imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageCreateInfo.format = m_swapChainImageFormat;
+		imageCreateInfo.extent = { m_swapChainExtent.width, m_swapChainExtent.height, 1 };
+		imageCreateInfo.mipLevels = 1;
+		imageCreateInfo.arrayLayers = 1;
+		imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageCreateInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		m_swapChainImages.resize(nImages);
+		m_offscreenImageAllocations.resize(nImages);
+		for (uint32_t i = 0; i < nImages; ++i)
+		{
+			if (vkCreateImage(m_vulkanLogicalDevice, &imageCreateInfo, nullptr, &m_swapChainImages[i]) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to create offscreen image");
+			}
+			m_offscreenImageAllocations[i] = m_deviceMemoryAllocator.AllocateForImage(m_swapChainImages[i], VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		}
+
+		if (m_settings.m_readbackFrames)
+		{
+			CreateReadbackBuffers();
+		}
+	}
+
+	void CreateReadbackBuffers()
+	{
+		// one host visible buffer per offscreen image, the command buffer for that image copies into it after the render pass
+		const size_t nImages = m_swapChainImages.size();
+		const VkDeviceSize readbackSize = static_cast<VkDeviceSize>(m_swapChainExtent.width) * m_swapChainExtent.height * 4; // R8G8B8A8
+		m_readbackBuffers.resize(nImages);
+		m_readbackBufferAllocations.resize(nImages);
+
+		VkBufferCreateInfo readbackBufCreateInfo = {};
+		readbackBufCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		readbackBufCreateInfo.size = readbackSize;
+		readbackBufCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		readbackBufCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		for (size_t i = 0; i < nImages; ++i)
+		{
+			if (vkCreateBuffer(m_vulkanLogicalDevice, &readbackBufCreateInfo, nullptr, &m_readbackBuffers[i]) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create readback buffer");
+			}
+
+			// cached memory makes the CPU reads far cheaper where the device offers it
+			m_readbackBufferAllocations[i] = m_deviceMemoryAllocator.AllocateForBuffer(m_readbackBuffers[i], VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+		}
+		m_readbackFrame.resize(static_cast<size_t>(readbackSize));
+	}
+
+	void ReadBackOffscreenImage(size_t imageIndex)
+	{
+		// only call once the graphics timeline has passed the frame that rendered imageIndex
+		const DeviceAllocation& readbackAllocation = m_readbackBufferAllocations[imageIndex];
+		m_deviceMemoryAllocator.InvalidateAllocation(readbackAllocation);
+		std::memcpy(m_readbackFrame.data(), readbackAllocation.m_mappedData, m_readbackFrame.size());
+		++m_nReadbackFrames;
+	}
+
+	// reads back every pending frame the graphics timeline has reached, oldest first
+	void ReadBackCompletedFrames(uint64_t completedValue)
+	{
+		while (!m_pendingReadbacks.empty() && m_pendingReadbacks.front().m_timelineValue <= completedValue)
+		{
+			ReadBackOffscreenImage(m_pendingReadbacks.front().m_imageIndex);
+			m_pendingReadbacks.pop_front();
+		}
+	}
+
+	void WriteReadbackFrameToFile(const std::string& filePath)
+	{
+		std::ofstream ppmFile(filePath, std::ios::binary);
+		if (!ppmFile.is_open())
+		{
+			throw std::runtime_error("Failed to open " + filePath);
+		}
+		ppmFile << "P6\n" << m_swapChainExtent.width << " " << m_swapChainExtent.height << "\n255\n";
+		const size_t nPixels = m_readbackFrame.size() / 4;
+		for (size_t i = 0; i < nPixels; ++i)
+		{
+			ppmFile.write(reinterpret_cast<const char*>(&m_readbackFrame[i * 4]), 3); // drop alpha
+		}
+	}
+
+	void DestroyOffscreenTargets()
+	{
+		for (size_t i = 0; i < m_readbackBuffers.size(); ++i)
+		{
+			vkDestroyBuffer(m_vulkanLogicalDevice, m_readbackBuffers[i], nullptr);
+			m_deviceMemoryAllocator.Free(m_readbackBufferAllocations[i]);
+		}
+		m_readbackBuffers.clear();
+		m_readbackBufferAllocations.clear();
+
+		for (size_t i = 0; i < m_swapChainImages.size(); ++i)
+		{
+			vkDestroyImage(m_vulkanLogicalDevice, m_swapChainImages[i], nullptr);
+			m_deviceMemoryAllocator.Free(m_offscreenImageAllocations[i]);
+		}
+		m_swapChainImages.clear();
+		m_offscreenImageAllocations.clear();
+	}
+
+	void CreateImageViews()
+	{
+		const size_t nSwapChainImages = m_swapChainImages.size();
+		m_swapChainImageViews.resize(nSwapChainImages);
+		for (size_t i = 0; i < nSwapChainImages; ++i)
+		{
+			VkImageViewCreateInfo imgViewCreateInfo = {};
+			imgViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			imgViewCreateInfo.image = m_swapChainImages[i];
+			imgViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			imgViewCreateInfo.format = m_swapChainImageFormat;
+			imgViewCreateInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+			imgViewCreateInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+			imgViewCreateInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+			imgViewCreateInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+			imgViewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			imgViewCreateInfo.subresourceRange.baseMipLevel = 0;
+			imgViewCreateInfo.subresourceRange.levelCount = 1;
+			imgViewCreateInfo.subresourceRange.baseArrayLayer = 0;
+			imgViewCreateInfo.subresourceRange.layerCount = 1;
+
+			if (vkCreateImageView(m_vulkanLogicalDevice, &imgViewCreateInfo, nullptr, &m_swapChainImageViews[i]) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to create an image view");
+			}
+		}
+	}
+
+	void CreateShaderModules()
+	{
+		m_vertexShaderModule = CreateShaderModule(LoadShader(VertexLayout<SceneVertex>::GetVertexShaderPath()));
+		m_fragmentShaderModule = CreateShaderModule(LoadShader(S_FRAGMENT_SHADER_PATH));
+		if (m_bindlessEnabled)
+		{
+			m_bindlessFragmentShaderModule = CreateShaderModule(LoadShader(S_BINDLESS_FRAGMENT_SHADER_PATH));
+		}
+		if (m_gpuDrivenEnabled)
+		{
+			m_gpuDrivenVertexShaderModule = CreateShaderModule(LoadShader(VertexLayout<SceneVertex>::GetGpuDrivenVertexShaderPath()));
+		}
+		if (m_settings.m_depthPrepass)
+		{
+			m_depthOnlyVertexShaderModule = CreateShaderModule(LoadShader(VertexLayout<SceneVertex>::GetDepthOnlyVertexShaderPath()));
+			if (m_gpuDrivenEnabled)
+			{
+				m_gpuDrivenDepthOnlyVertexShaderModule = CreateShaderModule(LoadShader(VertexLayout<SceneVertex>::GetGpuDrivenDepthOnlyVertexShaderPath()));
+			}
+		}
+	}
+
+	void CreateGraphicsPipeline()
+	{
+		// everything the CPU draws read comes from the frame data ring's set through dynamic offsets, and from the bindless table
+		// when there is one (the materials), both bound once per command buffer whatever's drawn
+		std::vector<VkDescriptorSetLayout> setLayouts = { m_frameDataRing.GetDescriptorSetLayout() };
+		if (m_bindlessEnabled)
+		{
+			setLayouts.push_back(m_bindlessResources.GetDescriptorSetLayout()); // BindlessResourceTable::S_SET
+		}
+		VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+		pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutCreateInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+		pipelineLayoutCreateInfo.pSetLayouts = setLayouts.data();
+		pipelineLayoutCreateInfo.pushConstantRangeCount = 0;
+		pipelineLayoutCreateInfo.pPushConstantRanges = nullptr;
+
+		if (vkCreatePipelineLayout(m_vulkanLogicalDevice, &pipelineLayoutCreateInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create pipeline layout!");
+		}
+
+		m_pipeline = CreatePipeline(m_vertexShaderModule, m_bindlessEnabled ? m_bindlessFragmentShaderModule : m_fragmentShaderModule, m_pipelineLayout, "Default");
+		if (m_depthPrepass != RenderGraph::S_INVALID_ID)
+		{
+			m_depthPrepassPipeline = CreatePipeline(m_depthOnlyVertexShaderModule, nullptr, m_pipelineLayout, "DepthPrepass", true);
+		}
+	}
+
+	void CreateGpuDrivenPipeline()
+	{
+		// same fixed function state, the vertex shader reads the instance buffer rather than push constants
+		m_gpuDrivenPipeline = CreatePipeline(m_gpuDrivenVertexShaderModule, m_fragmentShaderModule, m_gpuDrivenRenderer.GetDrawPipelineLayout(), "GpuDriven");
+		if (m_depthPrepass != RenderGraph::S_INVALID_ID)
+		{
+			m_gpuDrivenDepthPrepassPipeline = CreatePipeline(m_gpuDrivenDepthOnlyVertexShaderModule, nullptr, m_gpuDrivenRenderer.GetDrawPipelineLayout(), "GpuDrivenDepthPrepass", true);
+		}
+	}
+
+	// depthOnly is for the depth pre-pass's subpass, no fragment shader (pass null) or colour and only the position stream
+	VkPipeline CreatePipeline(VkShaderModule vertexShaderModule, VkShaderModule fragmentShaderModule, VkPipelineLayout pipelineLayout, const char* pipelineName, bool depthOnly = false)
+	{
+		VkPipelineShaderStageCreateInfo vertexShaderStageCreateInfo = {};
+		vertexShaderStageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		vertexShaderStageCreateInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+		vertexShaderStageCreateInfo.module = vertexShaderModule;
+		vertexShaderStageCreateInfo.pName = "main";
+
+		VkPipelineShaderStageCreateInfo fragmentShaderStageCreateInfo = {};
+		fragmentShaderStageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		fragmentShaderStageCreateInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+		fragmentShaderStageCreateInfo.module = fragmentShaderModule;
+		fragmentShaderStageCreateInfo.pName = "main";
+
+		VkPipelineShaderStageCreateInfo piplineStagesCreateInfo[] = { vertexShaderStageCreateInfo, fragmentShaderStageCreateInfo };
+
+		VkPipelineVertexInputStateCreateInfo vertexInputStateCreateInfo = {};
+		vertexInputStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+		
+		constexpr VkVertexInputBindingDescription vertBindingDesc = VertexLayout<SceneVertex>::GetBindingDescription();
+		constexpr auto attribDesc = VertexLayout<SceneVertex>::GetAttributeDescriptions();
+		constexpr VkVertexInputBindingDescription positionBindingDesc = VertexLayout<SceneVertex>::GetPositionBindingDescription();
+		constexpr VkVertexInputAttributeDescription positionAttribDesc = VertexLayout<SceneVertex>::GetPositionAttributeDescription();
+
+		vertexInputStateCreateInfo.vertexBindingDescriptionCount = 1;
+		vertexInputStateCreateInfo.vertexAttributeDescriptionCount = depthOnly ? 1 : static_cast<uint32_t>(attribDesc.size());
+		vertexInputStateCreateInfo.pVertexBindingDescriptions = depthOnly ? &positionBindingDesc : &vertBindingDesc;
+		vertexInputStateCreateInfo.pVertexAttributeDescriptions = depthOnly ? &positionAttribDesc : attribDesc.data();
+
+		VkPipelineInputAssemblyStateCreateInfo inputAssemblyStateCreateInfo = {};
+		inputAssemblyStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+		inputAssemblyStateCreateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+		inputAssemblyStateCreateInfo.primitiveRestartEnable = VK_FALSE;
+		
+		// viewport and scissor are dynamic so the pipeline doesn't depend on the swap chain extent, set when recording
+		VkPipelineViewportStateCreateInfo viewportStateCreateInfo = {};
+		viewportStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+		viewportStateCreateInfo.viewportCount = 1;
+		viewportStateCreateInfo.pViewports = nullptr;
+		viewportStateCreateInfo.scissorCount = 1;
+		viewportStateCreateInfo.pScissors = nullptr;
+
+		VkPipelineRasterizationStateCreateInfo rasterisationStateCreateInfo = {};
+		rasterisationStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+		rasterisationStateCreateInfo.depthClampEnable = VK_FALSE;
+		rasterisationStateCreateInfo.rasterizerDiscardEnable = VK_FALSE; // VK_TRUE results on dropping the results before presenting to frame buffer
+		rasterisationStateCreateInfo.polygonMode = VK_POLYGON_MODE_FILL; // as opposed to lines or points
+		rasterisationStateCreateInfo.lineWidth = 1.0f;
+		rasterisationStateCreateInfo.cullMode = VK_CULL_MODE_BACK_BIT;
+		rasterisationStateCreateInfo.frontFace = VK_FRONT_FACE_CLOCKWISE;
+		rasterisationStateCreateInfo.depthBiasEnable = VK_FALSE;
+		rasterisationStateCreateInfo.depthBiasConstantFactor = rasterisationStateCreateInfo.depthBiasClamp = rasterisationStateCreateInfo.depthBiasSlopeFactor = 0.0f;
+
+		VkPipelineMultisampleStateCreateInfo multisampleStateCreateInfo = {};
+		multisampleStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+		multisampleStateCreateInfo.sampleShadingEnable = VK_FALSE;
+		multisampleStateCreateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+		multisampleStateCreateInfo.minSampleShading = 1.0f;
+		multisampleStateCreateInfo.pSampleMask = nullptr;
+		multisampleStateCreateInfo.alphaToCoverageEnable = VK_FALSE;
+		multisampleStateCreateInfo.alphaToOneEnable = VK_FALSE;
+
+		// after a pre-pass the depth buffer already holds the nearest surface, the scene pass only shades fragments that match it and has
+		// nothing to write (the depth only shaders' gl_Position is invariant so the values are identical). Without one it tests and writes
+		// as it goes, the draws are sorted front to back so early-Z still throws away most of what's hidden
+		const bool afterDepthPrepass = !depthOnly && m_depthPrepass != RenderGraph::S_INVALID_ID;
+		VkPipelineDepthStencilStateCreateInfo depthStencilStateCreateInfo = {};
+		depthStencilStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+		depthStencilStateCreateInfo.depthTestEnable = VK_TRUE;
+		depthStencilStateCreateInfo.depthWriteEnable = afterDepthPrepass ? VK_FALSE : VK_TRUE;
+		depthStencilStateCreateInfo.depthCompareOp = afterDepthPrepass ? VK_COMPARE_OP_LESS_OR_EQUAL : VK_COMPARE_OP_LESS;
+		depthStencilStateCreateInfo.depthBoundsTestEnable = VK_FALSE;
+		depthStencilStateCreateInfo.stencilTestEnable = VK_FALSE;
+		depthStencilStateCreateInfo.minDepthBounds = 0.0f;
+		depthStencilStateCreateInfo.maxDepthBounds = 1.0f;
+
+		VkPipelineColorBlendAttachmentState colourBlendAttachmentState = {}; // should be named disabled colour blend attachment state
+		colourBlendAttachmentState.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+		colourBlendAttachmentState.blendEnable = VK_FALSE;
+		colourBlendAttachmentState.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+		colourBlendAttachmentState.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+		colourBlendAttachmentState.colorBlendOp = VK_BLEND_OP_ADD;
+		colourBlendAttachmentState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+		colourBlendAttachmentState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+		colourBlendAttachmentState.alphaBlendOp = VK_BLEND_OP_ADD;
+
+		VkPipelineColorBlendStateCreateInfo colourBlendStateCreateInfo = {};
+		colourBlendStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+		colourBlendStateCreateInfo.logicOpEnable = VK_FALSE;
+		colourBlendStateCreateInfo.logicOp = VK_LOGIC_OP_COPY; // Optional
+		colourBlendStateCreateInfo.attachmentCount = depthOnly ? 0 : 1; // the pre-pass's subpass has no colour attachment
+		colourBlendStateCreateInfo.pAttachments = &colourBlendAttachmentState;
+		// defaults to black no alpha
+		colourBlendStateCreateInfo.blendConstants[0] = 0.0f; // Optional
+		colourBlendStateCreateInfo.blendConstants[1] = 0.0f; // Optional
+		colourBlendStateCreateInfo.blendConstants[2] = 0.0f; // Optional
+		colourBlendStateCreateInfo.blendConstants[3] = 0.0f; // Optional
+
+		VkDynamicState pipelineDynamicStates[] =
+		{
+			VK_DYNAMIC_STATE_VIEWPORT,
+			VK_DYNAMIC_STATE_SCISSOR
+		};
+
+		VkPipelineDynamicStateCreateInfo pipelineDynamicStatesCreateInfo = {};
+		pipelineDynamicStatesCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+		pipelineDynamicStatesCreateInfo.dynamicStateCount = static_cast<uint32_t>(std::size(pipelineDynamicStates));
+		pipelineDynamicStatesCreateInfo.pDynamicStates = pipelineDynamicStates;
+
+		VkGraphicsPipelineCreateInfo pipelineCreateInfo = {};
+		pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		pipelineCreateInfo.stageCount = depthOnly ? 1 : 2;
+		pipelineCreateInfo.pStages = piplineStagesCreateInfo;
+		pipelineCreateInfo.pVertexInputState = &vertexInputStateCreateInfo;
+		pipelineCreateInfo.pInputAssemblyState = &inputAssemblyStateCreateInfo;
+		pipelineCreateInfo.pViewportState = &viewportStateCreateInfo;
+		pipelineCreateInfo.pRasterizationState = &rasterisationStateCreateInfo;
+		pipelineCreateInfo.pMultisampleState = &multisampleStateCreateInfo;
+		pipelineCreateInfo.pDepthStencilState = &depthStencilStateCreateInfo;
+		pipelineCreateInfo.pColorBlendState = &colourBlendStateCreateInfo;
+		pipelineCreateInfo.pDynamicState = &pipelineDynamicStatesCreateInfo;
+		pipelineCreateInfo.layout = pipelineLayout;
+		const RenderGraph::PassId pass = depthOnly ? m_depthPrepass : m_scenePass;
+		pipelineCreateInfo.renderPass = m_renderGraph.GetRenderPass(pass);
+		pipelineCreateInfo.subpass = m_renderGraph.GetSubpass(pass);
+		pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+		pipelineCreateInfo.basePipelineIndex = -1;
+
+		VkPipeline pipeline = nullptr;
+		const auto createStart = std::chrono::high_resolution_clock::now();
+		if (vkCreateGraphicsPipelines(m_vulkanLogicalDevice, m_pipelineCache.GetHandle(), 1, &pipelineCreateInfo, nullptr, &pipeline) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create graphics pipeline.");
+		}
+		m_pipelineCache.RecordPipelineCreation(pipelineName, std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - createStart).count());
+		return pipeline;
+	}
+
+	// declared at startup and again if the render target format changes, the graph only rebuilds its plan when what's declared changes
+	void BuildRenderGraph(VkFormat colourFormat)
+	{
+		// the image's contents from before the frame never matter. Headless images are left however the last pass used them,
+		// ready for the read back copy when there is one
+		m_renderGraph.Reset();
+		const VkImageLayout finalLayout = m_settings.m_headless ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		m_backBuffer = m_renderGraph.ImportImage("BackBuffer", colourFormat, VK_IMAGE_LAYOUT_UNDEFINED, finalLayout);
+		// only needed while the scene's drawn, so the graph owns it, remakes it when the extent changes and uses lazily allocated memory for it where there is some
+		m_depthBuffer = m_renderGraph.CreateTransientImage("Depth", m_depthFormat);
+
+		// the GPU driven draws are a handful of commands, not worth a secondary
+		const VkSubpassContents drawContents = m_gpuDrivenEnabled ? VK_SUBPASS_CONTENTS_INLINE : VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS;
+		m_depthPrepass = RenderGraph::S_INVALID_ID;
+		if (m_settings.m_depthPrepass)
+		{
+			// ends up the subpass before the scene's in the same render pass, so the depth never leaves tile memory on tilers
+			m_depthPrepass = m_renderGraph.AddGraphicsPass("DepthPrepass", [this](const RenderGraphPassContext& context) { RecordDepthPrepass(context); }, drawContents);
+			m_renderGraph.WriteDepth(m_depthPrepass, m_depthBuffer, VK_ATTACHMENT_LOAD_OP_CLEAR);
+		}
+
+		m_scenePass = m_renderGraph.AddGraphicsPass("Scene", [this](const RenderGraphPassContext& context) { RecordScenePass(context); }, drawContents);
+		m_renderGraph.WriteColour(m_scenePass, m_backBuffer, VK_ATTACHMENT_LOAD_OP_CLEAR, { { 0.0f, 0.0f, 0.0f, 1.0f } });
+		if (m_depthPrepass != RenderGraph::S_INVALID_ID)
+		{
+			m_renderGraph.ReadDepth(m_scenePass, m_depthBuffer);
+		}
+		else
+		{
+			m_renderGraph.WriteDepth(m_scenePass, m_depthBuffer, VK_ATTACHMENT_LOAD_OP_CLEAR);
+		}
+
+		if (m_settings.m_headless && m_settings.m_readbackFrames)
+		{
+			const RenderGraph::PassId readbackPass = m_renderGraph.AddTransferPass("Readback", [this](const RenderGraphPassContext& context)
+			{
+				PROFILE_GPU_ZONE(m_profiler, context.m_commandBuffer, "Readback");
+				RecordReadbackCopy(context.m_commandBuffer, m_recordingImageIndex);
+			});
+			m_renderGraph.ReadTransfer(readbackPass, m_backBuffer);
+			m_renderGraph.SetSideEffects(readbackPass); // the read back buffer's outside the graph
+		}
+		m_renderGraph.Compile();
+	}
+
+	static std::vector<uint32_t> ReadShader(const std::string& shaderFilePath)
+	{
+		std::ifstream shaderFile(shaderFilePath, std::ios::binary | std::ios::ate); // opens file in binary mode at end of file
+		if (!shaderFile.is_open())
+		{
+			throw std::runtime_error("Failed to open " + shaderFilePath);
+		}
+		const size_t shaderFileSize = shaderFile.tellg();
+		if (shaderFileSize == 0 || shaderFileSize % sizeof(uint32_t) != 0)
+		{
+			throw std::runtime_error(shaderFilePath + " isn't SPIR-V, it's not a whole number of words");
+		}
+		shaderFile.seekg(0);
+		std::vector<uint32_t> shaderCode(shaderFileSize / sizeof(uint32_t)); // read as words so pCode is properly aligned
+		shaderFile.read(reinterpret_cast<char*>(shaderCode.data()), shaderFileSize);
+		shaderFile.close();
+		return shaderCode;
+	}
+	
+	// from the asset package when it has it, then what was embedded at build time, then from disk.
+	// SPIR-V is small enough that copying it out of the mapping doesn't matter
+	std::vector<uint32_t> LoadShader(const std::string& shaderFilePath)
+	{
+		PackagedBlob shader = {};
+		if (m_assetPackage.IsOpen() && m_assetPackage.FindShader(shaderFilePath, shader))
+		{
+			if (shader.m_size == 0 || shader.m_size % sizeof(uint32_t) != 0)
+			{
+				throw std::runtime_error(shaderFilePath + " in the asset package isn't SPIR-V");
+			}
+			std::vector<uint32_t> shaderCode(static_cast<size_t>(shader.m_size / sizeof(uint32_t)));
+			std::memcpy(shaderCode.data(), shader.m_data, static_cast<size_t>(shader.m_size));
+			return shaderCode;
+		}
+		return LoadBuiltInShader(shaderFilePath);
+	}
+
+	// what was embedded at build time, then from disk. What goes into a written asset package
+	static std::vector<uint32_t> LoadBuiltInShader(const std::string& shaderFilePath)
+	{
+		if (const EmbeddedShader* embeddedShader = FindEmbeddedShader(shaderFilePath))
+		{
+			return std::vector<uint32_t>(embeddedShader->m_code, embeddedShader->m_code + embeddedShader->m_size / sizeof(uint32_t));
+		}
+		return ReadShader(shaderFilePath);
+	}
+
+	VkShaderModule CreateShaderModule(const std::vector<uint32_t>& shaderCode)
+	{
+		VkShaderModuleCreateInfo moduleCreateInfo = {};
+		moduleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		moduleCreateInfo.codeSize = shaderCode.size() * sizeof(uint32_t);
+		moduleCreateInfo.pCode = shaderCode.data();
+		VkShaderModule resultingModule = nullptr;
+		if (vkCreateShaderModule(m_vulkanLogicalDevice, &moduleCreateInfo, nullptr, &resultingModule) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create shader module");
+		}
+		return resultingModule;
+	}
+
+	void CreateCommandPool()
+	{
+		// a pool per frame in flight for the primary command buffers, reset as a whole once the graphics timeline has passed the frame
+		const uint32_t graphicsFamilyIndex = m_graphicsQueueFamilyIndices.m_graphicsFamilyIndex.value();
+		VkCommandPoolCreateInfo cmdPoolCreateInfo = {};
+		cmdPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		cmdPoolCreateInfo.queueFamilyIndex = graphicsFamilyIndex;
+		cmdPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+		m_frameCommandPools.resize(m_nFramesInFlight);
+		for (VkCommandPool& commandPool : m_frameCommandPools)
+		{
+			if (vkCreateCommandPool(m_vulkanLogicalDevice, &cmdPoolCreateInfo, nullptr, &commandPool))
+			{
+				throw std::runtime_error("Failed to create command queue");
+			}
+		}
+
+		// the secondary command buffers get their own pools per recording batch
+		m_commandRecorder.Init(m_vulkanLogicalDevice, m_jobSystem, graphicsFamilyIndex, m_nFramesInFlight);
+		if (m_settings.m_recordingThreadCount > 0)
+		{
+			m_commandRecorder.SetActiveThreadCount(m_settings.m_recordingThreadCount);
+		}
+	}
+
+	// generatedMesh is only used when the mesh isn't streamed or in the package, it's generated in a separate startup task
+	void CreateGeometryBuffers(const IndexedMesh<SceneVertex>& generatedMesh, const MeshProcessingStats& stats)
+	{
+		if (m_settings.m_streamAssets)
+		{
+			StartStreamingSceneMesh();
+			return;
+		}
+
+		PackagedMesh packagedMesh = {};
+		if (m_assetPackage.IsOpen() && m_assetPackage.FindMesh(S_SCENE_MESH_ASSET_NAME, packagedMesh))
+		{
+			// vertices and indices go from the mapping straight into the staging ring, already processed when the package was written
+			const auto loadStart = std::chrono::high_resolution_clock::now();
+			const MeshChunkHeader& meshHeader = *packagedMesh.m_header;
+			if (meshHeader.m_vertexStride != sizeof(SceneVertex))
+			{
+				throw std::runtime_error("The asset package's scene mesh was written with a different vertex format");
+			}
+			InitGeometryBuffers(meshHeader.m_vertexCount, meshHeader.m_indexCount, packagedMesh.GetIndexType());
+			m_sceneMeshHandle = m_geometryBuffers.AddMesh(packagedMesh.m_vertices, meshHeader.m_vertexCount, packagedMesh.m_indices, packagedMesh.GetIndexType(), meshHeader.m_indexCount);
+			std::cout << "Scene mesh: " << meshHeader.m_vertexCount << " vertices, " << meshHeader.m_indexCount << " indices from " << m_settings.m_assetPackagePath << " in "
+				<< std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - loadStart).count() << "ms" << std::endl;
+			return;
+		}
+
+		const IndexedMesh<SceneVertex>& mesh = generatedMesh;
+		const uint32_t nVertices = static_cast<uint32_t>(mesh.m_vertices.size());
+		const uint32_t nIndices = static_cast<uint32_t>(mesh.m_indices.size());
+		const VkIndexType indexType = nVertices <= UINT16_MAX + 1u ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+		PrintMeshProcessingStats(stats, indexType);
+
+		// every mesh shares the mega-buffers, lives in device local memory and gets there via the staging ring
+		InitGeometryBuffers(nVertices, nIndices, indexType);
+		m_sceneMeshHandle = m_geometryBuffers.AddMesh(mesh.m_vertices.data(), nVertices, mesh.m_indices.data(), nIndices);
+
+		if (!m_settings.m_writeAssetPackagePath.empty())
+		{
+			WriteAssetPackage(mesh, indexType);
+		}
+	}
+
+	// a few tints the scene's entities take turns with, DefaultBindless.frag finds them through the bindless table
+	void CreateMaterialBuffer()
+	{
+		const std::array<MaterialData, S_SCENE_MATERIAL_COUNT> materials =
+		{{
+			{ glm::vec4(1.0f, 1.0f, 1.0f, 1.0f) },
+			{ glm::vec4(1.0f, 0.75f, 0.75f, 1.0f) },
+			{ glm::vec4(0.75f, 1.0f, 0.75f, 1.0f) },
+			{ glm::vec4(0.75f, 0.75f, 1.0f, 1.0f) },
+		}};
+
+		VkBufferCreateInfo bufCreateInfo = {};
+		bufCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufCreateInfo.size = sizeof(materials);
+		bufCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		bufCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		if (vkCreateBuffer(m_vulkanLogicalDevice, &bufCreateInfo, nullptr, &m_materialBuffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create the material buffer");
+		}
+		m_materialBufferAllocation = m_deviceMemoryAllocator.AllocateForBuffer(m_materialBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		m_uploadManager.UploadToBuffer(m_materialBuffer, 0, materials.data(), sizeof(materials), VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+		m_materialBufferHandle = m_bindlessResources.AddStorageBuffer(m_materialBuffer);
+	}
+
+	// the triangle, or a grid of them. Generated as a triangle list, deduped and reordered before it goes anywhere near the GPU
+	static IndexedMesh<SceneVertex> GenerateSceneMesh(uint32_t nTriangles, MeshProcessingStats& stats)
+	{
+		std::vector<SceneVertex> vertices;
+		if (nTriangles <= 1)
+		{
+			vertices =
+			{
+				SceneVertex::Create({0.0f, -0.5f}, {1.0f, 1.0f, 1.0f}),
+				SceneVertex::Create({0.5f, 0.5f}, {0.0f, 1.0f, 0.0f}),
+				SceneVertex::Create({-0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}),
+			};
+		}
+		else
+		{
+			CreateTriangleGrid(nTriangles, vertices);
+		}
+		return ProcessMesh(vertices, [](const SceneVertex& vertex) { return vertex.GetPosition(); }, &stats);
+	}
+
+	static void PrintMeshProcessingStats(const MeshProcessingStats& stats, VkIndexType indexType)
+	{
+		std::cout << "Scene mesh: " << stats.m_nInputVertices << " -> " << stats.m_nUniqueVertices << " vertices, ACMR " << stats.m_before.m_acmr << " -> " << stats.m_after.m_acmr
+			<< ", ATVR " << stats.m_before.m_atvr << " -> " << stats.m_after.m_atvr << ", " << (indexType == VK_INDEX_TYPE_UINT16 ? 16 : 32) << " bit indices, processed in "
+			<< stats.m_processMs << "ms, " << sizeof(SceneVertex) << " bytes per vertex" << std::endl;
+	}
+
+	// The scene mesh is read (from the package if there is one) and decoded (checksummed, or generated and processed) in the background
+	// and uploaded a budget's worth a frame. Until then everything draws the triangle, which is small enough to upload here.
+	void StartStreamingSceneMesh()
+	{
+		// sized for the worst case since the real size isn't known until it's decoded, a generated mesh can't be bigger than its triangle list
+		const AssetTocEntry* packagedChunk = m_assetPackage.IsOpen() ? m_assetPackage.FindChunk(S_SCENE_MESH_ASSET_NAME, AssetChunkType::Mesh) : nullptr;
+		MeshChunkHeader streamedHeader = {};
+		if (packagedChunk && m_assetPackage.PeekMeshHeader(S_SCENE_MESH_ASSET_NAME, streamedHeader))
+		{
+			if (streamedHeader.m_vertexStride != sizeof(SceneVertex))
+			{
+				throw std::runtime_error("The asset package's scene mesh was written with a different vertex format");
+			}
+		}
+		else
+		{
+			packagedChunk = nullptr;
+			streamedHeader.m_vertexCount = (std::max)(m_settings.m_trianglesPerDraw, 1u) * 3;
+			streamedHeader.m_indexCount = streamedHeader.m_vertexCount;
+		}
+
+		MeshProcessingStats placeholderStats;
+		const IndexedMesh<SceneVertex> placeholder = GenerateSceneMesh(1, placeholderStats);
+		const uint32_t maxVertices = static_cast<uint32_t>(placeholder.m_vertices.size()) + streamedHeader.m_vertexCount;
+		const uint32_t maxIndices = static_cast<uint32_t>(placeholder.m_indices.size()) + streamedHeader.m_indexCount;
+		const VkIndexType indexType = maxVertices <= UINT16_MAX + 1u ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+		InitGeometryBuffers(maxVertices, maxIndices, indexType);
+		m_sceneMeshHandle = m_geometryBuffers.AddMesh(placeholder.m_vertices.data(), static_cast<uint32_t>(placeholder.m_vertices.size()), placeholder.m_indices.data(),
+			static_cast<uint32_t>(placeholder.m_indices.size()));
+
+		const uint32_t nTriangles = m_settings.m_trianglesPerDraw;
+		const uint32_t indexSize = indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+		const uint32_t nDecodeThreads = (std::max)(std::thread::hardware_concurrency() / 4, 1u);
+		m_assetStreamer.Init(S_STREAMED_ASSET_COUNT, 1, nDecodeThreads, AssetStreamer::S_DEFAULT_UPLOAD_BUDGET_PER_FRAME,
+			[this, packagedChunk](uint32_t, std::vector<uint8_t>& dataOut)
+			{
+				// faulting the pages in is the I/O, done here rather than wherever the mapping's first touched
+				if (packagedChunk)
+				{
+					const PackagedBlob chunk = m_assetPackage.GetUncheckedChunk(*packagedChunk);
+					const uint8_t* chunkBytes = static_cast<const uint8_t*>(chunk.m_data);
+					dataOut.assign(chunkBytes, chunkBytes + chunk.m_size);
+				}
+			},
+			[packagedChunk, nTriangles, indexSize](uint32_t, std::vector<uint8_t>& data)
+			{
+				if (packagedChunk)
+				{
+					PackagedMesh mesh = {};
+					if (!AssetPackage::VerifyChunk(*packagedChunk, data.data(), data.size()) || !AssetPackage::ParseMeshChunk(data.data(), data.size(), mesh))
+					{
+						throw std::runtime_error("the packaged scene mesh is corrupt");
+					}
+					return;
+				}
+				MeshProcessingStats stats;
+				const IndexedMesh<SceneVertex> mesh = GenerateSceneMesh(nTriangles, stats);
+				data = AssetPackageWriter::BuildMeshChunk(mesh.m_vertices.data(), sizeof(SceneVertex), static_cast<uint32_t>(mesh.m_vertices.size()), mesh.m_indices, indexSize);
+				PrintMeshProcessingStats(stats, indexSize == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32);
+			},
+			[this](uint32_t, const std::vector<uint8_t>& data, uint64_t offset, uint64_t maxBytes)
+			{
+				return UploadStreamedMesh(data, offset, maxBytes);
+			});
+		m_assetStreamer.Request(S_SCENE_MESH_ASSET_ID, 1.0f); // the only streamed asset, and every draw uses it
+		std::cout << "Streaming the scene mesh" << (packagedChunk ? " from " + m_settings.m_assetPackagePath : std::string()) << ", drawing the placeholder until it arrives" << std::endl;
+	}
+
+	// whole vertices then whole indices, as many as fit in maxBytes (at least one). Returns the bytes of data that covers
+	uint64_t UploadStreamedMesh(const std::vector<uint8_t>& data, uint64_t offset, uint64_t maxBytes)
+	{
+		PackagedMesh mesh = {};
+		AssetPackage::ParseMeshChunk(data.data(), data.size(), mesh); // checked when it was decoded
+		const MeshChunkHeader& header = *mesh.m_header;
+		if (offset == 0)
+		{
+			m_streamedSceneMeshHandle = m_geometryBuffers.AllocateMesh(header.m_vertexCount, header.m_indexCount);
+		}
+
+		const uint64_t vertexDataEnd = header.m_vertexDataOffset + static_cast<uint64_t>(header.m_vertexCount) * header.m_vertexStride;
+		if (offset < vertexDataEnd)
+		{
+			const uint32_t firstVertex = static_cast<uint32_t>(((std::max)(offset, header.m_vertexDataOffset) - header.m_vertexDataOffset) / header.m_vertexStride);
+			const uint32_t nVertices = static_cast<uint32_t>((std::min)(static_cast<uint64_t>(header.m_vertexCount - firstVertex), (std::max)(maxBytes / header.m_vertexStride, uint64_t(1))));
+			m_geometryBuffers.UploadVertices(m_streamedSceneMeshHandle, firstVertex, static_cast<const uint8_t*>(mesh.m_vertices) + static_cast<uint64_t>(firstVertex) * header.m_vertexStride, nVertices);
+			const uint64_t nextOffset = firstVertex + nVertices == header.m_vertexCount ? header.m_indexDataOffset
+				: header.m_vertexDataOffset + static_cast<uint64_t>(firstVertex + nVertices) * header.m_vertexStride;
+			return nextOffset - offset;
+		}
+
+		const uint32_t firstIndex = static_cast<uint32_t>((offset - header.m_indexDataOffset) / header.m_indexSize);
+		const uint32_t nIndices = static_cast<uint32_t>((std::min)(static_cast<uint64_t>(header.m_indexCount - firstIndex), (std::max)(maxBytes / header.m_indexSize, uint64_t(1))));
+		m_geometryBuffers.UploadIndices(m_streamedSceneMeshHandle, firstIndex, static_cast<const uint8_t*>(mesh.m_indices) + static_cast<uint64_t>(firstIndex) * header.m_indexSize,
+			mesh.GetIndexType(), nIndices);
+		const uint64_t nextOffset = firstIndex + nIndices == header.m_indexCount ? data.size() : header.m_indexDataOffset + static_cast<uint64_t>(firstIndex + nIndices) * header.m_indexSize;
+		return nextOffset - offset;
+	}
+
+	// what to draw for entities using the scene mesh, the placeholder until the streamed one is resident. Safe from Update()
+	uint32_t GetDrawnSceneMesh() const
+	{
+		return m_settings.m_streamAssets && m_assetStreamer.IsResident(S_SCENE_MESH_ASSET_ID) ? m_streamedSceneMeshHandle : m_sceneMeshHandle;
+	}
+
+	void InitGeometryBuffers(uint32_t maxVertices, uint32_t maxIndices, VkIndexType indexType)
+	{
+		m_geometryBuffers.Init(m_vulkanLogicalDevice, m_deviceMemoryAllocator, m_uploadManager, sizeof(SceneVertex), maxVertices, maxIndices, indexType,
+			GeometryBuffers::S_DEFAULT_MAX_MESHES, GetCullQueueFamilies());
+		if (m_settings.m_depthPrepass)
+		{
+			constexpr VertexAttribute positionAttribute = VertexLayout<SceneVertex>::GetPositionAttribute();
+			m_geometryBuffers.InitPositionStream(positionAttribute.m_offset, GetVertexFormatSize(positionAttribute.m_format));
+		}
+	}
+
+	void WriteAssetPackage(const IndexedMesh<SceneVertex>& mesh, VkIndexType indexType) const
+	{
+		AssetPackageWriter packageWriter;
+		packageWriter.AddMesh(S_SCENE_MESH_ASSET_NAME, mesh.m_vertices.data(), sizeof(SceneVertex), static_cast<uint32_t>(mesh.m_vertices.size()), mesh.m_indices,
+			indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t));
+		for (const char* shaderPath : { VertexLayout<SceneVertex>::GetVertexShaderPath(), VertexLayout<SceneVertex>::GetGpuDrivenVertexShaderPath(), VertexLayout<SceneVertex>::GetDepthOnlyVertexShaderPath(),
+			VertexLayout<SceneVertex>::GetGpuDrivenDepthOnlyVertexShaderPath(), S_FRAGMENT_SHADER_PATH, S_BINDLESS_FRAGMENT_SHADER_PATH, S_CULL_SHADER_PATH })
+		{
+			packageWriter.AddShader(shaderPath, LoadBuiltInShader(shaderPath));
+		}
+		packageWriter.Write(m_settings.m_writeAssetPackagePath);
+		std::cout << "Wrote the scene mesh and shaders to " << m_settings.m_writeAssetPackagePath << std::endl;
+	}
+
+	void CreateGpuDrivenRenderer()
+	{
+		VkPhysicalDeviceProperties deviceProperties = {};
+		vkGetPhysicalDeviceProperties(m_vulkanPhysicalDevice, &deviceProperties);
+		m_gpuDrivenRenderer.Init(m_vulkanLogicalDevice, m_deviceMemoryAllocator, m_pipelineCache, m_geometryBuffers, LoadShader(S_CULL_SHADER_PATH),
+			static_cast<uint32_t>(m_nFramesInFlight), GetSceneDrawCount(), deviceProperties.limits.maxDrawIndirectCount, m_drawIndexedIndirectCount,
+			GetCullQueueFamilies());
+		std::cout << "GPU driven rendering, culled by a compute pass" << (m_asyncComputeEnabled ? " on the compute queue" : "") << " and drawn with "
+			<< (m_gpuDrivenRenderer.UsesDrawIndirectCount() ? "vkCmdDrawIndexedIndirectCount" : "vkCmdDrawIndexedIndirect") << std::endl;
+	}
+
+	// the queue families the cull's buffers are used on, empty when it's all on the graphics queue and they can stay EXCLUSIVE
+	std::vector<uint32_t> GetCullQueueFamilies() const
+	{
+		if (!m_asyncComputeEnabled)
+		{
+			return {};
+		}
+		return { m_graphicsQueue.GetFamilyIndex(), m_computeQueue.GetFamilyIndex() };
+	}
+
+	static void CreateTriangleGrid(uint32_t nTriangles, std::vector<SceneVertex>& vertices)
+	{
+		// two triangles per cell over the same square the triangle sits in, the last cell may only get one
+		const uint32_t nCells = (nTriangles + 1) / 2;
+		const uint32_t nCellsPerSide = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(nCells))));
+		vertices.clear();
+		vertices.reserve(static_cast<size_t>(nTriangles) * 3);
+		// corners come from grid coordinates and colour from position, so neighbouring cells' shared corners are bitwise identical and dedupe
+		const auto corner = [nCellsPerSide](uint32_t x, uint32_t y)
+		{
+			const float u = static_cast<float>(x) / nCellsPerSide;
+			const float v = static_cast<float>(y) / nCellsPerSide;
+			return SceneVertex::Create({ u - 0.5f, v - 0.5f }, { u, v, 1.0f - u });
+		};
+		for (uint32_t cell = 0; cell < nCells; ++cell)
+		{
+			const uint32_t x = cell % nCellsPerSide;
+			const uint32_t y = cell / nCellsPerSide;
+			vertices.push_back(corner(x, y));
+			vertices.push_back(corner(x + 1, y));
+			vertices.push_back(corner(x, y + 1));
+			if (cell * 2 + 1 < nTriangles)
+			{
+				vertices.push_back(corner(x + 1, y));
+				vertices.push_back(corner(x + 1, y + 1));
+				vertices.push_back(corner(x, y + 1));
+			}
+		}
+	}
+
+	void CreateCommandBuffers()
+	{
+		// one per frame in flight rather than one per swap chain image, recorded each frame against whichever image was acquired
+		// so nothing recorded refers to the swap chain and a resize doesn't have to touch them
+		m_commandBuffers.resize(m_nFramesInFlight);
+
+		VkCommandBufferAllocateInfo cmdBuffersAllocInfo = {};
+		cmdBuffersAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		cmdBuffersAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		cmdBuffersAllocInfo.commandBufferCount = 1;
+
+		for (size_t i = 0; i < m_commandBuffers.size(); ++i)
+		{
+			cmdBuffersAllocInfo.commandPool = m_frameCommandPools[i];
+			if (vkAllocateCommandBuffers(m_vulkanLogicalDevice, &cmdBuffersAllocInfo, &m_commandBuffers[i]))
+			{
+				throw std::runtime_error("Failed to allocate Vulkan Command buffers");
+			}
+		}
+	}
+
+	void CreateScene()
+	{
+		// lays the draws out in a grid over the world, a single draw covers it like the original triangle did. the world is
+		// m_sceneWorldSize screens across so anything bigger than 1 leaves most of the scene off screen. Each draw is m_drawScale
+		// of its cell across and has its own depth, so where they overlap one's in front. The depths are scattered rather than
+		// following the grid so the order the draws were made in isn't already front to back
+		const uint32_t nDraws = GetSceneDrawCount();
+		const uint32_t nColumns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(nDraws))));
+		const uint32_t nRows = (nDraws + nColumns - 1) / nColumns;
+		const float worldExtent = GetSceneWorldExtent();
+		const float cellWidth = 2.0f * worldExtent / nColumns;
+		const float cellHeight = 2.0f * worldExtent / nRows;
+		const float drawScale = (std::max)(m_settings.m_drawScale, 0.0f);
+
+		constexpr ComponentMask drawableMask = MakeComponentMask<PositionComponent, RotationComponent, ScaleComponent, VelocityComponent, MeshComponent, MaterialComponent>();
+		m_sceneEntities.Reserve(drawableMask, nDraws);
+		for (uint32_t i = 0; i < nDraws; ++i)
+		{
+			const uint32_t column = i % nColumns;
+			const uint32_t row = i / nColumns;
+			const Entity entity = m_sceneEntities.CreateEntity(drawableMask);
+			const float depth = 0.01f + 0.98f * static_cast<float>(std::fmod(i * 0.6180339887, 1.0));
+			m_sceneEntities.GetComponent<PositionComponent>(entity)->m_position = glm::vec3(-worldExtent + cellWidth * (column + 0.5f), -worldExtent + cellHeight * (row + 0.5f), depth);
+			m_sceneEntities.GetComponent<ScaleComponent>(entity)->m_scale = glm::vec3(cellWidth * drawScale, cellHeight * drawScale, 1.0f);
+			m_sceneEntities.GetComponent<MeshComponent>(entity)->m_meshHandle = m_sceneMeshHandle;
+			m_sceneEntities.GetComponent<MaterialComponent>(entity)->m_materialHandle = i % S_SCENE_MATERIAL_COUNT;
+			if (m_settings.m_animateScene)
+			{
+				// fixed per entity so runs are repeatable
+				const float angle = static_cast<float>(i) * 2.39996f;
+				m_sceneEntities.GetComponent<VelocityComponent>(entity)->m_velocity = glm::vec3(std::cos(angle), std::sin(angle), 0.0f) * 0.25f;
+			}
+		}
+
+		std::cout << "Scene of " << nDraws << " draws over " << GetSceneWorldExtent() << "x" << GetSceneWorldExtent() << " screens, frustum culling with "
+			<< (m_gpuDrivenEnabled ? "a compute pass" : FrustumCuller::GetInstructionSetName(m_frustumCuller.GetInstructionSet())) << std::endl;
+
+		// nothing has moved yet, both copies of the draw state start out the same
+		Update(0.0f, m_drawStates[0]);
+		m_drawStates[1] = m_drawStates[0];
+		m_currentDrawState = 0;
+	}
+
+	void RecordFrameCommandBuffer(size_t frameSlot, uint32_t imageIndex)
+	{
+		// the slot has been waited on so everything recorded for it last time round can go
+		vkResetCommandPool(m_vulkanLogicalDevice, m_frameCommandPools[frameSlot], 0);
+		m_commandRecorder.BeginFrame(frameSlot);
+		const FrameDrawState& drawState = m_drawStates[m_currentDrawState];
+		if (m_gpuDrivenEnabled)
+		{
+			m_gpuDrivenRenderer.WriteInstances(frameSlot, drawState.m_gpuInstances);
+		}
+		else
+		{
+			// before the recording threads start, they all bind it
+			const FrameDataAllocation frameConstants = m_frameDataRing.AllocateUniform(sizeof(FrameConstants));
+			static_cast<FrameConstants*>(frameConstants.m_data)->m_cameraPosition = glm::vec4(drawState.m_cameraPosition.x, drawState.m_cameraPosition.y, 0.0f, 0.0f);
+			m_frameConstantsOffset = frameConstants.m_dynamicOffset;
+		}
+
+		VkCommandBuffer commandBuffer = m_commandBuffers[frameSlot];
+		VkCommandBufferBeginInfo cmdBuffBeginInfo = {};
+		cmdBuffBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		cmdBuffBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		if (vkBeginCommandBuffer(commandBuffer, &cmdBuffBeginInfo) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed the start recording a command buffer!");
+		}
+		m_profiler.ResetQueries(commandBuffer);
+
+		const uint32_t nGpuInstances = static_cast<uint32_t>(drawState.m_gpuInstances.size());
+		if (m_asyncComputeEnabled)
+		{
+			// the vertex shader reads the instances the cull was handed too, but they're host written so only the indirect args need waiting for
+			ScheduleAsyncCompute([this, frameSlot, &drawState, nGpuInstances](VkCommandBuffer computeCommandBuffer)
+			{
+				m_gpuDrivenRenderer.RecordCull(computeCommandBuffer, frameSlot, drawState.m_frustum, nGpuInstances);
+			}, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT);
+		}
+		else if (m_gpuDrivenEnabled)
+		{
+			PROFILE_GPU_ZONE(m_profiler, commandBuffer, "CullCompute");
+			m_gpuDrivenRenderer.RecordCull(commandBuffer, frameSlot, drawState.m_frustum, nGpuInstances);
+		}
+
+		{
+			// timestamps can't be written in the primary inside a render pass whose contents are secondaries, so this zone wraps the whole graph
+			PROFILE_GPU_ZONE(m_profiler, commandBuffer, "RenderGraph");
+			m_recordingFrameSlot = frameSlot;
+			m_recordingImageIndex = imageIndex;
+			m_renderGraph.SetExtent(m_swapChainExtent);
+			m_renderGraph.SetImportedImage(m_backBuffer, m_swapChainImages[imageIndex], m_swapChainImageViews[imageIndex]);
+			m_renderGraph.Execute(commandBuffer);
+		}
+
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to finish recording commands to buffer");
+		}
+	}
+
+	// records work for the compute queue and submits it straight away, ordered after everything uploaded so far. The next frame submit
+	// on the graphics queue waits for it at consumerStages, so graphics work already queued runs alongside it
+	void ScheduleAsyncCompute(const std::function<void(VkCommandBuffer)>& record, VkPipelineStageFlags consumerStages)
+	{
+		PROFILE_CPU_ZONE(m_profiler, "AsyncCompute");
+		VkCommandBuffer commandBuffer = m_computeQueue.BeginCommandBuffer();
+		record(commandBuffer);
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to finish recording compute commands");
+		}
+
+		// only holds the compute queue up on frames that uploaded something, otherwise the value's long since been reached
+		std::vector<GpuQueueWait> waits;
+		const uint64_t uploadValue = m_uploadManager.GetLastGraphicsSubmitValue();
+		if (uploadValue != 0)
+		{
+			waits.push_back(m_graphicsQueue.MakeWait(uploadValue, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
+		}
+		const uint64_t computeValue = m_computeQueue.Submit({ commandBuffer }, waits);
+		m_pendingGraphicsWaits.push_back(m_computeQueue.MakeWait(computeValue, consumerStages));
+	}
+
+	// the render graph's already begun the render pass, inline for the GPU driven draws and for secondaries otherwise
+	void RecordScenePass(const RenderGraphPassContext& context)
+	{
+		RecordScenePassDraws(context, false);
+	}
+
+	// the same draws in the same order, positions only
+	void RecordDepthPrepass(const RenderGraphPassContext& context)
+	{
+		RecordScenePassDraws(context, true);
+	}
+
+	void RecordScenePassDraws(const RenderGraphPassContext& context, bool depthOnly)
+	{
+		if (m_gpuDrivenEnabled)
+		{
+			const FrameDrawState& drawState = m_drawStates[m_currentDrawState];
+			vkCmdBindPipeline(context.m_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthOnly ? m_gpuDrivenDepthPrepassPipeline : m_gpuDrivenPipeline);
+			SetViewportAndScissor(context.m_commandBuffer);
+			m_gpuDrivenRenderer.RecordDraws(context.m_commandBuffer, m_recordingFrameSlot, static_cast<uint32_t>(drawState.m_gpuInstances.size()), drawState.m_cameraPosition, depthOnly);
+			return;
+		}
+
+		VkCommandBufferInheritanceInfo inheritanceInfo = {};
+		inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritanceInfo.renderPass = context.m_renderPass;
+		inheritanceInfo.subpass = context.m_subpass;
+		inheritanceInfo.framebuffer = context.m_framebuffer;
+
+		const std::vector<VkCommandBuffer>& secondaryCommandBuffers = m_commandRecorder.Record(inheritanceInfo, m_drawStates[m_currentDrawState].m_drawItems.size(),
+			[this, depthOnly](VkCommandBuffer secondaryCommandBuffer, size_t begin, size_t end) { RecordDraws(secondaryCommandBuffer, begin, end, depthOnly); });
+		vkCmdExecuteCommands(context.m_commandBuffer, static_cast<uint32_t>(secondaryCommandBuffers.size()), secondaryCommandBuffers.data());
+	}
+
+	void RecordDraws(VkCommandBuffer commandBuffer, size_t firstDrawItem, size_t endDrawItem, bool depthOnly)
+	{
+		// runs on the recording threads, nothing is inherited from the primary so each secondary sets up its own state
+		PROFILE_CPU_ZONE(m_profiler, "RecordDraws");
+		PROFILE_GPU_ZONE(m_profiler, commandBuffer, depthOnly ? "DepthBatch" : "DrawBatch");
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthOnly ? m_depthPrepassPipeline : m_pipeline);
+		SetViewportAndScissor(commandBuffer);
+		if (depthOnly)
+		{
+			m_geometryBuffers.BindPositions(commandBuffer);
+		}
+		else
+		{
+			m_geometryBuffers.Bind(commandBuffer);
+			if (m_bindlessEnabled)
+			{
+				// only the scene pass has a fragment shader to read the materials
+				const VkDescriptorSet bindlessSet = m_bindlessResources.GetDescriptorSet();
+				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, BindlessResourceTable::S_SET, 1, &bindlessSet, 0, nullptr);
+			}
+		}
+
+		// the draws' constants are copied into the ring as a block and each draw's firstInstance indexes into it, one bind per block
+		const FrameDrawState& drawState = m_drawStates[m_currentDrawState];
+		const VkDescriptorSet frameDataSet = m_frameDataRing.GetDescriptorSet();
+		for (size_t blockBegin = firstDrawItem; blockBegin < endDrawItem; blockBegin += S_MAX_DRAWS_PER_FRAME_DATA_BIND)
+		{
+			const size_t blockEnd = (std::min)(blockBegin + S_MAX_DRAWS_PER_FRAME_DATA_BIND, endDrawItem);
+			const FrameDataAllocation drawConstants = m_frameDataRing.AllocateStorage((blockEnd - blockBegin) * sizeof(DrawConstants));
+			std::memcpy(drawConstants.m_data, &drawState.m_drawItems[blockBegin], (blockEnd - blockBegin) * sizeof(DrawConstants));
+			const std::array<uint32_t, FrameDataRing::S_BINDING_COUNT> dynamicOffsets = { m_frameConstantsOffset, drawConstants.m_dynamicOffset }; // in binding order
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &frameDataSet, static_cast<uint32_t>(dynamicOffsets.size()), dynamicOffsets.data());
+			for (size_t i = blockBegin; i < blockEnd; ++i)
+			{
+				const MeshInfo& mesh = m_geometryBuffers.GetMesh(drawState.m_drawItemMeshes[i]);
+				vkCmdDrawIndexed(commandBuffer, mesh.m_indexCount, 1, mesh.m_firstIndex, mesh.m_vertexOffset, static_cast<uint32_t>(i - blockBegin));
+			}
+		}
+	}
+
+	void SetViewportAndScissor(VkCommandBuffer commandBuffer)
+	{
+		VkViewport viewport = {};
+		viewport.x = 0.0f;
+		viewport.y = 0.0f;
+		viewport.width = static_cast<float>(m_swapChainExtent.width);
+		viewport.height = static_cast<float>(m_swapChainExtent.height);
+		viewport.minDepth = 0.0f;
+		viewport.maxDepth = 1.0f;
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+		VkRect2D scissorRect = {};
+		scissorRect.offset = { 0, 0 };
+		scissorRect.extent = m_swapChainExtent;
+		vkCmdSetScissor(commandBuffer, 0, 1, &scissorRect);
+	}
+
+	void RecordReadbackCopy(VkCommandBuffer commandBuffer, size_t imageIndex)
+	{
+		// the render graph has already moved the image to TRANSFER_SRC_OPTIMAL
+		VkBufferImageCopy copyRegion = {};
+		copyRegion.bufferOffset = 0;
+		copyRegion.bufferRowLength = 0; // tightly packed
+		copyRegion.bufferImageHeight = 0;
+		copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		copyRegion.imageSubresource.mipLevel = 0;
+		copyRegion.imageSubresource.baseArrayLayer = 0;
+		copyRegion.imageSubresource.layerCount = 1;
+		copyRegion.imageOffset = { 0, 0, 0 };
+		copyRegion.imageExtent = { m_swapChainExtent.width, m_swapChainExtent.height, 1 };
+		vkCmdCopyImageToBuffer(commandBuffer, m_swapChainImages[imageIndex], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_readbackBuffers[imageIndex], 1, &copyRegion);
+
+		VkBufferMemoryBarrier hostReadBarrier = {};
+		hostReadBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		hostReadBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		hostReadBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		hostReadBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		hostReadBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		hostReadBarrier.buffer = m_readbackBuffers[imageIndex];
+		hostReadBarrier.offset = 0;
+		hostReadBarrier.size = VK_WHOLE_SIZE;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &hostReadBarrier, 0, nullptr);
+	}
+
+	void CreateVulkanSyncObjects()
+	{
+		// the swap chain only takes binary semaphores, everything else waits on the queues' timelines
+		VkSemaphoreCreateInfo semaphoneCreateInfo = {};
+		semaphoneCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+		m_imageAvailableSemaphones.resize(m_nFramesInFlight);
+		m_renderFinishedSemaphores.resize(m_nFramesInFlight);
+		for (size_t i = 0; i < m_nFramesInFlight; ++i)
+		{
+			if (vkCreateSemaphore(m_vulkanLogicalDevice, &semaphoneCreateInfo, nullptr, &m_imageAvailableSemaphones[i]) != VK_SUCCESS 
+				|| vkCreateSemaphore(m_vulkanLogicalDevice, &semaphoneCreateInfo, nullptr, &m_renderFinishedSemaphores[i]) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to Create vulkan sync objects.");
+			}
+		}
+		m_frameSlotTimelineValues.assign(m_nFramesInFlight, 0); // 0 is where the timeline starts, so a fresh slot never waits
+	}
+
+	void MainLoop()
+	{
+		if (m_settings.m_headless)
+		{
+			HeadlessMainLoop();
+			return;
+		}
+		std::chrono::steady_clock::time_point lastFrameStart = std::chrono::steady_clock::now();
+		while (!glfwWindowShouldClose(m_window))
+		{
+			m_framePacer.WaitForFrameStart(); // before the input's polled, so the frame's built from the newest input it can be
+			glfwPollEvents();
+			const std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+			RunFrame(std::chrono::duration<float>(frameStart - lastFrameStart).count());
+			lastFrameStart = frameStart;
+		}
+		vkDeviceWaitIdle(m_vulkanLogicalDevice);
+		m_framePacer.PrintStats(std::cout);
+	}
+
+public:
+	void RunFrame(const float deltaSeconds)
+	{
+		// the next frame's Update() runs on the job system while this frame is recorded, submitted and presented from the
+		// state the last Update() produced, so simulating frame N+1 overlaps the CPU side of frame N (and the GPU's frames in flight)
+		const size_t nextDrawState = (m_currentDrawState + 1) % m_drawStates.size();
+		m_framePacer.BeginFrame();
+		JobCounter updateCounter;
+		m_jobSystem.Run([this, deltaSeconds, nextDrawState]() { Update(deltaSeconds, m_drawStates[nextDrawState]); }, &updateCounter);
+
+		std::exception_ptr drawException = nullptr;
+		try
+		{
+			if (m_settings.m_headless)
+			{
+				DrawHeadless();
+			}
+			else
+			{
+				Draw();
+			}
+		}
+		catch (...)
+		{
+			drawException = std::current_exception(); // Update() is still writing into scene state we own
+		}
+		m_jobSystem.Wait(updateCounter);
+		if (drawException)
+		{
+			std::rethrow_exception(drawException);
+		}
+		m_currentDrawState = nextDrawState;
+		m_framePacer.EndFrame();
+
+		if (m_timeToFirstFrameMs == 0.0 && m_nFrameSubmits > 0)
+		{
+			// submitted rather than on screen, but that's the part we control
+			m_timeToFirstFrameMs = static_cast<double>(Profiler::NowNs() - m_initStartNs) / 1000000.0;
+			std::cout << "First frame submitted " << m_timeToFirstFrameMs << "ms after Init() started (Init() took " << m_initMs << "ms)" << std::endl;
+		}
+	}
+
+private:
+	void HeadlessMainLoop()
+	{
+		if (m_settings.m_recordingThreadSweep)
+		{
+			// same run once per thread count so the record times can be compared directly
+			std::vector<uint32_t> threadCounts;
+			for (uint32_t nThreads = 1; nThreads < m_commandRecorder.GetMaxThreadCount(); nThreads *= 2)
+			{
+				threadCounts.push_back(nThreads);
+			}
+			threadCounts.push_back(m_commandRecorder.GetMaxThreadCount());
+			for (uint32_t nThreads : threadCounts)
+			{
+				m_commandRecorder.SetActiveThreadCount(nThreads);
+				RunHeadlessFrames();
+			}
+		}
+		else
+		{
+			RunHeadlessFrames();
+		}
+
+		if (m_settings.m_readbackFrames && !m_settings.m_readbackOutputPath.empty() && m_nReadbackFrames > 0)
+		{
+			WriteReadbackFrameToFile(m_settings.m_readbackOutputPath);
+		}
+	}
+
+	void RunHeadlessFrames()
+	{
+		// runs a fixed number of frames and reports throughput, the CPU time is process wide so includes any driver threads (e.g. lavapipe's)
+		const std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+		const std::clock_t cpuStart = std::clock();
+		double totalRecordMs = 0.0;
+		for (uint64_t i = 0; i < m_settings.m_headlessFrameCount; ++i)
+		{
+			RunFrame(S_HEADLESS_FRAME_DELTA_SECONDS); // fixed step so runs are repeatable
+			totalRecordMs += m_commandRecorder.GetFrameRecordMs();
+		}
+		vkDeviceWaitIdle(m_vulkanLogicalDevice);
+		// the last frames submitted haven't been read back yet, the device is idle so it's safe to now
+		ReadBackCompletedFrames(m_graphicsQueue.GetLastSubmittedValue());
+		const std::clock_t cpuEnd = std::clock();
+		const std::chrono::steady_clock::time_point wallEnd = std::chrono::steady_clock::now();
+
+		const double wallSeconds = std::chrono::duration<double>(wallEnd - wallStart).count();
+		const double cpuSeconds = static_cast<double>(cpuEnd - cpuStart) / CLOCKS_PER_SEC;
+		const double nFrames = static_cast<double>(m_settings.m_headlessFrameCount);
+		std::cout << "Headless run: " << m_settings.m_headlessFrameCount << " frames of " << m_sceneEntities.GetEntityCount() << " draws in " << wallSeconds << "s, "
+			<< (wallSeconds > 0.0 ? nFrames / wallSeconds : 0.0) << " frames/s, "
+			<< (nFrames > 0.0 ? (cpuSeconds * 1000.0) / nFrames : 0.0) << "ms CPU per frame, "
+			<< (nFrames > 0.0 ? totalRecordMs / nFrames : 0.0) << "ms recording per frame on " << m_commandRecorder.GetActiveThreadCount() << " threads";
+		if (m_settings.m_readbackFrames)
+		{
+			std::cout << ", " << m_nReadbackFrames << " frames read back";
+		}
+		std::cout << std::endl;
+		m_framePacer.PrintStats(std::cout);
+	}
+
+	void Update(const float deltaSeconds, FrameDrawState& drawState)
+	{
+		// runs as a job alongside the previous frame's Draw(), so only touches the entities and the draw state it's been handed
+		PROFILE_CPU_ZONE(m_profiler, "Update");
+		m_sceneTimeSeconds += deltaSeconds;
+		const float worldExtent = GetSceneWorldExtent();
+		const size_t nInstances = m_sceneEntities.CountEntitiesWith<PositionComponent, ScaleComponent, VelocityComponent, MeshComponent, MaterialComponent>();
+		m_cullingBounds.Resize(nInstances);
+		m_instanceMeshHandles.resize(nInstances);
+		m_instanceMaterials.resize(nInstances);
+		if (m_depthRank.size() != nInstances)
+		{
+			// sorted at the end of this Update()
+			m_depthOrder.resize(nInstances);
+			m_depthRank.resize(nInstances);
+			std::iota(m_depthOrder.begin(), m_depthOrder.end(), 0u);
+			std::iota(m_depthRank.begin(), m_depthRank.end(), 0u);
+		}
+		const uint32_t drawnSceneMesh = GetDrawnSceneMesh();
+		m_sceneEntities.ParallelForEachChunk<PositionComponent, ScaleComponent, VelocityComponent, MeshComponent, MaterialComponent>(m_jobSystem,
+			[this, deltaSeconds, worldExtent, drawnSceneMesh](size_t firstEntity, size_t nEntities, PositionComponent* positions, const ScaleComponent* scales, VelocityComponent* velocities,
+				const MeshComponent* meshes, const MaterialComponent* materials)
+		{
+			for (size_t i = 0; i < nEntities; ++i)
+			{
+				// moves in a straight line and bounces off the edges of the world
+				glm::vec3& position = positions[i].m_position;
+				glm::vec3& velocity = velocities[i].m_velocity;
+				const glm::vec3& scale = scales[i].m_scale;
+				position += velocity * deltaSeconds;
+				if (std::abs(position.x) > worldExtent - scale.x && position.x * velocity.x > 0.0f)
+				{
+					velocity.x = -velocity.x;
+				}
+				if (std::abs(position.y) > worldExtent - scale.y && position.y * velocity.y > 0.0f)
+				{
+					velocity.y = -velocity.y;
+				}
+				const uint32_t slot = m_depthRank[firstEntity + i];
+				m_cullingBounds.Set(slot, position, scale * 0.5f); // the mesh spans -0.5 to 0.5 before scaling
+				m_instanceMeshHandles[slot] = meshes[i].m_meshHandle == m_sceneMeshHandle ? drawnSceneMesh : meshes[i].m_meshHandle;
+				m_instanceMaterials[slot] = materials[i].m_materialHandle;
+			}
+		});
+		UpdateDepthOrder();
+
+		// the camera sweeps over the world when it's bigger than the screen
+		const float cameraRange = m_settings.m_animateScene ? worldExtent - 1.0f : 0.0f;
+		const float sceneTime = static_cast<float>(m_sceneTimeSeconds);
+		const glm::vec2 cameraPosition(cameraRange * std::sin(sceneTime * 0.2f), cameraRange * std::sin(sceneTime * 0.13f));
+		glm::mat4 viewProjection(1.0f); // orthographic, one world unit per half screen
+		viewProjection[3] = glm::vec4(-cameraPosition.x, -cameraPosition.y, 0.0f, 1.0f);
+		drawState.m_frustum = Frustum::FromViewProjection(viewProjection);
+		drawState.m_cameraPosition = cameraPosition;
+
+		if (m_gpuDrivenEnabled)
+		{
+			// the compute pass culls, everything goes over front to back. Uncompacted draws keep that order, compacted ones
+			// are appended in whatever order the cull's invocations get there but that's still roughly front to back
+			drawState.m_gpuInstances.resize(nInstances);
+			m_jobSystem.ParallelFor(nInstances, S_MIN_DRAW_ITEM_BATCH_SIZE, [this, &drawState](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+				{
+					GpuInstanceData& instance = drawState.m_gpuInstances[i];
+					instance.m_boundsCentreAndRadius = glm::vec4(m_cullingBounds.m_centreX[i], m_cullingBounds.m_centreY[i], m_cullingBounds.m_centreZ[i], m_cullingBounds.m_radius[i]);
+					instance.m_boundsExtents = glm::vec3(m_cullingBounds.m_extentX[i], m_cullingBounds.m_extentY[i], m_cullingBounds.m_extentZ[i]);
+					instance.m_meshHandle = m_instanceMeshHandles[i];
+				}
+			});
+			return;
+		}
+
+		const std::vector<uint32_t>* visibleIndices = nullptr;
+		{
+			PROFILE_CPU_ZONE(m_profiler, "Cull");
+			visibleIndices = &m_frustumCuller.Cull(m_jobSystem, drawState.m_frustum, m_cullingBounds);
+		}
+		// in the bounds' order, so front to back
+		drawState.m_drawItems.resize(visibleIndices->size());
+		drawState.m_drawItemMeshes.resize(visibleIndices->size());
+		m_jobSystem.ParallelFor(visibleIndices->size(), S_MIN_DRAW_ITEM_BATCH_SIZE, [this, visibleIndices, &drawState](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				const uint32_t instance = (*visibleIndices)[i];
+				drawState.m_drawItems[i].m_positionAndScale = glm::vec4(m_cullingBounds.m_centreX[instance], m_cullingBounds.m_centreY[instance],
+					m_cullingBounds.m_extentX[instance] * 2.0f, m_cullingBounds.m_extentY[instance] * 2.0f);
+				drawState.m_drawItems[i].m_depth = m_cullingBounds.m_centreZ[instance];
+				drawState.m_drawItems[i].m_materialBuffer = m_materialBufferHandle;
+				drawState.m_drawItems[i].m_material = m_instanceMaterials[instance];
+				drawState.m_drawItemMeshes[i] = m_instanceMeshHandles[instance];
+			}
+		});
+	}
+
+	// opaque draws go front to back so early-Z rejects what's behind them, so the culling bounds are kept in depth order and the draws
+	// come out of culling in it. Depths only change when something moves in z, so mostly this just checks they're still in order.
+	// When they aren't the order's sorted again and the bounds moved to their new slots
+	void UpdateDepthOrder()
+	{
+		const std::vector<float>& slotDepths = m_cullingBounds.m_centreZ;
+		if (std::is_sorted(slotDepths.begin(), slotDepths.end()))
+		{
+			return;
+		}
+
+		PROFILE_CPU_ZONE(m_profiler, "DepthSort");
+		std::stable_sort(m_depthOrder.begin(), m_depthOrder.end(), [this, &slotDepths](uint32_t a, uint32_t b) { return slotDepths[m_depthRank[a]] < slotDepths[m_depthRank[b]]; });
+		CullingBounds sortedBounds;
+		sortedBounds.Resize(m_depthOrder.size());
+		std::vector<uint32_t> sortedMeshHandles(m_depthOrder.size());
+		std::vector<uint32_t> sortedMaterials(m_depthOrder.size());
+		for (uint32_t slot = 0; slot < m_depthOrder.size(); ++slot)
+		{
+			const uint32_t entity = m_depthOrder[slot];
+			sortedBounds.Copy(slot, m_cullingBounds, m_depthRank[entity]);
+			sortedMeshHandles[slot] = m_instanceMeshHandles[m_depthRank[entity]];
+			sortedMaterials[slot] = m_instanceMaterials[m_depthRank[entity]];
+			m_depthRank[entity] = slot;
+		}
+		m_cullingBounds = std::move(sortedBounds);
+		m_instanceMeshHandles = std::move(sortedMeshHandles);
+		m_instanceMaterials = std::move(sortedMaterials);
+	}
+
+	uint32_t GetSceneDrawCount() const
+	{
+		return (std::max)(m_settings.m_drawCount, 1u);
+	}
+
+	float GetSceneWorldExtent() const
+	{
+		return (std::max)(m_settings.m_sceneWorldSize, 1.0f);
+	}
+
+	void Draw()
+	{
+		const uint64_t completedValue = WaitForFrameSlot();
+		m_deferredDestructionQueue.OnFrameCompleted(completedValue);
+		m_frameDataRing.BeginFrame(m_currentFrameSyncObjectIndex, completedValue);
+		m_profiler.BeginFrame(m_currentFrameSyncObjectIndex);
+
+		// anything uploaded since the last frame goes out in one batch ahead of this frame's submit
+		if (m_settings.m_streamAssets)
+		{
+			PROFILE_CPU_ZONE(m_profiler, "StreamingUploads");
+			m_assetStreamer.ProcessUploads();
+		}
+		m_uploadManager.Flush();
+
+		// get next image index from swap chain
+		uint32_t imageIndex = 0; // not to be confused with m_currentFrameSemaphoreIndex
+		VkResult acquireNextImgRes = VK_SUCCESS;
+		{
+			PROFILE_CPU_ZONE(m_profiler, "Acquire");
+			const uint64_t acquireStartNs = Profiler::NowNs();
+			acquireNextImgRes = vkAcquireNextImageKHR(m_vulkanLogicalDevice, m_swapChain, m_getImageTimeOutNanoSeconds, m_imageAvailableSemaphones[m_currentFrameSyncObjectIndex], VK_NULL_HANDLE, &imageIndex);
+			m_framePacer.AddCpuWait(Profiler::NowNs() - acquireStartNs);
+			m_framePacer.OnAcquired();
+		}
+		if (acquireNextImgRes == VK_ERROR_OUT_OF_DATE_KHR)
+		{
+			RecreateSwapChain();
+			return; // nothing was acquired or submitted, the semaphore is still unsignalled and the slot's timeline value unchanged so it can be reused as is
+		}
+		else if (acquireNextImgRes != VK_SUCCESS && acquireNextImgRes != VK_SUBOPTIMAL_KHR)
+		{
+			throw std::runtime_error("Failed to acquire swap chain image.");
+		}
+
+		{
+			PROFILE_CPU_ZONE(m_profiler, "Record");
+			RecordFrameCommandBuffer(m_currentFrameSyncObjectIndex, imageIndex);
+		}
+
+		// submit the command buffer for the frame
+		SubmitFrame({ { m_imageAvailableSemaphones[m_currentFrameSyncObjectIndex], 0, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT } },
+			{ m_renderFinishedSemaphores[m_currentFrameSyncObjectIndex] });
+
+		// present the image final image
+		VkPresentInfoKHR presentInfo = {};
+		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+		presentInfo.waitSemaphoreCount = 1;
+		presentInfo.pWaitSemaphores = &m_renderFinishedSemaphores[m_currentFrameSyncObjectIndex];
+		presentInfo.swapchainCount = 1;
+		presentInfo.pImageIndices = &imageIndex;
+		presentInfo.pResults = nullptr;
+		presentInfo.swapchainCount = 1;
+		presentInfo.pSwapchains = &m_swapChain;
+		VkResult vkQueuePresentRes = VK_SUCCESS;
+		{
+			PROFILE_CPU_ZONE(m_profiler, "Present");
+			vkQueuePresentRes = vkQueuePresentKHR(m_presentQueue, &presentInfo);
+			m_framePacer.OnPresented();
+		}
+
+		if (vkQueuePresentRes == VK_ERROR_OUT_OF_DATE_KHR || vkQueuePresentRes == VK_SUBOPTIMAL_KHR || m_frameBufferResized)
+		{
+			m_frameBufferResized = false;
+			RecreateSwapChain();
+		}
+
+		++m_currentFrameSyncObjectIndex;
+		m_currentFrameSyncObjectIndex %= m_nFramesInFlight;
+	}
+
+	void DrawHeadless()
+	{
+		// same as Draw() minus the swap chain, images are handed out round robin and there's nothing to present
+		const uint64_t completedValue = WaitForFrameSlot();
+		m_deferredDestructionQueue.OnFrameCompleted(completedValue);
+		m_frameDataRing.BeginFrame(m_currentFrameSyncObjectIndex, completedValue);
+		m_profiler.BeginFrame(m_currentFrameSyncObjectIndex);
+		if (m_settings.m_streamAssets)
+		{
+			PROFILE_CPU_ZONE(m_profiler, "StreamingUploads");
+			m_assetStreamer.ProcessUploads();
+		}
+		m_uploadManager.Flush();
+
+		const uint32_t imageIndex = m_headlessImageIndex;
+		m_headlessImageIndex = (m_headlessImageIndex + 1) % static_cast<uint32_t>(m_swapChainImages.size());
+		// there are at least as many images as frames in flight, so the frame slot wait has already covered the image's last frame
+		ReadBackCompletedFrames(completedValue);
+		{
+			PROFILE_CPU_ZONE(m_profiler, "Record");
+			RecordFrameCommandBuffer(m_currentFrameSyncObjectIndex, imageIndex);
+		}
+
+		SubmitFrame({}, {});
+
+		if (m_settings.m_readbackFrames)
+		{
+			m_pendingReadbacks.push_back({ imageIndex, m_frameSlotTimelineValues[m_currentFrameSyncObjectIndex] });
+		}
+
+		++m_currentFrameSyncObjectIndex;
+		m_currentFrameSyncObjectIndex %= m_nFramesInFlight;
+	}
+
+	// waits until the graphics timeline reaches the value the slot's last frame signalled, returns the value it's known to have reached.
+	// One counter read per frame when the GPU's keeping up, nothing to reset
+	uint64_t WaitForFrameSlot()
+	{
+		PROFILE_CPU_ZONE(m_profiler, "WaitForFrameSlot");
+		uint64_t completedValue = m_graphicsQueue.GetCompletedValue();
+		// if everything submitted has already finished the GPU has nothing to do until this frame's submitted
+		if (completedValue >= m_graphicsQueue.GetLastSubmittedValue())
+		{
+			m_framePacer.OnGpuIdle();
+		}
+		const uint64_t slotValue = m_frameSlotTimelineValues[m_currentFrameSyncObjectIndex];
+		if (completedValue < slotValue)
+		{
+			const uint64_t waitStartNs = Profiler::NowNs();
+			m_graphicsQueue.WaitForValue(slotValue, m_getImageTimeOutNanoSeconds);
+			m_framePacer.AddCpuWait(Profiler::NowNs() - waitStartNs);
+			completedValue = slotValue;
+		}
+		return completedValue;
+	}
+
+	// the frame's primary command buffer, also waiting on any async compute work scheduled while it was recorded
+	void SubmitFrame(std::vector<GpuQueueWait>&& waits, const std::vector<VkSemaphore>& binarySignals)
+	{
+		PROFILE_CPU_ZONE(m_profiler, "Submit");
+		waits.insert(waits.end(), m_pendingGraphicsWaits.begin(), m_pendingGraphicsWaits.end());
+		m_pendingGraphicsWaits.clear();
+		m_frameDataRing.Flush();
+		const uint64_t timelineValue = m_graphicsQueue.Submit({ m_commandBuffers[m_currentFrameSyncObjectIndex] }, waits, binarySignals);
+		m_framePacer.OnSubmitted();
+		m_frameDataRing.OnFrameSubmitted(timelineValue);
+		m_frameSlotTimelineValues[m_currentFrameSyncObjectIndex] = timelineValue;
+		m_deferredDestructionQueue.OnFrameSubmitted(timelineValue);
+		m_profiler.OnFrameSubmitted();
+		++m_nFrameSubmits;
+	}
+
+	static void OnFrameBufferResizeCallback(GLFWwindow* window, int width, int height)
+	{
+		VulkanApp* appPtr = reinterpret_cast<VulkanApp*>(glfwGetWindowUserPointer(window));
+		appPtr->m_frameBufferResized = true;
+		appPtr->m_windowWidth = static_cast<uint32_t>(width);
+		appPtr->m_windowHeight = static_cast<uint32_t>(height);
+	}
+
+	void RecreateSwapChain()
+	{
+		int width = 0, height = 0;
+		while (width == 0 || height == 0)
+		{
+			glfwGetFramebufferSize(m_window, &width, &height);
+			glfwWaitEvents();
+		}
+		m_windowWidth = static_cast<uint32_t>(width);
+		m_windowHeight = static_cast<uint32_t>(height);
+
+		// only the extent changes so the render graph and pipeline stay, frames still in flight keep using the old swap chain's
+		// views and the graph's frame buffers made with them so those are handed to the deferred destruction queue rather than idling the device
+		VkSwapchainKHR oldSwapChain = m_swapChain;
+		std::vector<VkImageView> oldImageViews = std::move(m_swapChainImageViews);
+		const VkFormat oldImageFormat = m_swapChainImageFormat;
+		m_swapChainImageViews.clear();
+		m_renderGraph.OnImportedImagesChanged();
+
+		CreateSwapChain(oldSwapChain);
+		VkDevice device = m_vulkanLogicalDevice;
+		m_deferredDestructionQueue.Enqueue([device, oldSwapChain, oldImageViews]()
+		{
+			for (VkImageView imageView : oldImageViews)
+			{
+				vkDestroyImageView(device, imageView, nullptr);
+			}
+			vkDestroySwapchainKHR(device, oldSwapChain, nullptr);
+		});
+
+		if (m_swapChainImageFormat != oldImageFormat)
+		{
+			// the graph's render passes have to match the new format, shouldn't happen in practice so the slow path is fine
+			vkDeviceWaitIdle(m_vulkanLogicalDevice);
+			DestroyPipelines();
+			BuildRenderGraph(m_swapChainImageFormat);
+			CreateShaderModules();
+			CreateGraphicsPipeline();
+			if (m_gpuDrivenEnabled)
+			{
+				CreateGpuDrivenPipeline();
+			}
+		}
+
+		CreateImageViews();
+	}
+
+public:
+	// headless counterpart to RecreateSwapChain(), lets the benchmark run resize storms without a window
+	void ResizeOffscreenTargets(uint32_t width, uint32_t height)
+	{
+		if (!m_readbackBuffers.empty())
+		{
+			// pending read backs refer to the old images' buffers, drain them first, read back runs aren't about speed
+			vkDeviceWaitIdle(m_vulkanLogicalDevice);
+			ReadBackCompletedFrames(m_graphicsQueue.GetLastSubmittedValue());
+		}
+
+		m_windowWidth = (std::max)(width, 1u);
+		m_windowHeight = (std::max)(height, 1u);
+		std::vector<VkImage> oldImages = std::move(m_swapChainImages);
+		std::vector<DeviceAllocation> oldImageAllocations = std::move(m_offscreenImageAllocations);
+		std::vector<VkImageView> oldImageViews = std::move(m_swapChainImageViews);
+		std::vector<VkBuffer> oldReadbackBuffers = std::move(m_readbackBuffers);
+		std::vector<DeviceAllocation> oldReadbackAllocations = std::move(m_readbackBufferAllocations);
+		m_swapChainImages.clear();
+		m_offscreenImageAllocations.clear();
+		m_swapChainImageViews.clear();
+		m_readbackBuffers.clear();
+		m_readbackBufferAllocations.clear();
+		m_renderGraph.OnImportedImagesChanged();
+
+		CreateOffscreenTargets();
+		CreateImageViews();
+		m_headlessImageIndex = 0;
+
+		VkDevice device = m_vulkanLogicalDevice;
+		DeviceMemoryAllocator* allocator = &m_deviceMemoryAllocator;
+		m_deferredDestructionQueue.Enqueue([device, allocator, oldImages, oldImageAllocations, oldImageViews, oldReadbackBuffers, oldReadbackAllocations]() mutable
+		{
+			for (VkImageView imageView : oldImageViews)
+			{
+				vkDestroyImageView(device, imageView, nullptr);
+			}
+			for (size_t i = 0; i < oldImages.size(); ++i)
+			{
+				vkDestroyImage(device, oldImages[i], nullptr);
+				allocator->Free(oldImageAllocations[i]);
+			}
+			for (size_t i = 0; i < oldReadbackBuffers.size(); ++i)
+			{
+				vkDestroyBuffer(device, oldReadbackBuffers[i], nullptr);
+				allocator->Free(oldReadbackAllocations[i]);
+			}
+		});
+	}
+
+private:
+	void CleanupSwapChain()
+	{
+		for (size_t i = 0; i < m_swapChainImageViews.size(); ++i)
+		{
+			vkDestroyImageView(m_vulkanLogicalDevice, m_swapChainImageViews[i], nullptr);
+		}
+		m_swapChainImageViews.clear();
+		if (m_settings.m_headless)
+		{
+			DestroyOffscreenTargets();
+		}
+		else
+		{
+			vkDestroySwapchainKHR(m_vulkanLogicalDevice, m_swapChain, nullptr);
+			m_swapChain = nullptr;
+		}
+	}
+
+	void DestroyPipelines()
+	{
+		vkDestroyPipeline(m_vulkanLogicalDevice, m_pipeline, nullptr);
+		if (m_gpuDrivenPipeline)
+		{
+			vkDestroyPipeline(m_vulkanLogicalDevice, m_gpuDrivenPipeline, nullptr);
+			m_gpuDrivenPipeline = nullptr;
+		}
+		if (m_depthPrepassPipeline)
+		{
+			vkDestroyPipeline(m_vulkanLogicalDevice, m_depthPrepassPipeline, nullptr);
+			m_depthPrepassPipeline = nullptr;
+		}
+		if (m_gpuDrivenDepthPrepassPipeline)
+		{
+			vkDestroyPipeline(m_vulkanLogicalDevice, m_gpuDrivenDepthPrepassPipeline, nullptr);
+			m_gpuDrivenDepthPrepassPipeline = nullptr;
+		}
+		vkDestroyPipelineLayout(m_vulkanLogicalDevice, m_pipelineLayout, nullptr);
+		m_pipeline = nullptr;
+		m_pipelineLayout = nullptr;
+		if (m_vertexShaderModule)
+		{
+			vkDestroyShaderModule(m_vulkanLogicalDevice, m_vertexShaderModule, nullptr);
+			m_vertexShaderModule = nullptr;
+		}
+		if (m_fragmentShaderModule)
+		{
+			vkDestroyShaderModule(m_vulkanLogicalDevice, m_fragmentShaderModule, nullptr);
+			m_fragmentShaderModule = nullptr;
+		}
+		if (m_bindlessFragmentShaderModule)
+		{
+			vkDestroyShaderModule(m_vulkanLogicalDevice, m_bindlessFragmentShaderModule, nullptr);
+			m_bindlessFragmentShaderModule = nullptr;
+		}
+		if (m_gpuDrivenVertexShaderModule)
+		{
+			vkDestroyShaderModule(m_vulkanLogicalDevice, m_gpuDrivenVertexShaderModule, nullptr);
+			m_gpuDrivenVertexShaderModule = nullptr;
+		}
+		if (m_depthOnlyVertexShaderModule)
+		{
+			vkDestroyShaderModule(m_vulkanLogicalDevice, m_depthOnlyVertexShaderModule, nullptr);
+			m_depthOnlyVertexShaderModule = nullptr;
+		}
+		if (m_gpuDrivenDepthOnlyVertexShaderModule)
+		{
+			vkDestroyShaderModule(m_vulkanLogicalDevice, m_gpuDrivenDepthOnlyVertexShaderModule, nullptr);
+			m_gpuDrivenDepthOnlyVertexShaderModule = nullptr;
+		}
+	}
+
+public:
+	void Shutdown()
+	{
+		m_assetStreamer.Shutdown();
+		if (m_profiler.IsEnabled() && !m_settings.m_profileOutputPath.empty())
+		{
+			m_profiler.CollectAll(); // the main loop idled the device, the last frames' timestamps are ready
+			m_profiler.Export(m_settings.m_profileOutputPath);
+		}
+		m_profiler.Shutdown();
+		m_uploadManager.Shutdown();
+		m_deferredDestructionQueue.DestroyAll(); // the main loop idled the device on the way out
+		m_renderGraph.Shutdown(); // its frame buffers use the swap chain's views
+		CleanupSwapChain();
+		DestroyPipelines();
+		m_gpuDrivenRenderer.Shutdown();
+		m_frameDataRing.Shutdown();
+		if (m_materialBuffer)
+		{
+			m_bindlessResources.RemoveStorageBuffer(m_materialBufferHandle);
+			vkDestroyBuffer(m_vulkanLogicalDevice, m_materialBuffer, nullptr);
+			m_deviceMemoryAllocator.Free(m_materialBufferAllocation);
+			m_materialBuffer = nullptr;
+			m_materialBufferHandle = BindlessResourceTable::S_INVALID_HANDLE;
+		}
+		m_bindlessResources.Shutdown();
+		m_geometryBuffers.Shutdown();
+		m_assetPackage.Close();
+		if (m_imageAvailableSemaphones.size() > 0 || m_renderFinishedSemaphores.size() > 0)
+		{
+			for (size_t i = 0; i < m_nFramesInFlight; ++i)
+			{
+				vkDestroySemaphore(m_vulkanLogicalDevice, m_imageAvailableSemaphones[i], nullptr);
+				vkDestroySemaphore(m_vulkanLogicalDevice, m_renderFinishedSemaphores[i], nullptr);
+			}
+		}
+		m_commandRecorder.Shutdown();
+		for (VkCommandPool commandPool : m_frameCommandPools)
+		{
+			vkDestroyCommandPool(m_vulkanLogicalDevice, commandPool, nullptr);
+		}
+		m_computeQueue.Shutdown();
+		m_transferQueue.Shutdown();
+		m_graphicsQueue.Shutdown();
+		if (m_useVulkanValidationLayers)
+		{
+			DestroyDebugUtilsMessengerEXT(m_vulkanInstance, m_vulkanDebugMessenger, nullptr);
+		}
+		if (m_vulkanLogicalDevice)
+		{
+			m_pipelineCache.Save();
+			m_pipelineCache.Shutdown();
+			m_deviceMemoryAllocator.Shutdown();
+			vkDestroyDevice(m_vulkanLogicalDevice, nullptr); // note that this also deletes the graphics queue
+		}
+		if (m_surfaceToDrawTo)
+		{
+			vkDestroySurfaceKHR(m_vulkanInstance, m_surfaceToDrawTo, nullptr);
+		}
+		vkDestroyInstance(m_vulkanInstance, nullptr);
+		if (m_window)
+		{
+			glfwDestroyWindow(m_window);
+			glfwTerminate();
+			m_window = nullptr;
+		}
+		m_jobSystem.Shutdown();
+	}
+
+private:
+
+	// Debug functions
+	VkResult CreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pDebugMessenger) {
+		auto func = (PFN_vkCreateDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkCreateDebugUtilsMessengerEXT");
+		if (func != nullptr) {
+			return func(instance, pCreateInfo, pAllocator, pDebugMessenger);
+		}
+		else {
+			return VK_ERROR_EXTENSION_NOT_PRESENT;
+		}
+	}
+
+	static VKAPI_ATTR VkBool32 VKAPI_CALL VulkanDebugCallback(
+    VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
+    VkDebugUtilsMessageTypeFlagsEXT messageType,
+    const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData,
+    void* pUserData) 
+	{
+		if (messageSeverity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)
+		{
+			// std::cout << ?
+		}
+	    std::cerr << "validation layer: " << pCallbackData->pMessage << std::endl;
+
+	    return VK_FALSE;
+	}
+
+	void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT debugMessenger, const VkAllocationCallbacks* pAllocator) 
+	{
+		auto func = (PFN_vkDestroyDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkDestroyDebugUtilsMessengerEXT");
+		if (func != nullptr)
+		{
+			func(instance, debugMessenger, pAllocator);
+		}
+	}
+	// end of debug functions
+
+	const VulkanAppSettings m_settings;
+	uint32_t m_windowWidth;
+	uint32_t m_windowHeight;
+	GLFWwindow* m_window;
+	VkInstance m_vulkanInstance;
+	VkPhysicalDevice m_vulkanPhysicalDevice; //note that this gets deleted when destroying m_vulkanInstance
+	VkDevice m_vulkanLogicalDevice;
+	GpuQueue m_graphicsQueue;
+	GpuQueue m_transferQueue; // only valid with a dedicated transfer family, see GetUploadQueue()
+	GpuQueue m_computeQueue; // only valid with async compute
+	std::vector<GpuQueueWait> m_pendingGraphicsWaits; // compute work the next frame submit has to wait for
+	QueueFamilyIndices m_graphicsQueueFamilyIndices;
+	VkDebugUtilsMessengerEXT m_vulkanDebugMessenger;
+	const bool m_useVulkanValidationLayers;
+
+	// window surface creation variables
+	VkSurfaceKHR m_surfaceToDrawTo;
+	VkQueue m_presentQueue;
+	
+	// swap chain variables, note need the enable to extensions
+	VkSwapchainKHR m_swapChain;
+	std::vector<VkImage> m_swapChainImages;
+	VkFormat m_swapChainImageFormat;
+	VkExtent2D m_swapChainExtent;
+	static constexpr VkFormat S_OFFSCREEN_IMAGE_FORMAT = VK_FORMAT_R8G8B8A8_UNORM; // what the readback expects
+	std::vector<VkImageView> m_swapChainImageViews;
+
+	VkShaderModule m_vertexShaderModule;
+	VkShaderModule m_fragmentShaderModule;
+	VkShaderModule m_bindlessFragmentShaderModule; // only with the bindless table, the CPU draws' pipeline uses it in place of the default one
+	VkShaderModule m_gpuDrivenVertexShaderModule;
+	VkShaderModule m_depthOnlyVertexShaderModule; // only with the depth pre-pass, as are the gpu driven one and the pipelines
+	VkShaderModule m_gpuDrivenDepthOnlyVertexShaderModule;
+
+	VkPipeline m_pipeline;
+	VkPipelineLayout m_pipelineLayout;
+	VkPipeline m_depthPrepassPipeline; // shares m_pipelineLayout
+	VkFormat m_depthFormat;
+	// the frame's passes, the render passes and frame buffers are the graph's
+	RenderGraph m_renderGraph;
+	RenderGraph::ResourceId m_backBuffer; // the swap chain or offscreen image being drawn to, imported each frame
+	RenderGraph::ResourceId m_depthBuffer; // transient, the graph makes it at the back buffer's size
+	RenderGraph::PassId m_depthPrepass; // S_INVALID_ID without the depth pre-pass
+	RenderGraph::PassId m_scenePass;
+	size_t m_recordingFrameSlot; // what the graph's passes are being recorded for
+	uint32_t m_recordingImageIndex;
+
+	DeviceMemoryAllocator m_deviceMemoryAllocator;
+	PipelineCache m_pipelineCache;
+	UploadManager m_uploadManager;
+	Profiler m_profiler;
+	bool m_calibratedTimestampsEnabled;
+
+	// all the meshes share these, drawn either a draw call per item from the CPU or through m_gpuDrivenRenderer
+	GeometryBuffers m_geometryBuffers;
+	GpuDrivenRenderer m_gpuDrivenRenderer;
+	FrameDataRing m_frameDataRing; // per frame uniform and storage data, the CPU draws' constants
+	uint32_t m_frameConstantsOffset; // this frame's FrameConstants in m_frameDataRing
+	BindlessResourceTable m_bindlessResources;
+	bool m_bindlessEnabled; // asked for and the device supports update after bind descriptor indexing
+	VkBuffer m_materialBuffer; // the scene's MaterialData, only with the bindless table
+	DeviceAllocation m_materialBufferAllocation;
+	uint32_t m_materialBufferHandle; // its storage buffer handle in m_bindlessResources
+	bool m_gpuDrivenEnabled; // asked for and supported by the device
+	bool m_asyncComputeEnabled; // the cull runs on m_computeQueue and the frame's graphics submit waits for it
+	VkPipeline m_gpuDrivenPipeline;
+	VkPipeline m_gpuDrivenDepthPrepassPipeline;
+	PFN_vkCmdDrawIndexedIndirectCountKHR m_drawIndexedIndirectCount; // null without VK_KHR_draw_indirect_count
+	uint32_t m_sceneMeshHandle; // the placeholder while streaming
+	AssetPackage m_assetPackage; // mapped for the app's lifetime, pipelines get rebuilt from its shaders on resize
+	AssetStreamer m_assetStreamer; // after m_assetPackage, its I/O threads read from the mapping
+	uint32_t m_streamedSceneMeshHandle; // set before the streamer says it's resident
+	static constexpr uint32_t S_SCENE_MESH_ASSET_ID = 0;
+	static constexpr uint32_t S_STREAMED_ASSET_COUNT = 1;
+	static constexpr const char* S_SCENE_MESH_ASSET_NAME = "SceneMesh";
+	static constexpr const char* S_FRAGMENT_SHADER_PATH = "Shaders/DefaultFrag.spv";
+	static constexpr const char* S_BINDLESS_FRAGMENT_SHADER_PATH = "Shaders/DefaultBindlessFrag.spv";
+	static constexpr uint32_t S_SCENE_MATERIAL_COUNT = 4; // the scene's entities take turns
+	static constexpr const char* S_CULL_SHADER_PATH = "Shaders/CullInstancesComp.spv";
+
+	// use these to "send drawing commands", primaries per frame in flight with the draws themselves in secondaries from m_commandRecorder
+	std::vector<VkCommandPool> m_frameCommandPools;
+	std::vector<VkCommandBuffer> m_commandBuffers;
+	ParallelCommandRecorder m_commandRecorder;
+
+	JobSystem m_jobSystem;
+	EntityStore m_sceneEntities; // only Update() touches it once the scene is built, along with the culling state below
+	CullingBounds m_cullingBounds;
+	std::vector<uint32_t> m_instanceMeshHandles; // alongside m_cullingBounds
+	std::vector<uint32_t> m_instanceMaterials; // alongside m_cullingBounds too
+	std::vector<uint32_t> m_depthOrder; // entity indices front to back, m_cullingBounds and so the draws are kept in this order
+	std::vector<uint32_t> m_depthRank; // each entity's place in m_depthOrder, where Update() writes its bounds
+	FrustumCuller m_frustumCuller;
+	double m_sceneTimeSeconds;
+	static constexpr size_t S_MIN_DRAW_ITEM_BATCH_SIZE = 4096;
+	static constexpr size_t S_MAX_DRAWS_PER_FRAME_DATA_BIND = FrameDataRing::S_STORAGE_RANGE / sizeof(DrawConstants);
+	// the draw state is double buffered, Update() writes one while the frame being drawn reads the other
+	std::array<FrameDrawState, 2> m_drawStates;
+	size_t m_currentDrawState;
+	static constexpr float S_HEADLESS_FRAME_DELTA_SECONDS = 1.0f / 60.0f;
+
+	// VkSemaphore m_imageReadyToDrawToSemaphore;
+	// VkSemaphore m_finishedDrawingSemaphore;
+
+	uint64_t m_getImageTimeOutNanoSeconds; // refactor name
+	const size_t m_nFramesInFlight; // from the settings, clamped to what FramePacer allows
+	FramePacer m_framePacer;
+	std::vector<VkSemaphore> m_imageAvailableSemaphones;
+	std::vector<VkSemaphore> m_renderFinishedSemaphores;
+	std::vector<uint64_t> m_frameSlotTimelineValues; // graphics timeline value each frame slot's last submit signals, the slot's free again once it's reached
+	DeferredDestructionQueue m_deferredDestructionQueue;
+
+	size_t m_currentFrameSyncObjectIndex;
+	bool m_frameBufferResized;
+	uint64_t m_nFrameSubmits;
+	uint64_t m_initStartNs;
+	double m_initMs;
+	double m_timeToFirstFrameMs;
+
+	// headless rendering, the offscreen images themselves live in m_swapChainImages
+	std::vector<DeviceAllocation> m_offscreenImageAllocations;
+	uint32_t m_headlessImageIndex;
+	std::vector<VkBuffer> m_readbackBuffers;
+	std::vector<DeviceAllocation> m_readbackBufferAllocations;
+	struct PendingReadback
+	{
+		size_t m_imageIndex;
+		uint64_t m_timelineValue; // graphics timeline value the frame that rendered it signals
+	};
+	std::deque<PendingReadback> m_pendingReadbacks; // in submit order
+	std::vector<uint8_t> m_readbackFrame; // most recent frame read back, R8G8B8A8
+	uint64_t m_nReadbackFrames;
+
+};
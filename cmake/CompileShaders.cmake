@@ -0,0 +1,63 @@
+# Compiles every shader in Shaders/ to SPIR-V at build time (glslc, then spirv-opt when it's around) and embeds the results in the
+# executables as constexpr uint32_t arrays, see SourceCode/EmbeddedShaders.h. Without glslc the shaders are loaded from the
+# pre-built Shaders/*.spv at runtime like before.
+
+find_program(GLSLC_EXECUTABLE glslc HINTS $ENV{VULKAN_SDK}/Bin $ENV{VULKAN_SDK}/bin)
+find_program(SPIRV_OPT_EXECUTABLE spirv-opt HINTS $ENV{VULKAN_SDK}/Bin $ENV{VULKAN_SDK}/bin)
+
+set(ShaderSourceDir ${CMAKE_SOURCE_DIR}/Shaders)
+set(GeneratedShaderDir ${CMAKE_BINARY_DIR}/GeneratedShaders)
+file(GLOB ShaderSources ${ShaderSourceDir}/*.vert ${ShaderSourceDir}/*.frag ${ShaderSourceDir}/*.comp)
+
+if(GLSLC_EXECUTABLE)
+	set(EmbeddedShaderHeaders)
+	set(EMBEDDED_SHADER_INCLUDES "")
+	set(EMBEDDED_SHADER_ENTRIES "")
+	foreach(ShaderSource ${ShaderSources})
+		# Default.vert -> DefaultVert, the same names Compile_To_SPIR-V.bat gives the .spv files
+		get_filename_component(ShaderName ${ShaderSource} NAME_WE)
+		get_filename_component(ShaderExtension ${ShaderSource} EXT)
+		string(SUBSTRING ${ShaderExtension} 1 1 ExtensionFirstLetter)
+		string(SUBSTRING ${ShaderExtension} 2 -1 ExtensionRest)
+		string(TOUPPER ${ExtensionFirstLetter} ExtensionFirstLetter)
+		set(SpirvName ${ShaderName}${ExtensionFirstLetter}${ExtensionRest})
+
+		set(SpirvFile ${GeneratedShaderDir}/${SpirvName}.spv)
+		set(EmbeddedSpirvFile ${SpirvFile})
+		set(OptimiseCommand)
+		if(SPIRV_OPT_EXECUTABLE)
+			set(EmbeddedSpirvFile ${GeneratedShaderDir}/${SpirvName}.opt.spv)
+			set(OptimiseCommand COMMAND ${SPIRV_OPT_EXECUTABLE} -O ${SpirvFile} -o ${EmbeddedSpirvFile})
+		endif()
+		set(HeaderFile ${GeneratedShaderDir}/${SpirvName}.spv.h)
+
+		add_custom_command(
+			OUTPUT ${HeaderFile}
+			COMMAND ${CMAKE_COMMAND} -E make_directory ${GeneratedShaderDir}
+			COMMAND ${GLSLC_EXECUTABLE} -O ${ShaderSource} -o ${SpirvFile}
+			${OptimiseCommand}
+			COMMAND ${CMAKE_COMMAND} -DINPUT=${EmbeddedSpirvFile} -DOUTPUT=${HeaderFile} -DSYMBOL=S_EMBEDDED_${SpirvName} -P ${CMAKE_SOURCE_DIR}/cmake/EmbedSpirv.cmake
+			DEPENDS ${ShaderSource} ${CMAKE_SOURCE_DIR}/cmake/EmbedSpirv.cmake
+			COMMENT "Compiling ${ShaderName}${ShaderExtension} to SPIR-V"
+			VERBATIM)
+
+		list(APPEND EmbeddedShaderHeaders ${HeaderFile})
+		string(APPEND EMBEDDED_SHADER_INCLUDES "#include \"${SpirvName}.spv.h\"\n")
+		string(APPEND EMBEDDED_SHADER_ENTRIES "\t{ \"Shaders/${SpirvName}.spv\", S_EMBEDDED_${SpirvName}, sizeof(S_EMBEDDED_${SpirvName}) },\n")
+	endforeach()
+
+	configure_file(${CMAKE_SOURCE_DIR}/cmake/EmbeddedShaderTable.inc.in ${GeneratedShaderDir}/EmbeddedShaderTable.inc @ONLY)
+	add_custom_target(VulkanEngineShaders DEPENDS ${EmbeddedShaderHeaders})
+	message("Shaders compiled with ${GLSLC_EXECUTABLE} and embedded, spirv-opt: ${SPIRV_OPT_EXECUTABLE}")
+else()
+	message(WARNING "glslc not found, shaders will be loaded from the pre-built Shaders/*.spv at runtime")
+endif()
+
+# for each executable that draws with these shaders
+function(vulkan_engine_use_shaders Target)
+	if(TARGET VulkanEngineShaders)
+		add_dependencies(${Target} VulkanEngineShaders)
+		target_include_directories(${Target} PRIVATE ${GeneratedShaderDir})
+		target_compile_definitions(${Target} PRIVATE VULKAN_ENGINE_EMBEDDED_SHADERS)
+	endif()
+endfunction()
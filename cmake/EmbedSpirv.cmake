@@ -0,0 +1,14 @@
+# cmake -DINPUT=Shader.spv -DOUTPUT=Shader.spv.h -DSYMBOL=S_EMBEDDED_Shader -P EmbedSpirv.cmake
+# writes the SPIR-V out as a constexpr array of little endian 32 bit words, which is what VkShaderModuleCreateInfo wants
+
+file(READ ${INPUT} SpirvHex HEX)
+string(LENGTH "${SpirvHex}" SpirvHexLength)
+math(EXPR SpirvRemainder "${SpirvHexLength} % 8")
+if(SpirvHexLength EQUAL 0 OR NOT SpirvRemainder EQUAL 0)
+	message(FATAL_ERROR "${INPUT} isn't SPIR-V, it's empty or not a whole number of 32 bit words")
+endif()
+
+string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1u, " SpirvWords "${SpirvHex}")
+string(REGEX REPLACE "((0x[0-9a-f]+u, )(0x[0-9a-f]+u, )(0x[0-9a-f]+u, )(0x[0-9a-f]+u, )(0x[0-9a-f]+u, )(0x[0-9a-f]+u, )(0x[0-9a-f]+u, )(0x[0-9a-f]+u, ))" "\\1\n\t" SpirvWords "${SpirvWords}")
+
+file(WRITE ${OUTPUT} "// generated from ${INPUT} by cmake/EmbedSpirv.cmake, don't edit\n#pragma once\n\n#include <cstdint>\n\nalignas(4) static constexpr uint32_t ${SYMBOL}[] =\n{\n\t${SpirvWords}\n};\n")